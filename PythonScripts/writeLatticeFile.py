@@ -515,6 +515,52 @@ bN = [-12, 1, 2]
 
 #-------------------------------------------------------------
 
+# #Number of dimensions
+# nD = 3
+# #Number of lattice directions
+# nQ = 27
+
+# #Number of lattice pairs
+# nDirPairs = 13
+# #Number of lattice directions pointing to neighbors
+# nQNonZero = 26
+
+# # 1st lattice constant
+# c2Inv = 3.0
+# # 2nd lattice constant
+# c4Inv = 9.0
+
+# # weight fractions:
+# # weight denominator
+# wGcd = 216
+# #weight numerator
+# #Order: rest, lenght 1, lenght 2,...
+# wN = [64, 16, 4, 1]
+
+# #Lattice vectors:
+# vec = []
+# #x-component
+# vecDimX = [1, 0, 0, 1, 1, 1, 1, 0, 0, 1, 1, 1, 1, -1, 0, 0, -1, -1, -1, -1, 0, 0, -1, -1, -1, -1, 0]
+# vec.append(vecDimX)
+# #y-component
+# vecDimY = [0, 1, 0, 1, -1, 0, 0, 1, 1, 1, 1, -1, -1, 0, -1, 0, -1, 1, 0, 0, -1, -1, -1, -1, 1, 1, 0]
+# vec.append(vecDimY)
+# #z-component
+# vecDimZ = [0, 0, 1, 0, 0, 1, -1, 1, -1, 1, -1, 1, -1, 0, 0, -1, 0, 0, -1, 1, -1, 1, -1, 1, -1, 1, 0]
+# vec.append(vecDimZ)
+
+
+# // Two phase values
+# B weights used in surface tension. Same construction as for D2Q9 and D3Q19,
+# B = w*(|c|^2 - (nD-1)/3).
+#fractions:
+# denominator
+# bGcd = 648
+#numerator
+# bN = [-128, 16, 16, 7]
+
+#-------------------------------------------------------------
+
 # WRITE_FILE_HEADER
 file_path = "/home/AD.NORCERESEARCH.NO/esje/Programs/GitHub/BADCHiMP/PythonScripts/"
 f=open(file_path + "LBd{0:d}q{1:d}.h".format(nD, nQ),"w+")
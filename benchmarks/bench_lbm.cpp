@@ -0,0 +1,253 @@
+// //////////////////////////////////////////////
+//
+// BADChIMP library benchmark
+//
+// Measures MLUPS (million fluid node updates per
+// second) of the library collide-stream path, with
+// the time split into the phases
+//    collision : collision, propagation and swap
+//    boundary  : half way bounce back
+//    halo      : mpi communication
+//    output    : vtk output
+// The times are the maximum over the ranks, and the
+// MLUPS do not include the output.
+//
+// The geometries, a channel along x with walls normal
+// to y and random spheres for porosities below 1, are
+// generated in memory by GeometryGenerator, so no
+// input files are needed.
+//
+// Usage (all options are optional):
+//    mpirun -np 2 bench_lbm --lattice D2Q9 D3Q19 --collision bgk trt mrt cm cumulant
+//        --fields 1 2 --porosity 1.0 0.8 0.6 --steps 200
+//        --size2d 250 102 --size3d 64 66 64 --write 200 --storage double
+// --write is the output interval (0: no output).
+// --storage is the LbField storage type, double or float
+// (LbField<LT, float>, see LBfield.h).
+// mrt, cm (central moment) and cumulant are the
+// moment space operators of LBcollisionmoment.h, with
+// the bulk relaxation time equal to tau and the ghost
+// relaxation time 1.
+// Compare with bench_mainfast, the hand-tuned D2Q9
+// reference, on the same 250 x 100 channel.
+//
+// //////////////////////////////////////////////
+
+#include <LBSOLVER.h>
+#include <IO.h>
+#include <cstdio>
+#include <map>
+#include <memory>
+
+struct BenchCase
+{
+    std::string collision;
+    int nFields;
+    lbBase_t porosity;
+};
+
+struct BenchResult
+{
+    long numNodes;  // Fluid nodes on all ranks
+    double time[5];  // Collision, boundary, halo, output, total without output
+};
+
+
+template <typename LT, typename S>
+BenchResult runCase(const BenchCase &bc, const std::vector<int> &size, const int nSteps, const int nItrWrite, const int myRank, const int nProcs)
+{
+    // Geometry
+    GeometryGenerator<LT> generator(size);
+    generator.addWalls(1);
+    if (bc.porosity < 1)
+        generator.addSpheres(bc.porosity, std::max(2, size[1]/10), 1234);
+    LBvtk<LT> vtklb(std::istringstream(generator.vtklb(myRank, nProcs)));
+    Grid<LT> grid(vtklb);
+    Nodes<LT> nodes(vtklb, grid);
+    BndMpi<LT> mpiBoundary(vtklb, nodes, grid);
+    std::vector<int> bulkNodes = findBulkNodes(nodes);
+    HalfWayBounceBack<LT> bounceBackBnd(findFluidBndNodes(nodes), nodes, grid);
+
+    // Fluid, TRT with the magic parameter 3/16
+    const lbBase_t tau = 0.8;
+    const lbBase_t tauAnti = 0.5 + 3.0/(16*(tau - 0.5));
+    const bool trt = (bc.collision == "trt");
+    const lbBase_t tauGhost = 1.0;
+    MRTCollision<LT> mrt(tau, tauGhost);
+    CentralMomentCollision<LT> centralMoment(tau, tauGhost);
+    CumulantCollision<LT> cumulant(tau, tauGhost);
+    const int moment = (bc.collision == "mrt") ? 1 : ( (bc.collision == "cm") ? 2 : ( (bc.collision == "cumulant") ? 3 : 0 ) );
+    VectorField<LT> bodyForce(1, 1);
+    for (int d = 0; d < LT::nD; ++d)
+        bodyForce(0, d, 0) = 0.0;
+    bodyForce(0, 0, 0) = 1.0e-6;
+
+    ScalarField rho(bc.nFields, grid.size());
+    VectorField<LT> vel(bc.nFields, grid.size());
+    LbField<LT, S> f(bc.nFields, grid.size());
+    LbField<LT, S> fTmp(bc.nFields, grid.size());
+    for (auto nodeNo: bulkNodes)
+        for (int fieldNo = 0; fieldNo < bc.nFields; ++fieldNo)
+            for (int q = 0; q < LT::nQ; ++q)
+                f(fieldNo, q, nodeNo) = LT::w[q];
+
+    std::unique_ptr<Output<LT>> output;
+    if (nItrWrite > 0) {
+        output = std::make_unique<Output<LT>>(grid, bulkNodes, "bench_output/", myRank, nProcs);
+        output->add_file("bench");
+        output->add_scalar_variables({"rho"}, {rho});
+        output->add_vector_variables({"vel"}, {vel});
+    }
+
+    BenchResult ret;
+    double time[5] = {0, 0, 0, 0, 0};
+    MPI_Barrier(MPI_COMM_WORLD);
+    const double tStart = MPI_Wtime();
+    for (int i = 1; i <= nSteps; ++i) {
+        double t0 = MPI_Wtime();
+        for (auto nodeNo: bulkNodes) {
+            for (int fieldNo = 0; fieldNo < bc.nFields; ++fieldNo) {
+                const std::valarray<lbBase_t> fNode = f(fieldNo, nodeNo);
+                const lbBase_t rhoNode = calcRho<LT>(fNode);
+                const auto velNode = calcVel<LT>(fNode, rhoNode, bodyForce(0, 0));
+                rho(fieldNo, nodeNo) = rhoNode;
+                vel.set(fieldNo, nodeNo) = velNode;
+
+                if (moment == 1) {
+                    fTmp.propagateTo(fieldNo, nodeNo, mrt.collide(fNode, tau, rhoNode, velNode, bodyForce(0, 0)), grid);
+                } else if (moment == 2) {
+                    fTmp.propagateTo(fieldNo, nodeNo, centralMoment.collide(fNode, tau, rhoNode, velNode, bodyForce(0, 0)), grid);
+                } else if (moment == 3) {
+                    fTmp.propagateTo(fieldNo, nodeNo, cumulant.collide(fNode, tau, rhoNode, velNode, bodyForce(0, 0)), grid);
+                } else {
+                    const lbBase_t u2 = LT::dot(velNode, velNode);
+                    const std::valarray<lbBase_t> cu = LT::cDotAll(velNode);
+                    const lbBase_t uF = LT::dot(velNode, bodyForce(0, 0));
+                    const std::valarray<lbBase_t> cF = LT::cDotAll(bodyForce(0, 0));
+                    if (trt) {
+                        const std::valarray<lbBase_t> omega = calcOmegaBGKTRT<LT>(fNode, tau, tauAnti, rhoNode, u2, cu);
+                        const std::valarray<lbBase_t> deltaOmegaF = calcDeltaOmegaFTRT<LT>(tau, tauAnti, 1.0, cu, uF, cF);
+                        fTmp.propagateTo(fieldNo, nodeNo, fNode + omega + deltaOmegaF, grid);
+                    } else {
+                        const std::valarray<lbBase_t> omega = calcOmegaBGK<LT>(fNode, tau, rhoNode, u2, cu);
+                        const std::valarray<lbBase_t> deltaOmegaF = calcDeltaOmegaF<LT>(tau, cu, uF, cF);
+                        fTmp.propagateTo(fieldNo, nodeNo, fNode + omega + deltaOmegaF, grid);
+                    }
+                }
+            }
+        }
+        f.swapData(fTmp);
+        double t1 = MPI_Wtime();
+        mpiBoundary.communicateLbField(f, grid);
+        double t2 = MPI_Wtime();
+        bounceBackBnd.apply(f, grid);
+        double t3 = MPI_Wtime();
+        if ( output && (i % nItrWrite == 0) )
+            output->write(i);
+        double t4 = MPI_Wtime();
+        time[0] += t1 - t0;
+        time[2] += t2 - t1;
+        time[1] += t3 - t2;
+        time[3] += t4 - t3;
+    }
+    time[4] = MPI_Wtime() - tStart - time[3];
+
+    MPI_Reduce(time, ret.time, 5, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+    long numLocal = bulkNodes.size();
+    MPI_Reduce(&numLocal, &ret.numNodes, 1, MPI_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+    return ret;
+}
+
+
+int main(int argc, char *argv[])
+{
+    MPI_Init(&argc, &argv);
+    int nProcs;
+    MPI_Comm_size(MPI_COMM_WORLD, &nProcs);
+    int myRank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &myRank);
+
+    // Options, with the values following each option name
+    std::map<std::string, std::vector<std::string>> opt = {
+        {"--lattice", {"D2Q9", "D3Q19"}}, {"--collision", {"bgk", "trt", "mrt", "cm", "cumulant"}}, {"--fields", {"1", "2"}},
+        {"--porosity", {"1.0", "0.8", "0.6"}}, {"--steps", {"200"}}, {"--size2d", {"250", "102"}},
+        {"--size3d", {"64", "66", "64"}}, {"--write", {}}, {"--storage", {"double"}}};
+    std::string key;
+    for (int a = 1; a < argc; ++a) {
+        const std::string arg = argv[a];
+        if (arg.compare(0, 2, "--") == 0) {
+            if (opt.count(arg) == 0) {
+                if (myRank == 0)
+                    std::cout << "ERROR in bench_lbm: unknown option " << arg << std::endl;
+                MPI_Finalize();
+                return 1;
+            }
+            key = arg;
+            opt[key].clear();
+        } else if (!key.empty()) {
+            opt[key].push_back(arg);
+        }
+    }
+    auto toInts = [](const std::vector<std::string> &v) {
+        std::vector<int> ret;
+        for (const auto &s: v)
+            ret.push_back(std::stoi(s));
+        return ret;
+    };
+    const int nSteps = std::stoi(opt["--steps"][0]);
+    const int nItrWrite = opt["--write"].empty() ? nSteps : std::stoi(opt["--write"][0]);
+
+    if (myRank == 0) {
+        std::cout << "BADChIMP library benchmark, " << nProcs << " rank(s), " << nSteps << " steps" << std::endl;
+        std::printf("%-7s %-7s %-8s %6s %8s %10s %9s %10s %10s %10s %10s\n",
+                    "lattice", "storage", "coll", "fields", "porosity", "nodes", "MLUPS", "collision", "boundary", "halo", "output");
+    }
+    for (const auto &lattice: opt["--lattice"]) {
+        for (const auto &storage: opt["--storage"]) {
+            for (const auto &collision: opt["--collision"]) {
+                for (const auto &nFields: toInts(opt["--fields"])) {
+                    for (const auto &porosity: opt["--porosity"]) {
+                        if ( (collision != "bgk") && (collision != "trt") && (collision != "mrt") && (collision != "cm") && (collision != "cumulant") ) {
+                            if (myRank == 0)
+                                std::cout << "ERROR in bench_lbm: unknown collision " << collision << ". Use bgk, trt, mrt, cm or cumulant" << std::endl;
+                            MPI_Finalize();
+                            return 1;
+                        }
+                        if ( (storage != "double") && (storage != "float") ) {
+                            if (myRank == 0)
+                                std::cout << "ERROR in bench_lbm: unknown storage " << storage << ". Use double or float" << std::endl;
+                            MPI_Finalize();
+                            return 1;
+                        }
+                        const BenchCase bc = {collision, nFields, std::stod(porosity)};
+                        const bool single = (storage == "float");
+                        BenchResult res;
+                        if (lattice == "D2Q9") {
+                            if (single)
+                                res = runCase<D2Q9, float>(bc, toInts(opt["--size2d"]), nSteps, nItrWrite, myRank, nProcs);
+                            else
+                                res = runCase<D2Q9, lbBase_t>(bc, toInts(opt["--size2d"]), nSteps, nItrWrite, myRank, nProcs);
+                        } else if (lattice == "D3Q19") {
+                            if (single)
+                                res = runCase<D3Q19, float>(bc, toInts(opt["--size3d"]), nSteps, nItrWrite, myRank, nProcs);
+                            else
+                                res = runCase<D3Q19, lbBase_t>(bc, toInts(opt["--size3d"]), nSteps, nItrWrite, myRank, nProcs);
+                        } else {
+                            if (myRank == 0)
+                                std::cout << "ERROR in bench_lbm: unknown lattice " << lattice << ". Use D2Q9 or D3Q19" << std::endl;
+                            MPI_Finalize();
+                            return 1;
+                        }
+                        if (myRank == 0)
+                            std::printf("%-7s %-7s %-8s %6d %8.2f %10ld %9.3f %10.4f %10.4f %10.4f %10.4f\n",
+                                        lattice.c_str(), storage.c_str(), collision.c_str(), nFields, bc.porosity, res.numNodes,
+                                        1e-6*res.numNodes*nSteps/res.time[4], res.time[0], res.time[1], res.time[2], res.time[3]);
+                    }
+                }
+            }
+        }
+    }
+
+    MPI_Finalize();
+    return 0;
+}
@@ -57,8 +57,7 @@ int main()
     lbBase_t tau = input["fluid"]["viscosity"]*LT::c2Inv + 0.5;
     // Body force
     VectorField<LT> bodyForceInit(1, 1);
-    // bodyForceInit.set(0, 0) = inputAsValarray<lbBase_t>(input["fluid"]["bodyforce"]);
-    bodyForceInit.set(0, 0) = input["fluid"]["bodyforce"];
+    bodyForceInit.set(0, 0) = inputAsValarray<lbBase_t>(input["fluid"]["bodyforce"]);
 
     lbBase_t const momXInit = input["fluid"]["momx"];
     // std::string dirNum = std::to_string(static_cast<int>(input["out"]["directoryNum"]));
@@ -121,6 +120,12 @@ int main()
     // ******************
     HalfWayBounceBack<LT> bounceBackBnd(findFluidBndNodes(nodes), nodes, grid);
 
+    // ******************
+    // TRACER ACTIVE SET
+    // ******************
+    // Skips the tracer where it is below the threshold (optional <activeset> block)
+    ActiveSet<LT> activeSet(grid, bulkNodes, input);
+
     // *********
     // LB FIELDS
     // *********
@@ -146,8 +151,9 @@ int main()
     // **********
     Output<LT> output(grid, bulkNodes, outputDir2, myRank, nProcs);
     output.add_file("lb_run");
-    output.add_variables({"rho", "phi", "vel", "viscosity", "gammaDot", "epsilonDot", "E00", "E01", "E00_2"},
-                         { rho,   phi,   vel,   viscosity,   gammaDot,   epsilonDot,   E00,   E01,   E00_2});
+    output.add_scalar_variables({"rho", "phi", "viscosity", "gammaDot", "epsilonDot", "E00", "E01", "E00_2"},
+                                { rho,   phi,   viscosity,   gammaDot,   epsilonDot,   E00,   E01,   E00_2});
+    output.add_vector_variables({"vel"}, {vel});
 
     // VTK::Output<VTK_CELL, double> output(VTK::BINARY, grid.getNodePos(bulkNodes), outputDir2, myRank, nProcs);
     // output.add_file("lb_run");
@@ -178,28 +184,19 @@ int main()
         for (auto nodeNo: bulkNodes) {
             // Copy of local velocity diestirubtion
             const std::valarray<lbBase_t> fNode = f(0, nodeNo);
-	    const std::valarray<lbBase_t> gNode = g(0, nodeNo);
-	    const std::valarray<lbBase_t> g1Node = g(1, nodeNo);
 	    
             // Macroscopic values
             const lbBase_t rhoNode = calcRho<LT>(fNode);
             const auto velNode = calcVel<LT>(fNode, rhoNode, bodyForce(0, nodeNo));
 
-	    const lbBase_t phiNode = calcRho<LT>(gNode);
-	    const auto MiNode = LT::qSumC(gNode);
-
-	    const lbBase_t phi1Node = calcRho<LT>(g1Node);
-
             // Save density and velocity for printing
             rho(0, nodeNo) = rhoNode;
             vel.set(0, nodeNo) = velNode;
-	    phi(0, nodeNo) = phiNode;
-	    phi(1, nodeNo) = phi1Node;
 	    
             // BGK-collision term
             const lbBase_t u2 = LT::dot(velNode, velNode);
             const std::valarray<lbBase_t> cu = LT::cDotAll(velNode);
-            auto omegaBGK = newtonian.omegaBGK(fNode, rhoNode, velNode, u2, cu, bodyForce(0, nodeNo), 0);
+            auto omegaBGK = newtonian.omegaBGK(tau, fNode, rhoNode, velNode, u2, cu, bodyForce(0, nodeNo), 0);
 
             // Calculate the Guo-force correction
             const lbBase_t uF = LT::dot(velNode, bodyForce(0, nodeNo));
@@ -214,7 +211,29 @@ int main()
 	    E00_2(0, nodeNo) = newtonian.E00_2();
             const std::valarray<lbBase_t> deltaOmegaF = calcDeltaOmegaF<LT>(tau, cu, uF, cF);
 
-	    
+            // Collision and propagation
+            fTmp.propagateTo(0, nodeNo, fNode + omegaBGK + deltaOmegaF, grid);
+
+        } // End nodes
+
+        // Tracer, only on the active nodes
+        for (auto nodeNo: activeSet.nodes()) {
+	    const std::valarray<lbBase_t> gNode = g(0, nodeNo);
+	    const std::valarray<lbBase_t> g1Node = g(1, nodeNo);
+
+            const lbBase_t rhoNode = rho(0, nodeNo);
+            const auto velNode = vel(0, nodeNo);
+            const lbBase_t u2 = LT::dot(velNode, velNode);
+            const std::valarray<lbBase_t> cu = LT::cDotAll(velNode);
+
+	    const lbBase_t phiNode = calcRho<LT>(gNode);
+	    const auto MiNode = LT::qSumC(gNode);
+
+	    const lbBase_t phi1Node = calcRho<LT>(g1Node);
+
+	    phi(0, nodeNo) = phiNode;
+	    phi(1, nodeNo) = phi1Node;
+
 	    const std::valarray<lbBase_t> omegaAdvMom = LT::cDotAll(phiNode*velNode - MiNode);
 	    std::valarray<lbBase_t> omegaPhi(LT::nQ);
 	    std::valarray<lbBase_t> omegaPhi1(LT::nQ);
@@ -224,7 +243,6 @@ int main()
 	    }
 		
             // Collision and propagation
-            fTmp.propagateTo(0, nodeNo, fNode + omegaBGK + deltaOmegaF, grid);
 	    gTmp.propagateTo(0, nodeNo, gNode + omegaPhi, grid);
 	    gTmp.propagateTo(1, nodeNo, g1Node + omegaPhi1, grid);
 
@@ -239,11 +257,15 @@ int main()
         // *******************
         // Mpi
         mpiBoundary.communicateLbField(0, f, grid);
-	mpiBoundary.communicateLbField(g, grid);
+	if (activeSet.enabled())
+	    mpiBoundary.communicateLbField(g, grid, activeSet.mask());
+	else
+	    mpiBoundary.communicateLbField(g, grid);
 	
         // Half way bounce back
         bounceBackBnd.apply(f, grid);
 	bounceBackBnd.apply(g, grid);
+        activeSet.update(i + 1, g, gTmp, mpiBoundary);
         // *************
         // WRITE TO FILE
         // *************
@@ -388,6 +388,12 @@ int main()
   output.add_scalar_variables({"rho", "pressure", "p_perturb", "nodeType", "BndTags", "nodeNoField", "numSolidNeig", "numSolidNeigBnd"}, {rho, pressure, pPert, nodeTypeField, tagsField, nodeNoField, numSolidNeig, numSolidNeigBnd});
   output.add_vector_variables({"vel", "force", "boundaryMeanDir", "boundaryMeanDirBnd"}, {vel, force, boundaryMeanDir, boundaryMeanDirBnd});
 
+  // ******************
+  // CONVERGENCE
+  // ******************
+  // Disabled if input.dat has no <convergence> block
+  ConvergenceMonitor<LT> convergence(input);
+
   // *********
   // MAIN LOOP
   // *********
@@ -493,6 +499,21 @@ int main()
       }
     }
 
+    // ***********
+    // CONVERGENCE
+    // ***********
+    if (convergence.check(i, bulkNodes, rho, vel, grid))
+    {
+      if (myRank == 0)
+      {
+        std::cout << "CONVERGED AT ITERATION : " << i << " (residual = " << convergence.residual() << ")" << std::endl;
+      }
+      if (convergence.write() && ((i % nItrWrite) != 0))
+        output.write(i);
+      if (convergence.stop())
+        break;
+    }
+
   } // End iterations
 
   MPI_Finalize();
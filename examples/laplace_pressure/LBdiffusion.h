@@ -9,7 +9,10 @@
 #include <lbsolver/LBboundary.h>
 
 #include <array>
+#include <cmath>
 #include<set>
+#include <vector>
+#include <mpi.h>
 
 
 template<int ND>
@@ -1399,4 +1402,247 @@ void DiffusionSolver<DXQY>::writeFieldsToFile(const LbField<DXQY> & f, const Sca
 
 }
 
+//=====================================================================================
+//
+//                   A N D E R S O N A C C E L E R A T I O N
+//
+//=====================================================================================
+template<typename DXQY>
+class AndersonAcceleration
+/* Anderson acceleration (Anderson mixing) of the steady state of a linear LB
+ *  problem. One full time step, collision + propagation + mpi + boundary
+ *  conditions, is seen as a fixed-point map x -> G(x) for the distributions
+ *  on the bulk nodes, and the new iterate is the combination of the last
+ *  depth+1 values of G(x) with the smallest residual G(x) - x. For diffusion
+ *  this cuts the O(L^2) time steps of plain time stepping to roughly O(L).
+ *
+ *  Usage, after the boundary conditions in each time step:
+ *      anderson.update(f);
+ *
+ *  Each field is accelerated independently, with one MPI_Allreduce per update.
+ *  residual(fieldNo) is the relative l2 norm |G(x) - x|/|G(x)| over the node
+ *  list on all ranks, so the tolerance does not depend on the size of the
+ *  domain or the level of the distributions.
+ *  The memory cost is 2*depth + 3 extra copies of f on the node list (x, G(x),
+ *  the residual and depth difference columns of both), so depth 5 needs 13
+ *  times the memory of f. The depth is limited to maxDepth, as deeper histories
+ *  rarely converge faster.
+ */
+{
+public:
+    AndersonAcceleration(const int depth, const int numFields, const std::vector<int> &nodeList, const lbBase_t regularization=1e-10);
+
+    void update(LbField<DXQY> &f);
+    void restart() {nCols_ = 0; head_ = 0; first_ = true; std::fill(residual_.begin(), residual_.end(), -1.0);}
+    lbBase_t residual(const int fieldNo) const {return residual_[fieldNo];}
+
+    static constexpr int maxDepth = 10;
+
+private:
+    inline lbBase_t *column(std::vector<lbBase_t> &v, const int colNo, const int fieldNo) {return v.data() + (colNo*numFields_ + fieldNo)*size_;}
+    bool solve(std::vector<lbBase_t> &A, std::vector<lbBase_t> &b, const int n) const;
+
+    const int depth_;
+    const int numFields_;
+    const std::vector<int> nodeList_;
+    const int size_;  // nQ*(number of nodes), per field
+    const lbBase_t regularization_;
+    std::vector<lbBase_t> x_;  // Last iterate
+    std::vector<lbBase_t> gOld_;  // Last G(x)
+    std::vector<lbBase_t> rOld_;  // Last residual G(x) - x
+    std::vector<lbBase_t> dG_;  // Differences of G(x), ring buffer with depth columns
+    std::vector<lbBase_t> dR_;  // Differences of residuals, ring buffer with depth columns
+    int nCols_;
+    int head_;  // Next column to overwrite
+    bool first_;
+    std::vector<lbBase_t> residual_;  // Global l2 norm of the last residual relative to that of G(x), per field
+};
+
+//                               AndersonAcceleration
+//----------------------------------------------------------------------------------- AndersonAcceleration
+template<typename DXQY>
+AndersonAcceleration<DXQY>::AndersonAcceleration(const int depth, const int numFields, const std::vector<int> &nodeList, const lbBase_t regularization)
+//-----------------------------------------------------------------------------------
+:depth_(depth), numFields_(numFields), nodeList_(nodeList), size_(DXQY::nQ*nodeList.size()), regularization_(regularization),
+ x_(numFields*size_), gOld_(numFields*size_), rOld_(numFields*size_), dG_(depth*numFields*size_), dR_(depth*numFields*size_),
+ nCols_(0), head_(0), first_(true), residual_(numFields, -1.0)
+/* depth          : number of earlier iterates used in the mixing
+ * numFields      : number of fields in f
+ * nodeList       : nodes on this rank where f is a state variable (the bulk nodes)
+ * regularization : relative Tikhonov regularization of the least squares problem
+ */
+{
+    if ( (depth_ < 1) || (depth_ > maxDepth) ) {
+        std::cout << "ERROR in AndersonAcceleration: the depth must be from 1 to " << maxDepth
+                  << ", it needs 2*depth + 3 copies of the distributions" << std::endl;
+        exit(1);
+    }
+}
+
+//                               AndersonAcceleration
+//----------------------------------------------------------------------------------- update
+template<typename DXQY>
+void AndersonAcceleration<DXQY>::update(LbField<DXQY> &f)
+//-----------------------------------------------------------------------------------
+/* update : on entry f holds G(x) for the last iterate x, on exit f holds the
+ *  next iterate. The first call only records the iterate.
+ */
+{
+    constexpr int nQ = DXQY::nQ;
+    if (first_) {
+        for (int fieldNo = 0; fieldNo < numFields_; ++fieldNo) {
+            lbBase_t *x = x_.data() + fieldNo*size_;
+            for (const auto &nodeNo: nodeList_)
+                for (int q = 0; q < nQ; ++q)
+                    *x++ = f(fieldNo, q, nodeNo);
+        }
+        first_ = false;
+        nCols_ = 0;
+        return;
+    }
+
+    // Residuals and new difference columns
+    const bool addColumn = (residual_[0] >= 0);
+    const int col = head_;
+    for (int fieldNo = 0; fieldNo < numFields_; ++fieldNo) {
+        lbBase_t *x = x_.data() + fieldNo*size_;
+        lbBase_t *gOld = gOld_.data() + fieldNo*size_;
+        lbBase_t *rOld = rOld_.data() + fieldNo*size_;
+        lbBase_t *dG = column(dG_, col, fieldNo);
+        lbBase_t *dR = column(dR_, col, fieldNo);
+        int i = 0;
+        for (const auto &nodeNo: nodeList_) {
+            for (int q = 0; q < nQ; ++q, ++i) {
+                const lbBase_t g = f(fieldNo, q, nodeNo);
+                const lbBase_t r = g - x[i];
+                if (addColumn) {
+                    dG[i] = g - gOld[i];
+                    dR[i] = r - rOld[i];
+                }
+                gOld[i] = g;
+                rOld[i] = r;
+            }
+        }
+    }
+    if (addColumn) {
+        nCols_ = std::min(nCols_ + 1, depth_);
+        head_ = (head_ + 1) % depth_;
+    }
+
+    // Normal equations, (dR^T dR) gamma = dR^T r, |r|^2 and |G(x)|^2 for all fields in one reduction
+    const int n = nCols_;
+    const int blockSize = n*n + n + 2;
+    std::vector<lbBase_t> local(numFields_*blockSize, 0.0), global(numFields_*blockSize);
+    for (int fieldNo = 0; fieldNo < numFields_; ++fieldNo) {
+        lbBase_t *block = local.data() + fieldNo*blockSize;
+        const lbBase_t *r = rOld_.data() + fieldNo*size_;
+        const lbBase_t *g = gOld_.data() + fieldNo*size_;
+        for (int j = 0; j < n; ++j) {
+            const lbBase_t *dRj = column(dR_, j, fieldNo);
+            for (int k = 0; k <= j; ++k) {
+                const lbBase_t *dRk = column(dR_, k, fieldNo);
+                lbBase_t sum = 0;
+                for (int i = 0; i < size_; ++i)
+                    sum += dRj[i]*dRk[i];
+                block[j*n + k] = sum;
+            }
+            lbBase_t sum = 0;
+            for (int i = 0; i < size_; ++i)
+                sum += dRj[i]*r[i];
+            block[n*n + j] = sum;
+        }
+        lbBase_t sum = 0, sumG = 0;
+        for (int i = 0; i < size_; ++i) {
+            sum += r[i]*r[i];
+            sumG += g[i]*g[i];
+        }
+        block[n*n + n] = sum;
+        block[n*n + n + 1] = sumG;
+    }
+    MPI_Allreduce(local.data(), global.data(), numFields_*blockSize, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+
+    // New iterate x = G(x) - dG gamma
+    bool singular = false;
+    for (int fieldNo = 0; fieldNo < numFields_; ++fieldNo) {
+        lbBase_t *block = global.data() + fieldNo*blockSize;
+        residual_[fieldNo] = std::sqrt(block[n*n + n]/(block[n*n + n + 1] + lbBaseEps));
+        std::vector<lbBase_t> A(n*n), gamma(block + n*n, block + n*n + n);
+        for (int j = 0; j < n; ++j)
+            for (int k = 0; k <= j; ++k)
+                A[j*n + k] = A[k*n + j] = block[j*n + k];
+        if ( (n > 0) && !solve(A, gamma, n) ) {
+            singular = true;
+            std::fill(gamma.begin(), gamma.end(), 0.0);
+        }
+
+        lbBase_t *x = x_.data() + fieldNo*size_;
+        const lbBase_t *g = gOld_.data() + fieldNo*size_;
+        for (int i = 0; i < size_; ++i)
+            x[i] = g[i];
+        for (int j = 0; j < n; ++j) {
+            const lbBase_t *dGj = column(dG_, j, fieldNo);
+            for (int i = 0; i < size_; ++i)
+                x[i] -= gamma[j]*dGj[i];
+        }
+        int i = 0;
+        for (const auto &nodeNo: nodeList_)
+            for (int q = 0; q < nQ; ++q, ++i)
+                f(fieldNo, q, nodeNo) = x[i];
+    }
+    // Drop the history if the columns have become linearly dependent
+    if (singular) {
+        nCols_ = 0;
+        head_ = 0;
+    }
+}
+
+//                               AndersonAcceleration
+//----------------------------------------------------------------------------------- solve
+template<typename DXQY>
+bool AndersonAcceleration<DXQY>::solve(std::vector<lbBase_t> &A, std::vector<lbBase_t> &b, const int n) const
+//-----------------------------------------------------------------------------------
+/* solve : Cholesky solution of the regularized symmetric system (A + lambda I) x = b,
+ *  with lambda = regularization*trace(A)/n. Returns false if the columns are linearly
+ *  dependent to working precision.
+ *  The solution is returned in b.
+ */
+{
+    lbBase_t trace = 0;
+    for (int j = 0; j < n; ++j)
+        trace += A[j*n + j];
+    if (trace <= 0) {  // Nothing changes, e.g. an already converged field
+        std::fill(b.begin(), b.end(), 0.0);
+        return true;
+    }
+    const lbBase_t lambda = regularization_*trace/n;
+    for (int j = 0; j < n; ++j)
+        A[j*n + j] += lambda;
+
+    for (int j = 0; j < n; ++j) {
+        lbBase_t d = A[j*n + j];
+        for (int k = 0; k < j; ++k)
+            d -= A[j*n + k]*A[j*n + k];
+        if (d <= 2*lambda)
+            return false;
+        A[j*n + j] = std::sqrt(d);
+        for (int i = j + 1; i < n; ++i) {
+            lbBase_t s = A[i*n + j];
+            for (int k = 0; k < j; ++k)
+                s -= A[i*n + k]*A[j*n + k];
+            A[i*n + j] = s/A[j*n + j];
+        }
+    }
+    for (int j = 0; j < n; ++j) {
+        for (int k = 0; k < j; ++k)
+            b[j] -= A[j*n + k]*b[k];
+        b[j] /= A[j*n + j];
+    }
+    for (int j = n - 1; j >= 0; --j) {
+        for (int k = j + 1; k < n; ++k)
+            b[j] -= A[k*n + j]*b[k];
+        b[j] /= A[j*n + j];
+    }
+    return true;
+}
+
 #endif
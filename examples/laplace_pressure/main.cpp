@@ -11,6 +11,7 @@
 #include <IO.h>
 #include "./LBdiffusion.h"
 
+#include <memory>
 #include <random>
 
 // SET THE LATTICE TYPE
@@ -67,6 +68,14 @@ int main()
     int nItrWrite = input["iterations"]["write"];
     // Relaxation time
     lbBase_t tau = input["diffusion"]["tau"];
+    // Steady state acceleration (optional), 0 gives plain time stepping. The tolerance
+    // is on the relative residual |G(x) - x|/|G(x)| of the distributions
+    int andersonDepth = 0;
+    lbBase_t andersonTolerance = 0;
+    if (input["diffusion"].contains("anderson_depth")) {
+        andersonDepth = input["diffusion"]["anderson_depth"];
+        andersonTolerance = input["diffusion"]["anderson_tolerance"];
+    }
 
     // ---------------------------------------------------------------------------------- Setup pressure boundary
     std::vector<int> bulkNodes = findBulkNodes<LT>(nodes);
@@ -119,6 +128,12 @@ int main()
 
     VectorField<LT> jVecOut(numFields, grid.size());
 
+    // Anderson acceleration of the distributions on the bulk nodes, only allocated
+    // when it is used (it holds 2*depth + 3 copies of f)
+    std::unique_ptr<AndersonAcceleration<LT>> anderson;
+    if (andersonDepth > 0)
+        anderson = std::make_unique<AndersonAcceleration<LT>>(andersonDepth, numFields, bulkNodes);
+
     // *********
     // LB FIELDS
     // *********
@@ -156,6 +171,17 @@ int main()
     output.add_vector_variables({"PressureForceField"}, {jVecOut});
     // output.write(0);
 
+    // ******************
+    // CONVERGENCE
+    // ******************
+    // Disabled if input.dat has no <convergence> block. The diffusion has no
+    // velocity, so only the rho norms of field 0 can be used.
+    ConvergenceMonitor<LT> convergence(input);
+    if (convergence.usesVelocity()) {
+        std::cout << "ERROR in laplace_pressure: the convergence block must use the l2 or linf norm of rho" << std::endl;
+        exit(1);
+    }
+
     // *********
     // MAIN LOOP
     // *********
@@ -196,6 +222,40 @@ int main()
 	  bnd.apply(fieldNum, f, tau, nodes, grid, applyBnd);
         }
 
+        // ********************
+        // STEADY STATE SOLVER
+        // ********************
+        bool converged = false;
+        if (anderson) {
+            anderson->update(f);
+            converged = (i > 1);
+            for (int fieldNum = 0; fieldNum < numFields; ++fieldNum)
+                converged = converged && (anderson->residual(fieldNum) < andersonTolerance);
+            if (converged && (myRank == 0))
+                std::cout << "STEADY STATE AT ITERATION : " << i << std::endl;
+        }
+
+        // ***********
+        // CONVERGENCE
+        // ***********
+        bool writeConverged = false;
+        if (convergence.check(i, bulkNodes, rho, jVecOut, grid)) {
+            if (myRank == 0)
+                std::cout << "CONVERGED AT ITERATION : " << i << " (residual = " << convergence.residual() << ")" << std::endl;
+            writeConverged = convergence.write() && ((i % nItrWrite) != 0);
+            converged = converged || convergence.stop();
+        }
+
+        // rho was computed before the last step (and the Anderson update), so the
+        // output at convergence takes it from the final distributions
+        if (converged || writeConverged) {
+            for (int fieldNum = 0; fieldNum < numFields; ++fieldNum)
+                for (auto nodeNo : bulkNodes)
+                    rho(fieldNum, nodeNo) = LT::qSum(f(fieldNum, nodeNo));
+        }
+        if (writeConverged)
+            output.write(i);
+
         // *************
         // WRITE TO FILE
         // *************
@@ -275,6 +335,8 @@ int main()
                 }
             }
         }
+        if (converged)
+            break;
     } // End iterations
 
     //----------------------------------------------------------------------------------- Write forces and pressures to file
@@ -19,7 +19,7 @@
 #include <LBSOLVER.h>
 #include <IO.h>
 
-#include "LBsubgridboundary.h"
+#include <lbsolver/LBsubgridboundary.h>
 #include "LBsubgridboundaryd.h"
 
 //  Linear algebra package
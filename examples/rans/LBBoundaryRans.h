@@ -24,7 +24,7 @@ template<typename DXQY>
 std::valarray<lbBase_t> interpolateVector(const VectorField<DXQY> &val, const std::vector<lbBase_t> &w, const std::vector<int> &pnts);
 
 template<typename DXQY>
-std::valarray<lbBase_t> interpolateLBFieldNeq(const ScalarField &rho, const VectorField<DXQY> &vel, const LbField<DXQY> &f, const std::vector<lbBase_t> &w, const std::vector<int> &pnts);
+std::valarray<lbBase_t> interpolateLBFieldNeq(const ScalarField &rho, const VectorField<DXQY> &vel, const LbField<DXQY> &f, const std::vector<lbBase_t> &w, const std::vector<int> &pnts, const int fieldNo=0);
 
 //========================================================================================================== wall_boundary_rans works for newtonian
 template<typename DXQY>
@@ -268,7 +268,7 @@ std::valarray<lbBase_t> interpolateVector(const VectorField<DXQY> &val, const st
 }
 
 template<typename DXQY>
-std::valarray<lbBase_t> interpolateLBFieldNeq(const ScalarField &rho, const VectorField<DXQY> &vel, const LbField<DXQY> &f, const std::vector<lbBase_t> &w, const std::vector<int> &pnts)
+std::valarray<lbBase_t> interpolateLBFieldNeq(const ScalarField &rho, const VectorField<DXQY> &vel, const LbField<DXQY> &f, const std::vector<lbBase_t> &w, const std::vector<int> &pnts, const int fieldNo)
 {
     std::valarray<lbBase_t> ret(0.0, DXQY::nQ);
 
@@ -277,7 +277,7 @@ std::valarray<lbBase_t> interpolateLBFieldNeq(const ScalarField &rho, const Vect
         const int n = pnts[i];
         //const lbBase_t rhoNode = rho(0, n);
         //const std::valarray<lbBase_t> velNode = vel(0, n);
-        const std::valarray<lbBase_t> fNode = f(0, n);
+        const std::valarray<lbBase_t> fNode = f(fieldNo, n);
 
         // Test
         const lbBase_t rhoNode = DXQY::qSum(fNode);
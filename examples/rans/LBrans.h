@@ -60,7 +60,8 @@ public:
 		  const T1 &bndNodes,
 		  T2 &f,
 		  T3 &rho,
-		  const lbBase_t fixValue/*,
+		  const lbBase_t fixValue,
+		  const int fieldNo=0/*,
 		  const T3 &grid*/);
   template <typename T1, typename T2/*, typename T3*/>
   void zouHeFixedVelocityLeftBnd(
@@ -96,11 +97,7 @@ public:
       ScalarField &rho,
       VectorField<DXQY> &vel,
       ScalarField &viscocity,
-      LbField<DXQY> &g,
-      LbField<DXQY> &gTmp,
       ScalarField &rhoK, 
-      LbField<DXQY> &h,
-      LbField<DXQY> &hTmp,
       ScalarField &rhoE,
       std::vector<InterpolationElement> &boundarynodes, 
       Nodes<DXQY> &nodes,
@@ -397,7 +394,8 @@ void Rans<DXQY>::zouHeFixedValueLeftBnd(
 					const T1 &bndNodes,
 					T2 &f,
 					T3 &rho,
-					const lbBase_t fixValue/*,
+					const lbBase_t fixValue,
+					const int fieldNo/*,
 			                const T3 &grid*/ 		  
 					)
 /* Returns void: computes object values
@@ -415,6 +413,8 @@ void Rans<DXQY>::zouHeFixedValueLeftBnd(
  * fixValue : float-like
  *     scalar to be set at boundary
  * 
+ * fieldNo : int
+ *     field of f to set
   
  *  : array-like, size = [DXQY::nD]
  *     body force
@@ -430,12 +430,12 @@ void Rans<DXQY>::zouHeFixedValueLeftBnd(
 {
 
   for (const auto &nodeNo: bndNodes) {
-        const std::valarray<lbBase_t> fNode = f(0, nodeNo);
+        const std::valarray<lbBase_t> fNode = f(fieldNo, nodeNo);
         //const std::valarray<lbBase_t> forceNode = force(0, nodeNo);
         const lbBase_t rho_ux = fixValue*rho(0, nodeNo) /*- 0.5*forceNode[0]*/ - (fNode[2] + fNode[6] + fNode[8] + 2*(fNode[3] + fNode[4] + fNode[5]));
-        f(0, 0, nodeNo) = fNode[4] + (2./3.)*rho_ux /*- (1./3.)*forceNode[0]*/;
-        f(0, 1, nodeNo) = fNode[5] + 0.5*(fNode[6] - fNode[2]) + (1./6.)*rho_ux /*+ (5./12.)*forceNode[0] + (1./4.)*forceNode[1]*/; 
-        f(0, 7, nodeNo) = fNode[3] + 0.5*(fNode[2] - fNode[6]) + (1./6.)*rho_ux /*+ (5./12.)*forceNode[0] - (1./4.)*forceNode[1]*/;
+        f(fieldNo, 0, nodeNo) = fNode[4] + (2./3.)*rho_ux /*- (1./3.)*forceNode[0]*/;
+        f(fieldNo, 1, nodeNo) = fNode[5] + 0.5*(fNode[6] - fNode[2]) + (1./6.)*rho_ux /*+ (5./12.)*forceNode[0] + (1./4.)*forceNode[1]*/; 
+        f(fieldNo, 7, nodeNo) = fNode[3] + 0.5*(fNode[2] - fNode[6]) + (1./6.)*rho_ux /*+ (5./12.)*forceNode[0] - (1./4.)*forceNode[1]*/;
 
     }
   
@@ -617,7 +617,8 @@ void Rans<DXQY>::copyDistBnd(
 {
   for (const auto &nodeNo : bndNodes)
   {
-    f.set(0, nodeNo) = f(0, grid.neighbor(qDir, nodeNo));
+    for (int fieldNo = 0; fieldNo < f.num_fields(); ++fieldNo)
+      f.set(fieldNo, nodeNo) = f(fieldNo, grid.neighbor(qDir, nodeNo));
   }
 }
 
@@ -648,15 +649,14 @@ void Rans<DXQY>::solidBnd(
       ScalarField &rho,
       VectorField<DXQY> &vel,
       ScalarField &viscocity,
-      LbField<DXQY> &g,
-      LbField<DXQY> &gTmp,
       ScalarField &rhoK, 
-      LbField<DXQY> &h,
-      LbField<DXQY> &hTmp,
       ScalarField &rhoE,
       std::vector<InterpolationElement> &boundarynodes, 
       Nodes<DXQY> &nodes,
       Grid<DXQY> &grid)
+/* solidBnd : wall function boundary. f and fTmp hold the flow (field 0), rho*k (field 1)
+ *  and rho*epsilon (field 2) distributions.
+ */
 {
     int cnt = 0;
     lbBase_t sumrho = 0;
@@ -885,19 +885,19 @@ void Rans<DXQY>::solidBnd(
 
         const lbBase_t rhoKNode =  (bn.gamma*interpolateScalar(rhoK, bn.wb, bn.pnts) + bn.gamma2*rhoNode*k_wall)/(bn.gamma + bn.gamma2);
         const lbBase_t tauKNode = tauK0Term_ + 0.5 + (tauNode - 0.5 - tau0_)*sigmakInv_;
-        const std::valarray<lbBase_t> gNode = calcfeq<DXQY>(rhoKNode, uNode) +  0*interpolateLBFieldNeq(rhoK, vel, g, bn.wb, bn.pnts);
+        const std::valarray<lbBase_t> gNode = calcfeq<DXQY>(rhoKNode, uNode) +  0*interpolateLBFieldNeq(rhoK, vel, f, bn.wb, bn.pnts, 1);
         const auto omegaBGK_K = calcOmegaBGKTRT<DXQY>(gNode, 1.0, tauKNode, rhoKNode, u2, cu);
 
         const lbBase_t rhoENode = (bn.gamma*interpolateScalar(rhoE, bn.wb, bn.pnts) + bn.gamma2*rhoNode*epsilon_wall)/(bn.gamma + bn.gamma2);
         const lbBase_t tauENode = tauE0Term_ + 0.5 + (tauNode - 0.5 - tau0_)*sigmaepsilonInv_;
-        const std::valarray<lbBase_t> hNode  = calcfeq<DXQY>(rhoENode, uNode) +  0*interpolateLBFieldNeq(rhoE, vel, h, bn.wb, bn.pnts); 
+        const std::valarray<lbBase_t> hNode  = calcfeq<DXQY>(rhoENode, uNode) +  0*interpolateLBFieldNeq(rhoE, vel, f, bn.wb, bn.pnts, 2); 
         const auto omegaBGK_E = calcOmegaBGKTRT<DXQY>(hNode, 1.0, tauENode, rhoENode, u2, cu);
 
       //                               Collision and propagation
       //------------------------------------------------------------------------------------- Collision and propagation
       fTmp.propagateTo(0, nodeNo, fNode + omegaBGK, grid);
-      gTmp.propagateTo(0, nodeNo, gNode + omegaBGK_K, grid);
-      hTmp.propagateTo(0, nodeNo, hNode + omegaBGK_E, grid);
+      fTmp.propagateTo(1, nodeNo, gNode + omegaBGK_K, grid);
+      fTmp.propagateTo(2, nodeNo, hNode + omegaBGK_E, grid);
 
     }
 
@@ -39,70 +39,6 @@
 //    RUN Iteration
 //
 //=======================================================================================
-//=====================================================================================
-//
-//                  R E G U L A R I Z E D   D I S T R I B U T I O N
-//
-//=====================================================================================
-template<int DIM>
-inline lbBase_t lowerDiagCcCont(const std::valarray<lbBase_t> &m, const std::valarray<lbBase_t> & c)
-{
-    std::cout << "Error in template specialization" << std::endl;
-    exit(1);
-    return 0;
-}
-
-template<>
-inline lbBase_t lowerDiagCcCont<2>(const std::valarray<lbBase_t> &m, const std::valarray<lbBase_t> & c)
-{
-    return c[0]*c[0]*m[0] + 2*c[0]*c[1]*m[1] + c[1]*c[1]*m[2];
-}
-
-template<>
-inline lbBase_t lowerDiagCcCont<3>(const std::valarray<lbBase_t> &m, const std::valarray<lbBase_t> & c)
-{
-    return c[0]*c[0]*m[0] + 2*c[1]*c[0]*m[1] + c[1]*c[1]*m[2] + 2*c[2]*c[0]*m[3] + 2*c[2]*c[1]*m[4] + c[2]*c[2]*m[5];
-}
-
-template<int DIM>
-inline lbBase_t lowerDiagTrace(const std::valarray<lbBase_t> &m)
-{
-    std::cout << "Error in template specialization" << std::endl;
-    exit(1);
-    return 0;
-}
-
-template<>
-inline lbBase_t lowerDiagTrace<2>(const std::valarray<lbBase_t> &m)
-{
-    return m[0] + m[2];   
-}
-
-template<>
-inline lbBase_t lowerDiagTrace<3>(const std::valarray<lbBase_t> &m)
-{
-    return m[0] + m[2] + m[5];   
-}
-
-template<typename DXQY>
-std::valarray<lbBase_t> fRegularized(const std::valarray<lbBase_t> &f, const lbBase_t dRhoNode)
-{
-    const lbBase_t M = DXQY::qSum(f) + dRhoNode;
-    const auto Mi = DXQY::qSumC(f);
-    const auto Mij = DXQY::qSumCCLowTri(f);
-
-    std::valarray<lbBase_t> fReg(DXQY::nQ);
-    const lbBase_t c2traceM = DXQY::c2*lowerDiagTrace<DXQY::nD>(Mij);
-    for (int q=0; q<DXQY::nQ; ++q) {
-        const lbBase_t Qdelta = DXQY::cNorm[q]*DXQY::cNorm[q] - DXQY::nD*DXQY::c2;
-        const lbBase_t cM = DXQY::cDotRef(q, Mi)*DXQY::c2Inv;        
-        const lbBase_t QM = DXQY::c4Inv0_5*(lowerDiagCcCont<DXQY::nD>(Mij, DXQY::cValarray(q)) - c2traceM - DXQY::c2*Qdelta*M);
-        fReg[q] = DXQY::w[q]*(M + cM + QM);
-    }
-
-    return fReg;
-}
-
 //=======================================================================================
 //
 //                                      M A I N
@@ -339,20 +275,12 @@ int main()
   //
   //=====================================================================================
 
-  //                                        flow LB field
-  //------------------------------------------------------------------------------------- flow LB field
-  LbField<LT> f(1, grid.size());
-  LbField<LT> fTmp(1, grid.size());
-
-  //                                        rho k LB field
-  //------------------------------------------------------------------------------------- rho k LB field
-  LbField<LT> g(1, grid.size());
-  LbField<LT> gTmp(1, grid.size());
-
-  //                                     rho epsilon LB field
-  //------------------------------------------------------------------------------------- rho epsilon LB field
-  LbField<LT> h(1, grid.size());
-  LbField<LT> hTmp(1, grid.size());
+  //                             flow, rho k and rho epsilon LB fields
+  //------------------------------------------------------------------------------------- flow, rho k and rho epsilon LB fields
+  // One LbField with the flow (field 0), rho k (field 1) and rho epsilon (field 2), so
+  // that one mpi exchange per neighbor communicates all three.
+  LbField<LT> f(3, grid.size());
+  LbField<LT> fTmp(3, grid.size());
 
   //                                initiate LB distributions
   //------------------------------------------------------------------------------------- initiate LB distributions
@@ -361,8 +289,8 @@ int main()
     for (int q = 0; q < LT::nQ; ++q)
     {
       f(0, q, nodeNo) = LT::w[q] * rho(0, nodeNo);
-      g(0, q, nodeNo) = LT::w[q] * rhoK(0, nodeNo);
-      h(0, q, nodeNo) = LT::w[q] * rhoEpsilon(0, nodeNo);
+      f(1, q, nodeNo) = LT::w[q] * rhoK(0, nodeNo);
+      f(2, q, nodeNo) = LT::w[q] * rhoEpsilon(0, nodeNo);
     }
   }
 
@@ -417,10 +345,6 @@ int main()
       int xpos = grid.pos(nodeNo, 0);
       int xposMax = vtklb.getGlobaDimensions(0) - 3; 
       if ( (xpos > 0) && (xpos < xposMax) && nodes.isFluidBoundary(nodeNo)  && nodes.isMyRank(nodeNo)) {
-        const auto fNode = f(0, nodeNo);
-        const auto gNode = g(0, nodeNo);
-        const auto hNode = h(0, nodeNo);
-
         std::vector<lbBase_t> fMean(LT::nQ, 0.0);
         std::vector<lbBase_t> gMean(LT::nQ, 0.0);
         std::vector<lbBase_t> hMean(LT::nQ, 0.0);
@@ -432,23 +356,20 @@ int main()
             norm += 1.0;
             for (int q=0; q < LT::nQ; ++q) {
               fMean[q] += f(0, q, n);
-              gMean[q] += g(0, q, n);
-              hMean[q] += h(0, q, n);
+              gMean[q] += f(1, q, n);
+              hMean[q] += f(2, q, n);
             }
           }
         }
         for (int q=0; q < LT::nQ; ++q) {
           fTmp(0, q, nodeNo) = fMean[q]/norm;
-          gTmp(0, q, nodeNo) = gMean[q]/norm;
-          hTmp(0, q, nodeNo) = hMean[q]/norm;
+          fTmp(1, q, nodeNo) = gMean[q]/norm;
+          fTmp(2, q, nodeNo) = hMean[q]/norm;
         }
       }
       else {
-        for (int q=0; q < LT::nQ; ++q) {
-          fTmp(0, q, nodeNo) = f(0, q, nodeNo);
-          gTmp(0, q, nodeNo) = g(0, q, nodeNo);
-          hTmp(0, q, nodeNo) = h(0, q, nodeNo);
-        }
+        for (int fieldNo=0; fieldNo < 3; ++fieldNo)
+          fTmp.set(fieldNo, nodeNo) = f(fieldNo, nodeNo);
         if (nodes.isFluid(nodeNo) && nodes.isMyRank(nodeNo) && (xpos > 0) && (xpos < xposMax)) {
           const std::valarray<lbBase_t> zeroForce(0.0, LT::nD);
           const auto fNode = f(0, nodeNo);
@@ -460,9 +381,7 @@ int main()
       }
     }
 
-    f.swapData(fTmp); // flow LBfield
-    g.swapData(gTmp); // rhoK LBfield
-    h.swapData(hTmp); // rhoEpsilon LBfield
+    f.swapData(fTmp); // flow, rhoK and rhoEpsilon LBfields
 
     lbBase_t drivingForce_x = 2.0*M_fluid*(drivingVelocity_x - Mx_fluid/M_fluid) / (1.0*numForceNodes);
 
@@ -479,8 +398,8 @@ int main()
       //                           Copy of local LB distribution
       //------------------------------------------------------------------------------------- Copy of local LB distribution
       const auto fNode = fRegularized<LT>(f(0, nodeNo), 0); //f(0, nodeNo);
-      const auto gNode = fRegularized<LT>(g(0, nodeNo), 0); //f(0, nodeNo);
-      const auto hNode = fRegularized<LT>(h(0, nodeNo), 0); //f(0, nodeNo);
+      const auto gNode = fRegularized<LT>(f(1, nodeNo), 0); //f(1, nodeNo);
+      const auto hNode = fRegularized<LT>(f(2, nodeNo), 0); //f(2, nodeNo);
 
       //                                    Macroscopic values
       //------------------------------------------------------------------------------------- Macroscopic values
@@ -546,8 +465,8 @@ int main()
       //                               Collision and propagation
       //------------------------------------------------------------------------------------- Collision and propagation
       fTmp.propagateTo(0, nodeNo, fNode + omegaBGK + deltaOmegaF, grid);
-      gTmp.propagateTo(0, nodeNo, gNode + omegaBGK_K + dOmegaFK + dOmegaSourceK, grid);
-      hTmp.propagateTo(0, nodeNo, hNode + omegaBGK_E + dOmegaFE + dOmegaSourceE, grid);
+      fTmp.propagateTo(1, nodeNo, gNode + omegaBGK_K + dOmegaFK + dOmegaSourceK, grid);
+      fTmp.propagateTo(2, nodeNo, hNode + omegaBGK_E + dOmegaFE + dOmegaSourceE, grid);
 
     } //------------------------------------------------------------------------------------- End bulkNodes
 
@@ -559,30 +478,24 @@ int main()
     //=====================================================================================
 
     // ------------------------------------------------------------------------------------- Solid boundary conditions
-    rans.solidBnd(f, fTmp, rho, vel, viscosity, g, gTmp, rhoK, h, hTmp, rhoEpsilon, bndInterp, nodes,grid);
+    rans.solidBnd(f, fTmp, rho, vel, viscosity, rhoK, rhoEpsilon, bndInterp, nodes,grid);
 
     //                                   Swap data_ from fTmp to f etc.
     //------------------------------------------------------------------------------------- Swap data_ from fTmp to f etc.
-    f.swapData(fTmp); // flow LBfield
-    g.swapData(gTmp); // rhoK LBfield
-    h.swapData(hTmp); // rhoEpsilon LBfield
+    f.swapData(fTmp); // flow, rhoK and rhoEpsilon LBfields
 
     //                                            MPI
     //------------------------------------------------------------------------------------- MPI
-    mpiBoundary.communicateLbField(0, f, grid);
-    mpiBoundary.communicateLbField(0, g, grid);
-    mpiBoundary.communicateLbField(0, h, grid);
+    mpiBoundary.communicateLbField(f, grid);
 
     // ------------------------------------------------------------------------------------- inlet/outlet boundary conditions
     rans.zouHeFixedVelocityLeftBnd(inletBoundaryNodes, f, u_ref * ramp);
     drivingVelocity_x = u_ref * ramp;
-    rans.zouHeFixedValueLeftBnd(inletBoundaryNodes, g, rho, kInlet );
-    rans.zouHeFixedValueLeftBnd(inletBoundaryNodes, h, rho, epsilonInlet );
+    rans.zouHeFixedValueLeftBnd(inletBoundaryNodes, f, rho, kInlet, 1);
+    rans.zouHeFixedValueLeftBnd(inletBoundaryNodes, f, rho, epsilonInlet, 2);
 
 
     rans.copyDistBnd(outletBoundaryNodes, f, 4, grid);
-    rans.copyDistBnd(outletBoundaryNodes, g, 4, grid);
-    rans.copyDistBnd(outletBoundaryNodes, h, 4, grid);
 
 
     //=====================================================================================
@@ -103,10 +103,26 @@ int main()
     output.add_scalar_variables({"rho"}, {rho});
     output.add_vector_variables({"vel"}, {vel}); 
 
+    // ******************
+    // CONVERGENCE
+    // ******************
+    // Disabled if input.dat has no <convergence> block
+    ConvergenceMonitor<LT> convergence(input);
+
+    // ******************
+    // PROFILING
+    // ******************
+    // Disabled if input.dat has no <profiling> block
+    profiler().setup(input, bulkNodes.size());
+    // Estimated memory traffic and flops of the collision loop
+    const KernelWork collisionWork = bulkNodes.size()*(KernelCost<LT>::stream() + KernelCost<LT>::macroscopic(true) + KernelCost<LT>::bgk(true));
+
     // *********
     // MAIN LOOP
     // *********
-    for (int i = 0; i <= nIterations; i++) {
+    int i = 0;
+    for (i = 0; i <= nIterations; i++) {
+        ScopedTimer collisionTimer("collision", collisionWork);
         for (auto nodeNo: bulkNodes) {
             // Copy of local velocity diestirubtion
             const std::valarray<lbBase_t> fNode = f(0, nodeNo);
@@ -135,6 +151,7 @@ int main()
         } // End nodes
 
         f.swapData(fTmp);  // LBfield
+        collisionTimer.stop();
 
         // *******************
         // BOUNDARY CONDITIONS
@@ -152,10 +169,26 @@ int main()
             if (myRank==0) {
                 std::cout << "PLOT AT ITERATION : " << i << std::endl;
             }
+            profiler().report(i);
+        }
+
+        // ***********
+        // CONVERGENCE
+        // ***********
+        if (convergence.check(i, bulkNodes, rho, vel, grid)) {
+            if (myRank==0) {
+                std::cout << "CONVERGED AT ITERATION : " << i << " (residual = " << convergence.residual() << ")" << std::endl;
+            }
+            if ( convergence.write() && ((i % nItrWrite) != 0) )
+                output.write(i);
+            if (convergence.stop())
+                break;
         }
 
     } // End iterations
 
+    profiler().finish(std::min(i, nIterations));
+
     MPI_Finalize();
 
     return 0;
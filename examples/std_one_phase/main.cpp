@@ -484,6 +484,8 @@ int main()
   //                           Check convergence of rel.perm
   //------------------------------------------------------------------------------------- Check convergence of rel.perm
   std::vector<lbBase_t> oldMassFlux(2, 0.0);
+  // Optional <convergence> block in input.dat, e.g. with the flux norm
+  ConvergenceMonitor<LT> convergence(input);
 
   //######################################################################################
   //
@@ -612,6 +614,16 @@ int main()
       // Sett local to zeros
       std::fill(massChangeLocal.begin(), massChangeLocal.end(), 0.0);
    }  
+    //                                 Convergence
+    //------------------------------------------------------------------------------------- Convergence
+    if (convergence.check(i, bulkNodes, rho, vel, grid)) {
+      if (myRank==0)
+        std::cout << "CONVERGED AT ITERATION: " << i << " (residual = " << convergence.residual() << ")" << std::endl;
+      if ( convergence.write() && ((i % nItrWrite) != 0) )
+        output.write(i);
+      if (convergence.stop())
+        break;
+    }
   } //----------------------------------------------------------------------------------------  End for nIterations
   
   MPI_Finalize();
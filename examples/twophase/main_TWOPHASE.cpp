@@ -22,6 +22,7 @@
 #include <iomanip>
 #include <cmath>
 #include <cstdlib>
+#include <memory>
 
 #include <lbsolver/LBbndmpi.h>
 #include <lbsolver/LBboundary.h>
@@ -33,6 +34,7 @@
 #include <lbsolver/LBgrid.h>
 #include <lbsolver/LBhalfwaybb.h>
 #include <lbsolver/LBinitiatefield.h>
+#include <lbsolver/LBloadbalance.h>
 #include <lbsolver/LBmacroscopic.h>
 #include <lbsolver/LBnodes.h>
 #include <lbsolver/LBsnippets.h>
@@ -214,15 +216,32 @@ int main()
     // **********
     // OUTPUT VTK
     // **********
-    Output<LT> output(grid, bulkNodes, outputDir, myRank, nProcs);
-    output.add_file("fluid");
-    output.add_scalar_variables({"rho"}, {rho});
-    output.add_vector_variables({"vel"}, {vel});
+    auto makeOutput = [&]() {
+        auto ret = std::make_unique<Output<LT>>(grid, bulkNodes, outputDir, myRank, nProcs);
+        ret->add_file("fluid");
+        ret->add_scalar_variables({"rho"}, {rho});
+        ret->add_vector_variables({"vel"}, {vel});
+        return ret;
+    };
+    std::unique_ptr<Output<LT>> output = makeOutput();
     
     auto geo = nodes.geo(grid, vtklb);
     Output<LT, int> geoout(grid.pos(), outputDir, myRank, nProcs, "geo", geo);
     geoout.write();
 
+    // ***************
+    // LOAD BALANCING
+    // ***************
+    // Enabled by a <loadbalance> block in the input file. Interface nodes
+    // (color gradient, recoloring) cost more than bulk nodes.
+    LoadBalancer<LT> balancer(vtklb, input);
+    balancer.addField(f);
+    balancer.addField(fTmp);
+    balancer.addField(rho);
+    balancer.addField(vel);
+    balancer.addField(cgField);
+    balancer.addField(Q);
+
     // -----------------MAIN LOOP------------------
     /* Comments to main loop:
      * Calculation of cu is kept outside of calcOmega and calcDeltaOmega
@@ -235,6 +254,7 @@ int main()
 
     for (int i = 0; i <= nIterations; i++) {
 
+        balancer.startTimer();
         for (auto nodeNo : bulkNodes) {
             // UPDATE MACROSCOPIC DENSITIES
             // Calculate rho for each phase
@@ -282,6 +302,7 @@ int main()
             const lbBase_t rho1Node = rho(1, nodeNo);
             cgField(0, nodeNo) = (rho0Node - rho1Node)/(rho0Node + rho1Node);
         }
+        balancer.stopTimer();
 
         //  MPI: COMMUNCATE SCALAR 'cgField'
         mpiBoundary.communciateScalarField(cgField);
@@ -309,6 +330,7 @@ int main()
 	//----------------------------------end Flux---------------------------------------
 
 
+        balancer.startTimer();
         for (auto nodeNo: bulkNodes) {
 
             // Set the local total lb distribution
@@ -374,6 +396,7 @@ int main()
             }
 
         } // End nodes
+        balancer.stopTimer();
 
         // Swap data_ from fTmp to f;
         f.swapData(fTmp);  // LBfield
@@ -391,6 +414,27 @@ int main()
         bbBnd.apply(0, f, grid);  // LBboundary
         bbBnd.apply(1, f, grid);
 
+        // LOAD BALANCING
+        if (balancer.enabled()) {
+            std::vector<int> interfaceNodes;
+            for (auto nodeNo: bulkNodes) {
+                if (std::abs(cgField(0, nodeNo)) < 0.9)
+                    interfaceNodes.push_back(nodeNo);
+            }
+            if (balancer.check(i, grid, nodes, interfaceNodes)) {
+                LBvtk<LT> vtk(std::istringstream(balancer.repartition(grid, nodes)));
+                grid = Grid<LT>(vtk);
+                nodes = Nodes<LT>(vtk, grid);
+                mpiBoundary = BndMpi<LT>(vtk, nodes, grid);
+                bbBnd = HalfWayBounceBack<LT>(findBulkNodes(nodes), nodes, grid);
+                solidBnd = findSolidBndNodes(nodes);
+                bulkNodes = findBulkNodes(nodes);
+                output = makeOutput();
+                if (myRank == 0)
+                    std::cout << "REPARTITION AT ITERATION " << i << ", IMBALANCE " << balancer.imbalance() << std::endl;
+            }
+        }
+
 
 
 
@@ -421,7 +465,7 @@ int main()
             ofs.close(); */
 
             // JLV
-            output.write(i);
+            output->write(i);
 
 	    if (myRank==0){
 	      std::ofstream ofs;
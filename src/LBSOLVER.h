@@ -1,31 +1,52 @@
 #ifndef LBSOLVER_LIB
 #define LBSOLVER_LIB
 
+#include "lbsolver/LBactiveset.h"
 #include "lbsolver/LBbndmpi.h"
 #include "lbsolver/LBbounceback.h"
 #include "lbsolver/LBboundary.h"
+#include "lbsolver/LBboundarylinks.h"
 #include "lbsolver/LBcollision2phase.h"
 #include "lbsolver/LBcollision.h"
+#include "lbsolver/LBcollisionmoment.h"
+#include "lbsolver/LBconvergence.h"
 #include "lbsolver/LBd2q9.h"
 #include "lbsolver/LBd3q19.h"
+#include "lbsolver/LBd3q27.h"
 #include "lbsolver/LBfield.h"
 #include "lbsolver/LBfreeFlowCartesian.h"
 #include "lbsolver/LBfreeSlipCartesian.h"
 #include "lbsolver/LBfreeslipsolid.h"
 #include "lbsolver/LBgeometry.h"
+#include "lbsolver/LBgeometrygenerator.h"
 #include "lbsolver/LBglobal.h"
 #include "lbsolver/LBgrid.h"
+#include "lbsolver/LBgridtransfer.h"
 #include "lbsolver/LBhalfwaybb.h"
+#include "lbsolver/LBimmersedboundary.h"
 #include "lbsolver/LBinitiatefield.h"
 #include "lbsolver/LBinletoutlet.h"
+#include "lbsolver/LBinterpolatedbb.h"
+#include "lbsolver/LBkernelcost.h"
+#include "lbsolver/LBles.h"
 #include "lbsolver/LBlatticetypes.h"
+#include "lbsolver/LBloadbalance.h"
 #include "lbsolver/LBmacroscopic.h"
+#include "lbsolver/LBmovingboundary.h"
 #include "lbsolver/LBnodes.h"
 #include "lbsolver/LBpressurebnd.h"
+#include "lbsolver/LBprofiler.h"
+#include "lbsolver/LBranskepsilon.h"
+#include "lbsolver/LBrefinement.h"
+#include "lbsolver/LBrotatingframe.h"
+#include "lbsolver/LBslidinginterface.h"
 #include "lbsolver/LBsnippets.h"
+#include "lbsolver/LBsuspension.h"
 #include "lbsolver/LButilities.h"
 #include "lbsolver/LBglobalforcing.h"
 #include "lbsolver/LBvtk.h"
+#include "lbsolver/LBwallfunction.h"
 #include "lbsolver/LBrheology.h"
+#include "lbsolver/LBrigidbody.h"
 
 #endif
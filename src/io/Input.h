@@ -471,6 +471,11 @@ public:
         return var_names;
     }
     
+    //                                     Block
+    //-----------------------------------------------------------------------------------
+    bool contains(const char* keyword) const { return (find(std::string(keyword)) != nullptr); }
+    //-----------------------------------------------------------------------------------
+
     //                                     Block
     //-----------------------------------------------------------------------------------
     const Block& operator[](const char* keyword) const
@@ -850,6 +855,11 @@ public:
     const Block& operator[](const char *key) { return head_block_[key]; }
     //-----------------------------------------------------------------------------------
 
+    //                                     Input
+    //-----------------------------------------------------------------------------------
+    bool contains(const char *key) const { return head_block_.contains(key); }
+    //-----------------------------------------------------------------------------------
+
     //                                     Input
     //-----------------------------------------------------------------------------------
     const std::string& filename() const { return head_block_.name_; }
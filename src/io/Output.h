@@ -10,6 +10,7 @@
 #include "../lbsolver/LBnodes.h"
 #include "../lbsolver/LBgrid.h"
 #include "../lbsolver/LBfield.h"
+#include "../lbsolver/LBprofiler.h"
 #include "VTK.h"
 
 
@@ -51,7 +52,11 @@ class Output
 
     //                                     Output
     //-----------------------------------------------------------------------------------
-    void write(double t=0.0) { out_.write(t); }
+    void write(double t=0.0) {
+        static const int region = profiler().region("Output::write");
+        ScopedTimer timer(region);
+        out_.write(t);
+    }
     //-----------------------------------------------------------------------------------
 
     //                                     Output
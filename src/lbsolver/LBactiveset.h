@@ -0,0 +1,287 @@
+#ifndef LBACTIVESET_H
+#define LBACTIVESET_H
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <map>
+#include <vector>
+#include "LBglobal.h"
+#include "LBlatticetypes.h"
+#include "LBgrid.h"
+#include "LBfield.h"
+#include "LBbndmpi.h"
+#include "../io/Input.h"
+
+/*********************************************************
+ * class ACTIVESET: the bulk nodes where a transported
+ *  scalar (a tracer or a concentration) is non-negligible.
+ *
+ * The bulk nodes are grouped in tiles of tileSize^nD nodes
+ *  by position, counted from the lowest position on the
+ *  rank. A tile is hot if the concentration, max over
+ *  fields |sum_q g_q|, is above the threshold at one of
+ *  its nodes. Hot tiles and their neighbor tiles are
+ *  active, so a front can move tileSize nodes before it
+ *  reaches an inactive tile. Across ranks, a tile next to
+ *  a hot tile is hot, and a tile next to an active tile
+ *  is active, as tiles at the end of a rank may be thin.
+ *  The set is updated every interval time steps, and the
+ *  interval must not be larger than the tile size.
+ *
+ * Only the distributions of active nodes are collided and
+ *  propagated, and only those are sent in the halo
+ *  exchange. Inactive nodes keep their (small) values. The
+ *  concentration below the threshold at the edge of the
+ *  front is therefore not transported, so the threshold is
+ *  the accuracy of the scalar field. With threshold 0 all
+ *  nodes with a nonzero value are active.
+ *
+ * The two buffers of the lb field are swapped every step,
+ *  so update copies the distributions of the nodes that
+ *  become inactive to the second buffer. Both buffers then
+ *  hold the same values on the inactive nodes, apart from
+ *  the links from active nodes. Macroscopic values set in
+ *  the node loop, like the concentration, are not updated
+ *  on inactive nodes, and keep the values from the last
+ *  step they were active.
+ *
+ * The set is set up from the input file block
+ *     <activeset>
+ *         threshold   1e-10
+ *         tile        4      # optional
+ *         interval    4      # optional, default the tile size
+ *     <end>
+ * and all bulk nodes are active if the block is missing.
+ * In the main loop, after the boundary conditions:
+ *     activeSet.update(i, g, gTmp, mpiBoundary);
+ *     for (auto nodeNo: activeSet.nodes()) {...}
+ *     ...
+ *     mpiBoundary.communicateLbField(g, grid, activeSet.mask());
+ *********************************************************/
+template <typename DXQY>
+class ActiveSet
+{
+public:
+    ActiveSet(const Grid<DXQY> &grid, const std::vector<int> &bulkNodes, const lbBase_t threshold, const int tileSize=4, const int interval=0);
+    ActiveSet(const Grid<DXQY> &grid, const std::vector<int> &bulkNodes, Input &input);
+
+    template <typename S>
+    void update(const int iteration, const LbField<DXQY, S> &field, LbField<DXQY, S> &fieldTmp, BndMpi<DXQY> &mpiBoundary);
+
+    inline bool enabled() const {return enabled_;}
+    inline const std::vector<int> &nodes() const {return enabled_ ? activeNodes_ : bulkNodes_;}
+    inline const std::vector<char> &mask() const {return isActive_;}
+    inline bool isActive(const int nodeNo) const {return isActive_[nodeNo];}
+    inline int numTiles() const {return static_cast<int>(tileNodes_.size());}
+    inline int numActiveTiles() const {return numActiveTiles_;}
+
+private:
+    void setup(const Grid<DXQY> &grid);
+    void setFlags(const int fieldNo, const std::vector<char> &tileFlag, std::vector<char> &tileFlagOld);
+
+    bool enabled_;
+    lbBase_t threshold_;
+    int tileSize_;
+    int interval_;
+    std::vector<int> bulkNodes_;
+    std::vector<std::vector<int>> tileNodes_;  // Bulk nodes in each tile
+    std::vector<std::vector<int>> tileNeighbors_;  // Tiles linked to each tile
+    std::vector<std::vector<int>> tileHalo_;  // Non-bulk nodes linked to each tile
+    std::vector<char> tileHot_;
+    std::vector<char> tileActive_;
+    std::vector<int> checkTiles_;  // Tiles where the concentration may have changed since the last update
+    std::vector<int> activeNodes_;
+    std::vector<char> isActive_;  // Per node
+    ScalarField flags_;  // Hot (field 0) and active (field 1) tile flags per node, for the halo exchange
+    int numActiveTiles_;
+};
+
+
+template <typename DXQY>
+ActiveSet<DXQY>::ActiveSet(const Grid<DXQY> &grid, const std::vector<int> &bulkNodes, const lbBase_t threshold, const int tileSize, const int interval)
+    : enabled_(true), threshold_(threshold), tileSize_(tileSize), interval_(interval > 0 ? interval : tileSize), bulkNodes_(bulkNodes),
+      flags_(2, grid.size()), numActiveTiles_(0)
+/* grid, bulkNodes : grid and bulk nodes on this rank
+ * threshold       : concentration below which a node may be skipped
+ * tileSize        : tile edge length in nodes
+ * interval        : number of time steps between updates (default tileSize)
+ */
+{
+    setup(grid);
+}
+
+
+template <typename DXQY>
+ActiveSet<DXQY>::ActiveSet(const Grid<DXQY> &grid, const std::vector<int> &bulkNodes, Input &input)
+    : enabled_(input.contains("activeset")), threshold_(0), tileSize_(4), interval_(4), bulkNodes_(bulkNodes),
+      flags_(2, grid.size()), numActiveTiles_(0)
+/* input : reads the activeset block, see the class comment
+ */
+{
+    if (enabled_) {
+        const Block &block = input["activeset"];
+        threshold_ = block["threshold"];
+        if (block.contains("tile"))
+            tileSize_ = block["tile"];
+        interval_ = block.contains("interval") ? static_cast<int>(block["interval"]) : tileSize_;
+    }
+    setup(grid);
+}
+
+
+template <typename DXQY>
+void ActiveSet<DXQY>::setup(const Grid<DXQY> &grid)
+{
+    if ( (tileSize_ < 1) || (interval_ < 1) || (interval_ > tileSize_) || (threshold_ < 0) ) {
+        std::cout << "ERROR in ActiveSet: use a tile size >= 1, an interval from 1 to the tile size, and a threshold >= 0" << std::endl;
+        exit(1);
+    }
+    isActive_.assign(grid.size(), 1);
+    if (!enabled_)
+        return;
+
+    std::vector<int> minPos(DXQY::nD, grid.size());
+    for (const auto &nodeNo: bulkNodes_)
+        for (int d = 0; d < DXQY::nD; ++d)
+            minPos[d] = std::min(minPos[d], grid.pos(nodeNo, d));
+    std::map<std::vector<int>, int> tileNo;
+    std::vector<int> nodeTile(grid.size(), -1);
+    std::vector<int> key(DXQY::nD);
+    for (const auto &nodeNo: bulkNodes_) {
+        for (int d = 0; d < DXQY::nD; ++d)
+            key[d] = (grid.pos(nodeNo, d) - minPos[d])/tileSize_;
+        const auto ret = tileNo.emplace(key, static_cast<int>(tileNo.size()));
+        nodeTile[nodeNo] = ret.first->second;
+    }
+    const int nTiles = static_cast<int>(tileNo.size());
+    tileNodes_.assign(nTiles, {});
+    tileNeighbors_.assign(nTiles, {});
+    tileHalo_.assign(nTiles, {});
+    for (const auto &nodeNo: bulkNodes_) {
+        const int t = nodeTile[nodeNo];
+        tileNodes_[t].push_back(nodeNo);
+        for (int q = 0; q < DXQY::nQNonZero_; ++q) {
+            const int neigNode = grid.neighbor(q, nodeNo);
+            if (neigNode == 0)
+                continue;
+            if (nodeTile[neigNode] < 0)
+                tileHalo_[t].push_back(neigNode);
+            else if (nodeTile[neigNode] != t)
+                tileNeighbors_[t].push_back(nodeTile[neigNode]);
+        }
+    }
+    for (int t = 0; t < nTiles; ++t) {
+        for (auto *list: {&tileNeighbors_[t], &tileHalo_[t]}) {
+            std::sort(list->begin(), list->end());
+            list->erase(std::unique(list->begin(), list->end()), list->end());
+        }
+    }
+
+    // Everything is active until the first update, which checks all tiles
+    tileHot_.assign(nTiles, 1);
+    tileActive_.assign(nTiles, 1);
+    for (const auto &nodeNo: bulkNodes_) {
+        flags_(0, nodeNo) = 1;
+        flags_(1, nodeNo) = 1;
+    }
+    checkTiles_.resize(nTiles);
+    for (int t = 0; t < nTiles; ++t)
+        checkTiles_[t] = t;
+    activeNodes_ = bulkNodes_;
+    numActiveTiles_ = nTiles;
+}
+
+
+template <typename DXQY>
+template <typename S>
+void ActiveSet<DXQY>::update(const int iteration, const LbField<DXQY, S> &field, LbField<DXQY, S> &fieldTmp, BndMpi<DXQY> &mpiBoundary)
+/* update : recomputes the active set if iteration is a multiple of the interval.
+ *  Call it after the boundary conditions, with the scalar lb field and the
+ *  field it is swapped with. fieldTmp is set to field on the nodes that become
+ *  inactive.
+ *
+ * Only tiles that were active at the last update, or next to an active tile, can
+ *  have changed, so the concentration is only computed there. Two scalar halo
+ *  exchanges give the hot and active tiles of the neighbor ranks.
+ */
+{
+    if ( !enabled_ || (iteration % interval_ != 0) )
+        return;
+
+    const int nTiles = numTiles();
+    std::vector<char> hot(nTiles, 0);
+    for (const auto &t: checkTiles_) {
+        for (const auto &nodeNo: tileNodes_[t]) {
+            for (int fieldNo = 0; fieldNo < field.num_fields(); ++fieldNo) {
+                lbBase_t sum = 0;
+                for (int q = 0; q < DXQY::nQ; ++q)
+                    sum += field(fieldNo, q, nodeNo);
+                hot[t] = hot[t] || (std::abs(sum) > threshold_);
+            }
+            if (hot[t])
+                break;
+        }
+    }
+    // Hot tiles on the neighbor ranks
+    setFlags(0, hot, tileHot_);
+    mpiBoundary.communciateScalarField(0, flags_);
+    for (int t = 0; t < nTiles; ++t)
+        for (const auto &nodeNo: tileHalo_[t])
+            hot[t] = hot[t] || (flags_(0, nodeNo) > 0);
+
+    std::vector<char> active(hot);
+    for (int t = 0; t < nTiles; ++t)
+        if (hot[t])
+            for (const auto &neig: tileNeighbors_[t])
+                active[neig] = 1;
+    // Active tiles on the neighbor ranks
+    setFlags(1, active, tileActive_);
+    mpiBoundary.communciateScalarField(1, flags_);
+    for (int t = 0; t < nTiles; ++t)
+        for (const auto &nodeNo: tileHalo_[t])
+            active[t] = active[t] || (flags_(1, nodeNo) > 0);
+
+    checkTiles_.clear();
+    activeNodes_.clear();
+    std::vector<char> check(active);
+    numActiveTiles_ = 0;
+    for (int t = 0; t < nTiles; ++t) {
+        if (active[t] != isActive_[tileNodes_[t][0]]) {
+            for (const auto &nodeNo: tileNodes_[t]) {
+                isActive_[nodeNo] = active[t];
+                if (!active[t])
+                    for (int fieldNo = 0; fieldNo < field.num_fields(); ++fieldNo)
+                        for (int q = 0; q < DXQY::nQ; ++q)
+                            fieldTmp(fieldNo, q, nodeNo) = field(fieldNo, q, nodeNo);
+            }
+        }
+        if (!active[t])
+            continue;
+        ++numActiveTiles_;
+        activeNodes_.insert(activeNodes_.end(), tileNodes_[t].begin(), tileNodes_[t].end());
+        for (const auto &neig: tileNeighbors_[t])
+            check[neig] = 1;
+    }
+    for (int t = 0; t < nTiles; ++t)
+        if (check[t])
+            checkTiles_.push_back(t);
+}
+
+
+template <typename DXQY>
+void ActiveSet<DXQY>::setFlags(const int fieldNo, const std::vector<char> &tileFlag, std::vector<char> &tileFlagOld)
+/* setFlags : sets field fieldNo of flags_ on the nodes of the tiles where the flag changed
+ */
+{
+    for (int t = 0; t < numTiles(); ++t) {
+        if (tileFlag[t] == tileFlagOld[t])
+            continue;
+        for (const auto &nodeNo: tileNodes_[t])
+            flags_(fieldNo, nodeNo) = tileFlag[t];
+        tileFlagOld[t] = tileFlag[t];
+    }
+}
+
+
+#endif // LBACTIVESET_H
@@ -18,6 +18,7 @@
 #include "../io/Input.h"
 #include "../lbsolver/LButilities.h"
 #include "../lbsolver/LBvtk.h"
+#include "../lbsolver/LBprofiler.h"
 
 /********************************************************* PROTOCOL
  * We assume the existence of three types of input-files:
@@ -88,12 +89,17 @@ public:
     void inline communciateScalarField(ScalarField &field);
     void inline communciateVectorField_TEST(const int fieldNo, VectorField<DXQY> &field);
     void inline communciateVectorField_TEST(VectorField<DXQY> &field);
-    void inline communicateLbField(const int fieldNo, LbField<DXQY> &field, Grid<DXQY> &grid);
-    void inline communicateLbField(LbField<DXQY> &field, Grid<DXQY> &grid);
+    template <typename S>
+    void inline communicateLbField(const int fieldNo, LbField<DXQY, S> &field, Grid<DXQY> &grid);
+    template <typename S>
+    void inline communicateLbField(LbField<DXQY, S> &field, Grid<DXQY> &grid);
+    template <typename S>
+    void inline communicateLbField(LbField<DXQY, S> &field, Grid<DXQY> &grid, const std::vector<char> &isActive);
     void setup(LBvtk<DXQY> &vtklb, const Nodes<DXQY> &nodes, const Grid<DXQY> &grid);
     void setupNodeType(Nodes<DXQY> &nodes);
 
     void printNodesToSend();
+    std::vector<int> neighborRanks() const;
     void printInfo() {
         std::cout << "Number of neighbors = " << mpiList_.size() << std::endl;
     }
@@ -103,9 +109,22 @@ private:
     std::vector<MonLatMpi> mpiList_;
 };
 
+template <typename DXQY>
+std::vector<int> BndMpi<DXQY>::neighborRanks() const
+/* neighborRanks : ranks of the neighboring processes, in the communication order.
+ */
+{
+    std::vector<int> ret;
+    for (const auto& mpibnd: mpiList_)
+        ret.push_back(mpibnd.neigRank());
+    return ret;
+}
+
 template <typename DXQY>
 void inline BndMpi<DXQY>::communciateScalarField(const int fieldNo, ScalarField &field)
 {
+    static const int region = profiler().region("BndMpi::communicate");
+    ScopedTimer timer(region);
     for (auto& mpibnd: mpiList_)
         mpibnd.communicateScalarField(myRank_, field, fieldNo);
 }
@@ -114,6 +133,8 @@ void inline BndMpi<DXQY>::communciateScalarField(const int fieldNo, ScalarField
 template <typename DXQY>
 void inline BndMpi<DXQY>::communciateScalarField(ScalarField &field)
 {
+    static const int region = profiler().region("BndMpi::communicate");
+    ScopedTimer timer(region);
     for (int n = 0; n < field.num_fields(); ++n) {
         for (auto& mpibnd: mpiList_)
             mpibnd.communicateScalarField(myRank_, field, n);            
@@ -124,6 +145,8 @@ void inline BndMpi<DXQY>::communciateScalarField(ScalarField &field)
 template <typename DXQY>
 void inline BndMpi<DXQY>::communciateVectorField_TEST(const int fieldNo, VectorField<DXQY> &field)
 {
+    static const int region = profiler().region("BndMpi::communicate");
+    ScopedTimer timer(region);
     for (auto& mpibnd: mpiList_)
         mpibnd.communicateVectorField_TEST(myRank_, field, fieldNo);
 }
@@ -131,6 +154,8 @@ void inline BndMpi<DXQY>::communciateVectorField_TEST(const int fieldNo, VectorF
 template <typename DXQY>
 void inline BndMpi<DXQY>::communciateVectorField_TEST(VectorField<DXQY> &field)
 {
+    static const int region = profiler().region("BndMpi::communicate");
+    ScopedTimer timer(region);
     for (int n = 0; n < field.num_fields(); ++n) {
         for (auto& mpibnd: mpiList_)
             mpibnd.communicateVectorField_TEST(myRank_, field, n);            
@@ -139,20 +164,42 @@ void inline BndMpi<DXQY>::communciateVectorField_TEST(VectorField<DXQY> &field)
 
 
 template <typename DXQY>
-void inline BndMpi<DXQY>::communicateLbField(const int fieldNo, LbField<DXQY> &field, Grid<DXQY> &grid)
+template <typename S>
+void inline BndMpi<DXQY>::communicateLbField(const int fieldNo, LbField<DXQY, S> &field, Grid<DXQY> &grid)
 {
+    static const int region = profiler().region("BndMpi::communicate");
+    ScopedTimer timer(region);
     for (auto& mpibnd: mpiList_)
         mpibnd.communicateLbField(myRank_, grid, field, fieldNo);
 }
 
 
 template <typename DXQY>
-void inline BndMpi<DXQY>::communicateLbField(LbField<DXQY> &field, Grid<DXQY> &grid)
+template <typename S>
+void inline BndMpi<DXQY>::communicateLbField(LbField<DXQY, S> &field, Grid<DXQY> &grid)
+/* communicateLbField : communicates all fields, with one message per neighbor
+ *  rank. Store coupled distributions (for instance flow, k and epsilon) as
+ *  fields of one LbField to share the halo exchange.
+ */
 {
-    for (int n=0; n < field.num_fields(); ++n) {
-        for (auto& mpibnd: mpiList_)
-            mpibnd.communicateLbField(myRank_, grid, field, n);        
-    }
+    static const int region = profiler().region("BndMpi::communicate");
+    ScopedTimer timer(region);
+    for (auto& mpibnd: mpiList_)
+        mpibnd.communicateLbField(myRank_, grid, field);
+}
+
+
+template <typename DXQY>
+template <typename S>
+void inline BndMpi<DXQY>::communicateLbField(LbField<DXQY, S> &field, Grid<DXQY> &grid, const std::vector<char> &isActive)
+/* communicateLbField : communicates all fields, but only the distributions
+ *  propagated from nodes with isActive[nodeNo] != 0 (see ActiveSet)
+ */
+{
+    static const int region = profiler().region("BndMpi::communicate");
+    ScopedTimer timer(region);
+    for (auto& mpibnd: mpiList_)
+        mpibnd.communicateLbField(myRank_, grid, field, isActive);
 }
 
 
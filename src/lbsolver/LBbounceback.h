@@ -3,6 +3,7 @@
 
 #include "LBhalfwayhelperclass.h"
 #include "LBfield.h"
+#include "LBkernelcost.h"
 
 /* Direction classification:
  * 
@@ -21,26 +22,43 @@ template<typename DXQY>
 class SolidBounceBack: public BoundaryHalwWayHelper<DXQY> 
 {
 public:
-    SolidBounceBack(const std::vector<int> &bndNodes, const Nodes<DXQY> &nodes, const Grid<DXQY> &grid) : BoundaryHalwWayHelper<DXQY>(bndNodes, nodes, grid) {}
-    void apply(const int fieldNo, LbField<DXQY> &f, const Grid<DXQY> &grid) const;
+    SolidBounceBack(const std::vector<int> &bndNodes, const Nodes<DXQY> &nodes, const Grid<DXQY> &grid);
+    template <typename S>
+    void apply(const int fieldNo, LbField<DXQY, S> &f, const Grid<DXQY> &grid) const;
+private:
+    BoundaryLinks solidLinks_; // Links from the boundary node to its neighbors
 };
 
 
 template<typename DXQY>
-void SolidBounceBack<DXQY>::apply(const int fieldNo, LbField<DXQY> &f, const Grid<DXQY> &grid) const
+SolidBounceBack<DXQY>::SolidBounceBack(const std::vector<int> &bndNodes, const Nodes<DXQY> &nodes, const Grid<DXQY> &grid) 
+: BoundaryHalwWayHelper<DXQY>(bndNodes, nodes, grid)
+/* Sets up the links in the same order as they are applied, so that 
+ * overlapping links give the same result as a node by node loop.
+ */
 {
     for (int bndNo = 0; bndNo < this->size(); ++bndNo) {
-        int nodeNo = this->nodeNo(bndNo);
+        const int nodeNo = this->nodeNo(bndNo);
         for (auto beta: this->beta(bndNo)) {
-            int betaRev = this->dirRev(beta);
-            f(fieldNo, beta, grid.neighbor(beta, nodeNo)) = f(fieldNo, betaRev, nodeNo);
+            const int betaRev = this->dirRev(beta);
+            solidLinks_.add(grid.neighbor(beta, nodeNo), beta, betaRev, nodeNo);
         }
         for (auto gamma: this->gamma(bndNo)) {
-            int gammaRev = this->dirRev(gamma);
-            f(fieldNo, gamma, grid.neighbor(gamma, nodeNo)) = f(fieldNo, gammaRev, nodeNo);
-            f(fieldNo, gammaRev, grid.neighbor(gammaRev, nodeNo)) = f(fieldNo, gamma, nodeNo);
+            const int gammaRev = this->dirRev(gamma);
+            solidLinks_.add(grid.neighbor(gamma, nodeNo), gamma, gammaRev, nodeNo);
+            solidLinks_.add(grid.neighbor(gammaRev, nodeNo), gammaRev, gamma, nodeNo);
         }
     }
 }
 
+
+template<typename DXQY>
+template <typename S>
+void SolidBounceBack<DXQY>::apply(const int fieldNo, LbField<DXQY, S> &f, const Grid<DXQY> &grid) const
+{
+    static const int region = profiler().region("SolidBounceBack::apply");
+    ScopedTimer timer(region, solidLinks_.size()*KernelCost<DXQY, S>::bounceBackLink());
+    solidLinks_.copy(fieldNo, f);
+}
+
 #endif
\ No newline at end of file
@@ -7,6 +7,7 @@
 #include "LBlatticetypes.h"
 #include "LBnodes.h"
 #include "LBgrid.h"
+#include "LBboundarylinks.h"
 
 
 
@@ -0,0 +1,68 @@
+#ifndef LBBOUNDARYLINKS_H
+#define LBBOUNDARYLINKS_H
+
+#include <vector>
+
+/*********************************************************
+ * class BOUNDARYLINKS: flat list of boundary links
+ *
+ * The links are stored as a structure of arrays, so that
+ *  boundary conditions can loop over all links without
+ *  building direction lists for each boundary node.
+ *
+ * A link is the tuple (node, qIn, qOut, neighbor):
+ *  the distribution qIn at node is set from the
+ *  distribution qOut at node neighbor. For halfway
+ *  bounce back this is
+ *     f(qIn, node) = f(qOut, neighbor),
+ *  with qOut = reverse(qIn) and neighbor the node that
+ *  qOut streamed into.
+ *
+ * The links are set up in the boundary constructors, in
+ *  boundary node order.
+ *********************************************************/
+class BoundaryLinks
+{
+public:
+    BoundaryLinks() {}
+
+    inline void add(const int nodeNo, const int qIn, const int qOut, const int neigNo)
+    {
+        node_.push_back(nodeNo);
+        qIn_.push_back(qIn);
+        qOut_.push_back(qOut);
+        neighbor_.push_back(neigNo);
+    }
+
+    inline int size() const {return static_cast<int>(node_.size());}
+    inline int node(const int linkNo) const {return node_[linkNo];}
+    inline int qIn(const int linkNo) const {return qIn_[linkNo];}
+    inline int qOut(const int linkNo) const {return qOut_[linkNo];}
+    inline int neighbor(const int linkNo) const {return neighbor_[linkNo];}
+
+    template <typename F>
+    inline void copy(const int fieldNo, F &f) const
+    /* copy : sets f(fieldNo, qIn, node) = f(fieldNo, qOut, neighbor) for all links
+     *
+     * fieldNo : the lB-field number
+     * f       : the field object
+     */
+    {
+        const int *node = node_.data();
+        const int *qIn = qIn_.data();
+        const int *qOut = qOut_.data();
+        const int *neighbor = neighbor_.data();
+        const int nLinks = size();
+        for (int n = 0; n < nLinks; ++n) {
+            f(fieldNo, qIn[n], node[n]) = f(fieldNo, qOut[n], neighbor[n]);
+        }
+    }
+
+private:
+    std::vector<int> node_;  // Node where the value is set
+    std::vector<int> qIn_;  // Direction that is set
+    std::vector<int> qOut_;  // Direction that is read
+    std::vector<int> neighbor_;  // Node where the value is read
+};
+
+#endif // LBBOUNDARYLINKS_H
@@ -341,4 +341,147 @@ inline std::valarray<lbBase_t> calcDeltaOmegaGradDiff(const lbBase_t &tau, const
 }
 
 
+template <typename DXQY>
+inline std::valarray<lbBase_t> calcRegularizedFneq(const std::valarray<lbBase_t> &strainRateTildeLowTri)
+/* calcRegularizedFneq : reconstructs the non-equilibrium distribution from its second order 
+ * moment, 
+ *     f1_q = w_q/(2c^4) (c_q c_q - c^2 I):A1,   A1 = -strainRateTildeLowTri,
+ * where strainRateTildeLowTri is the value returned by calcStrainRateTildeLowTri (LBmacroscopic.h).
+ *
+ * strainRateTildeLowTri : lower triangular LB strain rate, without 1/(2*rho*c2*tau)
+ * ret                   : array of the regularized non-equilibrium distribution
+ */
+{
+    std::valarray<lbBase_t> ret(DXQY::nQ);
+    const lbBase_t traceA = -DXQY::traceLowTri(strainRateTildeLowTri);
+
+    for (int q = 0; q < DXQY::nQ; ++q)
+    {
+        lbBase_t cAc = 0;
+        int it = 0;
+        for (int i = 0; i < DXQY::nD; ++i) {
+            for (int j = 0; j < i; ++j) {
+                cAc -= 2*strainRateTildeLowTri[it]*DXQY::c(q, i)*DXQY::c(q, j);
+                it++;
+            }
+            cAc -= strainRateTildeLowTri[it]*DXQY::c(q, i)*DXQY::c(q, i);
+            it++;
+        }
+        ret[q] = DXQY::w[q]*DXQY::c4Inv0_5*(cAc - DXQY::c2*traceA);
+    }
+    return ret;
+}
+
+template <typename DXQY, typename T>
+inline std::valarray<lbBase_t> calcRecursiveRegularizedFneq(const T &vel, const std::valarray<lbBase_t> &cu, const std::valarray<lbBase_t> &strainRateTildeLowTri)
+/* calcRecursiveRegularizedFneq : reconstructs the non-equilibrium distribution from its second 
+ * order moment, and adds the third order Hermite term given by the recursive relation 
+ *     A1_ijk = u_i A1_jk + u_j A1_ik + u_k A1_ij,
+ * so that
+ *     f1_q = w_q/(2c^4) H2_q:A1 + w_q/(2c^6) [(c_q.u)(c_q.A1.c_q - c^2 tr A1) - 2c^2 u.A1.c_q].
+ * Third order Hermite polynomials that vanish on the lattice (e.g. xyz on D3Q19) drop out
+ * by themselves. 
+ *
+ * vel                   : velocity
+ * cu                    : array of scalar product of all lattice vectors and the velocity.
+ * strainRateTildeLowTri : lower triangular LB strain rate, without 1/(2*rho*c2*tau)
+ * ret                   : array of the regularized non-equilibrium distribution
+ */
+{
+    std::valarray<lbBase_t> ret(DXQY::nQ);
+    const lbBase_t traceA = -DXQY::traceLowTri(strainRateTildeLowTri);
+    const lbBase_t c6Inv0_5 = 0.5*DXQY::c2Inv*DXQY::c2Inv*DXQY::c2Inv;
+
+    for (int q = 0; q < DXQY::nQ; ++q)
+    {
+        lbBase_t cAc = 0;
+        lbBase_t uAc = 0;
+        int it = 0;
+        for (int i = 0; i < DXQY::nD; ++i) {
+            for (int j = 0; j < i; ++j) {
+                cAc -= 2*strainRateTildeLowTri[it]*DXQY::c(q, i)*DXQY::c(q, j);
+                uAc -= strainRateTildeLowTri[it]*(vel[i]*DXQY::c(q, j) + vel[j]*DXQY::c(q, i));
+                it++;
+            }
+            cAc -= strainRateTildeLowTri[it]*DXQY::c(q, i)*DXQY::c(q, i);
+            uAc -= strainRateTildeLowTri[it]*vel[i]*DXQY::c(q, i);
+            it++;
+        }
+        const lbBase_t QA = cAc - DXQY::c2*traceA;
+        ret[q] = DXQY::w[q]*(DXQY::c4Inv0_5*QA + c6Inv0_5*(cu[q]*QA - 2*DXQY::c2*uAc));
+    }
+    return ret;
+}
+
+template <typename DXQY, typename T>
+inline std::valarray<lbBase_t> calcOmegaRegularized(const T &f, const lbBase_t &tau, const lbBase_t& rho, const lbBase_t& u_sq, const std::valarray<lbBase_t> &cu, const lbBase_t &uF, const std::valarray<lbBase_t> &cF, const std::valarray<lbBase_t> &strainRateTildeLowTri)
+/* calcOmegaRegularized : sets the regularized BGK-collision term in the lattice boltzmann equation
+ *
+ * The non-equilibrium part of f is replaced by the projection of the strain rate onto the 
+ * second order Hermite polynomial (calcRegularizedFneq) before relaxation. As the strain rate 
+ * from calcStrainRateTildeLowTri includes the half force correction, half of the force term is 
+ * removed again here, so that the force is added as usual with calcDeltaOmegaF:
+ *     f + omega + deltaOmegaF = feq + (1 - 1/tau) (f1 - F/2) + (1 - 1/(2tau)) F.
+ * The strain rate is an input so that it can be shared with the rheology and LES models.
+ *
+ * f                     : pointer to node's lb distribution
+ * tau                   : relaxation time
+ * rho                   : density
+ * u_sq                  : square of the velocity
+ * cu                    : array of scalar product of all lattice vectors and the velocity.
+ * uF                    : scalar product of velocity and body force.
+ * cF                    : array of scalar product of all lattice vectors and body force.
+ * strainRateTildeLowTri : value returned by calcStrainRateTildeLowTri
+ * omegaReg              : array of the regularized collision term in each lattice direction
+ */
+{
+    const std::valarray<lbBase_t> fneq = calcRegularizedFneq<DXQY>(strainRateTildeLowTri);
+    std::valarray<lbBase_t> ret(DXQY::nQ);
+    const lbBase_t tau_factor = 1.0 - 1.0/tau;
+    for (int q = 0; q < DXQY::nQ; ++q)
+    {
+        const lbBase_t feq = rho * DXQY::w[q]*(1.0 + DXQY::c2Inv*cu[q] + DXQY::c4Inv0_5*(cu[q]*cu[q] - DXQY::c2*u_sq));
+        const lbBase_t forceHalf = 0.5*DXQY::w[q]*(DXQY::c2Inv*cF[q] + DXQY::c4Inv*(cF[q]*cu[q] - DXQY::c2*uF));
+        ret[q] = feq - f[q] + tau_factor*(fneq[q] - forceHalf);
+    }
+    return ret;
+}
+
+template <typename DXQY, typename T1, typename T2>
+inline std::valarray<lbBase_t> calcOmegaRecursiveRegularized(const T1 &f, const lbBase_t &tau, const lbBase_t& rho, const T2 &vel, const lbBase_t& u_sq, const std::valarray<lbBase_t> &cu, const lbBase_t &uF, const std::valarray<lbBase_t> &cF, const std::valarray<lbBase_t> &strainRateTildeLowTri)
+/* calcOmegaRecursiveRegularized : sets the recursive regularized BGK-collision term in the lattice 
+ * boltzmann equation
+ *
+ * Same as calcOmegaRegularized, but both the equilibrium and the non-equilibrium distribution 
+ * are extended with the third order Hermite terms supported by the lattice, 
+ *     feq3_q = w_q rho/(6c^6) (c_q.u)[(c_q.u)^2 - 3c^2 u^2],
+ * and calcRecursiveRegularizedFneq.
+ *
+ * f                     : pointer to node's lb distribution
+ * tau                   : relaxation time
+ * rho                   : density
+ * vel                   : velocity
+ * u_sq                  : square of the velocity
+ * cu                    : array of scalar product of all lattice vectors and the velocity.
+ * uF                    : scalar product of velocity and body force.
+ * cF                    : array of scalar product of all lattice vectors and body force.
+ * strainRateTildeLowTri : value returned by calcStrainRateTildeLowTri
+ * omegaReg              : array of the regularized collision term in each lattice direction
+ */
+{
+    const std::valarray<lbBase_t> fneq = calcRecursiveRegularizedFneq<DXQY>(vel, cu, strainRateTildeLowTri);
+    std::valarray<lbBase_t> ret(DXQY::nQ);
+    const lbBase_t tau_factor = 1.0 - 1.0/tau;
+    const lbBase_t c6Inv = DXQY::c2Inv*DXQY::c2Inv*DXQY::c2Inv;
+    for (int q = 0; q < DXQY::nQ; ++q)
+    {
+        const lbBase_t feq = rho * DXQY::w[q]*(1.0 + DXQY::c2Inv*cu[q] + DXQY::c4Inv0_5*(cu[q]*cu[q] - DXQY::c2*u_sq) 
+                                               + c6Inv/6.0*cu[q]*(cu[q]*cu[q] - 3*DXQY::c2*u_sq));
+        const lbBase_t forceHalf = 0.5*DXQY::w[q]*(DXQY::c2Inv*cF[q] + DXQY::c4Inv*(cF[q]*cu[q] - DXQY::c2*uF));
+        ret[q] = feq - f[q] + tau_factor*(fneq[q] - forceHalf);
+    }
+    return ret;
+}
+
+
 #endif // LBCOLLISION_H
@@ -0,0 +1,833 @@
+#ifndef LBCOLLISIONMOMENT_H
+#define LBCOLLISIONMOMENT_H
+
+#include <array>
+#include <type_traits>
+#include <utility>
+#include "LBglobal.h"
+#include "LBlatticetypes.h"
+
+/*********************************************************
+ * MOMENT SPACE COLLISION OPERATORS
+ *
+ * Collision operators that relax in moment space:
+ *  - MRT            : orthogonal (Gram-Schmidt) moment basis
+ *  - Central moment : raw moments shifted to the local velocity
+ *  - Cumulant       : central moments converted to cumulants
+ *
+ * The moment basis is built from the polynomials
+ *   c_x^a c_y^b c_z^c,  a, b, c in {0, 1, 2},
+ * ordered by polynomial degree. Polynomials that are linearly
+ * dependent on the lattice are discarded, which gives the usual
+ * 9 (D2Q9), 19 (D3Q19) and 27 (D3Q27) moments. All matrices are
+ * computed at compile time by MomentBasis<DXQY>, and the
+ * transforms are unrolled over the matrix entries (staticFor), so
+ * the zero entries cost nothing. The kernels work on fixed size
+ * arrays on the stack and return std::array<lbBase_t, nQ>.
+ *
+ * Relaxation times:
+ *  tau      : shear (deviatoric second order moments)
+ *  tauBulk  : trace of the second order moments
+ *  tauGhost : moments of order three and higher
+ * With tauBulk = tauGhost = tau the MRT operator reduces
+ * to the BGK operator.
+ *
+ * Usage (fused collision and propagation):
+ *   CumulantCollision<LT> cumulant(tauBulk, tauGhost);
+ *   ...
+ *   fTmp.propagateTo(0, nodeNo, cumulant.collide(fNode, tau, rhoNode, velNode, force), grid);
+ * where velNode is the force corrected velocity from calcVel.
+ *********************************************************/
+
+
+//                               MomentBasis helpers
+//-------------------------------------------------------------------------------------
+template <int NQ>
+using MomentMatrix = std::array<std::array<lbBase_t, NQ>, NQ>;
+
+template <int NQ>
+struct MomentTables
+{
+    std::array<std::array<int, 3>, NQ> exponent; // Exponents (a, b, c) of the raw moments
+    std::array<int, NQ> order;                   // Polynomial degree of the raw moments
+    std::array<std::array<std::array<int, 3>, 3>, 3> index; // Raw moment number of (a, b, c). -1 if not in the basis
+    MomentMatrix<NQ> raw;     // Raw moments: raw[k][q] = c_qx^a c_qy^b c_qz^c
+    MomentMatrix<NQ> rawInv;  // Inverse of raw
+    MomentMatrix<NQ> mrt;     // Gram-Schmidt orthogonal moments
+    MomentMatrix<NQ> mrtInv;  // Inverse of mrt
+    std::array<int, NQ> mrtOrder;  // Polynomial degree of the mrt moments
+    std::array<bool, NQ> mrtBulk;  // True for the trace of the second order moments
+};
+
+
+template <typename DXQY>
+constexpr lbBase_t momentPolynomial(const int q, const int a, const int b, const int c)
+/* momentPolynomial : returns c_qx^a c_qy^b c_qz^c. A negative a
+ *  gives the trace c_q^2.
+ */
+{
+    if (a < 0) {
+        lbBase_t ret = 0;
+        for (int d = 0; d < DXQY::nD; ++d)
+            ret += DXQY::cDMajor_[DXQY::nD*q + d]*DXQY::cDMajor_[DXQY::nD*q + d];
+        return ret;
+    }
+    const int exp[3] = {a, b, c};
+    lbBase_t ret = 1;
+    for (int d = 0; d < DXQY::nD; ++d)
+        for (int i = 0; i < exp[d]; ++i)
+            ret *= DXQY::cDMajor_[DXQY::nD*q + d];
+    return ret;
+}
+
+
+template <int NQ>
+constexpr bool gramSchmidtAppend(MomentMatrix<NQ> &basis, int &nBasis, std::array<lbBase_t, NQ> vec)
+/* gramSchmidtAppend : orthogonalizes vec against the nBasis first rows of basis
+ *  and appends the result. Returns false if vec is linearly dependent.
+ */
+{
+    for (int k = 0; k < nBasis; ++k) {
+        lbBase_t vm = 0, mm = 0;
+        for (int q = 0; q < NQ; ++q) {
+            vm += vec[q]*basis[k][q];
+            mm += basis[k][q]*basis[k][q];
+        }
+        for (int q = 0; q < NQ; ++q)
+            vec[q] -= (vm/mm)*basis[k][q];
+    }
+    lbBase_t norm = 0;
+    for (int q = 0; q < NQ; ++q)
+        norm += vec[q]*vec[q];
+    if (norm < 1e-10)
+        return false;
+    basis[nBasis] = vec;
+    nBasis += 1;
+    return true;
+}
+
+
+template <int NQ>
+constexpr MomentMatrix<NQ> invertMomentMatrix(MomentMatrix<NQ> mat)
+/* invertMomentMatrix : Gauss-Jordan elimination with partial pivoting.
+ */
+{
+    MomentMatrix<NQ> inv{};
+    for (int i = 0; i < NQ; ++i)
+        inv[i][i] = 1;
+
+    for (int col = 0; col < NQ; ++col) {
+        int pivot = col;
+        for (int row = col + 1; row < NQ; ++row) {
+            const lbBase_t a = mat[row][col] < 0 ? -mat[row][col] : mat[row][col];
+            const lbBase_t b = mat[pivot][col] < 0 ? -mat[pivot][col] : mat[pivot][col];
+            if (a > b)  pivot = row;
+        }
+        for (int j = 0; j < NQ; ++j) {
+            lbBase_t tmp = mat[col][j];  mat[col][j] = mat[pivot][j];  mat[pivot][j] = tmp;
+            tmp = inv[col][j];  inv[col][j] = inv[pivot][j];  inv[pivot][j] = tmp;
+        }
+        const lbBase_t pivotInv = 1.0/mat[col][col];
+        for (int j = 0; j < NQ; ++j) {
+            mat[col][j] *= pivotInv;
+            inv[col][j] *= pivotInv;
+        }
+        for (int row = 0; row < NQ; ++row) {
+            if (row != col) {
+                const lbBase_t factor = mat[row][col];
+                for (int j = 0; j < NQ; ++j) {
+                    mat[row][j] -= factor*mat[col][j];
+                    inv[row][j] -= factor*inv[col][j];
+                }
+            }
+        }
+    }
+    return inv;
+}
+
+
+template <typename DXQY>
+constexpr MomentTables<DXQY::nQ> makeMomentTables()
+{
+    constexpr int nQ = DXQY::nQ;
+    MomentTables<nQ> ret{};
+    for (int a = 0; a < 3; ++a)
+        for (int b = 0; b < 3; ++b)
+            for (int c = 0; c < 3; ++c)
+                ret.index[a][b][c] = -1;
+
+    MomentMatrix<nQ> rawOrtho{};
+    int nRaw = 0;
+    int nMrt = 0;
+    const int maxExp[3] = {2, DXQY::nD > 1 ? 2 : 0, DXQY::nD > 2 ? 2 : 0};
+
+    for (int degree = 0; degree <= 2*DXQY::nD; ++degree) {
+        // The trace of the second order moments is added first so that
+        // the bulk mode gets its own mrt moment
+        if (degree == 2) {
+            std::array<lbBase_t, nQ> vec{};
+            for (int q = 0; q < nQ; ++q)
+                vec[q] = momentPolynomial<DXQY>(q, -1, 0, 0);
+            const int k = nMrt;
+            if (gramSchmidtAppend<nQ>(ret.mrt, nMrt, vec)) {
+                ret.mrtOrder[k] = 2;
+                ret.mrtBulk[k] = true;
+            }
+        }
+        for (int a = 0; a <= maxExp[0]; ++a)
+            for (int b = 0; b <= maxExp[1]; ++b)
+                for (int c = 0; c <= maxExp[2]; ++c) {
+                    if (a + b + c != degree)
+                        continue;
+                    std::array<lbBase_t, nQ> vec{};
+                    for (int q = 0; q < nQ; ++q)
+                        vec[q] = momentPolynomial<DXQY>(q, a, b, c);
+                    // Raw moments
+                    const int k = nRaw;
+                    if (gramSchmidtAppend<nQ>(rawOrtho, nRaw, vec)) {
+                        ret.raw[k] = vec;
+                        ret.exponent[k] = {a, b, c};
+                        ret.order[k] = degree;
+                        ret.index[a][b][c] = k;
+                    }
+                    // Orthogonal moments
+                    const int m = nMrt;
+                    if (gramSchmidtAppend<nQ>(ret.mrt, nMrt, vec)) {
+                        ret.mrtOrder[m] = degree;
+                        ret.mrtBulk[m] = false;
+                    }
+                }
+    }
+
+    ret.rawInv = invertMomentMatrix<nQ>(ret.raw);
+    // Orthogonal rows: the inverse is the scaled transpose
+    for (int k = 0; k < nQ; ++k) {
+        lbBase_t mm = 0;
+        for (int q = 0; q < nQ; ++q)
+            mm += ret.mrt[k][q]*ret.mrt[k][q];
+        for (int q = 0; q < nQ; ++q)
+            ret.mrtInv[q][k] = ret.mrt[k][q]/mm;
+    }
+    return ret;
+}
+
+
+//=====================================================================================
+//
+//                              M O M E N T   B A S I S
+//
+//=====================================================================================
+template <typename F, int... I>
+inline void staticForImpl(F &&fun, std::integer_sequence<int, I...>)
+{
+    (fun(std::integral_constant<int, I>()), ...);
+}
+
+
+template <int N, typename F>
+inline void staticFor(F &&fun)
+/* staticFor : calls fun(std::integral_constant<int, i>()) for i = 0, ..., N-1. The loop
+ *  is unrolled, and i can be used in constant expressions in fun, e.g.
+ *     staticFor<DXQY::nQ>([&](auto q) { constexpr int Q = decltype(q)::value; ... });
+ */
+{
+    staticForImpl(fun, std::make_integer_sequence<int, N>());
+}
+
+
+template <typename DXQY>
+struct MomentBasis
+{
+    static constexpr int nQ = DXQY::nQ;
+    static constexpr MomentTables<DXQY::nQ> tables = makeMomentTables<DXQY>();
+    enum Matrix {RAW, RAW_INV, MRT, MRT_INV};
+
+    static constexpr const MomentMatrix<DXQY::nQ> &matrix(const int mat)
+    {
+        return (mat == RAW) ? tables.raw : ( (mat == RAW_INV) ? tables.rawInv : ( (mat == MRT) ? tables.mrt : tables.mrtInv ) );
+    }
+    static constexpr int index(const int k, const int d, const int e)
+    /* index : raw moment number of the exponents of moment k, with the exponent of c_d set to e */
+    {
+        std::array<int, 3> exp = tables.exponent[k];
+        exp[d] = e;
+        return tables.index[exp[0]][exp[1]][exp[2]];
+    }
+    static constexpr bool isDiagonal(const int k)
+    /* isDiagonal : true for the raw moments c_d^2 */
+    {
+        return (tables.order[k] == 2) && (tables.exponent[k][0] != 1) && (tables.exponent[k][1] != 1) && (tables.exponent[k][2] != 1);
+    }
+    static constexpr lbBase_t centralEquilibrium(const int k)
+    /* centralEquilibrium : central moment k of the Maxwell-Boltzmann distribution, divided by rho */
+    {
+        lbBase_t ret = 1;
+        for (int d = 0; d < DXQY::nD; ++d)
+            ret *= (tables.exponent[k][d] == 0) ? 1.0 : ( (tables.exponent[k][d] == 2) ? DXQY::c2 : 0.0 );
+        return ret;
+    }
+    static constexpr int mrtRate(const int k)
+    /* mrtRate : relaxation rate of the mrt moment k, 0 (shear), 1 (bulk) or 2 (ghost).
+     *  Conserved moments are given the shear rate so that the force correction is
+     *  consistent with calcDeltaOmegaF.
+     */
+    {
+        return (tables.mrtOrder[k] < 2) ? 0 : ( (tables.mrtOrder[k] == 2) ? (tables.mrtBulk[k] ? 1 : 0) : 2 );
+    }
+
+    template <int M, typename T>
+    inline static void transform(const T &in, lbBase_t *out);
+    template <typename T>
+    inline static void shift(T &mom, const lbBase_t *vel, const lbBase_t sign);
+};
+
+
+template <typename DXQY>
+template <int M, typename T>
+inline void MomentBasis<DXQY>::transform(const T &in, lbBase_t *out)
+/* transform : out = matrix(M)*in, unrolled over the matrix entries. Zero entries are
+ *  skipped and unit entries are added without a multiplication.
+ */
+{
+    staticFor<nQ>([&](auto k) {
+        constexpr int K = decltype(k)::value;
+        lbBase_t sum = 0;
+        staticFor<nQ>([&](auto q) {
+            constexpr int Q = decltype(q)::value;
+            constexpr lbBase_t a = matrix(M)[K][Q];
+            if constexpr (a == 1)
+                sum += in[Q];
+            else if constexpr (a == -1)
+                sum -= in[Q];
+            else if constexpr (a != 0)
+                sum += a*in[Q];
+        });
+        out[K] = sum;
+    });
+}
+
+
+template <typename DXQY>
+template <typename T>
+inline void MomentBasis<DXQY>::shift(T &mom, const lbBase_t *vel, const lbBase_t sign)
+/* shift : shifts raw moments to central moments (sign = -1), or central moments
+ *  back to raw moments (sign = 1). The shift is done one spatial dimension at the time,
+ *   m_2 <- m_2 + 2 s m_1 + s^2 m_0
+ *   m_1 <- m_1 + s m_0,
+ *  where s = sign*vel[d] and the subscript is the exponent of c_d.
+ */
+{
+    staticFor<DXQY::nD>([&](auto d) {
+        constexpr int D = decltype(d)::value;
+        const lbBase_t s = sign*vel[D];
+        staticFor<nQ>([&](auto k) {
+            constexpr int K = decltype(k)::value;
+            if constexpr (tables.exponent[K][D] == 2)
+                mom[K] += 2*s*mom[index(K, D, 1)] + s*s*mom[index(K, D, 0)];
+        });
+        staticFor<nQ>([&](auto k) {
+            constexpr int K = decltype(k)::value;
+            if constexpr (tables.exponent[K][D] == 1)
+                mom[K] += s*mom[index(K, D, 0)];
+        });
+    });
+}
+
+
+template <typename DXQY, typename T>
+inline std::array<lbBase_t, DXQY::nQ> momentCDotAll(const T &vec)
+/* momentCDotAll : DXQY::cDotAll(vec) as a fixed size array
+ */
+{
+    std::array<lbBase_t, DXQY::nQ> ret;
+    staticFor<DXQY::nQ>([&](auto q) {
+        constexpr int Q = decltype(q)::value;
+        lbBase_t sum = 0;
+        staticFor<DXQY::nD>([&](auto d) {
+            constexpr int D = decltype(d)::value;
+            constexpr int c = DXQY::cDMajor_[DXQY::nD*Q + D];
+            if constexpr (c == 1)
+                sum += vec[D];
+            else if constexpr (c == -1)
+                sum -= vec[D];
+        });
+        ret[Q] = sum;
+    });
+    return ret;
+}
+
+
+//                                     MRT
+//-------------------------------------------------------------------------------------
+template <typename DXQY, typename T1, typename T2>
+inline void calcMomentsNeqMRT(const T1 &f, const lbBase_t &tau, const lbBase_t &tauBulk, const lbBase_t &tauGhost, const lbBase_t& rho, const lbBase_t& u_sq, const T2 &cu, lbBase_t *mneq)
+/* calcMomentsNeqMRT : relaxed non-equilibrium mrt moments, -rate*M(f - feq)
+ */
+{
+    using MB = MomentBasis<DXQY>;
+    const lbBase_t rate[3] = {1.0/tau, 1.0/tauBulk, 1.0/tauGhost};
+
+    lbBase_t fneq[DXQY::nQ];
+    for (int q = 0; q < DXQY::nQ; ++q)
+        fneq[q] = f[q] - rho * DXQY::w[q]*(1.0 + DXQY::c2Inv*cu[q] + DXQY::c4Inv0_5*(cu[q]*cu[q] - DXQY::c2*u_sq));
+
+    MB::template transform<MB::MRT>(fneq, mneq);
+    staticFor<DXQY::nQ>([&](auto k) {
+        constexpr int K = decltype(k)::value;
+        mneq[K] *= -rate[MB::mrtRate(K)];
+    });
+}
+
+
+template <typename DXQY, typename T1, typename T2>
+inline void calcMomentsSourceMRT(const lbBase_t &tau, const lbBase_t &tauBulk, const lbBase_t &tauGhost, const T1 &cu, const lbBase_t &uF, const T2 &cF, lbBase_t *mSrc)
+/* calcMomentsSourceMRT : force source in mrt moments, (1 - rate/2)*M(src)
+ */
+{
+    using MB = MomentBasis<DXQY>;
+    const lbBase_t rate[3] = {1.0/tau, 1.0/tauBulk, 1.0/tauGhost};
+
+    lbBase_t src[DXQY::nQ];
+    for (int q = 0; q < DXQY::nQ; ++q)
+        src[q] = DXQY::w[q]*(DXQY::c2Inv*cF[q] + DXQY::c4Inv * ( cF[q] * cu[q] - DXQY::c2 * uF));
+
+    MB::template transform<MB::MRT>(src, mSrc);
+    staticFor<DXQY::nQ>([&](auto k) {
+        constexpr int K = decltype(k)::value;
+        mSrc[K] *= (1 - 0.5*rate[MB::mrtRate(K)]);
+    });
+}
+
+
+template <typename DXQY, typename T1, typename T2>
+inline std::array<lbBase_t, DXQY::nQ> calcOmegaMRT(const T1 &f, const lbBase_t &tau, const lbBase_t &tauBulk, const lbBase_t &tauGhost, const lbBase_t& rho, const lbBase_t& u_sq, const T2 &cu)
+/* calcOmegaMRT : sets the MRT-collision term in the lattice boltzmann equation
+ *
+ * f        : node's lb distribution
+ * tau      : shear relaxation time
+ * tauBulk  : bulk relaxation time
+ * tauGhost : relaxation time of the higher order moments
+ * rho      : density
+ * u_sq     : square of the velocity
+ * cu       : array of scalar product of all lattice vectors and the velocity.
+ * omegaMRT : array of the MRT-collision term in each lattice direction
+ */
+{
+    using MB = MomentBasis<DXQY>;
+    lbBase_t mneq[DXQY::nQ];
+    calcMomentsNeqMRT<DXQY>(f, tau, tauBulk, tauGhost, rho, u_sq, cu, mneq);
+
+    std::array<lbBase_t, DXQY::nQ> ret;
+    MB::template transform<MB::MRT_INV>(mneq, ret.data());
+    return ret;
+}
+
+
+template <typename DXQY, typename T1, typename T2>
+inline std::array<lbBase_t, DXQY::nQ> calcDeltaOmegaFMRT(const lbBase_t &tau, const lbBase_t &tauBulk, const lbBase_t &tauGhost, const T1 &cu, const lbBase_t &uF, const T2 &cF)
+/* calcDeltaOmegaFMRT : sets the force correction term for the MRT-collision
+ *
+ * tau        : shear relaxation time
+ * tauBulk    : bulk relaxation time
+ * tauGhost   : relaxation time of the higher order moments
+ * cu         : array of scalar product of all lattice vectors and the velocity.
+ * uF         : scalar product of velocity and body force.
+ * cF         : array of scalar product of all lattice vectors and body force.
+ * deltaOmega : array of the force correction term in each lattice direction
+ */
+{
+    using MB = MomentBasis<DXQY>;
+    lbBase_t mSrc[DXQY::nQ];
+    calcMomentsSourceMRT<DXQY>(tau, tauBulk, tauGhost, cu, uF, cF, mSrc);
+
+    std::array<lbBase_t, DXQY::nQ> ret;
+    MB::template transform<MB::MRT_INV>(mSrc, ret.data());
+    return ret;
+}
+
+
+//                          Central moment helpers
+//-------------------------------------------------------------------------------------
+template <typename DXQY, typename T1, typename T2, typename T3>
+inline void calcCentralMoments(const T1 &f, const T2 &vel, const T3 &force, lbBase_t *kappa)
+/* calcCentralMoments : central moments of f. Half of the force is added to the first
+ *  order moments so that the first order central moments are zero (vel is the
+ *  force corrected velocity).
+ */
+{
+    using MB = MomentBasis<DXQY>;
+    MB::template transform<MB::RAW>(f, kappa);
+    lbBase_t u[DXQY::nD];
+    staticFor<DXQY::nD>([&](auto d) {
+        constexpr int D = decltype(d)::value;
+        u[D] = vel[D];
+        kappa[MB::index(0, D, 1)] += 0.5*force[D];
+    });
+    MB::shift(kappa, u, -1.0);
+}
+
+
+template <typename DXQY, typename T1, typename T2, typename T3>
+inline std::array<lbBase_t, DXQY::nQ> fromCentralMoments(const T1 &f, const T2 &vel, const T3 &force, lbBase_t *kappa)
+/* fromCentralMoments : returns the collision term f* - f, given the post collision
+ *  central moments kappa. Adds the second half of the force to the first order moments.
+ */
+{
+    using MB = MomentBasis<DXQY>;
+    lbBase_t u[DXQY::nD];
+    for (int d = 0; d < DXQY::nD; ++d)
+        u[d] = vel[d];
+    MB::shift(kappa, u, 1.0);
+    staticFor<DXQY::nD>([&](auto d) {
+        constexpr int D = decltype(d)::value;
+        kappa[MB::index(0, D, 1)] += 0.5*force[D];
+    });
+    std::array<lbBase_t, DXQY::nQ> ret;
+    MB::template transform<MB::RAW_INV>(kappa, ret.data());
+    for (int q = 0; q < DXQY::nQ; ++q)
+        ret[q] -= f[q];
+    return ret;
+}
+
+
+template <typename DXQY>
+inline void relaxSecondOrderMoments(lbBase_t *mom, const lbBase_t &eq, const lbBase_t &tau, const lbBase_t &tauBulk)
+/* relaxSecondOrderMoments : relaxes the second order moments. The diagonal
+ *  moments relax towards eq, and the trace is relaxed with the bulk rate.
+ */
+{
+    using MB = MomentBasis<DXQY>;
+    const lbBase_t omega = 1.0/tau;
+    const lbBase_t omegaBulk = 1.0/tauBulk;
+    lbBase_t trace = 0;
+    staticFor<DXQY::nQ>([&](auto k) {
+        constexpr int K = decltype(k)::value;
+        if constexpr (MB::isDiagonal(K))
+            trace += mom[K] - eq;
+    });
+    const lbBase_t traceCorrection = (omegaBulk - omega)*trace/DXQY::nD;
+    staticFor<DXQY::nQ>([&](auto k) {
+        constexpr int K = decltype(k)::value;
+        if constexpr (MB::isDiagonal(K))
+            mom[K] -= omega*(mom[K] - eq) + traceCorrection;
+        else if constexpr (MB::tables.order[K] == 2)
+            mom[K] -= omega*mom[K];
+    });
+}
+
+
+//                               Central moment
+//-------------------------------------------------------------------------------------
+template <typename DXQY, typename T1, typename T2, typename T3>
+inline std::array<lbBase_t, DXQY::nQ> calcOmegaCentralMoment(const T1 &f, const lbBase_t &tau, const lbBase_t &tauBulk, const lbBase_t &tauGhost, const lbBase_t &rho, const T2 &vel, const T3 &force)
+/* calcOmegaCentralMoment : sets the central moment collision term, including the
+ *  body force, in the lattice boltzmann equation. The central moments relax towards
+ *  the central moments of the Maxwell-Boltzmann distribution.
+ *
+ * f        : node's lb distribution
+ * tau      : shear relaxation time
+ * tauBulk  : bulk relaxation time
+ * tauGhost : relaxation time of the higher order moments
+ * rho      : density
+ * vel      : force corrected velocity (see calcVel)
+ * force    : body force
+ */
+{
+    using MB = MomentBasis<DXQY>;
+    lbBase_t kappa[DXQY::nQ];
+    calcCentralMoments<DXQY>(f, vel, force, kappa);
+
+    relaxSecondOrderMoments<DXQY>(kappa, rho*DXQY::c2, tau, tauBulk);
+    const lbBase_t omegaGhost = 1.0/tauGhost;
+    staticFor<DXQY::nQ>([&](auto k) {
+        constexpr int K = decltype(k)::value;
+        if constexpr (MB::tables.order[K] > 2) {
+            constexpr lbBase_t eq = MB::centralEquilibrium(K);
+            if constexpr (eq == 0)
+                kappa[K] -= omegaGhost*kappa[K];
+            else
+                kappa[K] -= omegaGhost*(kappa[K] - eq*rho);
+        }
+        else if constexpr (MB::tables.order[K] == 1) {
+            kappa[K] = 0;
+        }
+    });
+
+    return fromCentralMoments<DXQY>(f, vel, force, kappa);
+}
+
+
+//                                  Cumulant
+//-------------------------------------------------------------------------------------
+template <int NQ>
+struct CumulantTables
+/* Partitions of the raw moment exponents into blocks of two or more
+ * lattice directions. Used to convert between central moments and cumulants
+ * when the first order central moments are zero. Terms with equal blocks are
+ * merged, and coef holds the number of partitions times the cumulant sign.
+ */
+{
+    static constexpr int maxTerms = 48;
+    std::array<int, NQ> nTerms;
+    std::array<std::array<int, maxTerms>, NQ> nBlocks;
+    std::array<std::array<lbBase_t, maxTerms>, NQ> coef;
+    std::array<std::array<lbBase_t, maxTerms>, NQ> count;
+    std::array<std::array<std::array<int, 3>, maxTerms>, NQ> block;
+};
+
+
+template <typename DXQY>
+constexpr CumulantTables<DXQY::nQ> makeCumulantTables()
+{
+    constexpr int nQ = DXQY::nQ;
+    const auto &tab = MomentBasis<DXQY>::tables;
+    CumulantTables<nQ> ret{};
+
+    for (int k = 0; k < nQ; ++k) {
+        // List of dimensions, eg. (2, 1, 0) -> [x, x, y]
+        int label[6] = {0, 0, 0, 0, 0, 0};
+        int n = 0;
+        for (int d = 0; d < 3; ++d)
+            for (int i = 0; i < tab.exponent[k][d]; ++i)
+                label[n++] = d;
+
+        // Restricted growth strings enumerates the set partitions
+        int rgs[6] = {0, 0, 0, 0, 0, 0};
+        bool done = (n < 4);
+        while (!done) {
+            int nB = 0;
+            int size[6] = {0, 0, 0, 0, 0, 0};
+            int exp[6][3] = {};
+            for (int i = 0; i < n; ++i) {
+                size[rgs[i]] += 1;
+                exp[rgs[i]][label[i]] += 1;
+                if (rgs[i] + 1 > nB)  nB = rgs[i] + 1;
+            }
+            bool valid = (nB > 1);
+            for (int b = 0; b < nB; ++b)
+                if (size[b] < 2)  valid = false;
+
+            if (valid) {
+                int rows[3] = {-1, -1, -1};
+                for (int b = 0; b < nB; ++b)
+                    rows[b] = tab.index[exp[b][0]][exp[b][1]][exp[b][2]];
+                // Sort the block rows so that equal terms can be merged
+                for (int i = 0; i < nB; ++i)
+                    for (int j = i + 1; j < nB; ++j)
+                        if (rows[j] < rows[i]) {
+                            const int tmp = rows[i];  rows[i] = rows[j];  rows[j] = tmp;
+                        }
+                int t = 0;
+                for (; t < ret.nTerms[k]; ++t)
+                    if ( (ret.nBlocks[k][t] == nB) && (ret.block[k][t][0] == rows[0]) && (ret.block[k][t][1] == rows[1]) && (ret.block[k][t][2] == rows[2]) )
+                        break;
+                if (t == ret.nTerms[k]) {
+                    ret.nTerms[k] += 1;
+                    ret.nBlocks[k][t] = nB;
+                    ret.block[k][t] = {rows[0], rows[1], rows[2]};
+                }
+                // (-1)^(nB-1) (nB-1)!
+                ret.coef[k][t] += (nB == 2) ? -1.0 : 2.0;
+                ret.count[k][t] += 1.0;
+            }
+
+            // Next restricted growth string
+            int i = n - 1;
+            for (; i > 0; --i) {
+                int maxPrev = 0;
+                for (int j = 0; j < i; ++j)
+                    if (rgs[j] > maxPrev)  maxPrev = rgs[j];
+                if (rgs[i] <= maxPrev) {
+                    rgs[i] += 1;
+                    for (int j = i + 1; j < n; ++j)
+                        rgs[j] = 0;
+                    break;
+                }
+            }
+            if (i == 0)  done = true;
+        }
+    }
+    return ret;
+}
+
+
+template <typename DXQY>
+struct CumulantBasis
+{
+    static constexpr CumulantTables<DXQY::nQ> tables = makeCumulantTables<DXQY>();
+};
+
+
+template <typename DXQY, typename T1, typename T2, typename T3>
+inline std::array<lbBase_t, DXQY::nQ> calcOmegaCumulant(const T1 &f, const lbBase_t &tau, const lbBase_t &tauBulk, const lbBase_t &tauGhost, const lbBase_t &rho, const T2 &vel, const T3 &force)
+/* calcOmegaCumulant : sets the cumulant collision term, including the body force,
+ *  in the lattice boltzmann equation. Second order cumulants relax towards c2*delta
+ *  and all higher order cumulants relax towards zero.
+ *
+ * f        : node's lb distribution
+ * tau      : shear relaxation time
+ * tauBulk  : bulk relaxation time
+ * tauGhost : relaxation time of the higher order cumulants
+ * rho      : density
+ * vel      : force corrected velocity (see calcVel)
+ * force    : body force
+ */
+{
+    using MB = MomentBasis<DXQY>;
+    using CB = CumulantBasis<DXQY>;
+
+    lbBase_t kappa[DXQY::nQ];
+    calcCentralMoments<DXQY>(f, vel, force, kappa);
+
+    // Central moments of f/rho -> cumulants
+    const lbBase_t rhoInv = 1.0/rho;
+    lbBase_t mu[DXQY::nQ];
+    for (int k = 0; k < DXQY::nQ; ++k)
+        mu[k] = kappa[k]*rhoInv;
+    lbBase_t cumulant[DXQY::nQ];
+    staticFor<DXQY::nQ>([&](auto k) {
+        constexpr int K = decltype(k)::value;
+        lbBase_t sum = mu[K];
+        staticFor<CB::tables.nTerms[K]>([&](auto t) {
+            constexpr int I = decltype(t)::value;
+            lbBase_t prod = CB::tables.coef[K][I];
+            staticFor<CB::tables.nBlocks[K][I]>([&](auto b) {
+                prod *= mu[CB::tables.block[K][I][decltype(b)::value]];
+            });
+            sum += prod;
+        });
+        cumulant[K] = sum;
+    });
+
+    // Collision
+    relaxSecondOrderMoments<DXQY>(cumulant, DXQY::c2, tau, tauBulk);
+    const lbBase_t omegaGhost = 1.0/tauGhost;
+    staticFor<DXQY::nQ>([&](auto k) {
+        constexpr int K = decltype(k)::value;
+        if constexpr (MB::tables.order[K] > 2)
+            cumulant[K] -= omegaGhost*cumulant[K];
+        else if constexpr (MB::tables.order[K] == 1)
+            cumulant[K] = 0;
+    });
+
+    // Cumulants -> central moments
+    staticFor<DXQY::nQ>([&](auto k) {
+        constexpr int K = decltype(k)::value;
+        lbBase_t sum = cumulant[K];
+        staticFor<CB::tables.nTerms[K]>([&](auto t) {
+            constexpr int I = decltype(t)::value;
+            lbBase_t prod = CB::tables.count[K][I];
+            staticFor<CB::tables.nBlocks[K][I]>([&](auto b) {
+                prod *= cumulant[CB::tables.block[K][I][decltype(b)::value]];
+            });
+            sum += prod;
+        });
+        kappa[K] = rho*sum;
+    });
+
+    return fromCentralMoments<DXQY>(f, vel, force, kappa);
+}
+
+
+//=====================================================================================
+//
+//                        C O L L I S I O N   O B J E C T S
+//
+//=====================================================================================
+/* Collision objects that hold the bulk and ghost relaxation times, and have a common
+ * interface
+ *   omega(f, tau, rho, vel, force)
+ * that returns the collision term including the body force, and
+ *   collide(f, tau, rho, vel, force)
+ * that returns the post collision distribution f + omega. Both return fixed size arrays,
+ * so the kernels do not allocate. Used by the rheology classes (see LBrheology.h) where
+ * tau is given by the local strain rate.
+ */
+template <typename DXQY, typename T>
+inline std::array<lbBase_t, DXQY::nQ> addOmega(const T &f, std::array<lbBase_t, DXQY::nQ> omega)
+/* addOmega : f + omega */
+{
+    for (int q = 0; q < DXQY::nQ; ++q)
+        omega[q] += f[q];
+    return omega;
+}
+
+
+template <typename DXQY>
+class MRTCollision
+{
+public:
+    MRTCollision(const lbBase_t tauBulk, const lbBase_t tauGhost) : tauBulk_(tauBulk), tauGhost_(tauGhost) {}
+    template <typename T1, typename T2, typename T3>
+    inline std::array<lbBase_t, DXQY::nQ> omega(const T1 &f, const lbBase_t &tau, const lbBase_t &rho, const T2 &vel, const T3 &force) const
+    /* omega : the relaxation and the force source are added in moment space, so that
+     *  only one inverse transform is needed
+     */
+    {
+        using MB = MomentBasis<DXQY>;
+        const lbBase_t u2 = DXQY::dot(vel, vel);
+        const auto cu = momentCDotAll<DXQY>(vel);
+        const lbBase_t uF = DXQY::dot(vel, force);
+        const auto cF = momentCDotAll<DXQY>(force);
+        lbBase_t mneq[DXQY::nQ];
+        calcMomentsNeqMRT<DXQY>(f, tau, tauBulk_, tauGhost_, rho, u2, cu, mneq);
+        lbBase_t mSrc[DXQY::nQ];
+        calcMomentsSourceMRT<DXQY>(tau, tauBulk_, tauGhost_, cu, uF, cF, mSrc);
+        for (int k = 0; k < DXQY::nQ; ++k)
+            mneq[k] += mSrc[k];
+        std::array<lbBase_t, DXQY::nQ> ret;
+        MB::template transform<MB::MRT_INV>(mneq, ret.data());
+        return ret;
+    }
+    template <typename T1, typename T2, typename T3>
+    inline std::array<lbBase_t, DXQY::nQ> collide(const T1 &f, const lbBase_t &tau, const lbBase_t &rho, const T2 &vel, const T3 &force) const
+    {
+        return addOmega<DXQY>(f, omega(f, tau, rho, vel, force));
+    }
+private:
+    const lbBase_t tauBulk_;
+    const lbBase_t tauGhost_;
+};
+
+template <typename DXQY>
+class CentralMomentCollision
+{
+public:
+    CentralMomentCollision(const lbBase_t tauBulk, const lbBase_t tauGhost) : tauBulk_(tauBulk), tauGhost_(tauGhost) {}
+    template <typename T1, typename T2, typename T3>
+    inline std::array<lbBase_t, DXQY::nQ> omega(const T1 &f, const lbBase_t &tau, const lbBase_t &rho, const T2 &vel, const T3 &force) const
+    {
+        return calcOmegaCentralMoment<DXQY>(f, tau, tauBulk_, tauGhost_, rho, vel, force);
+    }
+    template <typename T1, typename T2, typename T3>
+    inline std::array<lbBase_t, DXQY::nQ> collide(const T1 &f, const lbBase_t &tau, const lbBase_t &rho, const T2 &vel, const T3 &force) const
+    {
+        return addOmega<DXQY>(f, omega(f, tau, rho, vel, force));
+    }
+private:
+    const lbBase_t tauBulk_;
+    const lbBase_t tauGhost_;
+};
+
+template <typename DXQY>
+class CumulantCollision
+{
+public:
+    CumulantCollision(const lbBase_t tauBulk, const lbBase_t tauGhost) : tauBulk_(tauBulk), tauGhost_(tauGhost) {}
+    template <typename T1, typename T2, typename T3>
+    inline std::array<lbBase_t, DXQY::nQ> omega(const T1 &f, const lbBase_t &tau, const lbBase_t &rho, const T2 &vel, const T3 &force) const
+    {
+        return calcOmegaCumulant<DXQY>(f, tau, tauBulk_, tauGhost_, rho, vel, force);
+    }
+    template <typename T1, typename T2, typename T3>
+    inline std::array<lbBase_t, DXQY::nQ> collide(const T1 &f, const lbBase_t &tau, const lbBase_t &rho, const T2 &vel, const T3 &force) const
+    {
+        return addOmega<DXQY>(f, omega(f, tau, rho, vel, force));
+    }
+private:
+    const lbBase_t tauBulk_;
+    const lbBase_t tauGhost_;
+};
+
+
+#endif // LBCOLLISIONMOMENT_H
@@ -0,0 +1,272 @@
+#ifndef LBCONVERGENCE_H
+#define LBCONVERGENCE_H
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <mpi.h>
+#include "LBglobal.h"
+#include "LBlatticetypes.h"
+#include "LBgrid.h"
+#include "LBfield.h"
+#include "../io/Input.h"
+
+/*********************************************************
+ * class CONVERGENCEMONITOR: steady state test, evaluated
+ *  every interval time steps.
+ *
+ * Norms:
+ *  "l2"   : sqrt(sum |x - x_old|^2 / sum |x|^2)
+ *  "linf" : max |x - x_old| / max |x|
+ *           where x is the "vel" or "rho" field at the
+ *           nodes given to check, and x_old its value at the
+ *           last check.
+ *  "flux" : max over planes |Q - Q_old|/|Q|, where Q is the
+ *           mass flux (sum of rho u_d) through the plane
+ *           x_d = const.
+ * All norms use one MPI_Allreduce per check. If the number of
+ *  nodes given to check changes on any rank (e.g. after a
+ *  repartition), the next check only stores the values on all
+ *  ranks.
+ *
+ * The simulation is converged when the residual has been below
+ *  the tolerance for nConsecutive checks after minIterations.
+ *  The actions "stop" and "write" tell the main loop what to
+ *  do at convergence. There is no restart from checkpoint
+ *  files, so a "checkpoint" action is an input error.
+ *
+ * The monitor is set up from the input file block
+ *     <convergence>
+ *         norm        l2       # l2, linf or flux
+ *         variable    vel      # vel or rho (l2 and linf)
+ *         interval    100
+ *         tolerance   1e-7
+ *         actions     stop write
+ *         min_iterations 1000  # optional
+ *         consecutive 2        # optional
+ *         flux_direction 2     # flux
+ *         flux_planes 10 100   # flux
+ *     <end>
+ * and is disabled if the block is missing. In the main loop:
+ *     if (convergence.check(i, bulkNodes, rho, vel, grid)) {
+ *         if (convergence.write())
+ *             output.write(i);
+ *         if (convergence.stop())
+ *             break;
+ *     }
+ *********************************************************/
+template <typename DXQY>
+class ConvergenceMonitor
+{
+public:
+    ConvergenceMonitor(const std::string &norm, const std::string &variable, const int interval, const lbBase_t tolerance,
+                       const std::vector<std::string> &actions={"stop"}, const int minIterations=0, const int nConsecutive=1);
+    ConvergenceMonitor(Input &input);
+
+    void setFluxPlanes(const int direction, const std::vector<int> &planes);
+    bool check(const int iteration, const std::vector<int> &nodeList, const ScalarField &rho, const VectorField<DXQY> &vel, const Grid<DXQY> &grid);
+
+    inline bool enabled() const {return enabled_;}
+    inline bool converged() const {return converged_;}
+    inline lbBase_t residual() const {return residual_;}
+    inline bool stop() const {return converged_ && stop_;}
+    inline bool write() const {return converged_ && write_;}
+    inline bool usesVelocity() const {return enabled_ && ( (norm_ == FLUX) || (variable_ == VEL) );}
+
+private:
+    void setup(const std::string &norm, const std::string &variable, const std::vector<std::string> &actions);
+
+    bool enabled_;
+    enum { L2, LINF, FLUX } norm_;
+    enum { VEL, RHO } variable_;
+    int interval_;
+    lbBase_t tolerance_;
+    int minIterations_;
+    int nConsecutive_;
+    bool stop_, write_;
+    int fluxDirection_;
+    std::vector<int> fluxPlanes_;
+    std::vector<lbBase_t> old_;  // Values at the last check
+    bool first_;
+    int nBelow_;
+    bool converged_;
+    lbBase_t residual_;
+};
+
+
+template <typename DXQY>
+ConvergenceMonitor<DXQY>::ConvergenceMonitor(const std::string &norm, const std::string &variable, const int interval, const lbBase_t tolerance,
+                                             const std::vector<std::string> &actions, const int minIterations, const int nConsecutive)
+    : enabled_(true), interval_(interval), tolerance_(tolerance), minIterations_(minIterations), nConsecutive_(nConsecutive), fluxDirection_(-1),
+      first_(true), nBelow_(0), converged_(false), residual_(-1)
+/* norm     : "l2", "linf" or "flux"
+ * variable : "vel" or "rho"
+ * interval : number of time steps between checks
+ * actions  : "stop" and/or "write"
+ */
+{
+    setup(norm, variable, actions);
+}
+
+
+template <typename DXQY>
+ConvergenceMonitor<DXQY>::ConvergenceMonitor(Input &input)
+    : enabled_(input.contains("convergence")), interval_(1), tolerance_(0), minIterations_(0), nConsecutive_(1), fluxDirection_(-1),
+      first_(true), nBelow_(0), converged_(false), residual_(-1)
+/* input : reads the convergence block, see the class comment
+ */
+{
+    if (!enabled_)
+        return;
+    const Block &block = input["convergence"];
+    interval_ = block["interval"];
+    tolerance_ = block["tolerance"];
+    if (block.contains("min_iterations"))
+        minIterations_ = block["min_iterations"];
+    if (block.contains("consecutive"))
+        nConsecutive_ = block["consecutive"];
+    const std::string norm = block["norm"];
+    const std::string variable = block.contains("variable") ? std::string(block["variable"]) : std::string("vel");
+    std::vector<std::string> actions = {"stop"};
+    if (block.contains("actions"))
+        actions = static_cast<std::vector<std::string>>(block["actions"]);
+    setup(norm, variable, actions);
+    if (norm_ == FLUX)
+        setFluxPlanes(block["flux_direction"], block["flux_planes"]);
+}
+
+
+template <typename DXQY>
+void ConvergenceMonitor<DXQY>::setup(const std::string &norm, const std::string &variable, const std::vector<std::string> &actions)
+{
+    if (norm == "l2") {
+        norm_ = L2;
+    } else if (norm == "linf") {
+        norm_ = LINF;
+    } else if (norm == "flux") {
+        norm_ = FLUX;
+    } else {
+        std::cout << "ERROR in ConvergenceMonitor: unknown norm " << norm << ". Use l2, linf or flux" << std::endl;
+        exit(1);
+    }
+    if (variable == "vel") {
+        variable_ = VEL;
+    } else if (variable == "rho") {
+        variable_ = RHO;
+    } else {
+        std::cout << "ERROR in ConvergenceMonitor: unknown variable " << variable << ". Use vel or rho" << std::endl;
+        exit(1);
+    }
+    stop_ = write_ = false;
+    for (const auto &action: actions) {
+        if (action == "stop") {
+            stop_ = true;
+        } else if (action == "write") {
+            write_ = true;
+        } else if (action == "checkpoint") {
+            std::cout << "ERROR in ConvergenceMonitor: the checkpoint action is not supported, as there is no restart from checkpoint files. Use stop or write" << std::endl;
+            exit(1);
+        } else {
+            std::cout << "ERROR in ConvergenceMonitor: unknown action " << action << ". Use stop or write" << std::endl;
+            exit(1);
+        }
+    }
+    if (interval_ < 1) {
+        std::cout << "ERROR in ConvergenceMonitor: the interval must be positive" << std::endl;
+        exit(1);
+    }
+}
+
+
+template <typename DXQY>
+void ConvergenceMonitor<DXQY>::setFluxPlanes(const int direction, const std::vector<int> &planes)
+/* setFluxPlanes : planes x_direction = planes[n] for the flux norm
+ */
+{
+    if ( (direction < 0) || (direction >= DXQY::nD) || planes.empty() ) {
+        std::cout << "ERROR in ConvergenceMonitor: give a flux direction (0 to " << DXQY::nD - 1 << ") and at least one plane" << std::endl;
+        exit(1);
+    }
+    fluxDirection_ = direction;
+    fluxPlanes_ = planes;
+    old_.clear();
+    first_ = true;
+}
+
+
+template <typename DXQY>
+bool ConvergenceMonitor<DXQY>::check(const int iteration, const std::vector<int> &nodeList, const ScalarField &rho, const VectorField<DXQY> &vel,
+                                     const Grid<DXQY> &grid)
+/* check : computes the residual if iteration is a multiple of the interval, and
+ *  returns true at the check where the simulation first counts as converged.
+ *
+ * nodeList : nodes on this rank used by the norm (e.g. the bulk nodes)
+ * rho, vel : macroscopic fields (field 0)
+ */
+{
+    if ( !enabled_ || converged_ || (iteration % interval_ != 0) )
+        return false;
+
+    if (norm_ == FLUX) {
+        if (fluxDirection_ < 0) {
+            std::cout << "ERROR in ConvergenceMonitor: call setFluxPlanes before using the flux norm" << std::endl;
+            exit(1);
+        }
+        const int nPlanes = static_cast<int>(fluxPlanes_.size());
+        std::vector<lbBase_t> fluxLocal(nPlanes, 0.0), flux(nPlanes, 0.0);
+        for (const auto &nodeNo: nodeList) {
+            const int x = grid.pos(nodeNo, fluxDirection_);
+            for (int p = 0; p < nPlanes; ++p) {
+                if (x == fluxPlanes_[p])
+                    fluxLocal[p] += rho(0, nodeNo)*vel(0, fluxDirection_, nodeNo);
+            }
+        }
+        MPI_Allreduce(fluxLocal.data(), flux.data(), nPlanes, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+        if (!first_) {
+            residual_ = 0;
+            for (int p = 0; p < nPlanes; ++p)
+                residual_ = std::max(residual_, std::abs(flux[p] - old_[p])/(std::abs(flux[p]) + lbBaseEps));
+        }
+        old_ = flux;
+    } else {
+        const int nVal = (variable_ == VEL) ? DXQY::nD : 1;
+        lbBase_t local[3] = {0.0, 0.0, 0.0};  // Change, size and a changed node list, summed or maximum
+        if (old_.size() != nVal*nodeList.size()) {
+            old_.assign(nVal*nodeList.size(), 0.0);
+            local[2] = 1.0;
+        }
+        lbBase_t *oldVal = old_.data();
+        for (const auto &nodeNo: nodeList) {
+            for (int d = 0; d < nVal; ++d) {
+                const lbBase_t val = (variable_ == VEL) ? vel(0, d, nodeNo) : rho(0, nodeNo);
+                const lbBase_t diff = val - *oldVal;
+                *oldVal++ = val;
+                if (norm_ == L2) {
+                    local[0] += diff*diff;
+                    local[1] += val*val;
+                } else {
+                    local[0] = std::max(local[0], std::abs(diff));
+                    local[1] = std::max(local[1], std::abs(val));
+                }
+            }
+        }
+        lbBase_t global[3];
+        MPI_Allreduce(local, global, 3, MPI_DOUBLE, (norm_ == L2) ? MPI_SUM : MPI_MAX, MPI_COMM_WORLD);
+        if (global[2] > 0)  // A new node list on any rank restarts the test on all ranks
+            first_ = true;
+        if (!first_)
+            residual_ = (norm_ == L2) ? std::sqrt(global[0]/(global[1] + lbBaseEps)) : global[0]/(global[1] + lbBaseEps);
+    }
+
+    if (first_) {
+        first_ = false;
+        return false;
+    }
+    nBelow_ = (residual_ < tolerance_) ? nBelow_ + 1 : 0;
+    converged_ = (iteration >= minIterations_) && (nBelow_ >= nConsecutive_);
+    return converged_;
+}
+
+#endif // LBCONVERGENCE_H
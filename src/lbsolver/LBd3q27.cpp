@@ -0,0 +1,9 @@
+#include "LBd3q27.h"
+
+constexpr lbBase_t D3Q27::w[];
+constexpr int D3Q27::cDMajor_[];
+constexpr lbBase_t D3Q27::cNorm[];
+constexpr int D3Q27::reverseDirection_[];
+constexpr lbBase_t D3Q27::B[];
+constexpr lbBase_t D3Q27::UnitMatrixLowTri[];
+
@@ -0,0 +1,312 @@
+#ifndef LBD3Q27_H
+#define LBD3Q27_H
+
+#include "LBglobal.h"
+#include <vector>
+
+// See "LBlatticetypes.h" for description of the structure
+
+// TO MAKE CHANGES TO THIS FILE, MAKE THE CHANGES IN "PythonScripts/writeLatticeFile.py",
+// RUN THE SCRIPT AND PLACE RESULTING FILES IN "src/"
+
+struct D3Q27{
+
+static constexpr int nD = 3;
+static constexpr int nQ = 27;
+static constexpr int nDirPairs_ = 13;
+static constexpr int nQNonZero_ = 26;
+
+static constexpr lbBase_t c2Inv = 3.0;
+static constexpr lbBase_t c4Inv = 9.0;
+static constexpr lbBase_t c2 = 1.0 / c2Inv;
+static constexpr lbBase_t c4 = 1.0 / c4Inv;
+static constexpr lbBase_t c4Inv0_5 = 0.5 * c4Inv;
+
+static constexpr lbBase_t w0 = 64.0/216.0;
+static constexpr lbBase_t w0c2Inv = w0*c2Inv;
+static constexpr lbBase_t w1 = 16.0/216.0;
+static constexpr lbBase_t w1c2Inv = w1*c2Inv;
+static constexpr lbBase_t w2 = 4.0/216.0;
+static constexpr lbBase_t w2c2Inv = w2*c2Inv;
+static constexpr lbBase_t w3 = 1.0/216.0;
+static constexpr lbBase_t w3c2Inv = w3*c2Inv;
+
+static constexpr lbBase_t w[27] = {w1, w1, w1, w2, w2, w2, w2, w2, w2, w3, w3, w3, w3, w1, w1, w1, w2, w2, w2, w2, w2, w2, w3, w3, w3, w3, w0};
+static constexpr int cDMajor_[81] = {1, 0, 0, 0, 1, 0, 0, 0, 1, 1, 1, 0, 1, -1, 0, 1, 0, 1, 1, 0, -1, 0, 1, 1, 0, 1, -1, 1, 1, 1, 1, 1, -1, 1, -1, 1, 1, -1, -1, -1, 0, 0, 0, -1, 0, 0, 0, -1, -1, -1, 0, -1, 1, 0, -1, 0, -1, -1, 0, 1, 0, -1, -1, 0, -1, 1, -1, -1, -1, -1, -1, 1, -1, 1, -1, -1, 1, 1, 0, 0, 0};
+static constexpr lbBase_t cNorm[27] = {1.0, 1.0, 1.0, SQRT2, SQRT2, SQRT2, SQRT2, SQRT2, SQRT2, SQRT3, SQRT3, SQRT3, SQRT3, 1.0, 1.0, 1.0, SQRT2, SQRT2, SQRT2, SQRT2, SQRT2, SQRT2, SQRT3, SQRT3, SQRT3, SQRT3, 0.0};
+static constexpr int reverseDirection_[27] = {13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 26};
+static constexpr lbBase_t B0 = -128.0/648.0;
+static constexpr lbBase_t B1 = 16.0/648.0;
+static constexpr lbBase_t B2 = 16.0/648.0;
+static constexpr lbBase_t B3 = 7.0/648.0;
+static constexpr lbBase_t B[27] = {B1, B1, B1, B2, B2, B2, B2, B2, B2, B3, B3, B3, B3, B1, B1, B1, B2, B2, B2, B2, B2, B2, B3, B3, B3, B3, B0};
+
+static constexpr lbBase_t UnitMatrixLowTri[6] = {1, 0, 1, 0, 0, 1};
+
+// Functions
+
+inline static int c(const int qDirection, const int dimension)  {return cDMajor_[nD*qDirection + dimension];}
+inline static int reverseDirection(const int qDirection) {return reverseDirection_[qDirection];}
+
+inline static std::vector<int> c(const int qDirection) {
+std::vector<int> cq(cDMajor_ + nD*qDirection, cDMajor_ + nD*qDirection + nD);
+return cq;
+}
+
+inline static std::valarray<lbBase_t> cValarray(const int qDirection) {
+std::valarray<lbBase_t> cq(nD);
+const int dind = nD*qDirection;
+for (int d=0; d<nD; ++d)
+cq[d] = cDMajor_[dind + d];
+return cq;
+}
+
+template <typename T1, typename T2>
+inline static lbBase_t dot(const T1 &leftVec, const T2 &rightVec);
+template<typename T>
+inline static T cDot(const int qDir, const T* rightVec);
+template<typename T>
+inline static lbBase_t cDotRef(const int qDir, const T& rightVec);
+template <typename T>
+inline static std::valarray<lbBase_t> cDotAll(const T &vec);
+template <typename T>
+inline static std::valarray<lbBase_t> grad(const T &rho);
+
+template <typename T>
+inline static lbBase_t divGrad(const T &rho);
+
+template <typename T>
+inline static lbBase_t qSum(const T &dist);
+template <typename T>
+inline static std::valarray<lbBase_t> qSumC(const T &dist);
+
+inline static int c2q(const std::vector<int> &v);
+
+template <typename T>
+inline static std::valarray<lbBase_t> qSumCCLowTri(const T &dist);
+
+template <typename T>
+inline static lbBase_t traceLowTri(const T &lowTri);
+
+template <typename T>
+inline static lbBase_t traceOfMatrix(const T &mat);
+
+inline static std::valarray<lbBase_t> deltaLowTri();
+
+inline static std::valarray<lbBase_t> deltaMatrix();
+
+template <typename T1, typename T2>
+inline static lbBase_t contractionLowTri(const T1 &lowTri1, const T2 &lowTri2);
+
+template <typename T>
+inline static lbBase_t contractionRank2(const T &mat1, const T &mat2);
+
+template <typename T>
+inline static std::valarray<lbBase_t> matrixMultiplication(const T &mat1, const T &mat2);
+
+template <typename T1, typename T2>
+inline static std::valarray<lbBase_t> contractionLowTriVec(const T1 &lowTri, const T2 &vec);
+
+};
+
+
+template <typename T1, typename T2>
+inline lbBase_t D3Q27::dot(const T1 &leftVec, const T2 &rightVec)
+{
+    return leftVec[0]*rightVec[0] + leftVec[1]*rightVec[1] + leftVec[2]*rightVec[2];
+}
+
+template<typename T>
+inline T D3Q27::cDot(const int qDir, const T* rightVec)
+{
+    return c(qDir, 0)*rightVec[0] + c(qDir, 1)*rightVec[1] + c(qDir, 2)*rightVec[2];
+}
+
+template<typename T>
+inline lbBase_t D3Q27::cDotRef(const int qDir, const T& rightVec)
+{
+    return c(qDir, 0)*rightVec[0] + c(qDir, 1)*rightVec[1] + c(qDir, 2)*rightVec[2];
+}
+
+template <typename T>
+inline std::valarray<lbBase_t> D3Q27::cDotAll(const T &vec)
+{
+std::valarray<lbBase_t> ret(nQ);
+ret[0] = +vec[0];
+ret[1] = +vec[1];
+ret[2] = +vec[2];
+ret[3] = +vec[0] +vec[1];
+ret[4] = +vec[0] -vec[1];
+ret[5] = +vec[0] +vec[2];
+ret[6] = +vec[0] -vec[2];
+ret[7] = +vec[1] +vec[2];
+ret[8] = +vec[1] -vec[2];
+ret[9] = +vec[0] +vec[1] +vec[2];
+ret[10] = +vec[0] +vec[1] -vec[2];
+ret[11] = +vec[0] -vec[1] +vec[2];
+ret[12] = +vec[0] -vec[1] -vec[2];
+ret[13] = -vec[0];
+ret[14] = -vec[1];
+ret[15] = -vec[2];
+ret[16] = -vec[0] -vec[1];
+ret[17] = -vec[0] +vec[1];
+ret[18] = -vec[0] -vec[2];
+ret[19] = -vec[0] +vec[2];
+ret[20] = -vec[1] -vec[2];
+ret[21] = -vec[1] +vec[2];
+ret[22] = -vec[0] -vec[1] -vec[2];
+ret[23] = -vec[0] -vec[1] +vec[2];
+ret[24] = -vec[0] +vec[1] -vec[2];
+ret[25] = -vec[0] +vec[1] +vec[2];
+ret[26] = 0.0;
+return ret;
+}
+
+template <typename T>
+inline std::valarray<lbBase_t> D3Q27::grad(const T& rho)
+{
+std::valarray<lbBase_t> ret(nD);
+ret[0] =+ w1c2Inv * ( + rho[0] - rho[13] ) + w2c2Inv * ( + rho[3] + rho[4] + rho[5] + rho[6] - rho[16] - rho[17] - rho[18] - rho[19] ) + w3c2Inv * ( + rho[9] + rho[10] + rho[11] + rho[12] - rho[22] - rho[23] - rho[24] - rho[25] ) ;
+ret[1] =+ w1c2Inv * ( + rho[1] - rho[14] ) + w2c2Inv * ( + rho[3] - rho[4] + rho[7] + rho[8] - rho[16] + rho[17] - rho[20] - rho[21] ) + w3c2Inv * ( + rho[9] + rho[10] - rho[11] - rho[12] - rho[22] - rho[23] + rho[24] + rho[25] ) ;
+ret[2] =+ w1c2Inv * ( + rho[2] - rho[15] ) + w2c2Inv * ( + rho[5] - rho[6] + rho[7] - rho[8] - rho[18] + rho[19] - rho[20] + rho[21] ) + w3c2Inv * ( + rho[9] - rho[10] + rho[11] - rho[12] - rho[22] + rho[23] - rho[24] + rho[25] ) ;
+return ret;
+}
+
+template <typename T>
+inline lbBase_t D3Q27::divGrad(const T& rho)
+{
+lbBase_t ret;
+ret =+ 2*( w0c2Inv - c2Inv ) * ( + rho[26] ) + 2* w1c2Inv * ( + rho[0] + rho[1] + rho[2] + rho[13] + rho[14] + rho[15] ) + 2* w2c2Inv * ( + rho[3] + rho[4] + rho[5] + rho[6] + rho[7] + rho[8] + rho[16] + rho[17] + rho[18] + rho[19] + rho[20] + rho[21] ) + 2* w3c2Inv * ( + rho[9] + rho[10] + rho[11] + rho[12] + rho[22] + rho[23] + rho[24] + rho[25] ) ;
+return ret;
+}
+
+template <typename T>
+inline lbBase_t D3Q27::qSum(const T &dist)
+{
+lbBase_t ret = 0.0;
+for (int q = 0; q < nQ; ++q)
+ret += dist[q];
+return ret;
+}
+
+template <typename T>
+inline std::valarray<lbBase_t> D3Q27::qSumC(const T &dist)
+{
+std::valarray<lbBase_t> ret(nD);
+ret[0] = + dist[0] + dist[3] + dist[4] + dist[5] + dist[6] + dist[9] + dist[10] + dist[11] + dist[12] - dist[13] - dist[16] - dist[17] - dist[18] - dist[19] - dist[22] - dist[23] - dist[24] - dist[25];
+ret[1] = + dist[1] + dist[3] - dist[4] + dist[7] + dist[8] + dist[9] + dist[10] - dist[11] - dist[12] - dist[14] - dist[16] + dist[17] - dist[20] - dist[21] - dist[22] - dist[23] + dist[24] + dist[25];
+ret[2] = + dist[2] + dist[5] - dist[6] + dist[7] - dist[8] + dist[9] - dist[10] + dist[11] - dist[12] - dist[15] - dist[18] + dist[19] - dist[20] + dist[21] - dist[22] + dist[23] - dist[24] + dist[25];
+return ret;
+}
+
+template <typename T>
+inline std::valarray<lbBase_t> D3Q27::qSumCCLowTri(const T &dist)
+{
+std::valarray<lbBase_t> ret((nD*(nD+1))/2);
+ret[0] = + dist[0] + dist[3] + dist[4] + dist[5] + dist[6] + dist[9] + dist[10] + dist[11] + dist[12] + dist[13] + dist[16] + dist[17] + dist[18] + dist[19] + dist[22] + dist[23] + dist[24] + dist[25];
+ret[1] = + dist[3] - dist[4] + dist[9] + dist[10] - dist[11] - dist[12] + dist[16] - dist[17] + dist[22] + dist[23] - dist[24] - dist[25];
+ret[2] = + dist[1] + dist[3] + dist[4] + dist[7] + dist[8] + dist[9] + dist[10] + dist[11] + dist[12] + dist[14] + dist[16] + dist[17] + dist[20] + dist[21] + dist[22] + dist[23] + dist[24] + dist[25];
+ret[3] = + dist[5] - dist[6] + dist[9] - dist[10] + dist[11] - dist[12] + dist[18] - dist[19] + dist[22] - dist[23] + dist[24] - dist[25];
+ret[4] = + dist[7] - dist[8] + dist[9] - dist[10] - dist[11] + dist[12] + dist[20] - dist[21] + dist[22] - dist[23] - dist[24] + dist[25];
+ret[5] = + dist[2] + dist[5] + dist[6] + dist[7] + dist[8] + dist[9] + dist[10] + dist[11] + dist[12] + dist[15] + dist[18] + dist[19] + dist[20] + dist[21] + dist[22] + dist[23] + dist[24] + dist[25];
+return ret;
+}
+
+inline int D3Q27::c2q(const std::vector<int> &v)
+/*
+* returns the lattice direction that corresponds to the vector v.
+* returns -1 if the vector is not found amongs the lattice vectors.
+*/
+{
+for (int q = 0; q < nQ; ++q) {
+std::vector<int> cq(cDMajor_ + nD*q, cDMajor_ + nD*q + nD);
+if (cq == v) {
+return q;
+}
+}
+return -1;
+}
+
+template <typename T>
+inline lbBase_t D3Q27::traceLowTri(const T &lowTri)
+{
+lbBase_t ret;
+return ret =+ lowTri[0]+ lowTri[2]+ lowTri[5];
+}
+
+template <typename T>
+inline lbBase_t D3Q27::traceOfMatrix(const T &mat)
+{
+lbBase_t ret;
+return ret =+ mat[0]+ mat[4]+ mat[8];
+}
+
+inline std::valarray<lbBase_t> D3Q27::deltaLowTri()
+{
+std::valarray<lbBase_t> ret(nD*(nD+1)/2);
+ret[0] = 1;
+ret[1] = 0;
+ret[2] = 1;
+ret[3] = 0;
+ret[4] = 0;
+ret[5] = 1;
+return ret;
+}
+
+inline std::valarray<lbBase_t> D3Q27::deltaMatrix()
+{
+std::valarray<lbBase_t> ret(nD*nD);
+ret[0] = 1;
+ret[1] = 0;
+ret[2] = 0;
+ret[3] = 0;
+ret[4] = 1;
+ret[5] = 0;
+ret[6] = 0;
+ret[7] = 0;
+ret[8] = 1;
+return ret;
+}
+
+template <typename T1, typename T2>
+inline lbBase_t D3Q27::contractionLowTri(const T1 &lowTri1, const T2 &lowTri2)
+{
+lbBase_t ret;
+return ret =+ lowTri1[0]*lowTri2[0]+ 2*lowTri1[1]*lowTri2[1]+ lowTri1[2]*lowTri2[2]+ 2*lowTri1[3]*lowTri2[3]+ 2*lowTri1[4]*lowTri2[4]+ lowTri1[5]*lowTri2[5];
+}
+
+template <typename T>
+inline lbBase_t D3Q27::contractionRank2(const T &mat1, const T &mat2)
+{
+lbBase_t ret;
+return ret =+ mat1[0]*mat2[0]+ mat1[1]*mat2[1]+ mat1[2]*mat2[2]+ mat1[3]*mat2[3]+ mat1[4]*mat2[4]+ mat1[5]*mat2[5]+ mat1[6]*mat2[6]+ mat1[7]*mat2[7]+ mat1[8]*mat2[8];
+}
+
+template <typename T>
+inline std::valarray<lbBase_t> D3Q27::matrixMultiplication(const T &mat1, const T &mat2)
+{
+std::valarray<lbBase_t> ret(nD*nD);
+ret[0] = + mat1[0]*mat2[0] + mat1[1]*mat2[3] + mat1[2]*mat2[6];
+ret[1] = + mat1[0]*mat2[1] + mat1[1]*mat2[4] + mat1[2]*mat2[7];
+ret[2] = + mat1[0]*mat2[2] + mat1[1]*mat2[5] + mat1[2]*mat2[8];
+ret[3] = + mat1[3]*mat2[0] + mat1[4]*mat2[3] + mat1[5]*mat2[6];
+ret[4] = + mat1[3]*mat2[1] + mat1[4]*mat2[4] + mat1[5]*mat2[7];
+ret[5] = + mat1[3]*mat2[2] + mat1[4]*mat2[5] + mat1[5]*mat2[8];
+ret[6] = + mat1[6]*mat2[0] + mat1[7]*mat2[3] + mat1[8]*mat2[6];
+ret[7] = + mat1[6]*mat2[1] + mat1[7]*mat2[4] + mat1[8]*mat2[7];
+ret[8] = + mat1[6]*mat2[2] + mat1[7]*mat2[5] + mat1[8]*mat2[8];
+return ret;
+}
+
+template <typename T1, typename T2>
+inline std::valarray<lbBase_t> D3Q27::contractionLowTriVec(const T1 &lowTri, const T2 &vec)
+{
+std::valarray<lbBase_t> ret(nD);
+ret[0] = + lowTri[0]*vec[0] + lowTri[1]*vec[1] + lowTri[3]*vec[2];
+ret[1] = + lowTri[1]*vec[0] + lowTri[2]*vec[1] + lowTri[4]*vec[2];
+ret[2] = + lowTri[3]*vec[0] + lowTri[4]*vec[1] + lowTri[5]*vec[2];
+return ret;
+}
+
+
+#endif // LBD3Q27_H
@@ -6,6 +6,7 @@
 #include <iostream>
 #include <algorithm>
 #include <vector>
+#include <type_traits>
 
 
 // class Field
@@ -81,6 +82,7 @@ public:
 
     int size() {return nNodes_;} // Getter for nNodes_
     int num_fields() const {return nFields_;}
+    void resize(const int nNodes) {nNodes_ = nNodes; data_.resize(static_cast<std::size_t>(nFields_ * nNodes));}  // New values are zero
 private:
     const int nFields_;  // Number of fields
     int nNodes_;  // Number of nodes in each field
@@ -211,6 +213,7 @@ public:
     int size() {return nNodes_;} // laternative Getter for nNodes_    
     int size() const {return nNodes_;} // laternative Getter for nNodes_    
     int num_fields() const {return nFields_;} // Getter for nFields_
+    void resize(const int nNodes) {nNodes_ = nNodes; data_.resize(elementSize_ * nNodes);}  // New values are zero
     void writeToFile(const std::string fileName) const;
     void readFromFile(const std::string fileName);
 
@@ -281,27 +284,93 @@ void VectorField<DXQY>::readFromFile(const std::string fileName)
  * class LBFIELD: Represents a given number of lattice
  *  boltzmann distribution fields
  *
+ * The storage type S can differ from the compute type
+ *  lbBase_t (e.g. LbField<LT, float>). A reduced precision
+ *  field stores the shifted distribution f - w*rho0, and
+ *  all access goes through lbBase_t, so that the
+ *  arithmetic is unchanged and only the memory traffic is
+ *  reduced. For S = lbBase_t (default) the field is stored
+ *  as is.
+ *
  *********************************************************/
-template <typename DXQY>
+template <typename S>
+class LbFieldReference
+/* Reference to a single reduced precision distribution value. Converts to and
+ * from lbBase_t, and adds/removes the shift w*rho0.
+ */
+{
+public:
+    LbFieldReference(S &val, const lbBase_t shift): val_(val), shift_(shift) {}
+    inline operator lbBase_t() const {return val_ + shift_;}
+    inline LbFieldReference& operator = (const lbBase_t rhs) {val_ = static_cast<S>(rhs - shift_); return *this;}
+    inline LbFieldReference& operator = (const LbFieldReference& rhs) {return *this = static_cast<lbBase_t>(rhs);}
+    inline LbFieldReference& operator += (const lbBase_t rhs) {val_ += static_cast<S>(rhs); return *this;}
+    inline LbFieldReference& operator -= (const lbBase_t rhs) {val_ -= static_cast<S>(rhs); return *this;}
+    inline LbFieldReference& operator *= (const lbBase_t rhs) {return *this = static_cast<lbBase_t>(*this)*rhs;}
+private:
+    S &val_;
+    const lbBase_t shift_;
+};
+
+
+template <typename DXQY, typename S>
+class LbFieldNodeReference
+/* Assignable reference to all distribution values at a node, used by LbField::set for
+ * reduced precision storage.
+ */
+{
+public:
+    LbFieldNodeReference(S *val, const lbBase_t *shift): val_(val), shift_(shift) {}
+    template <typename T>
+    inline void operator = (const T &rhs) {
+        for (int q = 0; q < DXQY::nQ; ++q)
+            val_[q] = static_cast<S>(rhs[q] - shift_[q]);
+    }
+    inline void operator = (const lbBase_t rhs) {
+        for (int q = 0; q < DXQY::nQ; ++q)
+            val_[q] = static_cast<S>(rhs - shift_[q]);
+    }
+private:
+    S *val_;
+    const lbBase_t *shift_;
+};
+
+
+template <typename DXQY, typename S=lbBase_t>
 class LbField
 {
 public:
+    static constexpr bool isReduced = !std::is_same<S, lbBase_t>::value;
+    typedef typename std::conditional<isReduced, LbFieldReference<S>, lbBase_t&>::type reference;
+    typedef typename std::conditional<isReduced, LbFieldNodeReference<DXQY, S>, std::slice_array<lbBase_t>>::type node_reference;
+
     /* Constructor */
-    LbField(const int nFields, const int nNodes):
-        nFields_(nFields), elementSize_(nFields_ * DXQY::nQ), nNodes_(nNodes), data_(elementSize_ * nNodes_) {}
+    LbField(const int nFields, const int nNodes, const lbBase_t rho0=1.0):
+        nFields_(nFields), elementSize_(nFields_ * DXQY::nQ), nNodes_(nNodes), data_(elementSize_ * nNodes_) 
+    {
+        for (int q = 0; q < DXQY::nQ; ++q)
+            shift_[q] = isReduced ? DXQY::w[q]*rho0 : 0.0;
+    }
     /* nFields : number of vector fields
      * nNodes  : number of nodes
+     * rho0    : reference density for the shift w*rho0 (only used for reduced precision storage)
      */
 
 
     /* operator overloading of () */
-    inline const lbBase_t& operator () (const int fieldNo, const int dirNo, const int nodeNo) const // Returns element
+    inline lbBase_t operator () (const int fieldNo, const int dirNo, const int nodeNo) const // Returns element
     {
-        return data_[elementSize_ * nodeNo + DXQY::nQ * fieldNo + dirNo];
+        if constexpr (isReduced)
+            return data_[elementSize_ * nodeNo + DXQY::nQ * fieldNo + dirNo] + shift_[dirNo];
+        else
+            return data_[elementSize_ * nodeNo + DXQY::nQ * fieldNo + dirNo];
     }
-    inline lbBase_t& operator () (const int fieldNo, const int dirNo, const int nodeNo) // Returns element
+    inline reference operator () (const int fieldNo, const int dirNo, const int nodeNo) // Returns element
     {
-        return data_[elementSize_ * nodeNo + DXQY::nQ * fieldNo + dirNo];
+        if constexpr (isReduced)
+            return reference(data_[elementSize_ * nodeNo + DXQY::nQ * fieldNo + dirNo], shift_[dirNo]);
+        else
+            return data_[elementSize_ * nodeNo + DXQY::nQ * fieldNo + dirNo];
     }
     /* Returns a reference to a distribution component at a node.
      * Example:
@@ -323,16 +392,27 @@ public:
      */
     inline const std::valarray<lbBase_t> operator () (const int fieldNo, const int nodeNo) const // Returns element
     {
-        return data_[std::slice(elementSize_ * nodeNo + DXQY::nQ * fieldNo, DXQY::nQ, 1)];
+        if constexpr (isReduced) {
+            std::valarray<lbBase_t> ret(DXQY::nQ);
+            const S *val = &data_[elementSize_ * nodeNo + DXQY::nQ * fieldNo];
+            for (int q = 0; q < DXQY::nQ; ++q)
+                ret[q] = val[q] + shift_[q];
+            return ret;
+        } else {
+            return data_[std::slice(elementSize_ * nodeNo + DXQY::nQ * fieldNo, DXQY::nQ, 1)];
+        }
     }
     inline std::valarray<lbBase_t> operator () (const int fieldNo, const int nodeNo) // Returns element
     {       
-        return data_[std::slice(elementSize_ * nodeNo + DXQY::nQ * fieldNo, DXQY::nQ, 1)];
+        return static_cast<const LbField&>(*this)(fieldNo, nodeNo);
     }
 
-    inline std::slice_array<lbBase_t> set(const int fieldNo, const int nodeNo)
+    inline node_reference set(const int fieldNo, const int nodeNo)
     {
-        return data_[std::slice(elementSize_ * nodeNo + DXQY::nQ * fieldNo, DXQY::nQ, 1)];
+        if constexpr (isReduced)
+            return node_reference(&data_[elementSize_ * nodeNo + DXQY::nQ * fieldNo], shift_);
+        else
+            return data_[std::slice(elementSize_ * nodeNo + DXQY::nQ * fieldNo, DXQY::nQ, 1)];
     }
 
     /* Returns a pointer to a lb distribution at a given node for a given field number
@@ -344,6 +424,14 @@ public:
      * nodeNo  : the current node (tag)
      */
 
+    /* Returns the stored (possibly shifted) value. Used for mpi communication and checkpoints,
+     * where the data is copied without conversion.
+     */
+    inline S& storage(const int fieldNo, const int dirNo, const int nodeNo)
+    {
+        return data_[elementSize_ * nodeNo + DXQY::nQ * fieldNo + dirNo];
+    }
+
     /* Propagate values from the node with node number nodeNo and values f_omega to the neighboring distribution on
      * int this field.
      * */
@@ -352,7 +440,10 @@ public:
     {
         int ind_shift = fieldNo * DXQY::nQ;
         for (int q = 0; q < DXQY::nQ; ++q) {
-            data_[elementSize_ * grid.neighbor(q, nodeNo) + ind_shift + q] = f_omega[q];
+            if constexpr (isReduced)
+                data_[elementSize_ * grid.neighbor(q, nodeNo) + ind_shift + q] = static_cast<S>(f_omega[q] - shift_[q]);
+            else
+                data_[elementSize_ * grid.neighbor(q, nodeNo) + ind_shift + q] = f_omega[q];
         }
     }
 
@@ -365,6 +456,7 @@ public:
 
     int getNumNodes() const {return nNodes_;} // Getter for nNodes_
     int num_fields() const {return nFields_;} // Getter for nFields_
+    void resize(const int nNodes) {nNodes_ = nNodes; data_.resize(elementSize_ * nNodes);}  // New stored values are zero
     void writeToFile(const std::string fileName) const;
     void readFromFile(const std::string fileName);
 
@@ -372,11 +464,15 @@ private:
     const int nFields_;  // Number of fields
     const int elementSize_;  // Size of a memory block
     int nNodes_;  // number of nodes per field
-    std::valarray<lbBase_t> data_;  // Container for the field
+    lbBase_t shift_[DXQY::nQ];  // Storage shift w*rho0, zero for full precision
+    std::valarray<S> data_;  // Container for the field
 };
 
-template<typename DXQY>
-void LbField<DXQY>::writeToFile(const std::string fileName) const
+template<typename DXQY, typename S>
+void LbField<DXQY, S>::writeToFile(const std::string fileName) const
+/* Writes the stored values, so a reduced precision field gives a reduced precision file
+ * with the shifted distributions.
+ */
 {
     std::ofstream ofs(fileName+".lblbf", std::ios::out | std::ios::binary);
     if (!ofs) {
@@ -392,8 +488,12 @@ void LbField<DXQY>::writeToFile(const std::string fileName) const
     ofs.close();
 }
 
-template<typename DXQY>
-void LbField<DXQY>::readFromFile(const std::string fileName)
+template<typename DXQY, typename S>
+void LbField<DXQY, S>::readFromFile(const std::string fileName)
+/* Reads a file written with the same storage type. A reduced precision field can also
+ * read a full precision (lbBase_t) file, with a warning since the values are rounded
+ * to S. A full precision field does not read a reduced precision file.
+ */
 {
     std::ifstream ifs(fileName+".lblbf", std::ios::out | std::ios::binary);
     if (!ifs) {
@@ -405,17 +505,37 @@ void LbField<DXQY>::readFromFile(const std::string fileName)
     ifs.read((char*) &tmpNQ, sizeof(tmpNQ));
     int tmpNodes;
     ifs.read((char*) &tmpNodes, sizeof(nNodes_));  // Reads nNodes_ 
-    if ( (tmpFields != nFields_) || (tmpNodes != nNodes_) || (tmpNQ != DXQY::nQ)) {
+    // Size of the stored values
+    const std::streampos dataBegin = ifs.tellg();
+    ifs.seekg(0, std::ios::end);
+    const std::size_t dataSize = static_cast<std::size_t>(ifs.tellg() - dataBegin);
+    ifs.seekg(dataBegin);
+    const std::size_t numValues = static_cast<std::size_t>(elementSize_)*nNodes_;
+    const bool readStorage = (dataSize == numValues*sizeof(S));
+    const bool readFull = isReduced && (dataSize == numValues*sizeof(lbBase_t));
+    if ( (tmpFields != nFields_) || (tmpNodes != nNodes_) || (tmpNQ != DXQY::nQ) || !(readStorage || readFull) ) {
         std::cout << "WARNNING: Mismatch between Lbfield size and read field size in file:" << std::endl;
         std::cout << "              " + fileName  << std::endl;
         std::cout << "          number of fields = "  << tmpFields << "  (" << nFields_ << ")" << std::endl; 
         std::cout << "          number of directions = "  << tmpNQ << "  (" << DXQY::nQ << ")" << std::endl; 
         std::cout << "          number of nodes = "  << tmpNodes <<  "  (" << nNodes_ << ")" <<std::endl; 
+        std::cout << "          bytes per value = "  << dataSize/(numValues > 0 ? numValues : 1) <<  "  (" << sizeof(S) << ")" <<std::endl; 
         std::cout << "          No data read!" << std::endl;
         return;
     }
+    if (!readStorage) {
+        std::cout << "WARNNING: Reading a full precision file into a reduced precision LbField:" << std::endl;
+        std::cout << "              " + fileName  << std::endl;
+        std::cout << "          the values are rounded to " << sizeof(S) << " bytes per value" << std::endl;
+    }
     for (int nodeNo=0; nodeNo < elementSize_*nNodes_; ++nodeNo) {
-        ifs.read((char*) &data_[nodeNo], sizeof(data_[0]));
+        if (readStorage) {
+            ifs.read((char*) &data_[nodeNo], sizeof(data_[0]));
+        } else {
+            lbBase_t tmp;
+            ifs.read((char*) &tmp, sizeof(tmp));
+            data_[nodeNo] = static_cast<S>(tmp - shift_[nodeNo % DXQY::nQ]);
+        }
     }
     ifs.close();
 }
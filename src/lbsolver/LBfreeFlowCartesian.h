@@ -5,6 +5,7 @@
 #include "LBboundary.h"
 #include "LBgrid.h"
 #include "LBfield.h"
+#include "LBprofiler.h"
 
 
 /*********************************************************
@@ -29,6 +30,12 @@ public:
 
 private:
     int q_normal;
+    // Beta and gamma directions of boundary node n in beta_[betaBegin_[n]] ... beta_[betaBegin_[n+1]-1],
+    // and likewise for gamma, so that apply does not build direction lists
+    std::vector<int> betaBegin_;
+    std::vector<int> beta_;
+    std::vector<int> gammaBegin_;
+    std::vector<int> gamma_;
 };
 
 
@@ -39,6 +46,17 @@ FreeFlowCartesian<DXQY>::FreeFlowCartesian(const std::vector<int> bndNodes, cons
     std::vector<int> n_normal = {0, 1, 0};
 
     q_normal = DXQY::c2q(n_normal);
+
+    betaBegin_.push_back(0);
+    gammaBegin_.push_back(0);
+    for (int n = 0; n < this->size(); ++n) {
+        for (auto beta: this->beta(n))
+            beta_.push_back(beta);
+        for (auto gamma: this->gamma(n))
+            gamma_.push_back(gamma);
+        betaBegin_.push_back(beta_.size());
+        gammaBegin_.push_back(gamma_.size());
+    }
 }
 
 
@@ -57,7 +75,9 @@ inline void FreeFlowCartesian<DXQY>::apply(const int fieldNo, LbField<DXQY> &f,
     *
     */
 {
-    for (int n = 0; n < this->nBoundaryNodes_; ++n) {
+    static const int region = profiler().region("FreeFlowCartesian::apply");
+    ScopedTimer timer(region);
+    for (int n = 0; n < this->size(); ++n) {
         int node = this->nodeNo(n);
         int nodeNeig = grid.neighbor(q_normal, node);
         
@@ -77,43 +97,41 @@ inline void FreeFlowCartesian<DXQY>::apply(const int fieldNo, LbField<DXQY> &f,
         C0 += fNode[DXQY::nQ - 1];
         C0Neig += fNeig[DXQY::nQ - 1];
 	
-        for (auto gamma: this->gamma(n)) {	  
+        for (int k = gammaBegin_[n]; k < gammaBegin_[n+1]; ++k) {
+            const int gamma = gamma_[k];
             C0 += fNode[gamma];
             C0Neig += fNeig[gamma];
-            std::valarray<int> c_va(DXQY::c(gamma).data(), DXQY::nD);
             for(int d=0; d<DXQY::nD; d++) {
-                CV[d] += fNode[gamma]*c_va[d];
+                CV[d] += fNode[gamma]*DXQY::c(gamma, d);
             }
 
             int gamma_rev = this->dirRev(gamma);
             C0 += fNode[gamma_rev];
             C0Neig += fNeig[gamma_rev];
-            std::valarray<int> c_va_rev(DXQY::c(gamma_rev).data(), DXQY::nD);
             for(int d=0; d<DXQY::nD; d++) {
-                CV[d] += fNode[gamma_rev]*c_va_rev[d];
+                CV[d] += fNode[gamma_rev]*DXQY::c(gamma_rev, d);
             }
         }
 
-        for (auto beta: this->beta(n)) {
-            int beta_rev = this->dirRev(beta);
+        for (int k = betaBegin_[n]; k < betaBegin_[n+1]; ++k) {
+            int beta_rev = this->dirRev(beta_[k]);
             C0 += fNode[beta_rev];
             C0Neig += fNeig[beta_rev];
-            std::valarray<int> c_va(DXQY::c(beta_rev).data(), DXQY::nD);
             for(int d=0; d<DXQY::nD; d++) {
-                CV[d] += fNode[beta_rev]*c_va[d];
+                CV[d] += fNode[beta_rev]*DXQY::c(beta_rev, d);
             }
         }
 	
         std::vector<lbBase_t> fNeq(DXQY::nQ);
         lbBase_t uu = DXQY::dot(velNeig, velNeig);
         lbBase_t vel_tmp[] = {velNeig[0], velNeig[1], velNeig[2]};
-        for (auto beta: this->beta(n)) {
+        for (int k = betaBegin_[n]; k < betaBegin_[n+1]; ++k) {
+            const int beta = beta_[k];
             lbBase_t cu = DXQY::cDot(beta, vel_tmp);
             fNeq[beta] = fNeig[beta] - rhoNeig * DXQY::w[beta]*(1.0 + DXQY::c2Inv*cu + DXQY::c4Inv0_5*(cu*cu - DXQY::c2*uu) );
             C0 += fNeq[beta];
-            std::valarray<int> c_va(DXQY::c(beta).data(), DXQY::nD);
             for(int d=0; d<DXQY::nD; d++) {
-                CV[d] += c_va[d]*fNeq[beta];
+                CV[d] += DXQY::c(beta, d)*fNeq[beta];
             }
         }
 
@@ -151,7 +169,8 @@ inline void FreeFlowCartesian<DXQY>::apply(const int fieldNo, LbField<DXQY> &f,
         }
 
 	uu = DXQY::dot(velNode, velNode);
-        for (auto beta: this->beta(n)) {
+        for (int k = betaBegin_[n]; k < betaBegin_[n+1]; ++k) {
+            const int beta = beta_[k];
             lbBase_t cu = DXQY::cDot(beta, velNode);	    
             f(0, beta, node) = DXQY::w[beta]*rhoNode*(1.0 + DXQY::c2Inv*cu + DXQY::c4Inv0_5*(cu*cu - DXQY::c2*uu) ) /*+ fNeq[beta]*/;
         }
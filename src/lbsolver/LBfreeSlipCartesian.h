@@ -5,6 +5,7 @@
 #include "LBboundary.h"
 #include "LBgrid.h"
 #include "LBfield.h"
+#include "LBprofiler.h"
 
 
 /*********************************************************
@@ -28,18 +29,20 @@ class FreeSlipCartesian : public Boundary<DXQY>
 {
 public:
     FreeSlipCartesian(const std::vector<int> &normVec, const std::vector<int> bndNodes, const Nodes<DXQY> &nodes, const Grid<DXQY> &grid);     
-    void apply(const int fieldNo, LbField<DXQY> &f, const Grid<DXQY> &grid) const;
+    template <typename S>
+    void apply(const int fieldNo, LbField<DXQY, S> &f, const Grid<DXQY> &grid) const;
     
 private:    
     const std::vector<int> n_vec;  // Normal vector
     int q_wall;
     std::vector<int> beta_reflection;  // List of reflected beta values
+    BoundaryLinks links_;  // (node, beta, beta_reflection[beta], wall node) for all beta links
 };
 
 
 template <typename DXQY>
 FreeSlipCartesian<DXQY>::FreeSlipCartesian(const std::vector<int> &normVec, const std::vector<int> bndNodes, const Nodes<DXQY> &nodes, const Grid<DXQY> &grid)
-: n_vec(normVec.begin(), normVec.end()),  Boundary<DXQY>(bndNodes, nodes, grid), beta_reflection(DXQY::nQ)
+: Boundary<DXQY>(bndNodes, nodes, grid), n_vec(normVec.begin(), normVec.end()), beta_reflection(DXQY::nQ)
 {
     // Set the direction of the free slip wall
     q_wall = this->dirRev(DXQY::c2q(n_vec));
@@ -64,11 +67,21 @@ FreeSlipCartesian<DXQY>::FreeSlipCartesian(const std::vector<int> &normVec, cons
 	  std::cout<<"ERROR in FreeSlipCartesian initialization: c2q returns -1 for q = "<<q<<std::endl;
 	}
     }
+
+    // Setup the links
+    for (int n = 0; n < this->size(); ++n) {
+        const int node = this->nodeNo(n);
+        const int node_wall = grid.neighbor(q_wall, node);
+        for (auto beta: this->beta(n)) {
+            links_.add(node, beta, beta_reflection[beta], node_wall);
+        }
+    }
 }
 
 
 template <typename DXQY>
-inline void FreeSlipCartesian<DXQY>::apply(const int fieldNo, LbField<DXQY> &f, const Grid<DXQY> &grid) const
+template <typename S>
+inline void FreeSlipCartesian<DXQY>::apply(const int fieldNo, LbField<DXQY, S> &f, const Grid<DXQY> &grid) const
 /* apply : performs the free slip condition, at the bondary nodes.
     *
     * fieldNo :
@@ -78,18 +91,14 @@ inline void FreeSlipCartesian<DXQY>::apply(const int fieldNo, LbField<DXQY> &f,
     * grid    :
     grid object
     *
-    * Use 'this->' to access functions and variables in the parent class, Boundary<DXQY>.
+    * The links are precomputed in the constructor, so no direction lists are
+    * built here.
     *
     */
 {
-    for (int n = 0; n < this->nBoundaryNodes_; ++n) {
-        int node = this->nodeNo(n);
-        int node_wall = grid.neighbor(q_wall, node);
-
-        for (auto beta: this->beta(n)) {
-            f(fieldNo, beta, node) = f(fieldNo, beta_reflection[beta], node_wall);
-        }
-    }
+    static const int region = profiler().region("FreeSlipCartesian::apply");
+    ScopedTimer timer(region);
+    links_.copy(fieldNo, f);
 }
 
 #endif // LBFREESLIPCARTESIAN_H
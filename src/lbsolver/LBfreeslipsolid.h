@@ -6,6 +6,7 @@
 #include "LBgrid.h"
 #include "LBnodes.h"
 #include "LBfield.h"
+#include "LBprofiler.h"
 
 template<typename DXQY>
 class SolidFreeSlip
@@ -37,7 +38,7 @@ SolidFreeSlip<DXQY>::SolidFreeSlip(const std::vector<int> &outwardNormal, const
     // Grid direction for the inward pointing normal 
     qFluid_ = DXQY::c2q(vec);
     // Find the reflected direction. Set qSlipDir_
-    qSlipDir_.reserve(DXQY::nQ); 
+    qSlipDir_.resize(DXQY::nQ); 
     int normal[DXQY::nD]; // Hack, cDot sould take std::vector as argument
     for (int d=0; d<DXQY::nD; ++d) normal[d] = outwardNormal[d];
     for (int q=0; q<DXQY::nQ; ++q) {
@@ -93,6 +94,8 @@ inline std::vector<int> SolidFreeSlip<DXQY>::alpha(const int bndNo) const
 template<typename DXQY>
 void SolidFreeSlip<DXQY>::apply(const int fieldNo, LbField<DXQY> &f, const Grid<DXQY>& grid)
 {
+    static const int region = profiler().region("SolidFreeSlip::apply");
+    ScopedTimer timer(region);
     for (int bndNo = 0; bndNo < size(); ++bndNo) {
         int node = nodeNo(bndNo);
         int nodeFluid = grid.neighbor(qFluid_, node);
@@ -109,10 +112,12 @@ class SolidFreeSlipOld : public Boundary<DXQY>
 {
 public:
     SolidFreeSlipOld(const std::vector<int> &outwardNormal, const std::vector<int> &bndNodes, const Nodes<DXQY> &nodes, const Grid<DXQY> &grid);
-    void apply(const int fieldNo, LbField<DXQY> &f, const Grid<DXQY> &grid);
+    template <typename S>
+    void apply(const int fieldNo, LbField<DXQY, S> &f, const Grid<DXQY> &grid);
 private:
     int qFluid_; // Direction of the fluid node x_fluid = x + c_qFluid.
     std::vector<int> qSlipDir_;  // used as f_qSlipDir[q](x_fluid) = f_q(x)
+    BoundaryLinks links_;  // (x_fluid, qSlipDir[alpha], alpha, x) for the known directions alpha
 };
 
 
@@ -127,7 +132,7 @@ SolidFreeSlipOld<DXQY>::SolidFreeSlipOld(const std::vector<int> &outwardNormal,
     // Grid direction for the inward pointing normal 
     qFluid_ = DXQY::c2q(vec);
     // Find the reflected direction. Set qSlipDir_
-    qSlipDir_.reserve(DXQY::nQ); 
+    qSlipDir_.resize(DXQY::nQ); 
     int nVec[DXQY::nD]; // Hack, cDot sould take std::vector as argument
     for (int d=0; d<DXQY::nD; ++d) nVec[d] = outwardNormal[d];
     for (int q=0; q<DXQY::nQ; ++q) {
@@ -140,11 +145,26 @@ SolidFreeSlipOld<DXQY>::SolidFreeSlipOld(const std::vector<int> &outwardNormal,
             exit(1);
         }
     }
+    // Links in the order of a node by node loop
+    for (int bndNo=0; bndNo < this->size(); ++bndNo) {
+        const int nodeNo = this->nodeNo(bndNo);
+        const int nodeNoFluid = grid.neighbor(qFluid_, nodeNo);
+        for (auto beta: this->beta(bndNo)) {
+            const int alpha = this->dirRev(beta);
+            links_.add(nodeNoFluid, qSlipDir_[alpha], alpha, nodeNo);
+        }
+        for (auto gamma: this->gamma(bndNo)) {
+            links_.add(nodeNoFluid, qSlipDir_[gamma], gamma, nodeNo);
+            const int gammaRev = this->dirRev(gamma);
+            links_.add(nodeNoFluid, qSlipDir_[gammaRev], gammaRev, nodeNo);
+        }
+    }
 }
 
 
 template<typename DXQY>
-void SolidFreeSlipOld<DXQY>::apply(const int fieldNo, LbField<DXQY> &f, const Grid<DXQY> &grid)
+template<typename S>
+void SolidFreeSlipOld<DXQY>::apply(const int fieldNo, LbField<DXQY, S> &f, const Grid<DXQY> &grid)
 /*
  *  - beta          : Unknown
  *  - beta_revers   : Known
@@ -156,20 +176,9 @@ void SolidFreeSlipOld<DXQY>::apply(const int fieldNo, LbField<DXQY> &f, const Gr
  *  - delta_reverse : Unknown
  */
 {
-    for (int bndNo=0; bndNo < this->size(); ++bndNo) {
-        int nodeNo = this->nodeNo(bndNo);
-        int nodeNoFluid = grid.neighbor(qFluid_, nodeNo);
-        for (auto beta: this->beta(bndNo)) {
-            int alpha = this->dirRev(beta);
-            f(fieldNo, qSlipDir_[alpha], nodeNoFluid) = f(fieldNo, alpha, nodeNo);            
-        }
-        for (auto gamma: this->gamma(bndNo)) {
-            int alpha = gamma;
-            f(fieldNo, qSlipDir_[alpha], nodeNoFluid) = f(fieldNo, alpha, nodeNo);
-            alpha = this->dirRev(gamma);
-            f(fieldNo, qSlipDir_[alpha], nodeNoFluid) = f(fieldNo, alpha, nodeNo);            
-        }
-    }    
+    static const int region = profiler().region("SolidFreeSlipOld::apply");
+    ScopedTimer timer(region);
+    links_.copy(fieldNo, f);
 }
 
 #endif
\ No newline at end of file
@@ -0,0 +1,720 @@
+#ifndef LBGEOMETRYGENERATOR_H
+#define LBGEOMETRYGENERATOR_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <mpi.h>
+#include "LBglobal.h"
+#include "LBlatticetypes.h"
+#include "../io/Input.h"
+
+/*********************************************************
+ * class GEOMETRYGENERATOR: synthetic geometries generated
+ *  per rank in memory, in place of the vtklb files from
+ *  the PythonScripts.
+ *
+ * The system is periodic in all directions, as in vtklb.py,
+ *  and the solids are the union of
+ *  - walls     : the planes x_d = 0 and x_d = n_d - 1, for
+ *                a channel (one direction) or a duct
+ *  - cylinders : along an axis (disks in 2d)
+ *  - spheres   : random overlapping spheres (disks in 2d)
+ *                with a seed. The number of spheres is
+ *                chosen so that the expected porosity of
+ *                the spheres alone is the given value.
+ *  - gaussian  : random porous medium, solid where a
+ *                Gaussian filtered white noise field, with
+ *                the given correlation length, is above the
+ *                level that gives the expected porosity.
+ *  The random geometries depend only on the seed, not on
+ *  the number of ranks.
+ *
+ * The ranks get a Cartesian block decomposition of the
+ *  system (MPI_Dims_create, or the given rank dimensions).
+ *  Each rank evaluates the geometry only on its own block
+ *  and one layer around it, and the node labels of the
+ *  neighbor ranks are exchanged with MPI, so no rank holds
+ *  the whole system. vtklb(...) returns the vtklb file of
+ *  the rank, laid out as by PythonScripts/vtklb.py, for
+ *  LBvtk(std::istringstream). The text is only held until
+ *  the Grid, Nodes and BndMpi are set up.
+ *
+ * The generator is set up from the input file block
+ *     <geometry>
+ *         size       400 200 200
+ *         walls      1              # optional, wall normal directions
+ *         ranks      4 2 1          # optional, ranks per direction
+ *         cylinder_axis 2           # optional, default z
+ *         <cylinders>               # optional, center and radius per row
+ *             100 100 40
+ *         <end>
+ *         <spheres>                 # optional
+ *             porosity  0.7
+ *             radius    8
+ *             seed      1
+ *         <end>
+ *         <gaussian>                # optional
+ *             porosity  0.6
+ *             length    4
+ *             seed      2
+ *         <end>
+ *     <end>
+ * and used in place of the vtklb file:
+ *     GeometryGenerator<LT> generator(input);
+ *     LBvtk<LT> vtklb(std::istringstream(generator.vtklb(myRank, nProcs)));
+ *     Grid<LT> grid(vtklb);
+ *     ...
+ * The vtklb files have only the nodetype attribute.
+ *********************************************************/
+template <typename DXQY>
+class GeometryGenerator
+{
+public:
+    GeometryGenerator(const std::vector<int> &size);
+    GeometryGenerator(Input &input);
+
+    void addWalls(const int dir);
+    void addCylinder(const std::vector<lbBase_t> &center, const lbBase_t radius, const int axis=DXQY::nD-1);
+    void addSpheres(const lbBase_t porosity, const lbBase_t radius, const unsigned seed);
+    void setGaussian(const lbBase_t porosity, const lbBase_t length, const unsigned seed);
+    void setRankDims(const std::vector<int> &dims) {rankDims_ = dims;}
+
+    inline const std::vector<int> &size() const {return size_;}
+    std::vector<char> solid(const std::vector<int> &lo, const std::vector<int> &hi) const;
+    std::string vtklb(const int myRank, const int nProcs) const;
+
+private:
+    struct Ball
+    {
+        std::vector<lbBase_t> center;
+        lbBase_t radius;
+        int axis;  // Cylinder axis, -1 for a sphere
+    };
+    struct SphereSet
+    {
+        lbBase_t porosity;
+        lbBase_t radius;
+        unsigned seed;
+    };
+
+    static std::uint64_t hash(std::uint64_t x);
+    static unsigned seedValue(const lbBase_t value, const std::string &blockName);
+    void markBall(const Ball &ball, const std::vector<int> &lo, const std::vector<int> &hi, std::vector<char> &ret) const;
+    void markGaussian(const std::vector<int> &lo, const std::vector<int> &hi, std::vector<char> &ret) const;
+    long wrapIndex(const std::vector<int> &pos) const;
+
+    std::vector<int> size_;
+    std::vector<int> walls_;
+    std::vector<Ball> cylinders_;
+    std::vector<SphereSet> spheres_;
+    bool gaussian_;
+    lbBase_t gaussPorosity_;
+    lbBase_t gaussLength_;
+    unsigned gaussSeed_;
+    std::vector<int> rankDims_;  // Empty for MPI_Dims_create
+};
+
+
+template <typename DXQY>
+GeometryGenerator<DXQY>::GeometryGenerator(const std::vector<int> &size)
+    : size_(size), gaussian_(false), gaussPorosity_(1), gaussLength_(1), gaussSeed_(0)
+/* size : system size, DXQY::nD values
+ */
+{
+    if (static_cast<int>(size_.size()) != DXQY::nD) {
+        std::cout << "ERROR in GeometryGenerator: the size must have " << DXQY::nD << " components" << std::endl;
+        exit(1);
+    }
+}
+
+
+template <typename DXQY>
+GeometryGenerator<DXQY>::GeometryGenerator(Input &input)
+    : GeometryGenerator(static_cast<std::vector<int>>(input["geometry"]["size"]))
+/* input : reads the geometry block, see the class comment
+ */
+{
+    const Block &block = input["geometry"];
+    if (block.contains("walls"))
+        for (const auto &dir: static_cast<std::vector<int>>(block["walls"]))
+            addWalls(dir);
+    if (block.contains("ranks"))
+        setRankDims(block["ranks"]);
+    if (block.contains("cylinders")) {
+        const int axis = block.contains("cylinder_axis") ? static_cast<int>(block["cylinder_axis"]) : DXQY::nD - 1;
+        const std::vector<lbBase_t> values = block["cylinders"];
+        if (values.size() % (DXQY::nD + 1) != 0) {
+            std::cout << "ERROR in GeometryGenerator: give " << DXQY::nD << " center coordinates and the radius for each cylinder" << std::endl;
+            exit(1);
+        }
+        for (std::size_t n = 0; n < values.size(); n += DXQY::nD + 1)
+            addCylinder(std::vector<lbBase_t>(values.begin() + n, values.begin() + n + DXQY::nD), values[n + DXQY::nD], axis);
+    }
+    if (block.contains("spheres")) {
+        const Block &spheres = block["spheres"];
+        addSpheres(spheres["porosity"], spheres["radius"], seedValue(spheres["seed"], "spheres"));
+    }
+    if (block.contains("gaussian")) {
+        const Block &gaussian = block["gaussian"];
+        setGaussian(gaussian["porosity"], gaussian["length"], seedValue(gaussian["seed"], "gaussian"));
+    }
+}
+
+
+template <typename DXQY>
+unsigned GeometryGenerator<DXQY>::seedValue(const lbBase_t value, const std::string &blockName)
+/* seedValue : the seed read from the input file, which must be an integer from 0 to
+ *  2^32 - 1. The input values are doubles, so a cast would wrap negative seeds.
+ */
+{
+    if ( (value < 0) || (value > 4294967295.0) || (value != std::floor(value)) ) {
+        std::cout << "ERROR in GeometryGenerator: the " << blockName << " seed " << value << " is not an integer from 0 to 4294967295" << std::endl;
+        exit(1);
+    }
+    return static_cast<unsigned>(value);
+}
+
+
+template <typename DXQY>
+void GeometryGenerator<DXQY>::addWalls(const int dir)
+/* addWalls : solid planes at x_dir = 0 and x_dir = n_dir - 1
+ */
+{
+    if ( (dir < 0) || (dir >= DXQY::nD) ) {
+        std::cout << "ERROR in GeometryGenerator: wall direction " << dir << " is not in 0 to " << DXQY::nD - 1 << std::endl;
+        exit(1);
+    }
+    walls_.push_back(dir);
+}
+
+
+template <typename DXQY>
+void GeometryGenerator<DXQY>::addCylinder(const std::vector<lbBase_t> &center, const lbBase_t radius, const int axis)
+/* addCylinder : solid cylinder along axis (ignored in 2d). The axis component of the
+ *  center is not used.
+ */
+{
+    if ( (static_cast<int>(center.size()) != DXQY::nD) || (axis < 0) || (axis >= DXQY::nD) ) {
+        std::cout << "ERROR in GeometryGenerator: a cylinder needs " << DXQY::nD << " center coordinates and an axis from 0 to " << DXQY::nD - 1 << std::endl;
+        exit(1);
+    }
+    cylinders_.push_back({center, radius, (DXQY::nD == 2) ? -1 : axis});
+}
+
+
+template <typename DXQY>
+void GeometryGenerator<DXQY>::addSpheres(const lbBase_t porosity, const lbBase_t radius, const unsigned seed)
+/* addSpheres : random overlapping spheres with centers anywhere in the system
+ *
+ * porosity : expected fluid fraction of the spheres alone, exp(-number*sphere volume/volume)
+ */
+{
+    if ( (porosity <= 0) || (porosity > 1) || (radius <= 0) ) {
+        std::cout << "ERROR in GeometryGenerator: use a sphere porosity in (0, 1] and a positive radius" << std::endl;
+        exit(1);
+    }
+    spheres_.push_back({porosity, radius, seed});
+}
+
+
+template <typename DXQY>
+void GeometryGenerator<DXQY>::setGaussian(const lbBase_t porosity, const lbBase_t length, const unsigned seed)
+/* setGaussian : random porous medium from a Gaussian field
+ *
+ * porosity : expected fluid fraction of the medium alone
+ * length   : standard deviation of the Gaussian filter in nodes
+ */
+{
+    if ( (porosity <= 0) || (porosity > 1) || (length <= 0) ) {
+        std::cout << "ERROR in GeometryGenerator: use a gaussian porosity in (0, 1] and a positive length" << std::endl;
+        exit(1);
+    }
+    gaussian_ = true;
+    gaussPorosity_ = porosity;
+    gaussLength_ = length;
+    gaussSeed_ = seed;
+}
+
+
+template <typename DXQY>
+std::uint64_t GeometryGenerator<DXQY>::hash(std::uint64_t x)
+/* hash : splitmix64, a random number for each node and seed
+ */
+{
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30))*0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27))*0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+
+template <typename DXQY>
+long GeometryGenerator<DXQY>::wrapIndex(const std::vector<int> &pos) const
+/* wrapIndex : row-major index (x slowest) of the periodic image of pos in the system
+ */
+{
+    long ret = 0;
+    for (int d = 0; d < DXQY::nD; ++d)
+        ret = ret*size_[d] + ((pos[d] % size_[d]) + size_[d]) % size_[d];
+    return ret;
+}
+
+
+template <typename DXQY>
+std::vector<char> GeometryGenerator<DXQY>::solid(const std::vector<int> &lo, const std::vector<int> &hi) const
+/* solid : 1 for solid and 0 for fluid at the positions lo <= pos < hi, in row-major
+ *  order (x slowest). Positions outside the system are periodic images.
+ */
+{
+    constexpr int nD = DXQY::nD;
+    long num = 1;
+    for (int d = 0; d < nD; ++d)
+        num *= hi[d] - lo[d];
+    std::vector<char> ret(num, 0);
+
+    std::vector<int> pos(lo);
+    for (long ind = 0; ind < num; ++ind) {
+        for (const auto &dir: walls_) {
+            const int x = ((pos[dir] % size_[dir]) + size_[dir]) % size_[dir];
+            if ( (x == 0) || (x == size_[dir] - 1) )
+                ret[ind] = 1;
+        }
+        for (int d = nD - 1; d >= 0; --d) {
+            if (++pos[d] < hi[d])
+                break;
+            pos[d] = lo[d];
+        }
+    }
+
+    for (const auto &cylinder: cylinders_)
+        markBall(cylinder, lo, hi, ret);
+
+    const lbBase_t pi = 3.14159265358979323846;
+    lbBase_t volume = 1;
+    for (int d = 0; d < nD; ++d)
+        volume *= size_[d];
+    for (const auto &set: spheres_) {
+        const lbBase_t ballVolume = (nD == 2) ? pi*set.radius*set.radius : 4.0/3.0*pi*std::pow(set.radius, 3);
+        const long numSpheres = std::lround(-std::log(set.porosity)*volume/ballVolume);
+        std::mt19937_64 gen(set.seed);
+        std::uniform_real_distribution<lbBase_t> uniform(0.0, 1.0);
+        Ball sphere = {std::vector<lbBase_t>(nD), set.radius, -1};
+        for (long n = 0; n < numSpheres; ++n) {
+            for (int d = 0; d < nD; ++d)
+                sphere.center[d] = size_[d]*uniform(gen);
+            markBall(sphere, lo, hi, ret);
+        }
+    }
+
+    if (gaussian_)
+        markGaussian(lo, hi, ret);
+    return ret;
+}
+
+
+template <typename DXQY>
+void GeometryGenerator<DXQY>::markBall(const Ball &ball, const std::vector<int> &lo, const std::vector<int> &hi, std::vector<char> &ret) const
+/* markBall : marks the nodes inside the ball, and its periodic images, as solid
+ */
+{
+    constexpr int nD = DXQY::nD;
+    std::vector<int> boxLo(nD), boxHi(nD), shift(nD, -1), pos(nD);
+    while (shift[0] <= 1) {
+        bool empty = false;
+        for (int d = 0; d < nD; ++d) {
+            if (d == ball.axis) {
+                boxLo[d] = lo[d];
+                boxHi[d] = hi[d];
+            } else {
+                const lbBase_t c = ball.center[d] + shift[d]*size_[d];
+                boxLo[d] = std::max(lo[d], static_cast<int>(std::ceil(c - ball.radius)));
+                boxHi[d] = std::min(hi[d], static_cast<int>(std::floor(c + ball.radius)) + 1);
+            }
+            empty = empty || (boxLo[d] >= boxHi[d]);
+        }
+        if ( !empty && ((ball.axis < 0) || (shift[ball.axis] == 0)) ) {
+            pos = boxLo;
+            while (pos[0] < boxHi[0]) {
+                lbBase_t r2 = 0;
+                long ind = 0;
+                for (int d = 0; d < nD; ++d) {
+                    if (d != ball.axis) {
+                        const lbBase_t x = pos[d] - ball.center[d] - shift[d]*size_[d];
+                        r2 += x*x;
+                    }
+                    ind = ind*(hi[d] - lo[d]) + pos[d] - lo[d];
+                }
+                if (r2 <= ball.radius*ball.radius)
+                    ret[ind] = 1;
+                for (int d = nD - 1; d >= 0; --d) {
+                    if ( (++pos[d] < boxHi[d]) || (d == 0) )
+                        break;
+                    pos[d] = boxLo[d];
+                }
+            }
+        }
+        for (int d = nD - 1; d >= 0; --d) {
+            if ( (++shift[d] <= 1) || (d == 0) )
+                break;
+            shift[d] = -1;
+        }
+    }
+}
+
+
+template <typename DXQY>
+void GeometryGenerator<DXQY>::markGaussian(const std::vector<int> &lo, const std::vector<int> &hi, std::vector<char> &ret) const
+/* markGaussian : white noise, from the hash of the periodic node index, filtered with a
+ *  separable Gaussian kernel normalized to unit variance, and thresholded at the
+ *  standard normal quantile of the porosity
+ */
+{
+    constexpr int nD = DXQY::nD;
+    const lbBase_t pi = 3.14159265358979323846;
+    const int width = static_cast<int>(std::ceil(3*gaussLength_));
+    std::vector<lbBase_t> kernel(2*width + 1);
+    lbBase_t norm2 = 0;
+    for (int k = -width; k <= width; ++k) {
+        kernel[k + width] = std::exp(-0.5*k*k/(gaussLength_*gaussLength_));
+        norm2 += kernel[k + width]*kernel[k + width];
+    }
+    for (auto &w: kernel)
+        w /= std::sqrt(norm2);
+
+    // Noise on the box extended by the kernel width
+    std::vector<int> curLo(nD), curHi(nD), pos(nD);
+    long num = 1;
+    for (int d = 0; d < nD; ++d) {
+        curLo[d] = lo[d] - width;
+        curHi[d] = hi[d] + width;
+        num *= curHi[d] - curLo[d];
+    }
+    std::vector<lbBase_t> field(num);
+    pos = curLo;
+    for (long ind = 0; ind < num; ++ind) {
+        const std::uint64_t key = hash(gaussSeed_) ^ static_cast<std::uint64_t>(wrapIndex(pos));
+        const lbBase_t u1 = ((hash(2*key) >> 11) + 1.0)/9007199254740992.0;  // (0, 1]
+        const lbBase_t u2 = (hash(2*key + 1) >> 11)/9007199254740992.0;
+        field[ind] = std::sqrt(-2*std::log(u1))*std::cos(2*pi*u2);
+        for (int d = nD - 1; d >= 0; --d) {
+            if (++pos[d] < curHi[d])
+                break;
+            pos[d] = curLo[d];
+        }
+    }
+
+    // Filter one direction at a time, shrinking the box to [lo, hi) in that direction
+    for (int dir = 0; dir < nD; ++dir) {
+        long stride = 1;
+        for (int d = dir + 1; d < nD; ++d)
+            stride *= curHi[d] - curLo[d];
+        std::vector<int> newHi(curHi);
+        newHi[dir] = hi[dir];
+        num = 1;
+        for (int d = 0; d < nD; ++d)
+            num *= newHi[d] - ((d == dir) ? lo[d] : curLo[d]);
+        std::vector<lbBase_t> filtered(num);
+        std::vector<int> sizeIn(nD), sizeOut(nD);
+        for (int d = 0; d < nD; ++d) {
+            sizeIn[d] = curHi[d] - curLo[d];
+            sizeOut[d] = (d == dir) ? hi[d] - lo[d] : sizeIn[d];
+        }
+        std::vector<int> p(nD, 0);
+        for (long ind = 0; ind < num; ++ind) {
+            long in = 0;
+            for (int d = 0; d < nD; ++d)
+                in = in*sizeIn[d] + p[d];
+            lbBase_t sum = 0;
+            for (int k = 0; k <= 2*width; ++k)
+                sum += kernel[k]*field[in + k*stride];
+            filtered[ind] = sum;
+            for (int d = nD - 1; d >= 0; --d) {
+                if (++p[d] < sizeOut[d])
+                    break;
+                p[d] = 0;
+            }
+        }
+        field.swap(filtered);
+        curLo[dir] = lo[dir];
+        curHi[dir] = hi[dir];
+    }
+
+    // Level with P(field < level) = porosity
+    lbBase_t levelLo = -10, levelHi = 10;
+    for (int n = 0; n < 100; ++n) {
+        const lbBase_t level = 0.5*(levelLo + levelHi);
+        if (0.5*std::erfc(-level/std::sqrt(2.0)) < gaussPorosity_)
+            levelLo = level;
+        else
+            levelHi = level;
+    }
+    for (std::size_t ind = 0; ind < ret.size(); ++ind)
+        if (field[ind] > levelHi)
+            ret[ind] = 1;
+}
+
+
+template <typename DXQY>
+std::string GeometryGenerator<DXQY>::vtklb(const int myRank, const int nProcs) const
+/* vtklb : the vtklb file of rank myRank. Collective.
+ *
+ * Node order: fluid nodes of this rank, then the solid nodes next to them, then the
+ *  fluid nodes of each neighbor rank. Links through the periodic boundaries go
+ *  straight to nodes of this rank, and to rim copies (position -1 or n) otherwise.
+ */
+{
+    constexpr int nD = DXQY::nD;
+    constexpr int nQ = DXQY::nQ;
+
+    // Block decomposition
+    std::vector<int> dims(rankDims_);
+    if (dims.empty()) {
+        dims.assign(nD, 0);
+        MPI_Dims_create(nProcs, nD, dims.data());
+    }
+    int numBlocks = 1;
+    for (int d = 0; d < static_cast<int>(dims.size()); ++d) {
+        numBlocks *= dims[d];
+        if ( (d < nD) && (dims[d] > size_[d]) )
+            numBlocks = -1;
+    }
+    if ( (static_cast<int>(dims.size()) != nD) || (numBlocks != nProcs) ) {
+        std::cout << "ERROR in GeometryGenerator: the rank dimensions must have " << nD << " values, with product "
+                  << nProcs << " and none larger than the system size" << std::endl;
+        exit(1);
+    }
+    auto blockBegin = [&](const int d, const int i) {return static_cast<int>((static_cast<long>(i)*size_[d])/dims[d]);};
+    std::vector<int> myLo(nD), myHi(nD), lo(nD), hi(nD);  // Own block, and the box with one layer around it
+    for (int d = nD - 1, rest = myRank; d >= 0; --d) {
+        myLo[d] = blockBegin(d, rest % dims[d]);
+        myHi[d] = blockBegin(d, rest % dims[d] + 1);
+        lo[d] = myLo[d] - 1;
+        hi[d] = myHi[d] + 1;
+        rest /= dims[d];
+    }
+    auto owner = [&](const std::vector<int> &p) {
+        int ret = 0;
+        for (int d = 0; d < nD; ++d) {
+            const int x = ((p[d] % size_[d]) + size_[d]) % size_[d];
+            int i = static_cast<int>((static_cast<long>(x)*dims[d])/size_[d]);
+            while (blockBegin(d, i + 1) <= x)
+                ++i;
+            while (blockBegin(d, i) > x)
+                --i;
+            ret = ret*dims[d] + i;
+        }
+        return ret;
+    };
+
+    // Geometry on the box, indexed as boxIndex
+    const std::vector<char> isSolid = solid(lo, hi);
+    auto boxIndex = [&](const std::vector<int> &p) {
+        long ret = 0;
+        for (int d = 0; d < nD; ++d)
+            ret = ret*(hi[d] - lo[d]) + p[d] - lo[d];
+        return ret;
+    };
+    auto inBox = [&](const std::vector<int> &p) {
+        for (int d = 0; d < nD; ++d)
+            if ( (p[d] < lo[d]) || (p[d] >= hi[d]) )
+                return false;
+        return true;
+    };
+    auto wrapOwn = [&](const std::vector<int> &p) {  // Periodic image in the own block
+        std::vector<int> ret(nD);
+        for (int d = 0; d < nD; ++d) {
+            ret[d] = ((p[d] % size_[d]) + size_[d]) % size_[d];
+            if (ret[d] < myLo[d])
+                ret[d] += size_[d];
+        }
+        return ret;
+    };
+    auto boxPos = [&](long ind) {
+        std::vector<int> p(nD);
+        for (int d = nD - 1; d >= 0; --d) {
+            p[d] = lo[d] + ind % (hi[d] - lo[d]);
+            ind /= hi[d] - lo[d];
+        }
+        return p;
+    };
+
+    // Own fluid nodes, with their labels in local[]
+    std::vector<int> local(isSolid.size(), 0);
+    std::vector<long> nodeBox(1, -1);  // Box index of each local node
+    std::vector<int> p(myLo);
+    while (p[0] < myHi[0]) {
+        const long ind = boxIndex(p);
+        if (!isSolid[ind]) {
+            local[ind] = static_cast<int>(nodeBox.size());
+            nodeBox.push_back(ind);
+        }
+        for (int d = nD - 1; d >= 0; --d) {
+            if ( (++p[d] < myHi[d]) || (d == 0) )
+                break;
+            p[d] = myLo[d];
+        }
+    }
+    const int numOwn = static_cast<int>(nodeBox.size());
+
+    // Solid (key 0) and other rank (key 1 + rank) neighbors of the own nodes
+    std::map<int, std::vector<long>> extra;
+    for (int n = 1; n < numOwn; ++n) {
+        const std::vector<int> x = boxPos(nodeBox[n]);
+        for (int q = 0; q < nQ; ++q) {
+            for (int d = 0; d < nD; ++d)
+                p[d] = x[d] + DXQY::c(q, d);
+            const long ind = boxIndex(p);
+            const int rank = owner(p);
+            if (isSolid[ind])
+                extra[0].push_back(ind);
+            else if (rank != myRank)
+                extra[1 + rank].push_back(ind);
+        }
+    }
+    std::map<int, int> groupBegin;
+    for (auto &group: extra) {
+        std::vector<long> &list = group.second;
+        std::sort(list.begin(), list.end());
+        list.erase(std::unique(list.begin(), list.end()), list.end());
+        groupBegin[group.first] = static_cast<int>(nodeBox.size());
+        for (auto ind: list) {
+            local[ind] = static_cast<int>(nodeBox.size());
+            nodeBox.push_back(ind);
+        }
+    }
+    const int numPoints = static_cast<int>(nodeBox.size()) - 1;
+
+    // Labels of the other rank nodes, from their owners. The neighbor relation is
+    //  symmetric, so the ranks we request from are the ranks that request from us.
+    std::map<int, std::vector<long>> request, reply;  // Block indices, by rank
+    std::map<int, std::vector<int>> label, answer;
+    for (const auto &group: extra) {
+        if (group.first == 0)
+            continue;
+        const int rank = group.first - 1;
+        for (auto ind: group.second) {
+            const std::vector<int> x = boxPos(ind);
+            long blockInd = 0;
+            for (int d = nD - 1, rest = rank, mul = 1; d >= 0; --d) {
+                const int xd = ((x[d] % size_[d]) + size_[d]) % size_[d];
+                blockInd += mul*static_cast<long>(xd - blockBegin(d, rest % dims[d]));
+                mul *= blockBegin(d, rest % dims[d] + 1) - blockBegin(d, rest % dims[d]);
+                rest /= dims[d];
+            }
+            request[rank].push_back(blockInd);
+        }
+    }
+    std::vector<MPI_Request> reqs;
+    std::map<int, long> numReply;
+    for (auto &r: request) {
+        numReply[r.first] = 0;
+        reqs.emplace_back();
+        MPI_Irecv(&numReply[r.first], 1, MPI_LONG, r.first, 0, MPI_COMM_WORLD, &reqs.back());
+    }
+    std::map<int, long> numRequest;
+    for (auto &r: request) {
+        numRequest[r.first] = static_cast<long>(r.second.size());
+        reqs.emplace_back();
+        MPI_Isend(&numRequest[r.first], 1, MPI_LONG, r.first, 0, MPI_COMM_WORLD, &reqs.back());
+    }
+    MPI_Waitall(static_cast<int>(reqs.size()), reqs.data(), MPI_STATUSES_IGNORE);
+    reqs.clear();
+    for (auto &r: request) {
+        reply[r.first].resize(numReply[r.first]);
+        reqs.emplace_back();
+        MPI_Irecv(reply[r.first].data(), static_cast<int>(numReply[r.first]), MPI_LONG, r.first, 1, MPI_COMM_WORLD, &reqs.back());
+        reqs.emplace_back();
+        MPI_Isend(r.second.data(), static_cast<int>(r.second.size()), MPI_LONG, r.first, 1, MPI_COMM_WORLD, &reqs.back());
+    }
+    MPI_Waitall(static_cast<int>(reqs.size()), reqs.data(), MPI_STATUSES_IGNORE);
+    reqs.clear();
+    for (auto &r: reply) {
+        std::vector<int> &ans = answer[r.first];
+        for (auto blockInd: r.second) {
+            for (int d = nD - 1; d >= 0; --d) {
+                p[d] = myLo[d] + static_cast<int>(blockInd % (myHi[d] - myLo[d]));
+                blockInd /= myHi[d] - myLo[d];
+            }
+            ans.push_back(local[boxIndex(p)]);
+        }
+        label[r.first].resize(request[r.first].size());
+        reqs.emplace_back();
+        MPI_Irecv(label[r.first].data(), static_cast<int>(label[r.first].size()), MPI_INT, r.first, 2, MPI_COMM_WORLD, &reqs.back());
+        reqs.emplace_back();
+        MPI_Isend(ans.data(), static_cast<int>(ans.size()), MPI_INT, r.first, 2, MPI_COMM_WORLD, &reqs.back());
+    }
+    MPI_Waitall(static_cast<int>(reqs.size()), reqs.data(), MPI_STATUSES_IGNORE);
+
+    std::ostringstream ofs;
+    ofs << "# BADChIMP vtklb Version na\n";
+    ofs << "Geometry file for process " << myRank << "\n";
+    ofs << "ASCII\n";
+    ofs << "DATASET UNSTRUCTURED_LB_GRID\n";
+    ofs << "NUM_DIMENSIONS " << nD << "\n";
+    ofs << "GLOBAL_DIMENSIONS";
+    for (int d = 0; d < nD; ++d)
+        ofs << " " << size_[d] + 2;
+    ofs << "\n";
+    ofs << "USE_ZERO_GHOST_NODE\n";
+
+    ofs << "POINTS " << numPoints << " int\n";
+    for (int n = 1; n <= numPoints; ++n) {
+        const std::vector<int> x = boxPos(nodeBox[n]);
+        for (int d = 0; d < nD; ++d)
+            ofs << x[d] << ((d < nD - 1) ? " " : "\n");
+    }
+    ofs << "LATTICE " << nQ << " int\n";
+    for (int q = 0; q < nQ; ++q)
+        for (int d = 0; d < nD; ++d)
+            ofs << DXQY::c(q, d) << ((d < nD - 1) ? " " : "\n");
+    ofs << "NEIGHBORS int\n";
+    for (int n = 1; n <= numPoints; ++n) {
+        const std::vector<int> x = boxPos(nodeBox[n]);
+        for (int q = 0; q < nQ; ++q) {
+            bool inside = true;
+            for (int d = 0; d < nD; ++d) {
+                p[d] = x[d] + DXQY::c(q, d);
+                inside = inside && (p[d] >= -1) && (p[d] <= size_[d]);
+            }
+            int neig = 0;
+            if (inside) {
+                if (inBox(p))
+                    neig = local[boxIndex(p)];
+                if (neig == 0) {
+                    const std::vector<int> w = wrapOwn(p);
+                    if (inBox(w) && (owner(w) == myRank) && !isSolid[boxIndex(w)])
+                        neig = local[boxIndex(w)];
+                }
+            }
+            ofs << neig << ((q < nQ - 1) ? " " : "\n");
+        }
+    }
+
+    ofs << "PARALLEL_COMPUTING " << myRank << "\n";
+    for (const auto &group: extra) {
+        if (group.first == 0)
+            continue;
+        const int rank = group.first - 1;
+        const std::vector<int> &lab = label[rank];
+        ofs << "PROCESSOR " << group.second.size() << " " << rank << "\n";
+        for (std::size_t i = 0; i < group.second.size(); ++i)
+            ofs << groupBegin[group.first] + i << " " << lab[i] << "\n";
+    }
+
+    const int solidBegin = extra.count(0) ? groupBegin[0] : numOwn;
+    const int solidEnd = solidBegin + (extra.count(0) ? static_cast<int>(extra[0].size()) : 0);
+    ofs << "POINT_DATA " << numPoints << "\n";
+    ofs << "SCALARS nodetype int\n";
+    for (int n = 1; n <= numPoints; ++n)
+        ofs << ( ((n >= solidBegin) && (n < solidEnd)) ? 0 : 1 ) << "\n";
+    return ofs.str();
+}
+
+#endif // LBGEOMETRYGENERATOR_H
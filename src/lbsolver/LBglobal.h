@@ -10,6 +10,7 @@
 typedef double lbBase_t;
 #define SQRT2 1.4142135623730950488
 #define SQRT2INV 0.7071067811865475
+#define SQRT3 1.7320508075688772935
 
 constexpr lbBase_t lbBaseEps = std::numeric_limits<lbBase_t>::epsilon();
 
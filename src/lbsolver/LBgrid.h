@@ -23,10 +23,13 @@ public:
         posNodeNoPair_.insert( {multi2flat(pos), nodeNo});
     }
     template <typename T>
-    int operator[](const T &pos) {return this->posNodeNoPair_[this->multi2flat(pos)];}
+    int operator[](const T &pos) const {
+        const auto it = posNodeNoPair_.find(multi2flat(pos));
+        return (it != posNodeNoPair_.end()) ? it->second : 0;
+    }
 private:
     template <typename T>
-    inline int multi2flat(const T &pos);    std::array<int, DXQY::nD> posMul_;
+    inline int multi2flat(const T &pos) const;    std::array<int, DXQY::nD> posMul_;
     std::unordered_map<int, int> posNodeNoPair_;
 };
 
@@ -46,7 +49,7 @@ NodeNumber<DXQY>::NodeNumber(LBvtk<DXQY> &vtk)
 
 template<typename DXQY>
 template<typename T>
-inline int NodeNumber<DXQY>::multi2flat(const T &pos)
+inline int NodeNumber<DXQY>::multi2flat(const T &pos) const
 {
     int ret = pos[0];
     for (int i = 1; i < DXQY::nD; ++i) {
@@ -100,7 +103,7 @@ public:
     inline int& pos(const int nodeNo, const int index);
     inline const int& pos(const int nodeNo, const int index) const;
     template <typename T>
-    inline int nodeNo(const T &pos) {return nodeNumbers_[pos];}
+    inline int nodeNo(const T &pos) const {return nodeNumbers_[pos];}  // Returns 0 if the position is not in the grid
     inline int size() const {return nNodes_;}
     // std::vector<std::vector<int>> getNodePos(const std::vector<int> &nodeNoList) const;
     //std::vector<int> getNodePos(const std::vector<int> &nodeNoList) const;
@@ -0,0 +1,632 @@
+#ifndef LBGRIDTRANSFER_H
+#define LBGRIDTRANSFER_H
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <unordered_map>
+#include <vector>
+#include <mpi.h>
+#include "LBglobal.h"
+#include "LBlatticetypes.h"
+#include "LBgrid.h"
+#include "LBfield.h"
+
+/*********************************************************
+ * class GRIDTRANSFER: restriction and prolongation of rho,
+ *  vel and f between two grids of the same sample, where
+ *  each coarse voxel covers ratio^nD fine voxels.
+ *
+ * Voxel centres are matched through Grid::pos, so fine
+ *  voxel i lies at coarse coordinate (i + 0.5)/ratio - 0.5,
+ *  inside coarse voxel floor(i/ratio).
+ *
+ * toFine    : quadratic interpolation from the 3^nD coarse
+ *             nodes around the containing voxel if they are
+ *             all fluid, else (bi/tri)linear interpolation from
+ *             the coarse nodes around each fine node. Solid
+ *             coarse nodes are then replaced by mirror images
+ *             of their fluid neighbours across a half-way wall,
+ *             with the opposite velocity. Fine nodes with no
+ *             coarse fluid node nearby keep their values.
+ * toCoarse  : average over the fine fluid nodes in each
+ *             coarse voxel, summed in a fixed order so that
+ *             it does not depend on the partitioning.
+ *
+ * The distributions are set to the equilibrium of the
+ *  transferred rho and vel plus the transferred
+ *  non-equilibrium part, rescaled with the velocity scale
+ *  and the relaxation times. The velocity scale is u_fine/u_coarse
+ *  in lattice units, e.g. ratio^2 for the same tau and
+ *  body force in lattice units, or 1/ratio for the same
+ *  physical time step.
+ *
+ * The two grids may be partitioned differently. The
+ *  owner of each coarse node is found in the constructor
+ *  through a directory distributed over the ranks by
+ *  position, so each transfer is a single MPI_Alltoallv.
+ *
+ * Example, coarse run used to initiate the fine run:
+ *     GridTransfer<LT> transfer(gridC, bulkC, gridF, bulkF, 2);
+ *     transfer.toFine(0, tau, tau, 4.0, rhoC, velC, fC, rho, vel, f);
+ *********************************************************/
+template <typename DXQY>
+class GridTransfer
+{
+public:
+    GridTransfer(const Grid<DXQY> &coarseGrid, const std::vector<int> &coarseBulk, const Grid<DXQY> &fineGrid, const std::vector<int> &fineBulk,
+                 const int ratio, const std::vector<int> &fineOffset=std::vector<int>());
+
+    template <typename S>
+    void toFine(const int fieldNo, const lbBase_t tauCoarse, const lbBase_t tauFine, const lbBase_t velScale,
+                const ScalarField &rhoCoarse, const VectorField<DXQY> &velCoarse, const LbField<DXQY, S> &fCoarse,
+                ScalarField &rhoFine, VectorField<DXQY> &velFine, LbField<DXQY, S> &fFine) const;
+
+    // toFine in two steps, so that coarse values can be combined before the interpolation
+    template <typename S>
+    std::vector<lbBase_t> gatherCoarse(const int fieldNo, const LbField<DXQY, S> &fCoarse) const;
+    template <typename S>
+    void interpolateToFine(const int fieldNo, const std::vector<lbBase_t> &coarseVal, const lbBase_t tauCoarse, const lbBase_t tauFine, const lbBase_t velScale,
+                           ScalarField &rhoFine, VectorField<DXQY> &velFine, LbField<DXQY, S> &fFine) const
+    {
+        interpolateValues(fieldNo, coarseVal, tauCoarse, tauFine, velScale, &rhoFine, &velFine, fFine);
+    }
+    template <typename S>
+    void interpolateToFine(const int fieldNo, const std::vector<lbBase_t> &coarseVal, const lbBase_t tauCoarse, const lbBase_t tauFine, const lbBase_t velScale,
+                           LbField<DXQY, S> &fFine) const
+    {
+        interpolateValues(fieldNo, coarseVal, tauCoarse, tauFine, velScale, static_cast<ScalarField *>(nullptr), static_cast<VectorField<DXQY> *>(nullptr), fFine);
+    }
+
+    template <typename S>
+    void toCoarse(const int fieldNo, const lbBase_t tauFine, const lbBase_t tauCoarse, const lbBase_t velScale,
+                  const ScalarField &rhoFine, const VectorField<DXQY> &velFine, const LbField<DXQY, S> &fFine,
+                  ScalarField &rhoCoarse, VectorField<DXQY> &velCoarse, LbField<DXQY, S> &fCoarse) const;
+    template <typename S>
+    void toCoarse(const int fieldNo, const lbBase_t tauFine, const lbBase_t tauCoarse, const lbBase_t velScale,
+                  const LbField<DXQY, S> &fFine, LbField<DXQY, S> &fCoarse) const;
+
+private:
+    static constexpr int nVal_ = 1 + DXQY::nD + DXQY::nQ;  // rho, vel and f (or non-equilibrium f) per node
+
+    inline long long flat(const int *pos) const;
+    inline int parentPos(const int finePos) const {return (finePos >= 0) ? finePos/ratio_ : -1;}  // Halo positions are -1
+    template <typename T>
+    static std::vector<T> alltoallv(const std::vector<T> &sendBuf, const std::vector<int> &sendCount, std::vector<int> &recvCount, MPI_Datatype type);
+    template <typename T>
+    static void setNodeValues(const lbBase_t rho, const lbBase_t *vel, const lbBase_t *fNeq, const lbBase_t neqScale, const int fieldNo, const int nodeNo,
+                              ScalarField *rhoField, VectorField<DXQY> *velField, LbField<DXQY, T> &f);
+    template <typename S>
+    void interpolateValues(const int fieldNo, const std::vector<lbBase_t> &coarseVal, const lbBase_t tauCoarse, const lbBase_t tauFine, const lbBase_t velScale,
+                           ScalarField *rhoFine, VectorField<DXQY> *velFine, LbField<DXQY, S> &fFine) const;
+    template <typename S, typename T>
+    void restrictValues(const int fieldNo, const lbBase_t tauFine, const lbBase_t tauCoarse, const lbBase_t velScale, const T &fineValues,
+                        ScalarField *rhoCoarse, VectorField<DXQY> *velCoarse, LbField<DXQY, S> &fCoarse) const;
+    static inline void nonEquilibrium(const lbBase_t rho, const lbBase_t *vel, lbBase_t *f);
+    std::vector<lbBase_t> exchangeToFine(const std::vector<lbBase_t> &sendBuf) const;
+
+    const int ratio_;
+    const std::vector<int> coarseBulk_;
+    const std::vector<int> fineBulk_;
+    int nProcs_;
+    long long dimMul_[DXQY::nD];  // Multipliers from coarse position to flat index
+
+    // Coarse nodes this rank owns and sends, grouped by receiving rank
+    std::vector<int> sendCount_;
+    std::vector<int> sendNodes_;
+    // Coarse nodes this rank receives (slots), grouped by owner rank
+    std::vector<int> recvCount_;
+    int nSlots_;
+
+    // Interpolation stencil of each fine bulk node
+    std::vector<int> stencilBegin_;
+    std::vector<int> stencilSlot_;
+    std::vector<lbBase_t> stencilWeight_;
+    std::vector<lbBase_t> stencilVelWeight_;  // Negative for mirror images of fluid nodes
+    // Slot of the coarse voxel containing each fine bulk node, -1 if it is not a coarse fluid node
+    std::vector<int> parentSlot_;
+    std::vector<int> childNo_;  // Position of each fine bulk node in its coarse voxel
+};
+
+
+template <typename DXQY>
+GridTransfer<DXQY>::GridTransfer(const Grid<DXQY> &coarseGrid, const std::vector<int> &coarseBulk, const Grid<DXQY> &fineGrid,
+                                 const std::vector<int> &fineBulk, const int ratio, const std::vector<int> &fineOffset)
+    : ratio_(ratio), coarseBulk_(coarseBulk), fineBulk_(fineBulk)
+/* coarseGrid, coarseBulk : coarse grid and the coarse bulk nodes on this rank
+ * fineGrid, fineBulk     : fine grid and the fine bulk nodes on this rank
+ * ratio                  : coarse voxel size / fine voxel size
+ * fineOffset             : position of the fine grid's origin in fine voxels, when the
+ *                          fine grid only covers part of the sample (default zero)
+ */
+{
+    constexpr int nD = DXQY::nD;
+    if (ratio_ < 1) {
+        std::cout << "ERROR in GridTransfer: the refinement ratio must be positive" << std::endl;
+        exit(1);
+    }
+    if ( !fineOffset.empty() && (static_cast<int>(fineOffset.size()) != nD) ) {
+        std::cout << "ERROR in GridTransfer: the fine grid offset must have " << nD << " components" << std::endl;
+        exit(1);
+    }
+    auto finePos = [&](const int nodeNo, const int d) {return fineGrid.pos(nodeNo, d) + (fineOffset.empty() ? 0 : fineOffset[d]);};
+    MPI_Comm_size(MPI_COMM_WORLD, &nProcs_);
+
+    // Coarse dimensions, with room for the stencil outside the grid
+    int maxPosLocal[nD], maxPos[nD];
+    for (int d = 0; d < nD; ++d)
+        maxPosLocal[d] = 0;
+    for (int nodeNo = 1; nodeNo < coarseGrid.size(); ++nodeNo)
+        for (int d = 0; d < nD; ++d)
+            maxPosLocal[d] = std::max(maxPosLocal[d], coarseGrid.pos(nodeNo, d));
+    for (const auto &nodeNo: fineBulk_)
+        for (int d = 0; d < nD; ++d)
+            maxPosLocal[d] = std::max(maxPosLocal[d], parentPos(finePos(nodeNo, d)) + 1);
+    MPI_Allreduce(maxPosLocal, maxPos, nD, MPI_INT, MPI_MAX, MPI_COMM_WORLD);
+    dimMul_[0] = 1;
+    for (int d = 1; d < nD; ++d)
+        dimMul_[d] = dimMul_[d-1]*(maxPos[d-1] + 3);
+
+    auto owner = [&](const long long k) {return static_cast<int>(k % nProcs_);};
+
+    // ------------------------------------------------------------------ Register the coarse bulk nodes in the directory
+    std::unordered_map<long long, int> localCoarse;  // flat index -> local coarse node
+    std::vector<std::vector<long long>> toDir(nProcs_);
+    for (const auto &nodeNo: coarseBulk_) {
+        int pos[nD];
+        for (int d = 0; d < nD; ++d)
+            pos[d] = coarseGrid.pos(nodeNo, d);
+        const long long k = flat(pos);
+        localCoarse[k] = nodeNo;
+        toDir[owner(k)].push_back(k);
+    }
+    std::vector<long long> sendFlat;
+    std::vector<int> count(nProcs_), countRecv(nProcs_);
+    for (int r = 0; r < nProcs_; ++r) {
+        count[r] = toDir[r].size();
+        sendFlat.insert(sendFlat.end(), toDir[r].begin(), toDir[r].end());
+    }
+    std::vector<long long> recvFlat = alltoallv(sendFlat, count, countRecv, MPI_LONG_LONG);
+    std::unordered_map<long long, int> directory;  // flat index -> owner rank
+    for (int r = 0, i = 0; r < nProcs_; ++r)
+        for (int n = 0; n < countRecv[r]; ++n, ++i)
+            directory[recvFlat[i]] = r;
+
+    // ------------------------------------------------------------------ Coarse positions needed by the fine nodes
+    // The 3^nD neighbourhood of the containing coarse voxel covers the interpolation stencil
+    constexpr int nNeig = (nD == 2) ? 9 : 27;
+    std::unordered_map<long long, int> neededIndex;
+    std::vector<long long> needed;
+    for (const auto &nodeNo: fineBulk_) {
+        for (int m = 0; m < nNeig; ++m) {
+            int pos[nD];
+            for (int d = 0, mm = m; d < nD; ++d, mm /= 3)
+                pos[d] = parentPos(finePos(nodeNo, d)) + (mm % 3) - 1;
+            const long long k = flat(pos);
+            if (neededIndex.insert({k, static_cast<int>(needed.size())}).second)
+                needed.push_back(k);
+        }
+    }
+
+    // Ask the directory for the owners
+    for (auto &v: toDir)
+        v.clear();
+    for (const auto &k: needed)
+        toDir[owner(k)].push_back(k);
+    sendFlat.clear();
+    for (int r = 0; r < nProcs_; ++r) {
+        count[r] = toDir[r].size();
+        sendFlat.insert(sendFlat.end(), toDir[r].begin(), toDir[r].end());
+    }
+    recvFlat = alltoallv(sendFlat, count, countRecv, MPI_LONG_LONG);
+    std::vector<int> ownerReply(recvFlat.size());
+    for (size_t i = 0; i < recvFlat.size(); ++i) {
+        const auto it = directory.find(recvFlat[i]);
+        ownerReply[i] = (it != directory.end()) ? it->second : -1;
+    }
+    std::vector<int> countBack(nProcs_);
+    std::vector<int> ownerOfSent = alltoallv(ownerReply, countRecv, countBack, MPI_INT);
+
+    // ------------------------------------------------------------------ Slots, grouped by owner
+    std::vector<std::vector<long long>> request(nProcs_);
+    for (size_t i = 0; i < sendFlat.size(); ++i)
+        if (ownerOfSent[i] >= 0)
+            request[ownerOfSent[i]].push_back(sendFlat[i]);
+    std::unordered_map<long long, int> slot;
+    std::vector<long long> requestFlat;
+    recvCount_.assign(nProcs_, 0);
+    for (int r = 0; r < nProcs_; ++r) {
+        recvCount_[r] = request[r].size();
+        for (const auto &k: request[r]) {
+            slot[k] = static_cast<int>(requestFlat.size());
+            requestFlat.push_back(k);
+        }
+    }
+    nSlots_ = requestFlat.size();
+    sendCount_.assign(nProcs_, 0);
+    std::vector<long long> requested = alltoallv(requestFlat, recvCount_, sendCount_, MPI_LONG_LONG);
+    sendNodes_.resize(requested.size());
+    for (size_t i = 0; i < requested.size(); ++i)
+        sendNodes_[i] = localCoarse.at(requested[i]);
+
+    // ------------------------------------------------------------------ Interpolation stencils
+    stencilBegin_.push_back(0);
+    for (const auto &nodeNo: fineBulk_) {
+        int base[nD], parent[nD];
+        lbBase_t t[nD];
+        for (int d = 0; d < nD; ++d) {
+            const lbBase_t x = (finePos(nodeNo, d) + 0.5)/ratio_ - 0.5;
+            base[d] = static_cast<int>(std::floor(x));
+            t[d] = x - base[d];
+            parent[d] = parentPos(finePos(nodeNo, d));
+        }
+        const auto itParent = slot.find(flat(parent));
+        parentSlot_.push_back( (itParent != slot.end()) ? itParent->second : -1 );
+        int child = 0;
+        for (int d = nD - 1; d >= 0; --d)
+            child = child*ratio_ + finePos(nodeNo, d) - ratio_*parent[d];
+        childNo_.push_back(child);
+
+        const int begin = stencilBegin_.back();
+
+        // Quadratic interpolation if the 3^nD neighbourhood of the containing voxel is fluid
+        int neigSlot[nNeig];
+        bool allFluid = true;
+        for (int m = 0; m < nNeig; ++m) {
+            int pos[nD];
+            for (int d = 0, mm = m; d < nD; ++d, mm /= 3)
+                pos[d] = parent[d] + (mm % 3) - 1;
+            const auto it = slot.find(flat(pos));
+            neigSlot[m] = (it != slot.end()) ? it->second : -1;
+            allFluid = allFluid && (neigSlot[m] >= 0);
+        }
+        if (allFluid) {
+            lbBase_t w1D[nD][3];
+            for (int d = 0; d < nD; ++d) {
+                const lbBase_t s = t[d] + base[d] - parent[d];  // Offset from the centre of the containing voxel
+                w1D[d][0] = 0.5*s*(s - 1);
+                w1D[d][1] = 1 - s*s;
+                w1D[d][2] = 0.5*s*(s + 1);
+            }
+            for (int m = 0; m < nNeig; ++m) {
+                lbBase_t w = 1;
+                for (int d = 0, mm = m; d < nD; ++d, mm /= 3)
+                    w *= w1D[d][mm % 3];
+                if (w == 0)
+                    continue;
+                stencilSlot_.push_back(neigSlot[m]);
+                stencilWeight_.push_back(w);
+                stencilVelWeight_.push_back(w);
+            }
+            stencilBegin_.push_back(stencilSlot_.size());
+            continue;
+        }
+
+        constexpr int nCorner = 1 << nD;
+        int cornerSlot[nCorner];
+        lbBase_t cornerWeight[nCorner];
+        for (int m = 0; m < nCorner; ++m) {
+            int pos[nD];
+            cornerWeight[m] = 1;
+            for (int d = 0; d < nD; ++d) {
+                const int bit = (m >> d) & 1;
+                pos[d] = base[d] + bit;
+                cornerWeight[m] *= bit ? t[d] : 1 - t[d];
+            }
+            const auto it = slot.find(flat(pos));
+            cornerSlot[m] = (it != slot.end()) ? it->second : -1;
+        }
+        lbBase_t wSum = 0;
+        for (int m = 0; m < nCorner; ++m) {
+            if (cornerWeight[m] == 0)
+                continue;
+            if (cornerSlot[m] >= 0) {
+                stencilSlot_.push_back(cornerSlot[m]);
+                stencilWeight_.push_back(cornerWeight[m]);
+                stencilVelWeight_.push_back(cornerWeight[m]);
+                wSum += cornerWeight[m];
+                continue;
+            }
+            // Solid corner: mirror image of its fluid neighbours in the stencil across a
+            // half-way wall, so the velocity is zero at the wall
+            int nMirror = 0;
+            for (int d = 0; d < nD; ++d)
+                nMirror += (cornerSlot[m ^ (1 << d)] >= 0);
+            for (int d = 0; d < nD; ++d) {
+                const int mNeig = m ^ (1 << d);
+                if (cornerSlot[mNeig] >= 0) {
+                    stencilSlot_.push_back(cornerSlot[mNeig]);
+                    stencilWeight_.push_back(cornerWeight[m]/nMirror);
+                    stencilVelWeight_.push_back(-cornerWeight[m]/nMirror);
+                    wSum += cornerWeight[m]/nMirror;
+                }
+            }
+        }
+        if (wSum == 0) {  // Geometry differs between the resolutions: use the fluid neighbourhood
+            for (int m = 0; m < nNeig; ++m) {
+                if (neigSlot[m] >= 0) {
+                    stencilSlot_.push_back(neigSlot[m]);
+                    stencilWeight_.push_back(1.0);
+                    stencilVelWeight_.push_back(1.0);
+                    wSum += 1.0;
+                }
+            }
+        }
+        for (size_t i = begin; i < stencilSlot_.size(); ++i) {
+            stencilWeight_[i] /= wSum;
+            stencilVelWeight_[i] /= wSum;
+        }
+        stencilBegin_.push_back(stencilSlot_.size());
+    }
+}
+
+
+template <typename DXQY>
+inline long long GridTransfer<DXQY>::flat(const int *pos) const
+{
+    long long ret = 0;
+    for (int d = 0; d < DXQY::nD; ++d)
+        ret += (pos[d] + 1)*dimMul_[d];
+    return ret;
+}
+
+
+template <typename DXQY>
+template <typename T>
+std::vector<T> GridTransfer<DXQY>::alltoallv(const std::vector<T> &sendBuf, const std::vector<int> &sendCount, std::vector<int> &recvCount, MPI_Datatype type)
+/* alltoallv : sends sendCount[r] consecutive entries of sendBuf to rank r, and returns the
+ *  received entries grouped by sending rank. recvCount is set to the number received from each rank.
+ */
+{
+    const int nProcs = sendCount.size();
+    recvCount.resize(nProcs);
+    MPI_Alltoall(sendCount.data(), 1, MPI_INT, recvCount.data(), 1, MPI_INT, MPI_COMM_WORLD);
+    std::vector<int> sendDispl(nProcs, 0), recvDispl(nProcs, 0);
+    for (int r = 1; r < nProcs; ++r) {
+        sendDispl[r] = sendDispl[r-1] + sendCount[r-1];
+        recvDispl[r] = recvDispl[r-1] + recvCount[r-1];
+    }
+    std::vector<T> recvBuf(recvDispl[nProcs-1] + recvCount[nProcs-1]);
+    MPI_Alltoallv(sendBuf.data(), sendCount.data(), sendDispl.data(), type, recvBuf.data(), recvCount.data(), recvDispl.data(), type, MPI_COMM_WORLD);
+    return recvBuf;
+}
+
+
+template <typename DXQY>
+inline void GridTransfer<DXQY>::nonEquilibrium(const lbBase_t rho, const lbBase_t *vel, lbBase_t *f)
+/* nonEquilibrium : f -> f - feq(rho, vel)
+ */
+{
+    const lbBase_t uu = DXQY::dot(vel, vel);
+    for (int q = 0; q < DXQY::nQ; ++q) {
+        const lbBase_t cu = DXQY::cDot(q, vel);
+        f[q] -= DXQY::w[q]*rho*(1.0 + DXQY::c2Inv*cu + DXQY::c4Inv0_5*(cu*cu - DXQY::c2*uu));
+    }
+}
+
+
+template <typename DXQY>
+template <typename T>
+void GridTransfer<DXQY>::setNodeValues(const lbBase_t rho, const lbBase_t *vel, const lbBase_t *fNeq, const lbBase_t neqScale, const int fieldNo,
+                                       const int nodeNo, ScalarField *rhoField, VectorField<DXQY> *velField, LbField<DXQY, T> &f)
+/* setNodeValues : sets f = feq(rho, vel) + neqScale*fNeq at a node, and rho and vel
+ *  if the fields are given
+ */
+{
+    if (rhoField)
+        (*rhoField)(fieldNo, nodeNo) = rho;
+    if (velField)
+        for (int d = 0; d < DXQY::nD; ++d)
+            (*velField)(fieldNo, d, nodeNo) = vel[d];
+    const lbBase_t uu = DXQY::dot(vel, vel);
+    for (int q = 0; q < DXQY::nQ; ++q) {
+        const lbBase_t cu = DXQY::cDot(q, vel);
+        f(fieldNo, q, nodeNo) = DXQY::w[q]*rho*(1.0 + DXQY::c2Inv*cu + DXQY::c4Inv0_5*(cu*cu - DXQY::c2*uu)) + neqScale*fNeq[q];
+    }
+}
+
+
+template <typename DXQY>
+std::vector<lbBase_t> GridTransfer<DXQY>::exchangeToFine(const std::vector<lbBase_t> &sendBuf) const
+/* exchangeToFine : sends the packed values of the coarse nodes in sendNodes_ and
+ *  returns the values of the slots
+ */
+{
+    std::vector<int> sendCount(nProcs_), recvCount;
+    for (int r = 0; r < nProcs_; ++r)
+        sendCount[r] = nVal_*sendCount_[r];
+    return alltoallv(sendBuf, sendCount, recvCount, MPI_DOUBLE);
+}
+
+
+template <typename DXQY>
+template <typename S>
+void GridTransfer<DXQY>::toFine(const int fieldNo, const lbBase_t tauCoarse, const lbBase_t tauFine, const lbBase_t velScale,
+                                const ScalarField &rhoCoarse, const VectorField<DXQY> &velCoarse, const LbField<DXQY, S> &fCoarse,
+                                ScalarField &rhoFine, VectorField<DXQY> &velFine, LbField<DXQY, S> &fFine) const
+/* toFine : prolongation of field fieldNo from the coarse to the fine bulk nodes
+ *
+ * tauCoarse, tauFine : relaxation times of the two runs
+ * velScale           : fine lattice velocity / coarse lattice velocity
+ */
+{
+    constexpr int nD = DXQY::nD;
+    constexpr int nQ = DXQY::nQ;
+    std::vector<lbBase_t> sendBuf(nVal_*sendNodes_.size());
+    lbBase_t *val = sendBuf.data();
+    for (const auto &nodeNo: sendNodes_) {
+        val[0] = rhoCoarse(fieldNo, nodeNo);
+        for (int d = 0; d < nD; ++d)
+            val[1 + d] = velCoarse(fieldNo, d, nodeNo);
+        for (int q = 0; q < nQ; ++q)
+            val[1 + nD + q] = fCoarse(fieldNo, q, nodeNo);
+        nonEquilibrium(val[0], val + 1, val + 1 + nD);
+        val += nVal_;
+    }
+    interpolateToFine(fieldNo, exchangeToFine(sendBuf), tauCoarse, tauFine, velScale, rhoFine, velFine, fFine);
+}
+
+
+template <typename DXQY>
+template <typename S>
+std::vector<lbBase_t> GridTransfer<DXQY>::gatherCoarse(const int fieldNo, const LbField<DXQY, S> &fCoarse) const
+/* gatherCoarse : density, velocity and non-equilibrium distribution from the moments of
+ *  fCoarse (field fieldNo), at the coarse nodes used by this rank's fine nodes
+ */
+{
+    constexpr int nD = DXQY::nD;
+    constexpr int nQ = DXQY::nQ;
+    std::vector<lbBase_t> sendBuf(nVal_*sendNodes_.size());
+    lbBase_t *val = sendBuf.data();
+    for (const auto &nodeNo: sendNodes_) {
+        lbBase_t rho = 0, j[nD] = {};
+        for (int q = 0; q < nQ; ++q) {
+            const lbBase_t fq = fCoarse(fieldNo, q, nodeNo);
+            val[1 + nD + q] = fq;
+            rho += fq;
+            for (int d = 0; d < nD; ++d)
+                j[d] += fq*DXQY::c(q, d);
+        }
+        val[0] = rho;
+        for (int d = 0; d < nD; ++d)
+            val[1 + d] = j[d]/rho;
+        nonEquilibrium(val[0], val + 1, val + 1 + nD);
+        val += nVal_;
+    }
+    return exchangeToFine(sendBuf);
+}
+
+
+template <typename DXQY>
+template <typename S>
+void GridTransfer<DXQY>::interpolateValues(const int fieldNo, const std::vector<lbBase_t> &coarseVal, const lbBase_t tauCoarse, const lbBase_t tauFine,
+                                           const lbBase_t velScale, ScalarField *rhoFine, VectorField<DXQY> *velFine, LbField<DXQY, S> &fFine) const
+/* interpolateValues : sets the fine bulk nodes from coarse values returned by gatherCoarse
+ *  (or a linear combination of them). rhoFine and velFine are only set if given.
+ */
+{
+    constexpr int nD = DXQY::nD;
+    constexpr int nQ = DXQY::nQ;
+    const lbBase_t neqScale = velScale/ratio_*tauFine/tauCoarse;
+    for (size_t n = 0; n < fineBulk_.size(); ++n) {
+        if (stencilBegin_[n] == stencilBegin_[n+1])
+            continue;
+        lbBase_t node[nVal_] = {};
+        for (int i = stencilBegin_[n]; i < stencilBegin_[n+1]; ++i) {
+            const lbBase_t *s = &coarseVal[nVal_*stencilSlot_[i]];
+            node[0] += stencilWeight_[i]*s[0];
+            for (int d = 0; d < nD; ++d)
+                node[1 + d] += stencilVelWeight_[i]*s[1 + d];
+            for (int q = 0; q < nQ; ++q)
+                node[1 + nD + q] += stencilWeight_[i]*s[1 + nD + q];
+        }
+        for (int d = 0; d < nD; ++d)
+            node[1 + d] *= velScale;
+        setNodeValues(node[0], node + 1, node + 1 + nD, neqScale, fieldNo, fineBulk_[n], rhoFine, velFine, fFine);
+    }
+}
+
+
+template <typename DXQY>
+template <typename S>
+void GridTransfer<DXQY>::toCoarse(const int fieldNo, const lbBase_t tauFine, const lbBase_t tauCoarse, const lbBase_t velScale,
+                                  const ScalarField &rhoFine, const VectorField<DXQY> &velFine, const LbField<DXQY, S> &fFine,
+                                  ScalarField &rhoCoarse, VectorField<DXQY> &velCoarse, LbField<DXQY, S> &fCoarse) const
+/* toCoarse : restriction of field fieldNo from the fine to the coarse bulk nodes. Coarse
+ *  nodes with no fine fluid nodes keep their values.
+ *
+ * velScale : fine lattice velocity / coarse lattice velocity
+ */
+{
+    auto fineValues = [&](const int nodeNo, lbBase_t *node) {
+        node[0] = rhoFine(fieldNo, nodeNo);
+        for (int d = 0; d < DXQY::nD; ++d)
+            node[1 + d] = velFine(fieldNo, d, nodeNo);
+        for (int q = 0; q < DXQY::nQ; ++q)
+            node[1 + DXQY::nD + q] = fFine(fieldNo, q, nodeNo);
+    };
+    restrictValues(fieldNo, tauFine, tauCoarse, velScale, fineValues, &rhoCoarse, &velCoarse, fCoarse);
+}
+
+
+template <typename DXQY>
+template <typename S>
+void GridTransfer<DXQY>::toCoarse(const int fieldNo, const lbBase_t tauFine, const lbBase_t tauCoarse, const lbBase_t velScale,
+                                  const LbField<DXQY, S> &fFine, LbField<DXQY, S> &fCoarse) const
+/* toCoarse : as above, with the density and velocity given by the moments of fFine
+ */
+{
+    auto fineValues = [&](const int nodeNo, lbBase_t *node) {
+        node[0] = 0;
+        for (int d = 0; d < DXQY::nD; ++d)
+            node[1 + d] = 0;
+        for (int q = 0; q < DXQY::nQ; ++q) {
+            const lbBase_t fq = fFine(fieldNo, q, nodeNo);
+            node[1 + DXQY::nD + q] = fq;
+            node[0] += fq;
+            for (int d = 0; d < DXQY::nD; ++d)
+                node[1 + d] += fq*DXQY::c(q, d);
+        }
+        for (int d = 0; d < DXQY::nD; ++d)
+            node[1 + d] /= node[0];
+    };
+    restrictValues(fieldNo, tauFine, tauCoarse, velScale, fineValues, static_cast<ScalarField *>(nullptr), static_cast<VectorField<DXQY> *>(nullptr), fCoarse);
+}
+
+
+template <typename DXQY>
+template <typename S, typename T>
+void GridTransfer<DXQY>::restrictValues(const int fieldNo, const lbBase_t tauFine, const lbBase_t tauCoarse, const lbBase_t velScale, const T &fineValues,
+                                        ScalarField *rhoCoarse, VectorField<DXQY> *velCoarse, LbField<DXQY, S> &fCoarse) const
+/* restrictValues : averages fineValues(nodeNo, node), which sets rho, vel and f of a fine
+ *  node, over each coarse voxel
+ */
+{
+    constexpr int nD = DXQY::nD;
+    constexpr int nSum = nVal_ + 1;  // Values and a flag for the fine nodes that are present
+    const int nChild = static_cast<int>(std::pow(ratio_, nD));
+    // The values of each fine node are sent in the position of the node in its coarse voxel,
+    // and summed in that order, so the sum does not depend on how the voxel is partitioned
+    std::vector<lbBase_t> slotChild(nSum*nChild*nSlots_, 0.0);
+    for (size_t n = 0; n < fineBulk_.size(); ++n) {
+        if (parentSlot_[n] < 0)
+            continue;
+        lbBase_t *s = &slotChild[nSum*(nChild*parentSlot_[n] + childNo_[n])];
+        fineValues(fineBulk_[n], s);
+        nonEquilibrium(s[0], s + 1, s + 1 + nD);
+        s[nVal_] = 1;
+    }
+    std::vector<int> sendCount(nProcs_), recvCount;
+    for (int r = 0; r < nProcs_; ++r)
+        sendCount[r] = nSum*nChild*recvCount_[r];
+    const std::vector<lbBase_t> recvChild = alltoallv(slotChild, sendCount, recvCount, MPI_DOUBLE);
+
+    // A coarse node may get fine nodes from several ranks
+    std::unordered_map<int, std::vector<lbBase_t>> coarseChild;
+    for (size_t i = 0; i < sendNodes_.size(); ++i) {
+        const lbBase_t *s = &recvChild[nSum*nChild*i];
+        auto &child = coarseChild[sendNodes_[i]];
+        child.resize(nSum*nChild, 0.0);
+        for (int m = 0; m < nChild; ++m)
+            if (s[nSum*m + nVal_] > 0)
+                std::copy(s + nSum*m, s + nSum*(m + 1), child.begin() + nSum*m);
+    }
+
+    const lbBase_t neqScale = ratio_/velScale*tauCoarse/tauFine;
+    for (const auto &c: coarseChild) {
+        lbBase_t sum[nSum] = {};
+        for (int m = 0; m < nChild; ++m)
+            for (int v = 0; v < nSum; ++v)
+                sum[v] += c.second[nSum*m + v];
+        if (sum[nVal_] == 0)
+            continue;
+        const lbBase_t countInv = 1.0/sum[nVal_];
+        for (int v = 0; v < nVal_; ++v)
+            sum[v] *= countInv;
+        for (int d = 0; d < nD; ++d)
+            sum[1 + d] /= velScale;
+        setNodeValues(sum[0], &sum[1], &sum[1 + nD], neqScale, fieldNo, c.first, rhoCoarse, velCoarse, fCoarse);
+    }
+}
+
+#endif // LBGRIDTRANSFER_H
@@ -5,6 +5,7 @@
 //#include "LBboundary.h"
 #include "LBgrid.h"
 #include "LBfield.h"
+#include "LBkernelcost.h"
 #include "LBhalfwayhelperclass.h"
 
 /*********************************************************
@@ -27,15 +28,18 @@ class HalfWayBounceBack : public BoundaryHalwWayHelper<DXQY>
 public:
     HalfWayBounceBack(const std::vector<int> bndNodes, const Nodes<DXQY> &nodes, const Grid<DXQY> &grid) : BoundaryHalwWayHelper<DXQY>(bndNodes, nodes, grid) {}
 //    HalfWayBounceBack(Boundary<DXQY> base) : Boundary<DXQY>(base.size()) {}
-    void apply(const int fieldNo, LbField<DXQY> &f, const Grid<DXQY> &grid) const;
-    void apply(LbField<DXQY> &f, const Grid<DXQY> &grid) const;
+    template <typename S>
+    void apply(const int fieldNo, LbField<DXQY, S> &f, const Grid<DXQY> &grid) const;
+    template <typename S>
+    void apply(LbField<DXQY, S> &f, const Grid<DXQY> &grid) const;
     
 };
 
 
 
 template <typename DXQY>
-inline void HalfWayBounceBack<DXQY>::apply(const int fieldNo, LbField<DXQY> &f, const Grid<DXQY> &grid) const
+template <typename S>
+inline void HalfWayBounceBack<DXQY>::apply(const int fieldNo, LbField<DXQY, S> &f, const Grid<DXQY> &grid) const
 /* apply : performs the half way bounce back, the bondary nodes.
  *
  * fieldNo : the lB-field number
@@ -43,28 +47,21 @@ inline void HalfWayBounceBack<DXQY>::apply(const int fieldNo, LbField<DXQY> &f,
  * grid    : grid object
  *
  * Use 'this->' to access functions and variables in the parent class, Boundary<DXQY>.
- *
+ * The links are precomputed in the parent class, so no direction lists are
+ * built here.
  */
 {
-    for (int n = 0; n < this->nBoundaryNodes_; ++n) {
-        int node = this->nodeNo(n);
-	
-        for (auto beta: this->beta(n)) {
-            int beta_rev = this->dirRev(beta);
-            f(fieldNo, beta, node) = f(fieldNo, beta_rev, grid.neighbor(beta_rev, node));
-        }
-
-        for (auto delta: this->delta(n)) {
-            int delta_rev = this->dirRev(delta);
-            f(fieldNo, delta, node) = f(fieldNo, delta_rev, grid.neighbor(delta_rev, node));
-            f(fieldNo, delta_rev, node) = f(fieldNo, delta, grid.neighbor(delta, node));
-        }
-    }
+    static const int region = profiler().region("HalfWayBounceBack::apply");
+    ScopedTimer timer(region, this->unknownLinks_.size()*KernelCost<DXQY, S>::bounceBackLink());
+    this->unknownLinks_.copy(fieldNo, f);
 }
 
 template <typename DXQY>
-inline void HalfWayBounceBack<DXQY>::apply(LbField<DXQY> &f, const Grid<DXQY> &grid) const
+template <typename S>
+inline void HalfWayBounceBack<DXQY>::apply(LbField<DXQY, S> &f, const Grid<DXQY> &grid) const
 {
+    static const int region = profiler().region("HalfWayBounceBack::apply");
+    ScopedTimer timer(region);
     for (int n=0; n < f.num_fields(); ++n) {
         apply(n, f, grid);
     }
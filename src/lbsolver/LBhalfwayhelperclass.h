@@ -8,6 +8,7 @@
 #include "LBlatticetypes.h"
 #include "LBnodes.h"
 #include "LBgrid.h"
+#include "LBboundarylinks.h"
 
 /************************************************************
  * class BOUNDARY: super class used in boundary condtions.
@@ -94,6 +95,7 @@ public:
     inline int nBeta(const int bndNo) const {return nBeta_[bndNo];}
     inline int nGamma(const int bndNo) const {return nGamma_[bndNo];}
     inline int nDelta(const int bndNo) const {return nDelta_[bndNo];}
+    inline const BoundaryLinks & unknownLinks() const {return unknownLinks_;}
 
 protected:
     int nBoundaryNodes_;  // Number of boundary nodes
@@ -104,6 +106,7 @@ protected:
     std::vector<int> nBeta_; // List of the number of beta links for each boundary node
     std::vector<int> nGamma_;  // List of the number of gamma links for each boundary node
     std::vector<int> nDelta_;  // List of the number of delta links for each boundary node
+    BoundaryLinks unknownLinks_; // Halfway bounce back links for all unknown (beta and delta) directions
     
 };
 
@@ -156,6 +159,17 @@ BoundaryHalwWayHelper<DXQY>::BoundaryHalwWayHelper(const std::vector<int> &bndNo
             }
         } // END FOR DIR PAIRS
         addNode(nodeNo, nBeta, beta, nGamma, gamma, nDelta, delta);
+
+        // Unknown directions are set from the reverse direction streamed into the neighbor
+        for (int n = 0; n < nBeta; ++n) {
+            const int qRev = dirRev(beta[n]);
+            unknownLinks_.add(nodeNo, beta[n], qRev, grid.neighbor(qRev, nodeNo));
+        }
+        for (int n = 0; n < nDelta; ++n) {
+            const int qRev = dirRev(delta[n]);
+            unknownLinks_.add(nodeNo, delta[n], qRev, grid.neighbor(qRev, nodeNo));
+            unknownLinks_.add(nodeNo, qRev, delta[n], grid.neighbor(delta[n], nodeNo));
+        }
     } // For all boundary nodes
 
 }
@@ -0,0 +1,598 @@
+#ifndef LBIMMERSEDBOUNDARY_H
+#define LBIMMERSEDBOUNDARY_H
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <valarray>
+#include <mpi.h>
+#include "LBglobal.h"
+#include "LBlatticetypes.h"
+#include "LBnodes.h"
+#include "LBgrid.h"
+#include "LBfield.h"
+#include "LBprofiler.h"
+#include "LBvtk.h"
+#include "LBbndmpi.h"
+
+
+//=====================================================================================
+//
+//                     R E G U L A R I Z E D   D E L T A S
+//
+//=====================================================================================
+inline lbBase_t deltaTwoPoint(const lbBase_t r)
+/* deltaTwoPoint : linear hat function, support |r| < 1
+ */
+{
+    const lbBase_t a = std::abs(r);
+    return a < 1.0 ? 1.0 - a : 0.0;
+}
+
+
+inline lbBase_t deltaThreePoint(const lbBase_t r)
+/* deltaThreePoint : Roma et al. (1999), support |r| < 1.5
+ */
+{
+    const lbBase_t a = std::abs(r);
+    if (a <= 0.5)
+        return (1.0 + std::sqrt(1.0 - 3.0*a*a))/3.0;
+    if (a < 1.5)
+        return (5.0 - 3.0*a - std::sqrt(1.0 - 3.0*(1.0 - a)*(1.0 - a)))/6.0;
+    return 0.0;
+}
+
+
+inline lbBase_t deltaFourPoint(const lbBase_t r)
+/* deltaFourPoint : Peskin (2002), support |r| < 2
+ */
+{
+    const lbBase_t a = std::abs(r);
+    if (a <= 1.0)
+        return (3.0 - 2.0*a + std::sqrt(1.0 + 4.0*a - 4.0*a*a))/8.0;
+    if (a < 2.0)
+        return (5.0 - 2.0*a - std::sqrt(std::max(-7.0 + 12.0*a - 4.0*a*a, 0.0)))/8.0;
+    return 0.0;
+}
+
+
+/*********************************************************
+ * struct IMMERSEDMARKER: Lagrangian marker
+ *********************************************************/
+struct ImmersedMarker
+{
+    int id;  // Global marker id
+    lbBase_t x[3];  // Position
+    lbBase_t u[3];  // Prescribed velocity
+    lbBase_t weight;  // Area (or volume) element of the marker
+    lbBase_t force[3];  // Force on the fluid from the last apply (owned markers)
+    lbBase_t uFluid[3];  // Fluid velocity from the last interpolate (owned markers)
+};
+
+
+/*********************************************************
+ * class IMMERSEDBOUNDARY: immersed boundary method with
+ *  Lagrangian markers and multi-direct forcing
+ *  (Wang, Fan and Luo, 2008).
+ *
+ * Each marker interpolates the fluid velocity, and spreads
+ *  a force, over a 2, 3 or 4 point regularized delta stencil.
+ *  The stencil nodes are found from their positions with the
+ *  grid's NodeNumber lookup, so the work scales with the
+ *  number of markers and not with the number of fluid nodes.
+ *
+ * The velocity field must be the Guo forced velocity,
+ *  u = (sum_q f_q c_q + F/2)/rho, so that a node force F
+ *  changes the velocity by F/(2 rho). Each forcing iteration
+ *     U_m  = sum_n u(n) delta(x_n - X_m)
+ *     du(n) = sum_m (U_target_m - U_m) delta(x_n - X_m) dV_m
+ *     u(n) += du(n),  F(n) += 2 rho(n) du(n)
+ *
+ * Each marker is owned by the rank that owns the node nearest
+ *  to it. Copies are sent to the neighbor ranks that own nodes
+ *  in the marker's stencil. The copies interpolate over their
+ *  local nodes, the partial sums are added by the owner and
+ *  the velocity correction is sent back, so each forcing
+ *  iteration has two neighbor exchanges. Markers that move
+ *  into a neighbor domain are migrated in update(...).
+ *
+ * Use per time step, after the macroscopic values:
+ *     ibm.update(nodes, grid);
+ *     ibm.apply(rho, vel, force, nIter);
+ *     ... collision with force ...
+ *********************************************************/
+template <typename DXQY>
+class ImmersedBoundary
+{
+public:
+    ImmersedBoundary(const BndMpi<DXQY> &mpiBoundary, const Nodes<DXQY> &nodes, const Grid<DXQY> &grid, const LBvtk<DXQY> &vtk,
+                     const int stencilWidth=4, const std::string &periodic="");
+
+    void addMarker(const int id, const std::valarray<lbBase_t> &position, const lbBase_t weight, const Nodes<DXQY> &nodes, const Grid<DXQY> &grid);
+    void update(const Nodes<DXQY> &nodes, const Grid<DXQY> &grid);
+    void apply(const ScalarField &rho, VectorField<DXQY> &vel, VectorField<DXQY> &force, const int nIter=3);
+    void interpolate(const VectorField<DXQY> &vel);
+
+    inline int numOwned() const {return nOwned_;}
+    inline int numLocal() const {return static_cast<int>(markers_.size());}
+    inline ImmersedMarker & marker(const int n) {return markers_[n];}  // n < numOwned()
+    inline const ImmersedMarker & marker(const int n) const {return markers_[n];}
+    inline int stencilSize(const int n) const {return stencilStart_[n+1] - stencilStart_[n];}
+    std::valarray<lbBase_t> totalForce() const;
+    int numGlobal() const;
+
+private:
+    lbBase_t delta(const lbBase_t r) const;
+    void wrap(lbBase_t *x) const;
+    int findNode(int *pos, const Grid<DXQY> &grid) const;
+    int stencilBegin(const lbBase_t x) const;
+    bool overlap(const lbBase_t *x, const int *lo, const int *hi) const;
+    std::vector<lbBase_t> exchange(const int neigRank, const std::vector<lbBase_t> &sendBuffer, int nRecv=-1) const;
+    void reduce(const int nVal);
+    void scatter(const int nVal);
+
+    static constexpr int packSize_ = 8;  // id, x (3), u (3), weight
+    int myRank_;
+    int stencilWidth_;
+    int dim_[3];  // System size, without the rim of the vtklb file
+    bool periodic_[3];
+
+    // Mpi topology
+    std::vector<int> neigRanks_;
+    std::vector<std::array<int, 6>> neigBox_;  // Bounding box of the nodes owned by each neighbor rank
+
+    // Markers: owned markers first, then copies grouped by neighbor rank
+    std::vector<ImmersedMarker> markers_;
+    int nOwned_;
+    std::vector<std::vector<int>> sendList_;  // Owned markers copied to each neighbor rank
+    std::vector<int> recvBegin_;  // First copy from each neighbor rank, size neigRanks_.size() + 1
+
+    // Stencils (CSR), only fluid nodes on this rank
+    std::vector<int> stencilStart_;
+    std::vector<int> stencilNode_;
+    std::vector<lbBase_t> stencilDelta_;
+
+    std::vector<lbBase_t> buffer_;  // Per marker values for the reductions
+};
+
+
+template <typename DXQY>
+ImmersedBoundary<DXQY>::ImmersedBoundary(const BndMpi<DXQY> &mpiBoundary, const Nodes<DXQY> &nodes, const Grid<DXQY> &grid, const LBvtk<DXQY> &vtk,
+                                         const int stencilWidth, const std::string &periodic)
+    : stencilWidth_(stencilWidth), neigRanks_(mpiBoundary.neighborRanks()), nOwned_(0), stencilStart_(1, 0)
+/* mpiBoundary  : the mpi boundary object, used for the neighbor ranks
+ * vtk          : used for the system size
+ * stencilWidth : 2, 3 or 4 point delta function
+ * periodic     : periodic directions, for instance "xz" (as in vtklb.py)
+ */
+{
+    if ((stencilWidth_ < 2) || (stencilWidth_ > 4)) {
+        std::cout << "Error in ImmersedBoundary: stencil width must be 2, 3 or 4, and is " << stencilWidth_ << std::endl;
+        exit(1);
+    }
+    MPI_Comm_rank(MPI_COMM_WORLD, &myRank_);
+    const std::string axes = "xyz";
+    for (int d = 0; d < 3; ++d) {
+        dim_[d] = (d < DXQY::nD) ? vtk.getGlobaDimensions(d) - 2 : 1;  // Node positions are 0, ..., dim-1 (and -1, dim for the rim)
+        periodic_[d] = (d < DXQY::nD) && (periodic.find(axes[d]) != std::string::npos);
+    }
+
+    // Bounding boxes of the owned nodes of all ranks
+    std::array<int, 6> myBox = {0, 0, 0, 0, 0, 0};
+    for (int d = 0; d < DXQY::nD; ++d) {
+        myBox[d] = dim_[d];
+        myBox[3 + d] = -1;
+    }
+    for (int n = 1; n < grid.size(); ++n) {
+        bool inside = nodes.isMyRank(n);
+        for (int d = 0; d < DXQY::nD; ++d)
+            inside = inside && (grid.pos(n, d) >= 0) && (grid.pos(n, d) < dim_[d]);
+        if (inside) {
+            for (int d = 0; d < DXQY::nD; ++d) {
+                myBox[d] = std::min(myBox[d], grid.pos(n, d));
+                myBox[3 + d] = std::max(myBox[3 + d], grid.pos(n, d));
+            }
+        }
+    }
+    int nProcs;
+    MPI_Comm_size(MPI_COMM_WORLD, &nProcs);
+    std::vector<int> allBoxes(6*nProcs);
+    MPI_Allgather(myBox.data(), 6, MPI_INT, allBoxes.data(), 6, MPI_INT, MPI_COMM_WORLD);
+    for (const auto &rank: neigRanks_) {
+        std::array<int, 6> box;
+        for (int i = 0; i < 6; ++i)
+            box[i] = allBoxes[6*rank + i];
+        neigBox_.push_back(box);
+    }
+    sendList_.resize(neigRanks_.size());
+    recvBegin_.assign(neigRanks_.size() + 1, 0);
+}
+
+
+template <typename DXQY>
+lbBase_t ImmersedBoundary<DXQY>::delta(const lbBase_t r) const
+{
+    if (stencilWidth_ == 2)
+        return deltaTwoPoint(r);
+    if (stencilWidth_ == 3)
+        return deltaThreePoint(r);
+    return deltaFourPoint(r);
+}
+
+
+template <typename DXQY>
+void ImmersedBoundary<DXQY>::wrap(lbBase_t *x) const
+/* wrap : moves x into the domain in the periodic directions
+ */
+{
+    for (int d = 0; d < DXQY::nD; ++d) {
+        if (periodic_[d])
+            x[d] -= dim_[d]*std::floor(x[d]/dim_[d]);
+    }
+}
+
+
+template <typename DXQY>
+int ImmersedBoundary<DXQY>::findNode(int *pos, const Grid<DXQY> &grid) const
+/* findNode : node number at pos (wrapped in the periodic directions), or 0
+ *  if the position is outside the domain or not in the local grid.
+ */
+{
+    for (int d = 0; d < DXQY::nD; ++d) {
+        if (periodic_[d])
+            pos[d] = ((pos[d] % dim_[d]) + dim_[d]) % dim_[d];
+        if ((pos[d] < 0) || (pos[d] >= dim_[d]))
+            return 0;
+    }
+    return grid.nodeNo(pos);
+}
+
+
+template <typename DXQY>
+int ImmersedBoundary<DXQY>::stencilBegin(const lbBase_t x) const
+/* stencilBegin : lowest node index in the stencil of a marker at x
+ */
+{
+    if (stencilWidth_ % 2 == 0)
+        return static_cast<int>(std::floor(x)) - stencilWidth_/2 + 1;
+    return static_cast<int>(std::floor(x + 0.5)) - stencilWidth_/2;
+}
+
+
+template <typename DXQY>
+bool ImmersedBoundary<DXQY>::overlap(const lbBase_t *x, const int *lo, const int *hi) const
+/* overlap : true if the stencil of a marker at x (wrapped) overlaps the box [lo, hi],
+ *  also through the periodic boundaries.
+ */
+{
+    for (int d = 0; d < DXQY::nD; ++d) {
+        const int sLo = stencilBegin(x[d]);
+        const int sHi = sLo + stencilWidth_ - 1;
+        bool hit = (sHi >= lo[d]) && (sLo <= hi[d]);
+        if (periodic_[d])
+            hit = hit || ((sHi - dim_[d] >= lo[d]) && (sLo - dim_[d] <= hi[d])) || ((sHi + dim_[d] >= lo[d]) && (sLo + dim_[d] <= hi[d]));
+        if (!hit)
+            return false;
+    }
+    return true;
+}
+
+
+template <typename DXQY>
+void ImmersedBoundary<DXQY>::addMarker(const int id, const std::valarray<lbBase_t> &position, const lbBase_t weight, const Nodes<DXQY> &nodes, const Grid<DXQY> &grid)
+/* addMarker : adds a marker if its nearest node is on this rank. Can be called with
+ *  the same arguments on all ranks. Call update(...) after the markers are added.
+ *
+ * id       : unique marker id
+ * position : marker position (nD or 3 components)
+ * weight   : area (or volume) element of the marker, in lattice units
+ */
+{
+    ImmersedMarker m;
+    m.id = id;
+    m.weight = weight;
+    for (int d = 0; d < 3; ++d) {
+        m.x[d] = (d < static_cast<int>(position.size())) ? position[d] : 0.0;
+        m.u[d] = 0.0;
+        m.force[d] = 0.0;
+        m.uFluid[d] = 0.0;
+    }
+    lbBase_t xw[3] = {m.x[0], m.x[1], m.x[2]};
+    wrap(xw);
+    int pos[3] = {0, 0, 0};
+    for (int d = 0; d < DXQY::nD; ++d)
+        pos[d] = static_cast<int>(std::floor(xw[d] + 0.5));
+    const int nodeNo = findNode(pos, grid);
+    if ((nodeNo > 0) && nodes.isMyRank(nodeNo)) {
+        markers_.resize(nOwned_);  // Copies are rebuilt in update
+        markers_.push_back(m);
+        nOwned_ += 1;
+    }
+}
+
+
+template <typename DXQY>
+int ImmersedBoundary<DXQY>::numGlobal() const
+{
+    int ret = 0;
+    MPI_Allreduce(&nOwned_, &ret, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+    return ret;
+}
+
+
+template <typename DXQY>
+std::valarray<lbBase_t> ImmersedBoundary<DXQY>::totalForce() const
+/* totalForce : sum of the force on the fluid from all markers on all ranks
+ *  (3 components). The force on the immersed body is minus this value.
+ */
+{
+    lbBase_t local[3] = {0, 0, 0};
+    for (int n = 0; n < nOwned_; ++n) {
+        for (int d = 0; d < 3; ++d)
+            local[d] += markers_[n].force[d];
+    }
+    std::valarray<lbBase_t> ret(0.0, 3);
+    MPI_Allreduce(local, &ret[0], 3, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+    return ret;
+}
+
+
+template <typename DXQY>
+std::vector<lbBase_t> ImmersedBoundary<DXQY>::exchange(const int neigRank, const std::vector<lbBase_t> &sendBuffer, int nRecv) const
+/* exchange : sends a buffer to neigRank and receives one from it. If nRecv < 0
+ *  the size of the received buffer is exchanged first.
+ */
+{
+    int nSend = static_cast<int>(sendBuffer.size());
+    if (nRecv < 0)
+        MPI_Sendrecv(&nSend, 1, MPI_INT, neigRank, 0, &nRecv, 1, MPI_INT, neigRank, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+    std::vector<lbBase_t> ret(nRecv);
+    MPI_Sendrecv(sendBuffer.data(), nSend, MPI_DOUBLE, neigRank, 1, ret.data(), nRecv, MPI_DOUBLE, neigRank, 1, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+    return ret;
+}
+
+
+template <typename DXQY>
+void ImmersedBoundary<DXQY>::update(const Nodes<DXQY> &nodes, const Grid<DXQY> &grid)
+/* update : migrates markers that have moved to a neighbor domain, sends copies
+ *  to the neighbor ranks, and sets up the delta stencils. Call after the
+ *  marker positions have changed.
+ */
+{
+    auto pack = [](const ImmersedMarker &m, std::vector<lbBase_t> &buffer) {
+        buffer.push_back(m.id);
+        buffer.insert(buffer.end(), m.x, m.x + 3);
+        buffer.insert(buffer.end(), m.u, m.u + 3);
+        buffer.push_back(m.weight);
+    };
+    auto unpack = [](const lbBase_t *buffer) {
+        ImmersedMarker m;
+        m.id = static_cast<int>(buffer[0]);
+        for (int d = 0; d < 3; ++d) {
+            m.x[d] = buffer[1 + d];
+            m.u[d] = buffer[4 + d];
+            m.force[d] = 0.0;
+            m.uFluid[d] = 0.0;
+        }
+        m.weight = buffer[7];
+        return m;
+    };
+
+    // Migration of owned markers
+    markers_.resize(nOwned_);
+    std::vector<int> newRank(nOwned_, myRank_);
+    for (int n = 0; n < nOwned_; ++n) {
+        lbBase_t xw[3] = {markers_[n].x[0], markers_[n].x[1], markers_[n].x[2]};
+        wrap(xw);
+        int pos[3] = {0, 0, 0};
+        for (int d = 0; d < DXQY::nD; ++d)
+            pos[d] = static_cast<int>(std::floor(xw[d] + 0.5));
+        const int nodeNo = findNode(pos, grid);
+        if (nodeNo > 0)
+            newRank[n] = nodes.getRank(nodeNo);
+    }
+    std::vector<ImmersedMarker> received;
+    for (const auto &rank: neigRanks_) {
+        std::vector<lbBase_t> sendBuffer;
+        for (int n = 0; n < nOwned_; ++n) {
+            if (newRank[n] == rank)
+                pack(markers_[n], sendBuffer);
+        }
+        const auto recvBuffer = exchange(rank, sendBuffer);
+        for (std::size_t i = 0; i < recvBuffer.size(); i += packSize_)
+            received.push_back(unpack(&recvBuffer[i]));
+    }
+    std::vector<ImmersedMarker> owned;
+    for (int n = 0; n < nOwned_; ++n) {
+        if ((newRank[n] == myRank_) || (std::find(neigRanks_.begin(), neigRanks_.end(), newRank[n]) == neigRanks_.end()))
+            owned.push_back(markers_[n]);
+    }
+    owned.insert(owned.end(), received.begin(), received.end());
+    markers_ = owned;
+    nOwned_ = static_cast<int>(markers_.size());
+
+    // Copies to the neighbor ranks
+    for (std::size_t r = 0; r < neigRanks_.size(); ++r) {
+        std::vector<lbBase_t> sendBuffer;
+        sendList_[r].clear();
+        for (int n = 0; n < nOwned_; ++n) {
+            lbBase_t xw[3] = {markers_[n].x[0], markers_[n].x[1], markers_[n].x[2]};
+            wrap(xw);
+            if (overlap(xw, &neigBox_[r][0], &neigBox_[r][3])) {
+                sendList_[r].push_back(n);
+                pack(markers_[n], sendBuffer);
+            }
+        }
+        const auto recvBuffer = exchange(neigRanks_[r], sendBuffer);
+        recvBegin_[r] = static_cast<int>(markers_.size());
+        for (std::size_t i = 0; i < recvBuffer.size(); i += packSize_)
+            markers_.push_back(unpack(&recvBuffer[i]));
+    }
+    recvBegin_[neigRanks_.size()] = static_cast<int>(markers_.size());
+
+    // Stencils over the fluid nodes on this rank
+    stencilStart_.assign(1, 0);
+    stencilNode_.clear();
+    stencilDelta_.clear();
+    const int nD = DXQY::nD;
+    int nStencil = 1;
+    for (int d = 0; d < nD; ++d)
+        nStencil *= stencilWidth_;
+    for (const auto &m: markers_) {
+        lbBase_t xw[3] = {m.x[0], m.x[1], m.x[2]};
+        wrap(xw);
+        int begin[3] = {0, 0, 0};
+        for (int d = 0; d < nD; ++d)
+            begin[d] = stencilBegin(xw[d]);
+        for (int s = 0; s < nStencil; ++s) {
+            int pos[3] = {0, 0, 0};
+            lbBase_t dl = 1.0;
+            for (int d = 0, i = s; d < nD; ++d, i /= stencilWidth_) {
+                pos[d] = begin[d] + i % stencilWidth_;
+                dl *= delta(pos[d] - xw[d]);
+            }
+            const int nodeNo = findNode(pos, grid);
+            if ((dl > 0) && (nodeNo > 0) && nodes.isMyRank(nodeNo) && nodes.isFluid(nodeNo)) {
+                stencilNode_.push_back(nodeNo);
+                stencilDelta_.push_back(dl);
+            }
+        }
+        stencilStart_.push_back(static_cast<int>(stencilNode_.size()));
+    }
+}
+
+
+template <typename DXQY>
+void ImmersedBoundary<DXQY>::reduce(const int nVal)
+/* reduce : adds the nVal values per marker in buffer_ from the copies to the owners
+ */
+{
+    for (std::size_t r = 0; r < neigRanks_.size(); ++r) {
+        const std::vector<lbBase_t> sendBuffer(buffer_.begin() + nVal*recvBegin_[r], buffer_.begin() + nVal*recvBegin_[r+1]);
+        const auto recvBuffer = exchange(neigRanks_[r], sendBuffer, nVal*static_cast<int>(sendList_[r].size()));
+        for (std::size_t i = 0; i < sendList_[r].size(); ++i) {
+            for (int k = 0; k < nVal; ++k)
+                buffer_[nVal*sendList_[r][i] + k] += recvBuffer[nVal*i + k];
+        }
+    }
+}
+
+
+template <typename DXQY>
+void ImmersedBoundary<DXQY>::scatter(const int nVal)
+/* scatter : copies the nVal values per marker in buffer_ from the owners to the copies
+ */
+{
+    for (std::size_t r = 0; r < neigRanks_.size(); ++r) {
+        std::vector<lbBase_t> sendBuffer;
+        for (const auto &n: sendList_[r])
+            sendBuffer.insert(sendBuffer.end(), buffer_.begin() + nVal*n, buffer_.begin() + nVal*(n+1));
+        const auto recvBuffer = exchange(neigRanks_[r], sendBuffer, nVal*(recvBegin_[r+1] - recvBegin_[r]));
+        std::copy(recvBuffer.begin(), recvBuffer.end(), buffer_.begin() + nVal*recvBegin_[r]);
+    }
+}
+
+
+template <typename DXQY>
+void ImmersedBoundary<DXQY>::apply(const ScalarField &rho, VectorField<DXQY> &vel, VectorField<DXQY> &force, const int nIter)
+/* apply : multi-direct forcing. Adds the immersed boundary force to the force
+ *  field and corrects the velocity field. Only field number 0 is used.
+ *
+ * rho   : density
+ * vel   : Guo forced velocity, corrected in place
+ * force : body force, the marker forces are added
+ * nIter : number of forcing iterations
+ */
+{
+    static const int region = profiler().region("ImmersedBoundary::apply");
+    ScopedTimer timer(region);
+    const int nD = DXQY::nD;
+    const int nVal = nD + 2;  // sum delta u, sum delta rho, sum delta
+    const int nLocal = static_cast<int>(markers_.size());
+    for (int n = 0; n < nOwned_; ++n) {
+        for (int d = 0; d < 3; ++d)
+            markers_[n].force[d] = 0.0;
+    }
+
+    for (int it = 0; it < nIter; ++it) {
+        // Interpolation
+        buffer_.assign(nVal*nLocal, 0.0);
+        for (int n = 0; n < nLocal; ++n) {
+            lbBase_t *buf = &buffer_[nVal*n];
+            for (int l = stencilStart_[n]; l < stencilStart_[n+1]; ++l) {
+                const int nodeNo = stencilNode_[l];
+                const lbBase_t dl = stencilDelta_[l];
+                for (int d = 0; d < nD; ++d)
+                    buf[d] += dl*vel(0, d, nodeNo);
+                buf[nD] += dl*rho(0, nodeNo);
+                buf[nD + 1] += dl;
+            }
+        }
+        reduce(nVal);
+
+        // Velocity correction at the owned markers
+        for (int n = 0; n < nOwned_; ++n) {
+            lbBase_t *buf = &buffer_[nVal*n];
+            auto &m = markers_[n];
+            if (buf[nD + 1] < lbBaseEps) {
+                for (int d = 0; d < nD; ++d)
+                    buf[d] = 0.0;
+                continue;
+            }
+            const lbBase_t rhoM = buf[nD]/buf[nD + 1];
+            for (int d = 0; d < nD; ++d) {
+                buf[d] = m.u[d] - buf[d]/buf[nD + 1];
+                m.force[d] += 2*rhoM*buf[d]*m.weight;
+            }
+        }
+        scatter(nVal);
+
+        // Spreading
+        for (int n = 0; n < nLocal; ++n) {
+            const lbBase_t *buf = &buffer_[nVal*n];
+            const lbBase_t weight = markers_[n].weight;
+            for (int l = stencilStart_[n]; l < stencilStart_[n+1]; ++l) {
+                const int nodeNo = stencilNode_[l];
+                const lbBase_t dl = stencilDelta_[l]*weight;
+                const lbBase_t rhoNode = rho(0, nodeNo);
+                for (int d = 0; d < nD; ++d) {
+                    const lbBase_t du = buf[d]*dl;
+                    vel(0, d, nodeNo) += du;
+                    force(0, d, nodeNo) += 2*rhoNode*du;
+                }
+            }
+        }
+    }
+}
+
+
+template <typename DXQY>
+void ImmersedBoundary<DXQY>::interpolate(const VectorField<DXQY> &vel)
+/* interpolate : sets uFluid of the owned markers to the interpolated velocity.
+ *  Can be used to move membrane markers with the fluid.
+ */
+{
+    const int nD = DXQY::nD;
+    const int nVal = nD + 1;
+    const int nLocal = static_cast<int>(markers_.size());
+    buffer_.assign(nVal*nLocal, 0.0);
+    for (int n = 0; n < nLocal; ++n) {
+        lbBase_t *buf = &buffer_[nVal*n];
+        for (int l = stencilStart_[n]; l < stencilStart_[n+1]; ++l) {
+            for (int d = 0; d < nD; ++d)
+                buf[d] += stencilDelta_[l]*vel(0, d, stencilNode_[l]);
+            buf[nD] += stencilDelta_[l];
+        }
+    }
+    reduce(nVal);
+    for (int n = 0; n < nOwned_; ++n) {
+        const lbBase_t *buf = &buffer_[nVal*n];
+        for (int d = 0; d < nD; ++d)
+            markers_[n].uFluid[d] = (buf[nD] > lbBaseEps) ? buf[d]/buf[nD] : 0.0;
+    }
+}
+
+#endif // LBIMMERSEDBOUNDARY_H
@@ -6,8 +6,8 @@
 #include "LBfield.h"
 //#include "Field.h"
 
-template <typename DXQY>
-void initiateLbField(const int fieldNo, const std::vector<int> &bulk, const ScalarField &rho, const VectorField<DXQY> &vel, LbField<DXQY> &f)
+template <typename DXQY, typename S>
+void initiateLbField(const int fieldNo, const std::vector<int> &bulk, const ScalarField &rho, const VectorField<DXQY> &vel, LbField<DXQY, S> &f)
 /* initiateLbField : sets the lb distributions of the given field, given by fieldNo,
  *  to the equilibirum distribution with denisty and velocity given by the macroscopic
  *  fields rho and vel.
@@ -30,9 +30,9 @@ void initiateLbField(const int fieldNo, const std::vector<int> &bulk, const Scal
 }
 
 
-template <typename DXQY>
+template <typename DXQY, typename S>
 void initiateLbField(const int lbFieldNo, const int rhoFieldNo, const int velFieldNo,
-                     const std::vector<int> &bulk, const ScalarField &rho, const VectorField<DXQY> &vel, LbField<DXQY> &f)
+                     const std::vector<int> &bulk, const ScalarField &rho, const VectorField<DXQY> &vel, LbField<DXQY, S> &f)
 /* initiateLbField : sets the lb distributions of the given field, given by fieldNo,
  *  to the equilibirum distribution with denisty and velocity given by the macroscopic
  *  fields rho and vel. Here we can also choose which density and velocity fields to
@@ -6,6 +6,7 @@
 #include "LBgrid.h"
 #include "LBnodes.h"
 #include "LBfield.h"
+#include "LBprofiler.h"
 
 
 // *****************************************************
@@ -36,6 +37,8 @@ private:
 template<typename T>
 void Inlet<D2Q9>::apply(const int &fieldNo, LbField<D2Q9> &f, const Grid<D2Q9> &grid, const lbBase_t & rho, const T &F)
 {
+    static const int region = profiler().region("Inlet::apply");
+    ScopedTimer timer(region);
     for (auto nodeNo: boundaryNodes_) {
         lbBase_t jx, jy;
         jx = rho -f(fieldNo, 2, nodeNo) - 2*f(fieldNo, 3, nodeNo) - 2*f(fieldNo, 4, nodeNo)
@@ -75,6 +78,8 @@ private:
 template <typename T>
 void Outlet<D2Q9>::apply(const int &fieldNo, LbField<D2Q9> &f, const Grid<D2Q9> &grid, const lbBase_t & rho, const T &F)
 {
+    static const int region = profiler().region("Outlet::apply");
+    ScopedTimer timer(region);
     for (auto nodeNo: boundaryNodes_) {
         lbBase_t jx, jy;
         auto fn = f(fieldNo, nodeNo);
@@ -0,0 +1,249 @@
+#ifndef LBINTERPOLATEDBB_H
+#define LBINTERPOLATEDBB_H
+
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "LBglobal.h"
+#include "LBlatticetypes.h"
+#include "LBnodes.h"
+#include "LBgrid.h"
+#include "LBfield.h"
+#include "LBkernelcost.h"
+#include "LBvtk.h"
+#include "LBboundary.h"
+
+/*********************************************************
+ * class INTERPOLATEDBOUNCEBACK: interpolated bounce back
+ *  for static curved walls.
+ *
+ * The wall position along each unknown link is given by
+ *  q = sd(x_f)/(sd(x_f) - sd(x_s)), where sd is the signed
+ *  distance (positive in the fluid) at the fluid boundary
+ *  node x_f and at its solid neighbor x_s.
+ *
+ * With a = reverse(beta) the direction pointing into the
+ *  wall, all schemes are linear combinations of values that
+ *  are known after propagation:
+ *     f(a, x_s)        = f*_a(x_f)
+ *     f(a, x_f)        = f*_a(x_f + c_beta)
+ *     f(beta, x_f + c_beta) = f*_beta(x_f)
+ *  (and one more node into the fluid for the quadratic scheme).
+ *
+ * Schemes:
+ *  "bouzidi"   : Bouzidi, Firdaouss and Lallemand (2001), linear
+ *  "quadratic" : Bouzidi et al. (2001), quadratic
+ *  "yu"        : Yu, Mei, Luo and Shyy (2003)
+ *
+ * The source (direction, node) pairs and the coefficients
+ *  are computed in the constructor and stored in flat arrays,
+ *  so apply(...) has no branches on q. Links where the
+ *  stencil leaves the fluid (narrow gaps) fall back to the
+ *  linear scheme, or to halfway bounce back. The quadratic
+ *  scheme also falls back to the linear scheme when x_f + c_beta
+ *  is a ghost node, since its values are not communicated.
+ *
+ * Run apply(...) straight after propagation and the mpi
+ *  communication.
+ *********************************************************/
+template <typename DXQY>
+class InterpolatedBounceBack
+{
+public:
+    InterpolatedBounceBack(const std::vector<int> &bndNodes, const Nodes<DXQY> &nodes, const Grid<DXQY> &grid, const ScalarField &sd,
+                           const std::string &scheme="bouzidi");
+    InterpolatedBounceBack(const std::vector<int> &bndNodes, const Nodes<DXQY> &nodes, const Grid<DXQY> &grid, LBvtk<DXQY> &vtk,
+                           const std::string &attributeName, const std::string &scheme="bouzidi");
+
+    template <typename S>
+    void apply(const int fieldNo, LbField<DXQY, S> &f) const;
+    template <typename S>
+    void apply(LbField<DXQY, S> &f) const;
+
+    inline int size() const {return static_cast<int>(linkNode_.size());}
+    inline lbBase_t q(const int linkNo) const {return linkQ_[linkNo];}
+    static ScalarField readSignedDistance(const std::string &attributeName, LBvtk<DXQY> &vtk, const Nodes<DXQY> &nodes, const Grid<DXQY> &grid);
+
+private:
+    void setup(const std::vector<int> &bndNodes, const Nodes<DXQY> &nodes, const Grid<DXQY> &grid, const ScalarField &sd, const std::string &scheme);
+    void addLink(const int nodeNo, const int qIn, const lbBase_t qWall, const int *srcQ, const int *srcNode, const lbBase_t *coef);
+
+    static constexpr int nTerms_ = 4;
+    enum { BOUZIDI, QUADRATIC, YU } scheme_;
+    std::vector<int> linkNode_;  // Node where the value is set
+    std::vector<int> linkDir_;  // Direction that is set
+    std::vector<lbBase_t> linkQ_;  // Wall distance along the link
+    std::vector<int> termDir_;  // nTerms_ source directions per link
+    std::vector<int> termNode_;  // nTerms_ source nodes per link
+    std::vector<lbBase_t> termCoef_;  // nTerms_ coefficients per link
+};
+
+
+template <typename DXQY>
+InterpolatedBounceBack<DXQY>::InterpolatedBounceBack(const std::vector<int> &bndNodes, const Nodes<DXQY> &nodes, const Grid<DXQY> &grid, const ScalarField &sd,
+                                                     const std::string &scheme)
+/* bndNodes : fluid boundary nodes
+ * sd       : signed distance to the wall, positive in the fluid (field 0)
+ * scheme   : "bouzidi", "quadratic" or "yu"
+ */
+{
+    setup(bndNodes, nodes, grid, sd, scheme);
+}
+
+
+template <typename DXQY>
+InterpolatedBounceBack<DXQY>::InterpolatedBounceBack(const std::vector<int> &bndNodes, const Nodes<DXQY> &nodes, const Grid<DXQY> &grid, LBvtk<DXQY> &vtk,
+                                                     const std::string &attributeName, const std::string &scheme)
+/* attributeName : vtklb attribute with the distance to the wall
+ */
+{
+    setup(bndNodes, nodes, grid, readSignedDistance(attributeName, vtk, nodes, grid), scheme);
+}
+
+
+template <typename DXQY>
+ScalarField InterpolatedBounceBack<DXQY>::readSignedDistance(const std::string &attributeName, LBvtk<DXQY> &vtk, const Nodes<DXQY> &nodes, const Grid<DXQY> &grid)
+/* readSignedDistance : reads the distance attribute and sets the sign,
+ *  positive (and zero) for fluid nodes and negative for solid nodes.
+ */
+{
+    ScalarField sd(1, grid.size());
+    vtk.toAttribute(attributeName);
+    for (int nodeNo = vtk.beginNodeNo(); nodeNo < vtk.endNodeNo(); ++nodeNo) {
+        const lbBase_t val = std::abs(vtk.template getScalarAttribute<lbBase_t>());
+        sd(0, nodeNo) = nodes.isSolid(nodeNo) ? -val : val;
+    }
+    return sd;
+}
+
+
+template <typename DXQY>
+void InterpolatedBounceBack<DXQY>::addLink(const int nodeNo, const int qIn, const lbBase_t qWall, const int *srcQ, const int *srcNode, const lbBase_t *coef)
+{
+    linkNode_.push_back(nodeNo);
+    linkDir_.push_back(qIn);
+    linkQ_.push_back(qWall);
+    for (int k = 0; k < nTerms_; ++k) {
+        termDir_.push_back(srcQ[k]);
+        termNode_.push_back(srcNode[k]);
+        termCoef_.push_back(coef[k]);
+    }
+}
+
+
+template <typename DXQY>
+void InterpolatedBounceBack<DXQY>::setup(const std::vector<int> &bndNodes, const Nodes<DXQY> &nodes, const Grid<DXQY> &grid, const ScalarField &sd, const std::string &scheme)
+{
+    if (scheme == "bouzidi") {
+        scheme_ = BOUZIDI;
+    } else if (scheme == "quadratic") {
+        scheme_ = QUADRATIC;
+    } else if (scheme == "yu") {
+        scheme_ = YU;
+    } else {
+        std::cout << "ERROR in InterpolatedBounceBack: unknown scheme " << scheme << ". Use bouzidi, quadratic or yu" << std::endl;
+        exit(1);
+    }
+
+    const Boundary<DXQY> bnd(bndNodes, nodes, grid);
+    for (int bndNo = 0; bndNo < bnd.size(); ++bndNo) {
+        const int xf = bnd.nodeNo(bndNo);
+
+        // Delta links: halfway bounce back in both directions
+        for (const auto &delta: bnd.delta(bndNo)) {
+            for (const auto &qIn: {delta, DXQY::reverseDirection(delta)}) {
+                const int a = DXQY::reverseDirection(qIn);
+                const int srcQ[nTerms_] = {a, a, a, a};
+                const int srcNode[nTerms_] = {grid.neighbor(a, xf), xf, xf, xf};
+                const lbBase_t coef[nTerms_] = {1.0, 0.0, 0.0, 0.0};
+                addLink(xf, qIn, 0.5, srcQ, srcNode, coef);
+            }
+        }
+
+        for (const auto &beta: bnd.beta(bndNo)) {
+            const int a = DXQY::reverseDirection(beta);
+            const int xs = grid.neighbor(a, xf);
+            const int xf2 = grid.neighbor(beta, xf);
+            const int xf3 = grid.neighbor(beta, xf2);
+            const lbBase_t q = std::min(std::max(sd(0, xf)/(sd(0, xf) - sd(0, xs)), lbBaseEps), 1.0);
+
+            // Sources: f*_a(x_f), f*_a(x_f + c), f*_beta(x_f), and f*_a(x_f + 2c) or f*_beta(x_f + c)
+            int srcQ[nTerms_] = {a, a, beta, a};
+            int srcNode[nTerms_] = {xs, xf, xf2, xf};
+            lbBase_t coef[nTerms_] = {1.0, 0.0, 0.0, 0.0};
+
+            const bool linearOk = nodes.isFluid(xf2);
+            const bool quadraticOk = linearOk && nodes.isMyRank(xf2) && nodes.isFluid(xf3);
+
+            if ((scheme_ == QUADRATIC) && quadraticOk) {
+                if (q < 0.5) {
+                    srcNode[3] = xf2;  // f(a, x_f + c) = f*_a(x_f + 2c)
+                    coef[0] = q*(1 + 2*q);
+                    coef[1] = (1 - 2*q)*(1 + 2*q);
+                    coef[3] = -q*(1 - 2*q);
+                } else {
+                    srcQ[3] = beta;
+                    srcNode[3] = xf3;  // f(beta, x_f + 2c) = f*_beta(x_f + c)
+                    coef[0] = 1.0/(q*(2*q + 1));
+                    coef[2] = (2*q - 1)/q;
+                    coef[3] = -(2*q - 1)/(2*q + 1);
+                }
+            } else if ((scheme_ == YU) && linearOk) {
+                coef[0] = q/(1 + q);
+                coef[1] = (1 - q)/(1 + q);
+                coef[2] = q/(1 + q);
+            } else if (linearOk) {
+                if (q < 0.5) {
+                    coef[0] = 2*q;
+                    coef[1] = 1 - 2*q;
+                } else {
+                    coef[0] = 0.5/q;
+                    coef[2] = 1 - 0.5/q;
+                }
+            }
+            addLink(xf, beta, q, srcQ, srcNode, coef);
+        }
+    }
+}
+
+
+template <typename DXQY>
+template <typename S>
+inline void InterpolatedBounceBack<DXQY>::apply(const int fieldNo, LbField<DXQY, S> &f) const
+/* apply : sets the unknown distributions from the precomputed stencils.
+ *  Only known (streamed) values are read, so the links are independent.
+ *
+ * fieldNo : the lB-field number
+ * f       : the field object
+ */
+{
+    static const int region = profiler().region("InterpolatedBounceBack::apply");
+    ScopedTimer timer(region, size()*KernelCost<DXQY, S>::interpolatedLink(nTerms_));
+    const int *node = linkNode_.data();
+    const int *dir = linkDir_.data();
+    const int *termDir = termDir_.data();
+    const int *termNode = termNode_.data();
+    const lbBase_t *termCoef = termCoef_.data();
+    const int nLinks = size();
+    for (int n = 0; n < nLinks; ++n) {
+        const int k = nTerms_*n;
+        f(fieldNo, dir[n], node[n]) = termCoef[k]*f(fieldNo, termDir[k], termNode[k])
+                                    + termCoef[k+1]*f(fieldNo, termDir[k+1], termNode[k+1])
+                                    + termCoef[k+2]*f(fieldNo, termDir[k+2], termNode[k+2])
+                                    + termCoef[k+3]*f(fieldNo, termDir[k+3], termNode[k+3]);
+    }
+}
+
+
+template <typename DXQY>
+template <typename S>
+inline void InterpolatedBounceBack<DXQY>::apply(LbField<DXQY, S> &f) const
+{
+    static const int region = profiler().region("InterpolatedBounceBack::apply");
+    ScopedTimer timer(region);
+    for (int n = 0; n < f.num_fields(); ++n)
+        apply(n, f);
+}
+
+#endif // LBINTERPOLATEDBB_H
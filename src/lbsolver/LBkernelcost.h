@@ -0,0 +1,97 @@
+#ifndef LBKERNELCOST_H
+#define LBKERNELCOST_H
+
+#include <type_traits>
+#include "LBglobal.h"
+#include "LBprofiler.h"
+
+/*********************************************************
+ * class KERNELCOST: estimated work of the library kernels,
+ *  per node and field (per link for the boundaries), for
+ *  the roofline columns of the profiler report.
+ *
+ * The bytes are the compulsory memory traffic: each
+ *  distribution, neighbor index and macroscopic value
+ *  that is read or written once, as in STREAM (no write
+ *  allocate). Neighbor values that are reused from the
+ *  cache, and constants like the body force, are not
+ *  counted. S is the LbField storage type, so reduced
+ *  precision fields move fewer bytes and add a shift per
+ *  value.
+ *
+ * The flops are counted from the expressions as written in
+ *  LBcollision.h, LBmacroscopic.h and the lattice classes,
+ *  without removing common subexpressions, so they are an
+ *  upper estimate of what the compiler executes.
+ *
+ * Combine the kernels of a fused loop and scale by the
+ *  number of nodes and fields:
+ *     using Cost = KernelCost<LT>;
+ *     const KernelWork work = (nFields*bulkNodes.size())*(Cost::stream() + Cost::macroscopic(true) + Cost::bgk(true));
+ *********************************************************/
+template <typename DXQY, typename S=lbBase_t>
+struct KernelCost
+{
+    static constexpr double nQ = DXQY::nQ;
+    static constexpr double nD = DXQY::nD;
+    static constexpr double sizeF = sizeof(S);
+    static constexpr double sizeB = sizeof(lbBase_t);
+    static constexpr double sizeI = sizeof(int);
+    static constexpr double shiftFlops = std::is_same<S, lbBase_t>::value ? 0 : 1;
+
+    static KernelWork stream()
+    /* stream : read of f and propagateTo of the post collision values, with the neighbor list
+     */
+    {
+        return {2*nQ*sizeF + nQ*sizeI, 2*nQ*shiftFlops};
+    }
+
+    static KernelWork macroscopic(const bool forced)
+    /* macroscopic : calcRho and calcVel, with rho and vel written to their fields
+     */
+    {
+        return {(1 + nD)*sizeB, (nQ - 1) + nD*(nQ - 1) + nD + (forced ? 2*nD : 0)};
+    }
+
+    static KernelWork bgk(const bool forced)
+    /* bgk : calcOmegaBGK with u^2 and cDotAll(u), and calcDeltaOmegaF with u.F and
+     *  cDotAll(F) if forced, added to f. Only the flops, see stream and macroscopic
+     *  for the bytes.
+     */
+    {
+        const double dot = 2*nD - 1;
+        return {0, dot + nQ*(dot + 11 + 1) + (forced ? dot + nQ*(dot + 8 + 1) : 0)};
+    }
+
+    static KernelWork trt(const bool forced)
+    /* trt : calcOmegaBGKTRT and calcDeltaOmegaFTRT, as bgk
+     */
+    {
+        const double dot = 2*nD - 1;
+        return {0, dot + nQ*(dot + 20 + 1) + (forced ? dot + nQ*(dot + 11 + 1) : 0)};
+    }
+
+    static KernelWork gradient()
+    /* gradient : grad(...) of a scalar field from the neighbor values, with the
+     *  neighbor list and the written gradient
+     */
+    {
+        return {sizeB + nQ*sizeI + nD*sizeB, nD*(nQ - 1)};
+    }
+
+    static KernelWork bounceBackLink()
+    /* bounceBackLink : one link of BoundaryLinks::copy
+     */
+    {
+        return {2*sizeF + 4*sizeI, 0};
+    }
+
+    static KernelWork interpolatedLink(const int nTerms)
+    /* interpolatedLink : one link of InterpolatedBounceBack::apply with nTerms terms
+     */
+    {
+        return {(nTerms + 1)*sizeF + nTerms*sizeB + (2 + 2*nTerms)*sizeI, 2*nTerms - 1.0};
+    }
+};
+
+#endif // LBKERNELCOST_H
@@ -0,0 +1,378 @@
+#ifndef LBLES_H
+#define LBLES_H
+
+#include <array>
+#include <string>
+#include <vector>
+#include <queue>
+#include <limits>
+#include <iostream>
+#include "LBglobal.h"
+#include "LBfield.h"
+#include "LBgrid.h"
+#include "LBnodes.h"
+#include "LBwallfunction.h"
+
+/*
+ * Large eddy simulation (LES) closures for the single relaxation time collision.
+ *
+ * The LES object returns the effective relaxation time tau = tau0 + tau_t for a node. The
+ * model dependent coefficient (C*D)^2, where C is the model constant and D is the van Driest
+ * damping factor, is computed once per node (setWallDistance/setDamping), so that the main
+ * loop only needs one square root per node.
+ *
+ * Models:
+ *   "smagorinsky" : uses the shear rate from the non-equilibrium moments, given as the
+ *                   lower triangular strain rate from calcStrainRateTildeLowTri
+ *                   (LBmacroscopic.h). Tau is found implicitly, as the strain rate
+ *                   depends on tau.
+ *   "wale"        : wall-adapting local eddy-viscosity, uses the velocity gradient.
+ *   "vreman"      : Vreman's model with c = 2.5 C^2, uses the velocity gradient.
+ * The velocity gradient is calculated from the velocity field of the neighbors (previous time
+ * step), with the lattice gradient d_j u_i = sum_q w_q c_qj u_i(x + c_q)/c^2.
+ *
+ * Usage, in the main loop:
+ *   std::valarray<lbBase_t> ELowTri = calcStrainRateTildeLowTri<LT>(fNode, rhoNode, velNode, forceNode, 0);
+ *   lbBase_t tau = les.tau(nodeNo, rhoNode, ELowTri, vel, grid);
+ *   std::valarray<lbBase_t> omegaBGK = calcOmegaBGK<LT>(fNode, tau, rhoNode, uu, cu);
+ * and the eddy viscosity can be written with
+ *   output.add_scalar_variables({"nu_t"}, {les.eddyViscosityField()});
+ */
+
+template <typename DXQY>
+class LES
+/* Class for LES eddy viscosity models
+ *
+ * Methods
+ * -------
+ * setWallDistance(nodes, grid, maxDistance)
+ *     calculates the distance to the nearest solid boundary node, up to ``maxDistance``
+ *
+ * setDamping(uTau, APlus)
+ *     sets the van Driest damping from the wall distance and a reference friction velocity
+ *
+ * setDamping(wallLaw, vel, APlus)
+ *     sets the van Driest damping from the wall distance and the local friction velocity
+ *
+ * tau(nodeNo, rho, strainRateTildeLowTri, vel, grid)
+ *     returns the effective relaxation time at node ``nodeNo``
+ *
+ * eddyViscosity()
+ *     returns the eddy viscosity calculated in the last call to ``tau``
+ *
+ * eddyViscosityField()
+ *     returns the eddy viscosity field (if stored)
+ */
+{
+public:
+    LES(const std::string &model, const lbBase_t cModel, const lbBase_t tau0, const int nNodes, const bool storeEddyViscosity=false);
+    void setWallDistance(const Nodes<DXQY> &nodes, const Grid<DXQY> &grid, const lbBase_t maxDistance);
+    void setDamping(const lbBase_t uTau, const lbBase_t APlus=25.0);
+    void setDamping(const WallLaw &wallLaw, const VectorField<DXQY> &vel, const lbBase_t APlus=25.0);
+    template <typename T>
+    lbBase_t tau(const int nodeNo, const lbBase_t &rho, const T &strainRateTildeLowTri, const VectorField<DXQY> &vel, const Grid<DXQY> &grid);
+    inline lbBase_t eddyViscosity() const {
+        return eddyVisc_;
+    }
+    inline lbBase_t wallDistance(const int nodeNo) const {
+        return wallDistance_[nodeNo];
+    }
+    inline ScalarField& eddyViscosityField() {
+        return eddyViscField_;
+    }
+private:
+    std::array<lbBase_t, DXQY::nD*DXQY::nD> velocityGradient(const int nodeNo, const VectorField<DXQY> &vel, const Grid<DXQY> &grid) const;
+    enum { SMAGORINSKY, WALE, VREMAN } model_;
+    const lbBase_t cModel_;
+    const lbBase_t tau0_;
+    const bool storeEddyVisc_;
+    lbBase_t eddyVisc_;
+    std::vector<lbBase_t> wallDistance_;  // Distance to the nearest wall, negative if not found
+    std::vector<lbBase_t> coef_;  // (C*D)^2 for each node
+    ScalarField eddyViscField_;
+};
+
+
+template <typename DXQY>
+LES<DXQY>::LES(const std::string &model, const lbBase_t cModel, const lbBase_t tau0, const int nNodes, const bool storeEddyViscosity)
+/* Class constructor, sets an undamped model constant for all nodes
+ *
+ * Parameters
+ * ----------
+ * model : string
+ *     "smagorinsky", "wale" or "vreman"
+ *
+ * cModel : float-like
+ *     model constant (Smagorinsky constant C_s, WALE constant C_w, or C_s for Vreman)
+ *
+ * tau0 : float-like
+ *     molecular relaxation time
+ *
+ * nNodes : int
+ *     number of nodes in the grid
+ *
+ * storeEddyViscosity : bool
+ *     store the eddy viscosity in a scalar field for output
+ */
+    : cModel_(cModel), tau0_(tau0), storeEddyVisc_(storeEddyViscosity), eddyVisc_(0.0),
+      wallDistance_(nNodes, -1.0), coef_(nNodes, cModel*cModel), eddyViscField_(1, storeEddyViscosity ? nNodes : 0)
+{
+    if (model == "smagorinsky") {
+        model_ = SMAGORINSKY;
+    } else if (model == "wale") {
+        model_ = WALE;
+    } else if (model == "vreman") {
+        model_ = VREMAN;
+    } else {
+        std::cout << "ERROR in LES constructor: unknown model " << model << ". Use smagorinsky, wale or vreman" << std::endl;
+        exit(1);
+    }
+}
+
+
+template <typename DXQY>
+void LES<DXQY>::setWallDistance(const Nodes<DXQY> &nodes, const Grid<DXQY> &grid, const lbBase_t maxDistance)
+/* Calculates the distance from each fluid node to the nearest solid boundary node
+ *
+ * The nearest solid node is propagated from the solid boundary nodes through the lattice
+ * links, and the distance is the euclidean distance to that node, minus 1/2 for the
+ * halfway wall. Only walls known to this rank (including its ghost layer) are found. Nodes
+ * farther away than ``maxDistance`` are marked as far from walls.
+ *
+ * Parameters
+ * ----------
+ * nodes : Nodes object
+ *
+ * grid : Grid object
+ *
+ * maxDistance : float-like
+ *     largest wall distance that is calculated (lattice units)
+ */
+{
+    const lbBase_t maxDist2 = (maxDistance + 0.5)*(maxDistance + 0.5);
+    std::vector<lbBase_t> dist2(grid.size(), std::numeric_limits<lbBase_t>::max());
+    std::vector<int> nearest(grid.size(), -1);
+    std::queue<int> front;
+
+    for (int nodeNo = 1; nodeNo < grid.size(); ++nodeNo) {
+        if (nodes.isSolidBoundary(nodeNo)) {
+            dist2[nodeNo] = 0;
+            nearest[nodeNo] = nodeNo;
+            front.push(nodeNo);
+        }
+    }
+
+    while (!front.empty()) {
+        const int nodeNo = front.front();
+        front.pop();
+        for (int q = 0; q < DXQY::nQNonZero_; ++q) {
+            const int neigNo = grid.neighbor(q, nodeNo);
+            if (!nodes.isFluid(neigNo))
+                continue;
+            lbBase_t d2 = 0;
+            for (int d = 0; d < DXQY::nD; ++d) {
+                const lbBase_t dx = grid.pos(neigNo, d) - grid.pos(nearest[nodeNo], d);
+                d2 += dx*dx;
+            }
+            if ( (d2 < dist2[neigNo]) && (d2 <= maxDist2) ) {
+                dist2[neigNo] = d2;
+                nearest[neigNo] = nearest[nodeNo];
+                front.push(neigNo);
+            }
+        }
+    }
+
+    for (int nodeNo = 0; nodeNo < grid.size(); ++nodeNo) {
+        wallDistance_[nodeNo] = (nodes.isFluid(nodeNo) && (nearest[nodeNo] > 0)) ? sqrt(dist2[nodeNo]) - 0.5 : -1.0;
+    }
+}
+
+
+template <typename DXQY>
+void LES<DXQY>::setDamping(const lbBase_t uTau, const lbBase_t APlus)
+/* Sets the van Driest damped model coefficient (C*D)^2 for all nodes
+ *
+ *    D = 1 - exp(-y^+/A^+),   y^+ = y u_tau / nu0,
+ * where y is the wall distance from ``setWallDistance``. Nodes without a wall distance are
+ * undamped. Can be called again if the reference friction velocity changes.
+ *
+ * Parameters
+ * ----------
+ * uTau : float-like
+ *     reference friction velocity
+ *
+ * APlus : float-like
+ *     van Driest constant
+ */
+{
+    const lbBase_t nu0 = DXQY::c2*(tau0_ - 0.5);
+    for (std::size_t nodeNo = 0; nodeNo < coef_.size(); ++nodeNo) {
+        lbBase_t damping = 1.0;
+        if (wallDistance_[nodeNo] >= 0) {
+            const lbBase_t yPlus = wallDistance_[nodeNo]*uTau/nu0;
+            damping = 1.0 - exp(-yPlus/APlus);
+        }
+        coef_[nodeNo] = cModel_*cModel_*damping*damping;
+    }
+}
+
+
+template <typename DXQY>
+void LES<DXQY>::setDamping(const WallLaw &wallLaw, const VectorField<DXQY> &vel, const lbBase_t APlus)
+/* Sets the van Driest damped model coefficient (C*D)^2 from the local friction velocity
+ *
+ * The friction velocity at each node with a wall distance is found from the tabulated law of
+ * the wall, with the speed at the node and its wall distance, and the damping is also
+ * tabulated, so no exp or iterations are used. Call it every few time steps; the
+ * coefficients are kept until the next call.
+ *
+ * Parameters
+ * ----------
+ * wallLaw : WallLaw object
+ *     tabulated law of the wall (LBwallfunction.h)
+ *
+ * vel : VectorField
+ *     velocity field, field number 0
+ *
+ * APlus : float-like
+ *     van Driest constant
+ *
+ * The wall law must have the molecular viscosity of tau0, as y^+ is found with the wall law.
+ */
+{
+    const lbBase_t nu0 = wallLaw.viscosity0();
+    if (std::abs(nu0 - DXQY::c2*(tau0_ - 0.5)) > 1e-12*nu0) {
+        std::cout << "ERROR in LES: the wall law viscosity " << nu0 << " differs from the viscosity " << DXQY::c2*(tau0_ - 0.5) << " of tau0" << std::endl;
+        exit(1);
+    }
+    for (std::size_t nodeNo = 0; nodeNo < coef_.size(); ++nodeNo) {
+        lbBase_t damping = 1.0;
+        if (wallDistance_[nodeNo] >= 0) {
+            lbBase_t u2 = 0;
+            for (int d = 0; d < DXQY::nD; ++d)
+                u2 += vel(0, d, nodeNo)*vel(0, d, nodeNo);
+            const lbBase_t y = std::max(wallDistance_[nodeNo], 0.5);
+            const lbBase_t yPlus = y*wallLaw.frictionVelocity(sqrt(u2), y)/nu0;
+            damping = wallLaw.damping(yPlus, APlus);
+        }
+        coef_[nodeNo] = cModel_*cModel_*damping*damping;
+    }
+}
+
+
+template <typename DXQY>
+std::array<lbBase_t, DXQY::nD*DXQY::nD> LES<DXQY>::velocityGradient(const int nodeNo, const VectorField<DXQY> &vel, const Grid<DXQY> &grid) const
+/* Returns the velocity gradient g_ij = d_j u_i as a DXQY::nD x DXQY::nD matrix, (i, j) -> i*nD + j
+ */
+{
+    std::array<lbBase_t, DXQY::nD*DXQY::nD> ret;
+    ret.fill(0.0);
+    std::array<lbBase_t, DXQY::nQ> velTmp;
+    for (int i = 0; i < DXQY::nD; ++i) {
+        for (int q = 0; q < DXQY::nQ; ++q)
+            velTmp[q] = vel(0, i, grid.neighbor(q, nodeNo));
+        for (int q = 0; q < DXQY::nQ; ++q) {
+            const lbBase_t wu = DXQY::w[q]*DXQY::c2Inv*velTmp[q];
+            for (int j = 0; j < DXQY::nD; ++j)
+                ret[i*DXQY::nD + j] += wu*DXQY::c(q, j);
+        }
+    }
+    return ret;
+}
+
+
+template <typename DXQY>
+template <typename T>
+lbBase_t LES<DXQY>::tau(const int nodeNo, const lbBase_t &rho, const T &strainRateTildeLowTri, const VectorField<DXQY> &vel, const Grid<DXQY> &grid)
+/* Returns the effective relaxation time at a node
+ *
+ * Smagorinsky:
+ *     tau = 1/2 (tau0 + sqrt(tau0^2 + 2 (C D)^2 / (rho c^4) |S~|)),  |S~| = sqrt(2 S~:S~),
+ *     where S~ is the traceless part of ``strainRateTildeLowTri``.
+ * WALE and Vreman:
+ *     tau = tau0 + nu_t/c^2, with nu_t from the velocity gradient at the node.
+ *
+ * Parameters
+ * ----------
+ * nodeNo : int
+ *     node number
+ *
+ * rho : float-like
+ *     fluid density
+ *
+ * strainRateTildeLowTri : array-like, size = [DXQY::nD*(DXQY::nD+1)/2]
+ *     strain rate from calcStrainRateTildeLowTri (only used by the Smagorinsky model)
+ *
+ * vel : VectorField
+ *     velocity field, field number 0 (only used by the WALE and Vreman models)
+ *
+ * grid : Grid object
+ *
+ * Returns
+ * -------
+ * lbBase_t
+ *     the effective relaxation time
+ */
+{
+    lbBase_t tauEff = tau0_;
+
+    if (model_ == SMAGORINSKY) {
+        const lbBase_t trace = DXQY::traceLowTri(strainRateTildeLowTri)/DXQY::nD;
+        lbBase_t SS = DXQY::contractionLowTri(strainRateTildeLowTri, strainRateTildeLowTri);
+        SS -= DXQY::nD*trace*trace; // Remove the trace
+        const lbBase_t SAbs = sqrt(2*SS);
+        tauEff = 0.5*(tau0_ + sqrt(tau0_*tau0_ + 2*coef_[nodeNo]*DXQY::c4Inv*SAbs/rho));
+        eddyVisc_ = DXQY::c2*(tauEff - tau0_);
+    } else {
+        const std::array<lbBase_t, DXQY::nD*DXQY::nD> g = velocityGradient(nodeNo, vel, grid);
+        constexpr int nD = DXQY::nD;
+        if (model_ == WALE) {
+            // g2_ij = g_ik g_kj
+            lbBase_t g2[nD*nD];
+            lbBase_t traceG2 = 0;
+            for (int i = 0; i < nD; ++i) {
+                for (int j = 0; j < nD; ++j) {
+                    g2[i*nD + j] = 0;
+                    for (int k = 0; k < nD; ++k)
+                        g2[i*nD + j] += g[i*nD + k]*g[k*nD + j];
+                }
+                traceG2 += g2[i*nD + i];
+            }
+            lbBase_t SS = 0;
+            lbBase_t SdSd = 0;
+            for (int i = 0; i < nD; ++i) {
+                for (int j = 0; j < nD; ++j) {
+                    const lbBase_t S = 0.5*(g[i*nD + j] + g[j*nD + i]);
+                    const lbBase_t Sd = 0.5*(g2[i*nD + j] + g2[j*nD + i]) - (i == j ? traceG2/nD : 0.0);
+                    SS += S*S;
+                    SdSd += Sd*Sd;
+                }
+            }
+            const lbBase_t denom = pow(SS, 2.5) + pow(SdSd, 1.25);
+            eddyVisc_ = (denom > 0) ? coef_[nodeNo]*pow(SdSd, 1.5)/denom : 0.0;
+        } else {
+            // alpha_ij = d_i u_j = g_ji,  beta_ij = alpha_mi alpha_mj
+            lbBase_t beta[3][3] = {{0, 0, 0}, {0, 0, 0}, {0, 0, 0}};
+            lbBase_t alphaAlpha = 0;
+            for (int i = 0; i < nD; ++i) {
+                for (int j = 0; j < nD; ++j) {
+                    alphaAlpha += g[i*nD + j]*g[i*nD + j];
+                    for (int m = 0; m < nD; ++m)
+                        beta[i][j] += g[i*nD + m]*g[j*nD + m];
+                }
+            }
+            const lbBase_t B = beta[0][0]*beta[1][1] - beta[0][1]*beta[0][1]
+                             + beta[0][0]*beta[2][2] - beta[0][2]*beta[0][2]
+                             + beta[1][1]*beta[2][2] - beta[1][2]*beta[1][2];
+            eddyVisc_ = (alphaAlpha > 0 && B > 0) ? 2.5*coef_[nodeNo]*sqrt(B/alphaAlpha) : 0.0;
+        }
+        tauEff = tau0_ + eddyVisc_*DXQY::c2Inv;
+    }
+
+    if (storeEddyVisc_)
+        eddyViscField_(0, nodeNo) = eddyVisc_;
+
+    return tauEff;
+}
+
+#endif // LBLES_H
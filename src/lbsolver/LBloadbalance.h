@@ -0,0 +1,876 @@
+#ifndef LBLOADBALANCE_H
+#define LBLOADBALANCE_H
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <mpi.h>
+#include "LBglobal.h"
+#include "LBlatticetypes.h"
+#include "LBvtk.h"
+#include "LBgrid.h"
+#include "LBnodes.h"
+#include "LBfield.h"
+#include "../io/Input.h"
+
+/*********************************************************
+ * class LOADBALANCER: repartitions the fluid nodes between
+ *  the ranks from the measured compute time of each rank.
+ *
+ * Timing: put startTimer() and stopTimer() around the
+ *  compute part of the time step, not the mpi calls, which
+ *  mostly measure waiting. Every interval time steps,
+ *  check(...) finds the imbalance max_r T_r / mean_r T_r of
+ *  the accumulated times. If it is above the threshold, a
+ *  new partition is made, and check returns true if any
+ *  node would move.
+ *
+ * Cost per node: with a list of costly nodes (e.g. the
+ *  interface nodes of a multiphase run), the cost of a
+ *  normal and of a costly node is fitted to the measured
+ *  times of all ranks by least squares. Without the list,
+ *  or if the fit fails, a node on rank r costs T_r divided
+ *  by its number of fluid nodes.
+ *
+ * Partition: weighted recursive coordinate bisection. Each
+ *  box is cut normal to its longest axis, so that the cost
+ *  is split in proportion to the number of ranks on each
+ *  side. A level of cuts is one MPI_Allreduce of the cost
+ *  histograms along the cut axes.
+ *
+ * Migration: repartition(...) sends the nodes, with all
+ *  registered fields and the data set attributes of the
+ *  vtklb files, to their new ranks, and returns the vtklb
+ *  contents of the new partition on this rank, made in
+ *  memory. The registered fields are resized and numbered
+ *  as in the new contents. Everything that depends on the
+ *  node numbers must then be made from them:
+ *     if (balancer.check(i, grid, nodes, interfaceNodes)) {
+ *         LBvtk<LT> vtk(std::istringstream(balancer.repartition(grid, nodes)));
+ *         grid = Grid<LT>(vtk);
+ *         nodes = Nodes<LT>(vtk, grid);
+ *         mpiBoundary = BndMpi<LT>(vtk, nodes, grid);
+ *         bulkNodes = findBulkNodes(nodes);
+ *         ...  // boundary conditions, node lists and output
+ *     }
+ *  POINT_DATA_SUBSET attributes are not moved.
+ *
+ * The balancer is set up from the input file block
+ *     <loadbalance>
+ *         interval  500
+ *         threshold 1.1
+ *     <end>
+ *  and is disabled if the block is missing.
+ *********************************************************/
+template <typename DXQY>
+class LoadBalancer
+{
+public:
+    LoadBalancer(LBvtk<DXQY> &vtk, const int interval, const lbBase_t threshold);
+    LoadBalancer(LBvtk<DXQY> &vtk, Input &input);
+
+    template <typename S>
+    void addField(LbField<DXQY, S> &field);
+    void addField(ScalarField &field);
+    void addField(VectorField<DXQY> &field);
+
+    inline void startTimer() {tStart_ = MPI_Wtime();}
+    inline void stopTimer() {time_ += MPI_Wtime() - tStart_;}
+    bool check(const int iteration, const Grid<DXQY> &grid, const Nodes<DXQY> &nodes, const std::vector<int> &costlyNodes=std::vector<int>());
+    std::string repartition(const Grid<DXQY> &grid, const Nodes<DXQY> &nodes);
+
+    inline bool enabled() const {return enabled_;}
+    inline lbBase_t imbalance() const {return imbalance_;}
+    inline int numRepartitions() const {return numRepartitions_;}
+
+private:
+    struct FieldEntry  // Copies the values of a registered field at a node
+    {
+        int numValues;  // Values per node
+        std::function<void(const int, lbBase_t *)> get;
+        std::function<void(const int, const lbBase_t *)> set;
+        std::function<void(const int)> resize;
+    };
+    struct Cut  // Node in the bisection tree. Leaves have rank >= 0
+    {
+        int axis;
+        int plane;  // Last position in the lower child
+        int child[2];
+        int rank;
+    };
+
+    void setup(LBvtk<DXQY> &vtk);
+    static std::vector<int> findOwnNodes(const Grid<DXQY> &grid, const Nodes<DXQY> &nodes);
+    int numValues() const;
+    std::vector<lbBase_t> nodeCost(const std::vector<int> &ownNodes, const std::vector<int> &costlyNodes, const int numNodes) const;
+    void bisect(const Grid<DXQY> &grid, const std::vector<int> &ownNodes, const std::vector<lbBase_t> &cost);
+    int owner(const int *pos) const;
+    void wrap(const int *pos, int *ret) const;
+    long long flat(const int *pos) const;
+    long long flatWithRim(const int *pos) const;
+    void packNode(const int nodeNo, std::vector<lbBase_t> &buf);
+    template <typename T>
+    static std::vector<T> alltoallv(const std::vector<std::vector<T>> &sendBuf, std::vector<int> &recvCount, MPI_Datatype type);
+    void writeVtklb(std::ostream &ofs, const std::vector<int> &pos, const std::vector<int> &neig, const std::vector<int> &isFluid,
+                    const std::vector<int> &rank, const std::vector<int> &remoteNo, const std::vector<const lbBase_t *> &data) const;
+
+    bool enabled_;
+    int interval_;
+    lbBase_t threshold_;
+    int myRank_;
+    int nProcs_;
+    int size_[DXQY::nD];  // Global size, without the rim
+    std::vector<std::string> attributeNames_;
+    std::vector<bool> attributeIsInt_;
+    std::vector<lbBase_t> attributes_;  // Attribute a of node n at n*attributeNames_.size() + a
+    std::vector<FieldEntry> fields_;
+    std::vector<Cut> cuts_;  // Partition made by the last check
+    double tStart_;
+    double time_;  // Compute time since the last check
+    double lastTime_;  // Compute time between the two last checks
+    lbBase_t imbalance_;
+    int numRepartitions_;
+};
+
+
+template <typename DXQY>
+LoadBalancer<DXQY>::LoadBalancer(LBvtk<DXQY> &vtk, const int interval, const lbBase_t threshold)
+    : enabled_(true), interval_(interval), threshold_(threshold)
+/* vtk       : the vtklb file of the current partition, for the data set attributes
+ * interval  : number of time steps between checks
+ * threshold : repartition when max_r T_r / mean_r T_r is above this value
+ */
+{
+    setup(vtk);
+}
+
+
+template <typename DXQY>
+LoadBalancer<DXQY>::LoadBalancer(LBvtk<DXQY> &vtk, Input &input)
+    : enabled_(input.contains("loadbalance")), interval_(1), threshold_(0)
+/* input : reads the loadbalance block, see the class comment
+ */
+{
+    if (enabled_) {
+        const Block &block = input["loadbalance"];
+        interval_ = block["interval"];
+        threshold_ = block["threshold"];
+    }
+    setup(vtk);
+}
+
+
+template <typename DXQY>
+void LoadBalancer<DXQY>::setup(LBvtk<DXQY> &vtk)
+{
+    MPI_Comm_rank(MPI_COMM_WORLD, &myRank_);
+    MPI_Comm_size(MPI_COMM_WORLD, &nProcs_);
+    tStart_ = time_ = lastTime_ = 0;
+    imbalance_ = 1;
+    numRepartitions_ = 0;
+    if (interval_ < 1) {
+        std::cout << "ERROR in LoadBalancer: the interval must be positive" << std::endl;
+        exit(1);
+    }
+    for (int d = 0; d < DXQY::nD; ++d)
+        size_[d] = vtk.getGlobaDimensions(d) - 2;
+
+    for (const auto &name: vtk.getAttributeNames()) {
+        if (name != "nodetype") {
+            attributeNames_.push_back(name);
+            attributeIsInt_.push_back(vtk.getAttributeType(name) == "int");
+        }
+    }
+    const int numAttributes = attributeNames_.size();
+    attributes_.assign(numAttributes*vtk.endNodeNo(), 0.0);
+    for (int a = 0; a < numAttributes; ++a) {
+        vtk.toAttribute(attributeNames_[a]);
+        for (int nodeNo = vtk.beginNodeNo(); nodeNo < vtk.endNodeNo(); ++nodeNo)
+            attributes_[nodeNo*numAttributes + a] = vtk.template getScalarAttribute<lbBase_t>();
+    }
+}
+
+
+template <typename DXQY>
+template <typename S>
+void LoadBalancer<DXQY>::addField(LbField<DXQY, S> &field)
+/* addField : the field is moved with the nodes. The stored values are copied, so a
+ *  reduced precision field keeps its values exactly.
+ */
+{
+    FieldEntry entry;
+    entry.numValues = field.num_fields()*DXQY::nQ;
+    entry.get = [&field](const int nodeNo, lbBase_t *val) {
+        for (int fieldNo = 0; fieldNo < field.num_fields(); ++fieldNo)
+            for (int q = 0; q < DXQY::nQ; ++q)
+                *val++ = field.storage(fieldNo, q, nodeNo);
+    };
+    entry.set = [&field](const int nodeNo, const lbBase_t *val) {
+        for (int fieldNo = 0; fieldNo < field.num_fields(); ++fieldNo)
+            for (int q = 0; q < DXQY::nQ; ++q)
+                field.storage(fieldNo, q, nodeNo) = static_cast<S>(*val++);
+    };
+    entry.resize = [&field](const int numNodes) {field.resize(numNodes);};
+    fields_.push_back(entry);
+}
+
+
+template <typename DXQY>
+void LoadBalancer<DXQY>::addField(ScalarField &field)
+{
+    FieldEntry entry;
+    entry.numValues = field.num_fields();
+    entry.get = [&field](const int nodeNo, lbBase_t *val) {
+        for (int fieldNo = 0; fieldNo < field.num_fields(); ++fieldNo)
+            val[fieldNo] = field(fieldNo, nodeNo);
+    };
+    entry.set = [&field](const int nodeNo, const lbBase_t *val) {
+        for (int fieldNo = 0; fieldNo < field.num_fields(); ++fieldNo)
+            field(fieldNo, nodeNo) = val[fieldNo];
+    };
+    entry.resize = [&field](const int numNodes) {field.resize(numNodes);};
+    fields_.push_back(entry);
+}
+
+
+template <typename DXQY>
+void LoadBalancer<DXQY>::addField(VectorField<DXQY> &field)
+{
+    FieldEntry entry;
+    entry.numValues = field.num_fields()*DXQY::nD;
+    entry.get = [&field](const int nodeNo, lbBase_t *val) {
+        for (int fieldNo = 0; fieldNo < field.num_fields(); ++fieldNo)
+            for (int d = 0; d < DXQY::nD; ++d)
+                *val++ = field(fieldNo, d, nodeNo);
+    };
+    entry.set = [&field](const int nodeNo, const lbBase_t *val) {
+        for (int fieldNo = 0; fieldNo < field.num_fields(); ++fieldNo)
+            for (int d = 0; d < DXQY::nD; ++d)
+                field(fieldNo, d, nodeNo) = *val++;
+    };
+    entry.resize = [&field](const int numNodes) {field.resize(numNodes);};
+    fields_.push_back(entry);
+}
+
+
+template <typename DXQY>
+int LoadBalancer<DXQY>::numValues() const
+/* numValues : attributes and field values per node
+ */
+{
+    int ret = attributeNames_.size();
+    for (const auto &entry: fields_)
+        ret += entry.numValues;
+    return ret;
+}
+
+
+template <typename DXQY>
+bool LoadBalancer<DXQY>::check(const int iteration, const Grid<DXQY> &grid, const Nodes<DXQY> &nodes, const std::vector<int> &costlyNodes)
+/* check : finds the imbalance of the compute times since the last check, if iteration
+ *  is a multiple of the interval. Above the threshold, a new partition is made, and
+ *  check returns true if it moves any nodes. Call repartition(...) to move them.
+ *
+ * costlyNodes : fluid nodes on this rank with a higher cost (may be empty)
+ */
+{
+    if ( !enabled_ || (iteration <= 0) || (iteration % interval_ != 0) )
+        return false;
+    double tMax, tSum;
+    MPI_Allreduce(&time_, &tMax, 1, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+    MPI_Allreduce(&time_, &tSum, 1, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+    lastTime_ = time_;
+    time_ = 0;
+    imbalance_ = (tSum > 0) ? tMax*nProcs_/tSum : 1.0;
+    cuts_.clear();
+    if ( (nProcs_ == 1) || (imbalance_ <= threshold_) )
+        return false;
+
+    const std::vector<int> ownNodes = findOwnNodes(grid, nodes);
+    bisect(grid, ownNodes, nodeCost(ownNodes, costlyNodes, grid.size()));
+    int numMoved = 0, numMovedGlobal;
+    for (const auto &nodeNo: ownNodes) {
+        int pos[DXQY::nD];
+        for (int d = 0; d < DXQY::nD; ++d)
+            pos[d] = grid.pos(nodeNo, d);
+        numMoved += (owner(pos) != myRank_);
+    }
+    MPI_Allreduce(&numMoved, &numMovedGlobal, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+    if (numMovedGlobal == 0)
+        cuts_.clear();
+    return numMovedGlobal > 0;
+}
+
+
+template <typename DXQY>
+std::vector<int> LoadBalancer<DXQY>::findOwnNodes(const Grid<DXQY> &grid, const Nodes<DXQY> &nodes)
+/* findOwnNodes : fluid nodes on this rank
+ */
+{
+    std::vector<int> ret;
+    for (int nodeNo = 1; nodeNo < grid.size(); ++nodeNo) {
+        if (nodes.isFluid(nodeNo) && nodes.isMyRank(nodeNo))
+            ret.push_back(nodeNo);
+    }
+    return ret;
+}
+
+
+template <typename DXQY>
+std::vector<lbBase_t> LoadBalancer<DXQY>::nodeCost(const std::vector<int> &ownNodes, const std::vector<int> &costlyNodes, const int numNodes) const
+/* nodeCost : cost of each node in ownNodes, see the class comment. The least squares fit of
+ *  T_r = a n_r + b m_r, with n_r normal and m_r costly nodes on rank r, needs a > 0 and b > 0.
+ */
+{
+    std::vector<char> isCostly(numNodes, 0);
+    for (const auto &nodeNo: costlyNodes)
+        isCostly[nodeNo] = 1;
+    lbBase_t m = 0;
+    for (const auto &nodeNo: ownNodes)
+        m += isCostly[nodeNo];
+    const lbBase_t n = ownNodes.size() - m;
+    const lbBase_t t = lastTime_;
+    lbBase_t local[6] = {n*n, n*m, m*m, n*t, m*t, t}, sum[6];
+    MPI_Allreduce(local, sum, 6, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+
+    std::vector<lbBase_t> ret(ownNodes.size(), 1.0);
+    if (sum[5] <= 0)  // No timing
+        return ret;
+    const lbBase_t det = sum[0]*sum[2] - sum[1]*sum[1];
+    if (det > 1e-8*sum[0]*sum[2]) {
+        const lbBase_t a = (sum[3]*sum[2] - sum[1]*sum[4])/det;
+        const lbBase_t b = (sum[0]*sum[4] - sum[1]*sum[3])/det;
+        if ( (a > 0) && (b > 0) ) {
+            for (std::size_t i = 0; i < ownNodes.size(); ++i)
+                ret[i] = isCostly[ownNodes[i]] ? b : a;
+            return ret;
+        }
+    }
+    if (!ownNodes.empty())
+        std::fill(ret.begin(), ret.end(), t/ownNodes.size());
+    return ret;
+}
+
+
+template <typename DXQY>
+void LoadBalancer<DXQY>::bisect(const Grid<DXQY> &grid, const std::vector<int> &ownNodes, const std::vector<lbBase_t> &cost)
+/* bisect : makes the bisection tree cuts_, see the class comment
+ */
+{
+    constexpr int nD = DXQY::nD;
+    struct Box
+    {
+        int cut;
+        int lo[nD], hi[nD];
+        int rankBegin, rankEnd;
+    };
+    cuts_.assign(1, Cut{0, 0, {-1, -1}, -1});
+    Box root;
+    root.cut = 0;
+    for (int d = 0; d < nD; ++d) {
+        root.lo[d] = 0;
+        root.hi[d] = size_[d] - 1;
+    }
+    root.rankBegin = 0;
+    root.rankEnd = nProcs_;
+    std::vector<Box> boxes(1, root);
+    std::vector<int> nodeBox(ownNodes.size(), 0);  // Box of each node, -1 if the box is a leaf
+
+    while (!boxes.empty()) {
+        const int nBoxes = boxes.size();
+        std::vector<int> axis(nBoxes, 0), offset(nBoxes + 1, 0);
+        for (int b = 0; b < nBoxes; ++b) {
+            const Box &box = boxes[b];
+            int length = 0;
+            if (box.rankEnd - box.rankBegin > 1) {
+                for (int d = 0; d < nD; ++d) {
+                    if (box.hi[d] - box.lo[d] > box.hi[axis[b]] - box.lo[axis[b]])
+                        axis[b] = d;
+                }
+                length = std::max(box.hi[axis[b]] - box.lo[axis[b]] + 1, 0);
+            }
+            offset[b + 1] = offset[b] + length;
+        }
+        std::vector<lbBase_t> histLocal(offset[nBoxes], 0.0), hist(offset[nBoxes], 0.0);
+        for (std::size_t i = 0; i < ownNodes.size(); ++i) {
+            const int b = nodeBox[i];
+            if ( (b >= 0) && (offset[b + 1] > offset[b]) )
+                histLocal[offset[b] + grid.pos(ownNodes[i], axis[b]) - boxes[b].lo[axis[b]]] += cost[i];
+        }
+        MPI_Allreduce(histLocal.data(), hist.data(), offset[nBoxes], MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+
+        std::vector<Box> children;
+        std::vector<int> childIndex(nBoxes, -1);  // Index of the lower child in children
+        for (int b = 0; b < nBoxes; ++b) {
+            const Box &box = boxes[b];
+            const int nRanks = box.rankEnd - box.rankBegin;
+            if (nRanks == 1) {
+                cuts_[box.cut].rank = box.rankBegin;
+                continue;
+            }
+            const int ax = axis[b];
+            const int nLow = nRanks/2;
+            lbBase_t total = 0;
+            for (int i = offset[b]; i < offset[b + 1]; ++i)
+                total += hist[i];
+            const lbBase_t target = total*nLow/nRanks;
+            int plane = box.hi[ax];
+            lbBase_t cum = 0, best = std::numeric_limits<lbBase_t>::max();
+            for (int x = box.lo[ax]; x < box.hi[ax]; ++x) {
+                cum += hist[offset[b] + x - box.lo[ax]];
+                if (std::abs(cum - target) < best) {
+                    best = std::abs(cum - target);
+                    plane = x;
+                }
+            }
+            Box low = box, high = box;
+            low.hi[ax] = plane;
+            low.rankEnd = high.rankBegin = box.rankBegin + nLow;
+            high.lo[ax] = plane + 1;
+            low.cut = cuts_.size();
+            high.cut = low.cut + 1;
+            cuts_[box.cut].axis = ax;
+            cuts_[box.cut].plane = plane;
+            cuts_[box.cut].child[0] = low.cut;
+            cuts_[box.cut].child[1] = high.cut;
+            cuts_.push_back(Cut{0, 0, {-1, -1}, -1});
+            cuts_.push_back(Cut{0, 0, {-1, -1}, -1});
+            childIndex[b] = children.size();
+            children.push_back(low);
+            children.push_back(high);
+        }
+        for (std::size_t i = 0; i < ownNodes.size(); ++i) {
+            const int b = nodeBox[i];
+            if (b < 0)
+                continue;
+            if (childIndex[b] < 0) {
+                nodeBox[i] = -1;
+            } else {
+                const Cut &cut = cuts_[boxes[b].cut];
+                nodeBox[i] = childIndex[b] + (grid.pos(ownNodes[i], cut.axis) > cut.plane);
+            }
+        }
+        boxes.swap(children);
+    }
+}
+
+
+template <typename DXQY>
+int LoadBalancer<DXQY>::owner(const int *pos) const
+/* owner : new rank of the (wrapped) position
+ */
+{
+    int c = 0;
+    while (cuts_[c].rank < 0)
+        c = cuts_[c].child[pos[cuts_[c].axis] > cuts_[c].plane];
+    return cuts_[c].rank;
+}
+
+
+template <typename DXQY>
+inline void LoadBalancer<DXQY>::wrap(const int *pos, int *ret) const
+/* wrap : periodic image of pos inside the system. Only used for links that exist, so
+ *  a position outside the system is across a periodic boundary.
+ */
+{
+    for (int d = 0; d < DXQY::nD; ++d)
+        ret[d] = ((pos[d] % size_[d]) + size_[d]) % size_[d];
+}
+
+
+template <typename DXQY>
+inline long long LoadBalancer<DXQY>::flat(const int *pos) const
+{
+    long long ret = 0;
+    for (int d = DXQY::nD - 1; d >= 0; --d)
+        ret = ret*size_[d] + pos[d];
+    return ret;
+}
+
+
+template <typename DXQY>
+inline long long LoadBalancer<DXQY>::flatWithRim(const int *pos) const
+{
+    long long ret = 0;
+    for (int d = DXQY::nD - 1; d >= 0; --d)
+        ret = ret*(size_[d] + 2) + pos[d] + 1;
+    return ret;
+}
+
+
+template <typename DXQY>
+void LoadBalancer<DXQY>::packNode(const int nodeNo, std::vector<lbBase_t> &buf)
+/* packNode : appends the attributes and field values of the node
+ */
+{
+    const int numAttributes = attributeNames_.size();
+    for (int a = 0; a < numAttributes; ++a)
+        buf.push_back(attributes_[nodeNo*numAttributes + a]);
+    for (const auto &entry: fields_) {
+        const std::size_t begin = buf.size();
+        buf.resize(begin + entry.numValues);
+        entry.get(nodeNo, &buf[begin]);
+    }
+}
+
+
+template <typename DXQY>
+template <typename T>
+std::vector<T> LoadBalancer<DXQY>::alltoallv(const std::vector<std::vector<T>> &sendBuf, std::vector<int> &recvCount, MPI_Datatype type)
+/* alltoallv : sends sendBuf[r] to rank r, and returns the received entries grouped by
+ *  sending rank. recvCount is set to the number received from each rank.
+ */
+{
+    const int nProcs = sendBuf.size();
+    std::vector<int> sendCount(nProcs), sendDispl(nProcs, 0), recvDispl(nProcs, 0);
+    std::vector<T> send;
+    for (int r = 0; r < nProcs; ++r) {
+        sendCount[r] = sendBuf[r].size();
+        send.insert(send.end(), sendBuf[r].begin(), sendBuf[r].end());
+    }
+    recvCount.resize(nProcs);
+    MPI_Alltoall(sendCount.data(), 1, MPI_INT, recvCount.data(), 1, MPI_INT, MPI_COMM_WORLD);
+    for (int r = 1; r < nProcs; ++r) {
+        sendDispl[r] = sendDispl[r-1] + sendCount[r-1];
+        recvDispl[r] = recvDispl[r-1] + recvCount[r-1];
+    }
+    std::vector<T> recvBuf(recvDispl[nProcs-1] + recvCount[nProcs-1]);
+    MPI_Alltoallv(send.data(), sendCount.data(), sendDispl.data(), type, recvBuf.data(), recvCount.data(), recvDispl.data(), type, MPI_COMM_WORLD);
+    return recvBuf;
+}
+
+
+template <typename DXQY>
+std::string LoadBalancer<DXQY>::repartition(const Grid<DXQY> &grid, const Nodes<DXQY> &nodes)
+/* repartition : moves the nodes to the partition made by the last call to check, see
+ *  the class comment, and returns the vtklb contents of the new partition on this rank.
+ */
+{
+    constexpr int nD = DXQY::nD;
+    constexpr int nQ = DXQY::nQ;
+    const int numVal = numValues();
+    const int recSize = 2 + nD + numVal;  // fluid, links, position, values
+    if (cuts_.empty()) {
+        std::cout << "ERROR in LoadBalancer: call repartition only when check returns true" << std::endl;
+        exit(1);
+    }
+
+    const std::vector<int> ownNodes = findOwnNodes(grid, nodes);
+    std::vector<int> solidNodes;
+    for (int nodeNo = 1; nodeNo < grid.size(); ++nodeNo) {
+        if (nodes.isSolid(nodeNo))
+            solidNodes.push_back(nodeNo);
+    }
+
+    // SEND THE NODES TO THEIR NEW RANK
+    //  Fluid nodes also send a bit mask of their links. Solid nodes go to the owner of
+    //  their periodic image, and are kept once.
+    std::vector<std::vector<lbBase_t>> sendBuf(nProcs_);
+    for (const auto &nodeNo: ownNodes) {
+        int pos[nD];
+        int links = 0;
+        for (int q = 0; q < nQ; ++q)
+            links |= (grid.neighbor(q, nodeNo) != 0) << q;
+        for (int d = 0; d < nD; ++d)
+            pos[d] = grid.pos(nodeNo, d);
+        auto &buf = sendBuf[owner(pos)];
+        buf.push_back(1);
+        buf.push_back(links);
+        buf.insert(buf.end(), pos, pos + nD);
+        packNode(nodeNo, buf);
+    }
+    for (const auto &nodeNo: solidNodes) {
+        int pos[nD], w[nD];
+        for (int d = 0; d < nD; ++d)
+            pos[d] = grid.pos(nodeNo, d);
+        wrap(pos, w);
+        auto &buf = sendBuf[owner(w)];
+        buf.push_back(0);
+        buf.push_back(0);
+        buf.insert(buf.end(), w, w + nD);
+        packNode(nodeNo, buf);
+    }
+    std::vector<int> recvCount;
+    const std::vector<lbBase_t> nodeBuf = alltoallv(sendBuf, recvCount, MPI_DOUBLE);
+    sendBuf.clear();
+
+    std::vector<std::pair<long long, int>> ownRec;  // Flat position and record
+    std::unordered_map<long long, int> ownNo, solidRec;
+    for (std::size_t i = 0; i < nodeBuf.size(); i += recSize) {
+        int pos[nD];
+        for (int d = 0; d < nD; ++d)
+            pos[d] = nodeBuf[i + 2 + d];
+        if (nodeBuf[i] > 0)
+            ownRec.emplace_back(flat(pos), i);
+        else
+            solidRec.emplace(flat(pos), i);
+    }
+    std::sort(ownRec.begin(), ownRec.end());
+    const int numOwn = ownRec.size();
+    for (int n = 0; n < numOwn; ++n)
+        ownNo[ownRec[n].first] = n + 1;
+
+    int numTotal[2] = {static_cast<int>(ownNodes.size()), numOwn}, numTotalGlobal[2];
+    MPI_Allreduce(numTotal, numTotalGlobal, 2, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+    if (numTotalGlobal[0] != numTotalGlobal[1]) {
+        std::cout << "ERROR in LoadBalancer: " << numTotalGlobal[1] << " fluid nodes after the repartition, " << numTotalGlobal[0] << " before" << std::endl;
+        exit(1);
+    }
+
+    // HALO NODES
+    //  Local solid nodes, and nodes on other ranks, at the positions the own nodes link to
+    struct Halo
+    {
+        int pos[nD];
+        int rank;
+        int isFluid;
+        int remoteNo;
+        const lbBase_t *data;
+    };
+    std::vector<Halo> halo;
+    std::unordered_map<long long, int> haloIndex;  // Flat position with rim
+    std::vector<std::vector<int>> request(nProcs_);
+    std::vector<std::vector<int>> requestHalo(nProcs_);
+    std::vector<std::unordered_map<long long, int>> requested(nProcs_);
+    for (const auto &rec: ownRec) {
+        const int links = nodeBuf[rec.second + 1];
+        for (int q = 0; q < nQ; ++q) {
+            if ( !(links & (1 << q)) )
+                continue;
+            Halo h;
+            int w[nD];
+            for (int d = 0; d < nD; ++d)
+                h.pos[d] = nodeBuf[rec.second + 2 + d] + DXQY::c(q, d);
+            wrap(h.pos, w);
+            h.rank = owner(w);
+            if ( (h.rank == myRank_) && ownNo.count(flat(w)) )
+                continue;
+            const long long key = flatWithRim(h.pos);
+            if (haloIndex.count(key))
+                continue;
+            if (h.rank == myRank_) {
+                const auto it = solidRec.find(flat(w));
+                if (it == solidRec.end()) {
+                    std::cout << "ERROR in LoadBalancer: no node at a linked position on rank " << myRank_ << std::endl;
+                    exit(1);
+                }
+                h.isFluid = 0;
+                h.remoteNo = 0;
+                h.data = &nodeBuf[it->second + 2 + nD];
+            } else {
+                const auto it = requested[h.rank].find(flat(w));
+                if (it == requested[h.rank].end()) {
+                    requested[h.rank][flat(w)] = request[h.rank].size()/nD;
+                    request[h.rank].insert(request[h.rank].end(), w, w + nD);
+                }
+                requestHalo[h.rank].push_back(halo.size());
+            }
+            haloIndex[key] = halo.size();
+            halo.push_back(h);
+        }
+    }
+
+    // Remote halo nodes: ask their owner for the node type, node number and values
+    const std::vector<int> requestBuf = alltoallv(request, recvCount, MPI_INT);
+    std::vector<std::vector<lbBase_t>> replyBuf(nProcs_);
+    for (int r = 0, i = 0; r < nProcs_; ++r) {
+        for (const int iEnd = i + recvCount[r]; i < iEnd; i += nD) {
+            const long long key = flat(&requestBuf[i]);
+            const auto it = ownNo.find(key);
+            int rec;
+            if (it != ownNo.end()) {
+                rec = ownRec[it->second - 1].second;
+                replyBuf[r].push_back(1);
+                replyBuf[r].push_back(it->second);
+            } else if (solidRec.count(key)) {
+                rec = solidRec[key];
+                replyBuf[r].push_back(0);
+                replyBuf[r].push_back(0);
+            } else {
+                std::cout << "ERROR in LoadBalancer: rank " << r << " asks for a position without a node on rank " << myRank_ << std::endl;
+                exit(1);
+            }
+            replyBuf[r].insert(replyBuf[r].end(), &nodeBuf[rec + 2 + nD], &nodeBuf[rec + 2 + nD] + numVal);
+        }
+    }
+    const std::vector<lbBase_t> reply = alltoallv(replyBuf, recvCount, MPI_DOUBLE);
+    replyBuf.clear();
+    for (int r = 0, i = 0; r < nProcs_; ++r) {
+        for (const auto &h: requestHalo[r]) {
+            int w[nD];
+            wrap(halo[h].pos, w);
+            const int rec = i + requested[r][flat(w)]*(2 + numVal);
+            halo[h].isFluid = reply[rec];
+            halo[h].remoteNo = reply[rec + 1];
+            halo[h].data = &reply[rec + 2];
+        }
+        i += requested[r].size()*(2 + numVal);
+    }
+
+    // NEW NODE NUMBERS
+    //  Own fluid nodes, solid nodes and then the fluid nodes of each neighbor rank
+    std::vector<int> haloOrder(halo.size());
+    for (std::size_t h = 0; h < halo.size(); ++h)
+        haloOrder[h] = h;
+    std::sort(haloOrder.begin(), haloOrder.end(), [&](const int a, const int b) {
+        if (halo[a].isFluid != halo[b].isFluid)
+            return halo[a].isFluid < halo[b].isFluid;
+        if (halo[a].isFluid && (halo[a].rank != halo[b].rank))
+            return halo[a].rank < halo[b].rank;
+        return flatWithRim(halo[a].pos) < flatWithRim(halo[b].pos);
+    });
+    const int numNodes = 1 + numOwn + halo.size();
+    std::vector<int> pos(numNodes*nD, -1), isFluid(numNodes, 0), rank(numNodes, myRank_), remoteNo(numNodes, 0);
+    std::vector<const lbBase_t *> data(numNodes, nullptr);
+    std::unordered_map<long long, int> localNo;  // Flat position with rim
+    for (int n = 0; n < numOwn; ++n) {
+        const int nodeNo = n + 1;
+        for (int d = 0; d < nD; ++d)
+            pos[nodeNo*nD + d] = nodeBuf[ownRec[n].second + 2 + d];
+        isFluid[nodeNo] = 1;
+        data[nodeNo] = &nodeBuf[ownRec[n].second + 2 + nD];
+        localNo[flatWithRim(&pos[nodeNo*nD])] = nodeNo;
+    }
+    for (std::size_t n = 0; n < halo.size(); ++n) {
+        const Halo &h = halo[haloOrder[n]];
+        const int nodeNo = numOwn + 1 + n;
+        for (int d = 0; d < nD; ++d)
+            pos[nodeNo*nD + d] = h.pos[d];
+        isFluid[nodeNo] = h.isFluid;
+        if (h.isFluid)
+            rank[nodeNo] = h.rank;
+        remoteNo[nodeNo] = h.remoteNo;
+        data[nodeNo] = h.data;
+        localNo[flatWithRim(h.pos)] = nodeNo;
+    }
+
+    // NEIGHBORS
+    //  Own nodes use their links, so that periodic links to own nodes go directly to the
+    //  node. The other nodes link to the local nodes next to them.
+    std::vector<int> neig(numNodes*nQ, 0);
+    for (int nodeNo = 1; nodeNo < numNodes; ++nodeNo) {
+        const int links = (nodeNo <= numOwn) ? static_cast<int>(nodeBuf[ownRec[nodeNo - 1].second + 1]) : -1;
+        for (int q = 0; q < nQ; ++q) {
+            int p[nD], w[nD];
+            for (int d = 0; d < nD; ++d)
+                p[d] = pos[nodeNo*nD + d] + DXQY::c(q, d);
+            if (nodeNo <= numOwn) {
+                if ( !(links & (1 << q)) )
+                    continue;
+                wrap(p, w);
+                if (owner(w) == myRank_) {
+                    const auto it = ownNo.find(flat(w));
+                    if (it != ownNo.end()) {
+                        neig[nodeNo*nQ + q] = it->second;
+                        continue;
+                    }
+                }
+            }
+            bool inside = true;
+            for (int d = 0; d < nD; ++d)
+                inside = inside && (p[d] >= -1) && (p[d] <= size_[d]);
+            if (inside) {
+                const auto it = localNo.find(flatWithRim(p));
+                if (it != localNo.end())
+                    neig[nodeNo*nQ + q] = it->second;
+            }
+        }
+    }
+
+    std::ostringstream vtklb;
+    writeVtklb(vtklb, pos, neig, isFluid, rank, remoteNo, data);
+
+    // MOVE THE DATA
+    const int numAttributes = attributeNames_.size();
+    attributes_.assign(numNodes*numAttributes, 0.0);
+    for (auto &entry: fields_)
+        entry.resize(numNodes);
+    for (int nodeNo = 1; nodeNo < numNodes; ++nodeNo) {
+        const lbBase_t *val = data[nodeNo];
+        for (int a = 0; a < numAttributes; ++a)
+            attributes_[nodeNo*numAttributes + a] = *val++;
+        for (auto &entry: fields_) {
+            entry.set(nodeNo, val);
+            val += entry.numValues;
+        }
+    }
+    ++numRepartitions_;
+    cuts_.clear();
+    return vtklb.str();
+}
+
+
+template <typename DXQY>
+void LoadBalancer<DXQY>::writeVtklb(std::ostream &ofs, const std::vector<int> &pos, const std::vector<int> &neig, const std::vector<int> &isFluid,
+                                    const std::vector<int> &rank, const std::vector<int> &remoteNo, const std::vector<const lbBase_t *> &data) const
+/* writeVtklb : writes the vtklb contents of this rank in the format of vtklb.py
+ */
+{
+    constexpr int nD = DXQY::nD;
+    constexpr int nQ = DXQY::nQ;
+    const int numNodes = isFluid.size();
+    ofs << "# BADChIMP vtklb Version na\n";
+    ofs << "Geometry file for process " << myRank_ << "\n";
+    ofs << "ASCII\n";
+    ofs << "DATASET UNSTRUCTURED_LB_GRID\n";
+    ofs << "NUM_DIMENSIONS " << nD << "\n";
+    ofs << "GLOBAL_DIMENSIONS";
+    for (int d = 0; d < nD; ++d)
+        ofs << " " << size_[d] + 2;
+    ofs << "\n";
+    ofs << "USE_ZERO_GHOST_NODE\n";
+
+    ofs << "POINTS " << numNodes - 1 << " int\n";
+    for (int nodeNo = 1; nodeNo < numNodes; ++nodeNo) {
+        for (int d = 0; d < nD; ++d)
+            ofs << pos[nodeNo*nD + d] << ((d < nD - 1) ? " " : "\n");
+    }
+    ofs << "LATTICE " << nQ << " int\n";
+    for (int q = 0; q < nQ; ++q) {
+        for (int d = 0; d < nD; ++d)
+            ofs << DXQY::c(q, d) << ((d < nD - 1) ? " " : "\n");
+    }
+    ofs << "NEIGHBORS int\n";
+    for (int nodeNo = 1; nodeNo < numNodes; ++nodeNo) {
+        for (int q = 0; q < nQ; ++q)
+            ofs << neig[nodeNo*nQ + q] << ((q < nQ - 1) ? " " : "\n");
+    }
+
+    ofs << "PARALLEL_COMPUTING " << myRank_ << "\n";
+    for (int nodeNo = 1; nodeNo < numNodes; ) {
+        if (rank[nodeNo] == myRank_) {
+            ++nodeNo;
+            continue;
+        }
+        int end = nodeNo;
+        while ( (end < numNodes) && (rank[end] == rank[nodeNo]) )
+            ++end;
+        ofs << "PROCESSOR " << end - nodeNo << " " << rank[nodeNo] << "\n";
+        for (; nodeNo < end; ++nodeNo)
+            ofs << nodeNo << " " << remoteNo[nodeNo] << "\n";
+    }
+
+    ofs << "POINT_DATA " << numNodes - 1 << "\n";
+    ofs << "SCALARS nodetype int\n";
+    for (int nodeNo = 1; nodeNo < numNodes; ++nodeNo)
+        ofs << isFluid[nodeNo] << "\n";
+    ofs << std::setprecision(std::numeric_limits<lbBase_t>::max_digits10);
+    for (std::size_t a = 0; a < attributeNames_.size(); ++a) {
+        ofs << "SCALARS " << attributeNames_[a] << (attributeIsInt_[a] ? " int\n" : " float\n");
+        for (int nodeNo = 1; nodeNo < numNodes; ++nodeNo) {
+            if (attributeIsInt_[a])
+                ofs << std::llround(data[nodeNo][a]) << "\n";
+            else
+                ofs << data[nodeNo][a] << "\n";
+        }
+    }
+}
+
+#endif // LBLOADBALANCE_H
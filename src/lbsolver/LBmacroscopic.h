@@ -201,8 +201,8 @@ inline void setFieldToConst(const lbBase_t* velConst, const int &fieldNo, Vector
             vel(fieldNo, d, n) = velConst[d];
 }
 
-template <typename DXQY>
-inline void setFieldToConst(const lbBase_t* fConst, const int &fieldNo, LbField<DXQY> &f)
+template <typename DXQY, typename S>
+inline void setFieldToConst(const lbBase_t* fConst, const int &fieldNo, LbField<DXQY, S> &f)
 /* sets all lb distribution  values for field 'fieldNo' to a given distribution
  *
  * fConst  : pointer to distribution that is copied to all node
@@ -8,6 +8,7 @@
 #include <algorithm>
 #include <math.h>
 #include <stdlib.h>
+#include <type_traits>
 #include "mpi.h"
 #include "../lbsolver/LBglobal.h"
 #include "../lbsolver/LBboundary.h"
@@ -69,6 +70,17 @@
  *********************************************************/
 
 
+template <typename T>
+inline MPI_Datatype mpiDataType();
+/* Returns the mpi data type for the c++ type T */
+
+template <>
+inline MPI_Datatype mpiDataType<double>() {return MPI_DOUBLE;}
+
+template <>
+inline MPI_Datatype mpiDataType<float>() {return MPI_FLOAT;}
+
+
 class MonLatMpi
 {
 public:
@@ -102,8 +114,14 @@ public:
     template <typename DXQY>
     void inline communicateVectorField_TEST(const int &myRank, VectorField<DXQY> &field, const int &fieldNo);
     
-    template <typename DXQY>
-    void inline communicateLbField(const int &myRank, const Grid<DXQY> &grid, LbField<DXQY> &field, const int &fieldNo);
+    template <typename DXQY, typename S>
+    void inline communicateLbField(const int &myRank, const Grid<DXQY> &grid, LbField<DXQY, S> &field, const int &fieldNo);
+    template <typename DXQY, typename S>
+    void inline communicateLbField(const int &myRank, const Grid<DXQY> &grid, LbField<DXQY, S> &field);
+    template <typename DXQY, typename S>
+    void inline communicateLbField(const int &myRank, const Grid<DXQY> &grid, LbField<DXQY, S> &field, const std::vector<char> &isActive);
+
+    inline int neigRank() const {return neigRank_;}
 
     void printNodesToSend() {
         std::cout << "Nodes to send to rank " << neigRank_ << ": ";
@@ -175,9 +193,49 @@ private:
 
     std::vector<lbBase_t> sendBuffer_; // Buffer for sending values. sendBuffer_[i] = value(nodesToSend_[i])
     std::vector<lbBase_t> receiveBuffer_;  // Buffer for receiving values. value(nodesReceived_[i]) = receiveBuffer[i]
+    std::vector<float> sendBufferFloat_;  // Buffers for LbField<DXQY, float>, allocated on first use
+    std::vector<float> receiveBufferFloat_;
+
+    template <typename S>
+    inline std::vector<S>& typedSendBuffer(const std::size_t minSize);
+    template <typename S>
+    inline std::vector<S>& typedReceiveBuffer(const std::size_t minSize);
 };
 
 
+template <typename S>
+inline std::vector<S>& MonLatMpi::typedSendBuffer(const std::size_t minSize)
+/* typedSendBuffer : the send buffer for the LbField storage type S, with room for
+ *  at least minSize values. Sent with mpiDataType<S>().
+ */
+{
+    static_assert(std::is_same<S, lbBase_t>::value || std::is_same<S, float>::value, "LbField storage type must be lbBase_t or float");
+    std::vector<S> *buffer;
+    if constexpr (std::is_same<S, lbBase_t>::value)
+        buffer = &sendBuffer_;
+    else
+        buffer = &sendBufferFloat_;
+    if (buffer->size() < minSize)
+        buffer->resize(minSize);
+    return *buffer;
+}
+
+template <typename S>
+inline std::vector<S>& MonLatMpi::typedReceiveBuffer(const std::size_t minSize)
+/* typedReceiveBuffer : as typedSendBuffer, for receiving */
+{
+    static_assert(std::is_same<S, lbBase_t>::value || std::is_same<S, float>::value, "LbField storage type must be lbBase_t or float");
+    std::vector<S> *buffer;
+    if constexpr (std::is_same<S, lbBase_t>::value)
+        buffer = &receiveBuffer_;
+    else
+        buffer = &receiveBufferFloat_;
+    if (buffer->size() < minSize)
+        buffer->resize(minSize);
+    return *buffer;
+}
+
+
 void inline MonLatMpi::communicateScalarField(const int &myRank, ScalarField &field, const int &fieldNo)
 {
     if (myRank < neigRank_) {
@@ -233,9 +291,14 @@ void inline MonLatMpi::communicateVectorField_TEST(const int &myRank, VectorFiel
   }
 }
 
-template <typename DXQY>
-void inline MonLatMpi::communicateLbField(const int &myRank, const Grid<DXQY> &grid, LbField<DXQY> &field, const int &fieldNo)
+template <typename DXQY, typename S>
+void inline MonLatMpi::communicateLbField(const int &myRank, const Grid<DXQY> &grid, LbField<DXQY, S> &field, const int &fieldNo)
+/* The stored values are communicated, so a reduced precision field also has reduced
+ * precision mpi buffers (see typedSendBuffer).
+ */
 {
+    S *sendBuffer = typedSendBuffer<S>(dirListToSend_.size()).data();
+    S *receiveBuffer = typedReceiveBuffer<S>(dirListReceived_.size()).data();
 
     if (myRank < neigRank_) {
         // SEND first
@@ -246,35 +309,35 @@ void inline MonLatMpi::communicateLbField(const int &myRank, const Grid<DXQY> &g
                 int qDir = dirListToSend_[cnt];
                 int ghostNode = grid.neighbor(qDir, nodesToSend_[n]);
 
-                sendBuffer_[cnt] = field(fieldNo, qDir, ghostNode);
+                sendBuffer[cnt] = field.storage(fieldNo, qDir, ghostNode);
                 cnt += 1;
             }
         }
-        MPI_Send(sendBuffer_.data(), static_cast<int>(dirListToSend_.size()), MPI_DOUBLE, neigRank_, 0, MPI_COMM_WORLD);
+        MPI_Send(sendBuffer, static_cast<int>(dirListToSend_.size()), mpiDataType<S>(), neigRank_, 0, MPI_COMM_WORLD);
 
         // RECEIVE
 
-        MPI_Recv(receiveBuffer_.data(), static_cast<int>(dirListReceived_.size()), MPI_DOUBLE, neigRank_, 1, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+        MPI_Recv(receiveBuffer, static_cast<int>(dirListReceived_.size()), mpiDataType<S>(), neigRank_, 1, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
         cnt = 0;
         for (std::size_t n=0; n < nodesReceived_.size(); ++n) {
             for (int q = 0; q < nDirPerNodeReceived_[n]; ++q) {
                 int qDir = dirListReceived_[cnt];
                 int realNode = grid.neighbor(qDir, nodesReceived_[n]);
 
-                field(fieldNo, qDir, realNode) = receiveBuffer_[cnt] ;
+                field.storage(fieldNo, qDir, realNode) = receiveBuffer[cnt];
                 cnt += 1;
             }
         }
     } else {
         // RECEIVE first
-        MPI_Recv(receiveBuffer_.data(), static_cast<int>(dirListReceived_.size()), MPI_DOUBLE, neigRank_, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+        MPI_Recv(receiveBuffer, static_cast<int>(dirListReceived_.size()), mpiDataType<S>(), neigRank_, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
         std::size_t cnt = 0;
         for (std::size_t n=0; n < nodesReceived_.size(); ++n) {
             for (int q = 0; q < nDirPerNodeReceived_[n]; ++q) {
                 int qDir = dirListReceived_[cnt];
                 int realNode = grid.neighbor(qDir, nodesReceived_[n]);
 
-                field(fieldNo, qDir, realNode) = receiveBuffer_[cnt] ;
+                field.storage(fieldNo, qDir, realNode) = receiveBuffer[cnt];
                 cnt += 1;
             }
         }
@@ -287,15 +350,133 @@ void inline MonLatMpi::communicateLbField(const int &myRank, const Grid<DXQY> &g
                 int qDir = dirListToSend_[cnt];
                 int ghostNode = grid.neighbor(qDir, nodesToSend_[n]);
 
-                sendBuffer_[cnt] = field(fieldNo, qDir, ghostNode);
+                sendBuffer[cnt] = field.storage(fieldNo, qDir, ghostNode);
                 cnt += 1;
             }
         }
 
-        MPI_Send(sendBuffer_.data(), static_cast<int>(dirListToSend_.size()), MPI_DOUBLE, neigRank_, 1, MPI_COMM_WORLD);
+        MPI_Send(sendBuffer, static_cast<int>(dirListToSend_.size()), mpiDataType<S>(), neigRank_, 1, MPI_COMM_WORLD);
+    }
+}
+
+
+
+template <typename DXQY, typename S>
+void inline MonLatMpi::communicateLbField(const int &myRank, const Grid<DXQY> &grid, LbField<DXQY, S> &field)
+/* Communicates all fields in one message, with the fields of each
+ * direction stored next to each other.
+ */
+{
+    const int nFields = field.num_fields();
+    const std::size_t nSend = nFields*dirListToSend_.size();
+    const std::size_t nReceived = nFields*dirListReceived_.size();
+    S *sendBuffer = typedSendBuffer<S>(nSend).data();
+    S *receiveBuffer = typedReceiveBuffer<S>(nReceived).data();
+
+    auto fillSendBuffer = [&]() {
+        std::size_t cnt = 0;
+        std::size_t dirCnt = 0;
+        for (std::size_t n=0; n < nodesToSend_.size(); ++n) {
+            for (int q = 0; q < nDirPerNodeToSend_[n]; ++q) {
+                const int qDir = dirListToSend_[dirCnt++];
+                const int ghostNode = grid.neighbor(qDir, nodesToSend_[n]);
+                for (int fieldNo = 0; fieldNo < nFields; ++fieldNo)
+                    sendBuffer[cnt++] = field.storage(fieldNo, qDir, ghostNode);
+            }
+        }
+    };
+    auto readReceiveBuffer = [&]() {
+        std::size_t cnt = 0;
+        std::size_t dirCnt = 0;
+        for (std::size_t n=0; n < nodesReceived_.size(); ++n) {
+            for (int q = 0; q < nDirPerNodeReceived_[n]; ++q) {
+                const int qDir = dirListReceived_[dirCnt++];
+                const int realNode = grid.neighbor(qDir, nodesReceived_[n]);
+                for (int fieldNo = 0; fieldNo < nFields; ++fieldNo)
+                    field.storage(fieldNo, qDir, realNode) = receiveBuffer[cnt++];
+            }
+        }
+    };
+
+    if (myRank < neigRank_) {
+        fillSendBuffer();
+        MPI_Send(sendBuffer, static_cast<int>(nSend), mpiDataType<S>(), neigRank_, 0, MPI_COMM_WORLD);
+        MPI_Recv(receiveBuffer, static_cast<int>(nReceived), mpiDataType<S>(), neigRank_, 1, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+        readReceiveBuffer();
+    } else {
+        MPI_Recv(receiveBuffer, static_cast<int>(nReceived), mpiDataType<S>(), neigRank_, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+        readReceiveBuffer();
+        fillSendBuffer();
+        MPI_Send(sendBuffer, static_cast<int>(nSend), mpiDataType<S>(), neigRank_, 1, MPI_COMM_WORLD);
     }
 }
 
 
+template <typename DXQY, typename S>
+void inline MonLatMpi::communicateLbField(const int &myRank, const Grid<DXQY> &grid, LbField<DXQY, S> &field, const std::vector<char> &isActive)
+/* Communicates all fields as above, but only the distributions propagated
+ * from nodes marked in isActive. The message starts with one flag per node
+ * to send, and is empty if none of them are active. The distributions of
+ * inactive nodes are left unchanged, as for inactive nodes on this rank.
+ */
+{
+    const int nFields = field.num_fields();
+    const std::size_t nSend = nodesToSend_.size() + nFields*dirListToSend_.size();
+    const std::size_t nReceived = nodesReceived_.size() + nFields*dirListReceived_.size();
+    S *sendBuffer = typedSendBuffer<S>(nSend).data();
+    S *receiveBuffer = typedReceiveBuffer<S>(nReceived).data();
+
+    auto fillSendBuffer = [&]() {
+        std::size_t cnt = nodesToSend_.size();
+        std::size_t dirCnt = 0;
+        for (std::size_t n=0; n < nodesToSend_.size(); ++n) {
+            const bool active = isActive[nodesToSend_[n]];
+            sendBuffer[n] = active ? 1 : 0;
+            if (!active) {
+                dirCnt += nDirPerNodeToSend_[n];
+                continue;
+            }
+            for (int q = 0; q < nDirPerNodeToSend_[n]; ++q) {
+                const int qDir = dirListToSend_[dirCnt++];
+                const int ghostNode = grid.neighbor(qDir, nodesToSend_[n]);
+                for (int fieldNo = 0; fieldNo < nFields; ++fieldNo)
+                    sendBuffer[cnt++] = field.storage(fieldNo, qDir, ghostNode);
+            }
+        }
+        return static_cast<int>( (cnt > nodesToSend_.size()) ? cnt : 0 );
+    };
+    auto readReceiveBuffer = [&](MPI_Status &status) {
+        int count;
+        MPI_Get_count(&status, mpiDataType<S>(), &count);
+        if (count == 0)
+            return;
+        std::size_t cnt = nodesReceived_.size();
+        std::size_t dirCnt = 0;
+        for (std::size_t n=0; n < nodesReceived_.size(); ++n) {
+            if (receiveBuffer[n] == 0) {
+                dirCnt += nDirPerNodeReceived_[n];
+                continue;
+            }
+            for (int q = 0; q < nDirPerNodeReceived_[n]; ++q) {
+                const int qDir = dirListReceived_[dirCnt++];
+                const int realNode = grid.neighbor(qDir, nodesReceived_[n]);
+                for (int fieldNo = 0; fieldNo < nFields; ++fieldNo)
+                    field.storage(fieldNo, qDir, realNode) = receiveBuffer[cnt++];
+            }
+        }
+    };
+
+    MPI_Status status;
+    if (myRank < neigRank_) {
+        MPI_Send(sendBuffer, fillSendBuffer(), mpiDataType<S>(), neigRank_, 0, MPI_COMM_WORLD);
+        MPI_Recv(receiveBuffer, static_cast<int>(nReceived), mpiDataType<S>(), neigRank_, 1, MPI_COMM_WORLD, &status);
+        readReceiveBuffer(status);
+    } else {
+        MPI_Recv(receiveBuffer, static_cast<int>(nReceived), mpiDataType<S>(), neigRank_, 0, MPI_COMM_WORLD, &status);
+        readReceiveBuffer(status);
+        MPI_Send(sendBuffer, fillSendBuffer(), mpiDataType<S>(), neigRank_, 1, MPI_COMM_WORLD);
+    }
+}
+
 
 #endif // LBMONLATMPI_H
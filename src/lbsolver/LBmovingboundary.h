@@ -0,0 +1,382 @@
+#ifndef LBMOVINGBOUNDARY_H
+#define LBMOVINGBOUNDARY_H
+
+#include <cstdint>
+#include <vector>
+#include <valarray>
+#include <mpi.h>
+#include "LBglobal.h"
+#include "LBlatticetypes.h"
+#include "LBnodes.h"
+#include "LBgrid.h"
+#include "LBfield.h"
+#include "LBprofiler.h"
+
+/*********************************************************
+ * class MOVINGBOUNDARY: rigid body moving through the
+ *  fluid nodes of the static geometry.
+ *
+ * The body is given by a shape functor
+ *     bool isInside(const std::valarray<lbBase_t> &pos)
+ *  evaluated at the node positions (grid.pos). Only nodes
+ *  that are fluid in the Nodes object can be covered by
+ *  the body, static solids are left to the other boundary
+ *  conditions.
+ *
+ * The full domain is only checked in initiate(...). In
+ *  update(...) the shape is only evaluated at the current
+ *  boundary nodes and their neighbors, so the body is
+ *  assumed to move less than one lattice spacing per step.
+ *  Nodes next to other ranks are also evaluated every step,
+ *  so that a body can enter the local domain.
+ *  The unknown directions of each boundary node are stored
+ *  as a bit mask, and only the nodes next to a node that
+ *  changed state get their masks recomputed.
+ *
+ * The wall velocity is that of a rigid body,
+ *     u_w = U + Omega x (x - X),
+ *  with all vectors given with three components (z = 0 in 2D).
+ *
+ * Use per time step, after propagation and mpi communication:
+ *     mpiBoundary.communciateScalarField(rho);
+ *     movingBnd.update(isInside, nodes, grid);
+ *     movingBnd.apply(0, f, grid, center, velocity, omega);
+ *     movingBnd.refill(0, f, rho, nodes, grid, center, velocity, omega);
+ *     auto forceTorque = movingBnd.forceAndTorque();
+ *  where rho is the density set in the collision. The ghost
+ *  nodes only hold the distributions streamed into them, so
+ *  the density of the neighbors of an uncovered node is taken
+ *  from rho, which must also be set on the ghost nodes.
+ *
+ * Nodes covered by the body should still be collided (or
+ *  skipped with isSolid(nodeNo)), as their values are not read
+ *  by the link bounce back.
+ *********************************************************/
+template <typename DXQY>
+class MovingBoundary
+{
+public:
+    MovingBoundary(const Nodes<DXQY> &nodes, const Grid<DXQY> &grid);
+
+    template <typename F>
+    void initiate(const F &isInside, const Nodes<DXQY> &nodes, const Grid<DXQY> &grid);
+    template <typename F>
+    void update(const F &isInside, const Nodes<DXQY> &nodes, const Grid<DXQY> &grid);
+    template <typename S, typename T>
+    void apply(const int fieldNo, LbField<DXQY, S> &f, const Grid<DXQY> &grid, const T &center, const T &velocity, const T &omega, const lbBase_t rho0=1.0);
+    template <typename S, typename T>
+    void refill(const int fieldNo, LbField<DXQY, S> &f, const ScalarField &rho, const Nodes<DXQY> &nodes, const Grid<DXQY> &grid,
+                const T &center, const T &velocity, const T &omega);
+    std::valarray<lbBase_t> forceAndTorque();
+
+    inline bool isSolid(const int nodeNo) const {return inBody_[nodeNo];}
+    inline int size() const {return static_cast<int>(bndNodes_.size());}
+    inline int nodeNo(const int bndNo) const {return bndNodes_[bndNo];}
+    inline std::uint32_t unknownMask(const int nodeNo) const {return linkMask_[nodeNo];}
+    inline const std::vector<int> & freshNodes() const {return freshNodes_;}
+    inline const std::vector<int> & coveredNodes() const {return coveredNodes_;}
+
+private:
+    template <typename T>
+    inline std::valarray<lbBase_t> wallVelocity(const lbBase_t *x, const T &center, const T &velocity, const T &omega) const;
+    inline std::valarray<lbBase_t> nodePos(const int nodeNo, const Grid<DXQY> &grid) const;
+    void setMask(const int nodeNo, const Nodes<DXQY> &nodes, const Grid<DXQY> &grid);
+
+    std::vector<char> inBody_; // Node is covered by the body
+    std::vector<std::uint32_t> linkMask_; // Bit q is set if direction q is unknown, i.e. neighbor(qRev) is covered
+    std::vector<int> bndIndex_; // Index in bndNodes_, or -1
+    std::vector<int> bndNodes_; // Fluid nodes (on this rank) with at least one covered neighbor
+    std::vector<int> freshNodes_; // Nodes uncovered in the last update
+    std::vector<int> coveredNodes_; // Nodes covered in the last update
+    std::vector<int> interfaceNodes_; // Mpi boundary nodes and their fluid neighbors
+    std::vector<int> visited_; // Update number when the node was last evaluated
+    int updateNo_;
+    lbBase_t forceTorque_[DXQY::nD + 3]; // Local sum of force (nD) and torque (3)
+};
+
+
+template <typename DXQY>
+MovingBoundary<DXQY>::MovingBoundary(const Nodes<DXQY> &nodes, const Grid<DXQY> &grid)
+    : inBody_(grid.size(), 0), linkMask_(grid.size(), 0), bndIndex_(grid.size(), -1), visited_(grid.size(), -1), updateNo_(0)
+{
+    static_assert(DXQY::nQ <= 32, "MovingBoundary: link masks hold at most 32 directions");
+    for (auto &val: forceTorque_)
+        val = 0.0;
+    // Nodes where a body can enter from a neighboring rank
+    for (int n = 1; n < grid.size(); ++n) {
+        if (nodes.isMpiBoundary(n)) {
+            for (int q = 0; q < DXQY::nQ; ++q) {
+                const int neigNo = grid.neighbor(q, n);
+                if ((neigNo > 0) && nodes.isFluid(neigNo) && (visited_[neigNo] != 0)) {
+                    visited_[neigNo] = 0;
+                    interfaceNodes_.push_back(neigNo);
+                }
+            }
+        }
+    }
+}
+
+
+template <typename DXQY>
+inline std::valarray<lbBase_t> MovingBoundary<DXQY>::nodePos(const int nodeNo, const Grid<DXQY> &grid) const
+{
+    std::valarray<lbBase_t> ret(DXQY::nD);
+    for (int d = 0; d < DXQY::nD; ++d)
+        ret[d] = grid.pos(nodeNo, d);
+    return ret;
+}
+
+
+template <typename DXQY>
+template <typename T>
+inline std::valarray<lbBase_t> MovingBoundary<DXQY>::wallVelocity(const lbBase_t *x, const T &center, const T &velocity, const T &omega) const
+/* wallVelocity : rigid body velocity U + Omega x r at the point x
+ */
+{
+    lbBase_t r[3] = {0, 0, 0};
+    for (int d = 0; d < DXQY::nD; ++d)
+        r[d] = x[d] - center[d];
+    const lbBase_t wr[3] = {omega[1]*r[2] - omega[2]*r[1], omega[2]*r[0] - omega[0]*r[2], omega[0]*r[1] - omega[1]*r[0]};
+    std::valarray<lbBase_t> ret(DXQY::nD);
+    for (int d = 0; d < DXQY::nD; ++d)
+        ret[d] = velocity[d] + wr[d];
+    return ret;
+}
+
+
+template <typename DXQY>
+void MovingBoundary<DXQY>::setMask(const int nodeNo, const Nodes<DXQY> &nodes, const Grid<DXQY> &grid)
+/* setMask : recomputes the unknown directions of a node, and adds it to
+ *  or removes it from the list of boundary nodes.
+ */
+{
+    std::uint32_t mask = 0;
+    if (nodes.isFluid(nodeNo) && nodes.isMyRank(nodeNo) && !inBody_[nodeNo]) {
+        for (int q = 0; q < DXQY::nQ - 1; ++q) {
+            if (inBody_[grid.neighbor(DXQY::reverseDirection(q), nodeNo)])
+                mask |= (std::uint32_t(1) << q);
+        }
+    }
+    linkMask_[nodeNo] = mask;
+
+    const int bndNo = bndIndex_[nodeNo];
+    if (mask && (bndNo < 0)) {
+        bndIndex_[nodeNo] = static_cast<int>(bndNodes_.size());
+        bndNodes_.push_back(nodeNo);
+    }
+    else if (!mask && (bndNo >= 0)) {
+        // Swap with the last node and remove
+        const int lastNode = bndNodes_.back();
+        bndNodes_[bndNo] = lastNode;
+        bndIndex_[lastNode] = bndNo;
+        bndNodes_.pop_back();
+        bndIndex_[nodeNo] = -1;
+    }
+}
+
+
+template <typename DXQY>
+template <typename F>
+void MovingBoundary<DXQY>::initiate(const F &isInside, const Nodes<DXQY> &nodes, const Grid<DXQY> &grid)
+/* initiate : evaluates the shape at all fluid nodes and sets up the boundary nodes.
+ *
+ * isInside : functor returning true if the given position is inside the body
+ */
+{
+    for (int n = 1; n < grid.size(); ++n) {
+        inBody_[n] = nodes.isFluid(n) && isInside(nodePos(n, grid));
+    }
+    for (int n = 1; n < grid.size(); ++n) {
+        setMask(n, nodes, grid);
+    }
+    freshNodes_.clear();
+    coveredNodes_.clear();
+}
+
+
+template <typename DXQY>
+template <typename F>
+void MovingBoundary<DXQY>::update(const F &isInside, const Nodes<DXQY> &nodes, const Grid<DXQY> &grid)
+/* update : moves the body surface. The shape is evaluated at the boundary nodes
+ *  and all their neighbors, and masks are only recomputed around nodes that
+ *  changed state.
+ *
+ * isInside : functor returning true if the given position is inside the body
+ */
+{
+    updateNo_ += 1;
+    freshNodes_.clear();
+    coveredNodes_.clear();
+
+    // Candidates: the boundary nodes and their neighbors (both sides of the surface)
+    std::vector<int> candidates;
+    candidates.reserve(bndNodes_.size()*DXQY::nQ + interfaceNodes_.size());
+    for (const auto &nodeNo: interfaceNodes_) {
+        visited_[nodeNo] = updateNo_;
+        candidates.push_back(nodeNo);
+    }
+    for (const auto &bndNode: bndNodes_) {
+        for (int q = 0; q < DXQY::nQ; ++q) {
+            const int neigNo = grid.neighbor(q, bndNode);
+            if ((neigNo > 0) && (visited_[neigNo] != updateNo_)) {
+                visited_[neigNo] = updateNo_;
+                candidates.push_back(neigNo);
+            }
+        }
+    }
+
+    // Nodes that change state
+    for (const auto &nodeNo: candidates) {
+        const bool inside = nodes.isFluid(nodeNo) && isInside(nodePos(nodeNo, grid));
+        if (inside != static_cast<bool>(inBody_[nodeNo])) {
+            inBody_[nodeNo] = inside;
+            if (inside)
+                coveredNodes_.push_back(nodeNo);
+            else
+                freshNodes_.push_back(nodeNo);
+        }
+    }
+
+    // Update the masks of the changed nodes and their neighbors
+    updateNo_ += 1;
+    auto updateAround = [&](const std::vector<int> &changed) {
+        for (const auto &nodeNo: changed) {
+            for (int q = 0; q < DXQY::nQ; ++q) {
+                const int neigNo = grid.neighbor(q, nodeNo);
+                if ((neigNo > 0) && (visited_[neigNo] != updateNo_)) {
+                    visited_[neigNo] = updateNo_;
+                    setMask(neigNo, nodes, grid);
+                }
+            }
+        }
+    };
+    updateAround(coveredNodes_);
+    updateAround(freshNodes_);
+}
+
+
+template <typename DXQY>
+template <typename S, typename T>
+void MovingBoundary<DXQY>::apply(const int fieldNo, LbField<DXQY, S> &f, const Grid<DXQY> &grid, const T &center, const T &velocity, const T &omega, const lbBase_t rho0)
+/* apply : halfway bounce back with the rigid body wall velocity, and
+ *  accumulation of the momentum exchange force and torque.
+ *
+ *  f(q, x) = f(qRev, x - c_q) + 2 w_q rho0 (c_q . u_w)/c_s^2
+ *
+ * fieldNo  : the lB-field number
+ * f        : the field object
+ * grid     : grid object
+ * center   : center of rotation (3 components)
+ * velocity : translational velocity (3 components)
+ * omega    : angular velocity (3 components)
+ * rho0     : density used in the moving wall term
+ */
+{
+    static const int region = profiler().region("MovingBoundary::apply");
+    ScopedTimer timer(region);
+    for (const auto &nodeNo: bndNodes_) {
+        const std::uint32_t mask = linkMask_[nodeNo];
+        for (int q = 0; q < DXQY::nQ - 1; ++q) {
+            if (!(mask & (std::uint32_t(1) << q)))
+                continue;
+            const int qRev = DXQY::reverseDirection(q);
+            // Wall position halfway along the link
+            lbBase_t xWall[3] = {0, 0, 0};
+            for (int d = 0; d < DXQY::nD; ++d)
+                xWall[d] = grid.pos(nodeNo, d) + 0.5*DXQY::c(qRev, d);
+            const auto uWall = wallVelocity(xWall, center, velocity, omega);
+            const lbBase_t fOut = f(fieldNo, qRev, grid.neighbor(qRev, nodeNo));
+            const lbBase_t fIn = fOut + 2*DXQY::w[q]*rho0*DXQY::cDot(q, &uWall[0])*DXQY::c2Inv;
+            f(fieldNo, q, nodeNo) = fIn;
+            // Momentum exchange
+            lbBase_t F[3] = {0, 0, 0};
+            for (int d = 0; d < DXQY::nD; ++d) {
+                F[d] = (fOut + fIn)*DXQY::c(qRev, d);
+                forceTorque_[d] += F[d];
+            }
+            lbBase_t r[3] = {0, 0, 0};
+            for (int d = 0; d < DXQY::nD; ++d)
+                r[d] = xWall[d] - center[d];
+            forceTorque_[DXQY::nD + 0] += r[1]*F[2] - r[2]*F[1];
+            forceTorque_[DXQY::nD + 1] += r[2]*F[0] - r[0]*F[2];
+            forceTorque_[DXQY::nD + 2] += r[0]*F[1] - r[1]*F[0];
+        }
+    }
+}
+
+
+template <typename DXQY>
+template <typename S, typename T>
+void MovingBoundary<DXQY>::refill(const int fieldNo, LbField<DXQY, S> &f, const ScalarField &rho, const Nodes<DXQY> &nodes, const Grid<DXQY> &grid,
+                                  const T &center, const T &velocity, const T &omega)
+/* refill : sets the distributions at uncovered (fresh) nodes to the equilibrium
+ *  with the wall velocity and the mean density of the fluid neighbors. The
+ *  momentum given to fresh nodes, and taken from covered nodes, is added to the
+ *  force and torque on the body.
+ *
+ * rho : density field fieldNo, also on the ghost nodes, so that the neighbors
+ *       are the same for any number of ranks
+ */
+{
+    auto addMomentum = [&](const int nodeNo, const std::valarray<lbBase_t> &mom) {
+        lbBase_t r[3] = {0, 0, 0};
+        lbBase_t F[3] = {0, 0, 0};
+        for (int d = 0; d < DXQY::nD; ++d) {
+            r[d] = grid.pos(nodeNo, d) - center[d];
+            F[d] = mom[d];
+            forceTorque_[d] += F[d];
+        }
+        forceTorque_[DXQY::nD + 0] += r[1]*F[2] - r[2]*F[1];
+        forceTorque_[DXQY::nD + 1] += r[2]*F[0] - r[0]*F[2];
+        forceTorque_[DXQY::nD + 2] += r[0]*F[1] - r[1]*F[0];
+    };
+
+    for (const auto &nodeNo: coveredNodes_) {
+        if (!nodes.isMyRank(nodeNo))
+            continue;
+        std::valarray<lbBase_t> fNode(DXQY::nQ);
+        for (int q = 0; q < DXQY::nQ; ++q)
+            fNode[q] = f(fieldNo, q, nodeNo);
+        addMomentum(nodeNo, DXQY::qSumC(fNode));
+    }
+
+    for (const auto &nodeNo: freshNodes_) {
+        if (!nodes.isMyRank(nodeNo))
+            continue;
+        lbBase_t rhoNode = 0;
+        int nNeig = 0;
+        for (int q = 0; q < DXQY::nQ - 1; ++q) {
+            const int neigNo = grid.neighbor(q, nodeNo);
+            if (nodes.isFluid(neigNo) && !inBody_[neigNo]) {
+                rhoNode += rho(fieldNo, neigNo);
+                nNeig += 1;
+            }
+        }
+        rhoNode = (nNeig > 0) ? rhoNode/nNeig : 1.0;
+        lbBase_t x[3] = {0, 0, 0};
+        for (int d = 0; d < DXQY::nD; ++d)
+            x[d] = grid.pos(nodeNo, d);
+        const auto uWall = wallVelocity(x, center, velocity, omega);
+        const lbBase_t uu = DXQY::dot(uWall, uWall);
+        const auto cu = DXQY::cDotAll(uWall);
+        for (int q = 0; q < DXQY::nQ; ++q)
+            f(fieldNo, q, nodeNo) = DXQY::w[q]*rhoNode*(1.0 + DXQY::c2Inv*cu[q] + DXQY::c4Inv0_5*(cu[q]*cu[q] - DXQY::c2*uu));
+        addMomentum(nodeNo, -rhoNode*uWall);
+    }
+}
+
+
+template <typename DXQY>
+std::valarray<lbBase_t> MovingBoundary<DXQY>::forceAndTorque()
+/* forceAndTorque : global force (nD) and torque (3) on the body since the last
+ *  call, summed over all ranks in a single reduction.
+ */
+{
+    std::valarray<lbBase_t> ret(DXQY::nD + 3);
+    MPI_Allreduce(forceTorque_, &ret[0], DXQY::nD + 3, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+    for (auto &val: forceTorque_)
+        val = 0.0;
+    return ret;
+}
+
+#endif // LBMOVINGBOUNDARY_H
@@ -4,39 +4,68 @@
 
 #include "LBglobal.h"
 #include "LBboundary.h"
+#include "LBboundarylinks.h"
 #include "LBgrid.h"
 #include "LBfield.h"
+#include "LBprofiler.h"
+
+
+template <typename DXQY>
+BoundaryLinks unknownNeighborLinks(const Boundary<DXQY> &bnd, const Grid<DXQY> &grid)
+/* unknownNeighborLinks : the links (neighbor(q, node), q, reverse(q), node) for the
+ *  unknown (beta and delta) directions q of the boundary nodes. The values f_q are set
+ *  at the neighbor in direction q, from the macroscopic values of the boundary node.
+ *  No two links set the same value, so the order of the links does not matter.
+ */
+{
+    BoundaryLinks ret;
+    for (int n = 0; n < bnd.size(); ++n) {
+        const int nodeNo = bnd.nodeNo(n);
+        for (const auto q: bnd.unknown(n)) {
+            const int neigNo = grid.neighbor(q, nodeNo);
+            if ( (neigNo < 0) || (neigNo >= grid.size()) ) {
+                std::cout << "ERROR in pressure boundary: neighbor of boundary node " << nodeNo << " in direction " << q << " is not in the grid" << std::endl;
+                exit(1);
+            }
+            ret.add(neigNo, q, bnd.dirRev(q), nodeNo);
+        }
+    }
+    return ret;
+}
+
 
 template <typename DXQY>
 class PressureBnd : public Boundary<DXQY>
 {
 public:
-    PressureBnd(const std::vector<int> bndNodes, const Nodes<DXQY> &nodes, const Grid<DXQY> &grid) : Boundary<DXQY>(bndNodes, nodes, grid) {}
-    void apply(const int fieldNo, LbField<DXQY> &f, const Grid<DXQY> &grid, const ScalarField &rho) const;
+    PressureBnd(const std::vector<int> bndNodes, const Nodes<DXQY> &nodes, const Grid<DXQY> &grid)
+    : Boundary<DXQY>(bndNodes, nodes, grid), links_(unknownNeighborLinks(*this, grid)) {}
+    template <typename S>
+    void apply(const int fieldNo, LbField<DXQY, S> &f, const Grid<DXQY> &grid, const ScalarField &rho) const;
+private:
+    BoundaryLinks links_;  // See unknownNeighborLinks
 };
 
 template<typename DXQY>
-void PressureBnd<DXQY>::apply(const int fieldNo, LbField<DXQY> &f, const Grid<DXQY> &grid, const ScalarField &rho) const
+template<typename S>
+void PressureBnd<DXQY>::apply(const int fieldNo, LbField<DXQY, S> &f, const Grid<DXQY> &grid, const ScalarField &rho) const
 /* apply : performs the pressure boundary conditions.
  *
  * fieldNo : the lB-field number
  * f       : the field object
  * grid    : grid object
  *
- * Use 'this->' to access functions and variables in the parent class, Boundary<DXQY>.
+ * The unknown directions are precomputed in links_, so no direction lists are
+ * built here.
  *
  */
 {
-    for (int n=0; n < this->size(); ++n) {
-        int nodeNo = this->nodeNo(n);
-        for (auto beta: this->beta(n)) {
-            f(fieldNo, beta, grid.neighbor(beta, nodeNo)) = DXQY::w[beta]*rho(fieldNo, nodeNo);
-        }
-        for (auto delta: this->delta(n)) {
-            auto delta_rev = this->dirRev(delta);
-            f(fieldNo, delta, grid.neighbor(delta, nodeNo)) = DXQY::w[delta]*rho(fieldNo, nodeNo);
-            f(fieldNo, delta_rev, grid.neighbor(delta_rev, nodeNo)) = DXQY::w[delta_rev]*rho(fieldNo, nodeNo);
-        }
+    static const int region = profiler().region("PressureBnd::apply");
+    ScopedTimer timer(region);
+    const int nLinks = links_.size();
+    for (int n = 0; n < nLinks; ++n) {
+        const int q = links_.qIn(n);
+        f(fieldNo, q, links_.node(n)) = DXQY::w[q]*rho(fieldNo, links_.neighbor(n));
     }
 }
 
@@ -44,46 +73,32 @@ template<typename DXQY>
 class InletOutlet : public Boundary<DXQY>
 {
 public:
-    InletOutlet(const std::vector<int> bndNodes, const Nodes<DXQY> &nodes, const Grid<DXQY> &grid) : Boundary<DXQY>(bndNodes, nodes, grid) {}
-    void apply(const int fieldNo, LbField<DXQY> &f, const Grid<DXQY> &grid, const lbBase_t &rho, const std::vector<lbBase_t> vel) const;
+    InletOutlet(const std::vector<int> bndNodes, const Nodes<DXQY> &nodes, const Grid<DXQY> &grid)
+    : Boundary<DXQY>(bndNodes, nodes, grid), links_(unknownNeighborLinks(*this, grid)) {}
+    template <typename S>
+    void apply(const int fieldNo, LbField<DXQY, S> &f, const Grid<DXQY> &grid, const lbBase_t &rho, const std::vector<lbBase_t> vel) const;
+private:
+    BoundaryLinks links_;  // See unknownNeighborLinks
 };
 
 template<typename DXQY>
-void InletOutlet<DXQY>::apply(const int fieldNo, LbField<DXQY> &f, const Grid<DXQY> &grid, const lbBase_t &rho, const std::vector<lbBase_t> vel) const
+template<typename S>
+void InletOutlet<DXQY>::apply(const int fieldNo, LbField<DXQY, S> &f, const Grid<DXQY> &grid, const lbBase_t &rho, const std::vector<lbBase_t> vel) const
+/* apply : sets the unknown directions to the equilibrium of rho and vel. The
+ *  equilibrium is the same for all links, so it is computed once per call.
+ */
 {
+    static const int region = profiler().region("InletOutlet::apply");
+    ScopedTimer timer(region);
     lbBase_t u_sq = DXQY::dot(vel, vel);
     std::valarray<lbBase_t> cu = DXQY::cDotAll(vel);
-    for (int n=0; n < this->size(); ++n) {        
-        int nodeNo = this->nodeNo(n);
-        //std::cout << n << " " << nodeNo << std::endl;
-        if ((nodeNo >= grid.size()) || (nodeNo < 0) ){
-                std::cout << "ERROR " << std::endl;
-            
-        }
-        for (auto beta: this->beta(n)) {
-            if ( (grid.neighbor(beta, nodeNo) >= grid.size()) || (grid.neighbor(beta, nodeNo)<0) )
-            {
-                std::cout << "ERROR " << std::endl;
-            }
-            f(fieldNo, beta, grid.neighbor(beta, nodeNo)) = rho * DXQY::w[beta]*( 1.0 + DXQY::c2Inv*cu[beta] + DXQY::c4Inv0_5*(cu[beta]*cu[beta] - DXQY::c2*u_sq) );
-        }
-        for (auto delta: this->delta(n)) {
-            auto delta_rev = this->dirRev(delta);
-           if ( (grid.neighbor(delta, nodeNo) >= grid.size()) || (grid.neighbor(delta, nodeNo)<0) )
-            {
-                std::cout << "ERROR " << std::endl;
-            }
-             if ( (grid.neighbor(delta_rev, nodeNo) >= grid.size()) || (grid.neighbor(delta_rev, nodeNo)<0) )
-            {
-                std::cout << "ERROR " << std::endl;
-            }
-  
-
-
-
-            f(fieldNo, delta, grid.neighbor(delta, nodeNo)) = rho * DXQY::w[delta]*( 1.0 + DXQY::c2Inv*cu[delta] + DXQY::c4Inv0_5*(cu[delta]*cu[delta] - DXQY::c2*u_sq) );
-            f(fieldNo, delta_rev, grid.neighbor(delta_rev, nodeNo)) = rho * DXQY::w[delta_rev]*( 1.0 + DXQY::c2Inv*cu[delta_rev] + DXQY::c4Inv0_5*(cu[delta_rev]*cu[delta_rev] - DXQY::c2*u_sq) );
-        }
+    lbBase_t feq[DXQY::nQ];
+    for (int q = 0; q < DXQY::nQ; ++q)
+        feq[q] = rho * DXQY::w[q]*( 1.0 + DXQY::c2Inv*cu[q] + DXQY::c4Inv0_5*(cu[q]*cu[q] - DXQY::c2*u_sq) );
+    const int nLinks = links_.size();
+    for (int n = 0; n < nLinks; ++n) {
+        const int q = links_.qIn(n);
+        f(fieldNo, q, links_.node(n)) = feq[q];
     }
 }
 
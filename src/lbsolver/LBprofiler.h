@@ -0,0 +1,460 @@
+#ifndef LBPROFILER_H
+#define LBPROFILER_H
+
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+#include <mpi.h>
+#include "LBglobal.h"
+#include "../io/Input.h"
+
+/*********************************************************
+ * class PROFILER: wall clock time per named region, per
+ *  rank, with the min, average and max over the ranks.
+ *
+ * A region is timed by a ScopedTimer, which measures from
+ *  its construction to the end of its scope with
+ *  std::chrono::steady_clock. The library times
+ *     BndMpi::communicate   : halo exchanges
+ *     Output::write         : vtk output
+ *     <Boundary>::apply     : boundary conditions
+ *  and the main loop can add its own regions:
+ *     {
+ *         ScopedTimer timer("collision");
+ *         for (auto nodeNo: bulkNodes) {...}
+ *     }
+ *  A region that is entered again before it is left (an
+ *  apply of all fields that calls the apply of one field)
+ *  is only timed once. Times of different regions are
+ *  inclusive, so nested regions are counted in both.
+ *
+ * A timer can also be given the work of the region, the
+ *  bytes moved to and from memory and the floating point
+ *  operations, from the per node estimates in
+ *  LBkernelcost.h:
+ *     const KernelWork work = bulkNodes.size()*(KernelCost<LT>::stream() + KernelCost<LT>::bgk(true));
+ *     ScopedTimer timer("collision", work);
+ *  The report then gives the achieved GB/s and GFLOP/s of
+ *  the region, summed over the ranks, for a roofline
+ *  comparison with the STREAM bandwidth of the machine.
+ *  The halfway and interpolated bounce back give their
+ *  work themselves.
+ *
+ * The profiler is set up from the input file block
+ *     <profiling>
+ *         trace      trace.json   # optional
+ *         events     1000000      # optional, per rank
+ *         bandwidth  100          # optional, STREAM GB/s of all ranks
+ *     <end>
+ *  and the timers do nothing if the block is missing. With
+ *  a trace file, the timed regions of all ranks are written
+ *  in the Chrome trace format (chrome://tracing or
+ *  ui.perfetto.dev) by finish(...), one process per rank.
+ *
+ * In the main program (setup, report and finish are
+ *  collective):
+ *     profiler().setup(input, bulkNodes.size());
+ *     for (int i = 0; i <= nIterations; i++) {
+ *         ...
+ *         if ((i % nItrWrite) == 0)
+ *             profiler().report(i);
+ *     }
+ *     profiler().finish(nIterations);
+ * report prints the breakdown and the MLUPS since the last
+ *  report, finish since the setup. With the bandwidth, the
+ *  GB/s of each region are also given in percent of it.
+ *********************************************************/
+struct KernelWork
+{
+    double bytes;  // Bytes read and written
+    double flops;  // Floating point operations
+};
+
+inline KernelWork operator+(const KernelWork &lhs, const KernelWork &rhs) {return {lhs.bytes + rhs.bytes, lhs.flops + rhs.flops};}
+inline KernelWork operator*(const double num, const KernelWork &work) {return {num*work.bytes, num*work.flops};}
+
+
+class Profiler
+{
+public:
+    Profiler() : enabled_(false), numNodes_(0), iterStart_(0), iterLast_(0), tLast_(0), bandwidth_(0), maxEvents_(0), numDropped_(0) {}
+
+    void setup(Input &input, const long numNodes, const int iteration=0);
+    void enable(const long numNodes, const int iteration=0, const std::string &traceFile="", const long maxEvents=1000000);
+
+    inline bool enabled() const {return enabled_;}
+    int region(const std::string &name);
+    inline void begin(const int regionNo);
+    inline void end(const int regionNo);
+    inline void addWork(const int regionNo, const KernelWork &work);
+    inline void setBandwidth(const double bandwidth) {bandwidth_ = bandwidth;}
+
+    void report(const int iteration);
+    void finish(const int iteration);
+
+private:
+    struct Event
+    {
+        int regionNo;
+        double tBegin;
+        double tEnd;
+    };
+
+    inline double now() const {return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0_).count();}
+    void print(const std::string &title, const int numSteps, const double wallTime, const std::vector<double> &time, const std::vector<long> &calls,
+               const std::vector<double> &bytes, const std::vector<double> &flops) const;
+    void writeTrace() const;
+
+    bool enabled_;
+    long numNodes_;  // Fluid nodes on all ranks
+    int iterStart_;
+    int iterLast_;  // Iteration of the last report
+    std::chrono::steady_clock::time_point t0_;
+    double tLast_;  // Time of the last report
+    std::map<std::string, int> regionNo_;
+    std::vector<std::string> names_;
+    std::vector<int> depth_;  // Number of open timers per region
+    std::vector<double> tBegin_;
+    std::vector<double> time_;
+    std::vector<long> calls_;
+    std::vector<double> bytes_;
+    std::vector<double> flops_;
+    std::vector<double> timeLast_;  // Values at the last report
+    std::vector<long> callsLast_;
+    std::vector<double> bytesLast_;
+    std::vector<double> flopsLast_;
+    double bandwidth_;  // STREAM bandwidth of all ranks in GB/s, 0 if unknown
+    std::string traceFile_;
+    long maxEvents_;
+    long numDropped_;
+    std::vector<Event> events_;
+};
+
+
+inline Profiler &profiler()
+/* profiler : the profiler of this rank
+ */
+{
+    static Profiler ret;
+    return ret;
+}
+
+
+/*********************************************************
+ * class SCOPEDTIMER: times the region from construction to
+ *  the end of the scope, if the profiler is enabled.
+ *
+ * stop() ends the region early. In the library, look up
+ *  the region once:
+ *     static const int region = profiler().region("Output::write");
+ *     ScopedTimer timer(region);
+ *********************************************************/
+class ScopedTimer
+{
+public:
+    explicit ScopedTimer(const int regionNo) : regionNo_((profiler().enabled() && (regionNo >= 0)) ? regionNo : -1)
+    {
+        if (regionNo_ >= 0)
+            profiler().begin(regionNo_);
+    }
+    explicit ScopedTimer(const std::string &name) : ScopedTimer(profiler().enabled() ? profiler().region(name) : -1) {}
+    ~ScopedTimer() {stop();}
+    inline void stop()
+    /* stop : ends the region before the end of the scope
+     */
+    {
+        if (regionNo_ >= 0)
+            profiler().end(regionNo_);
+        regionNo_ = -1;
+    }
+    ScopedTimer(const int regionNo, const KernelWork &work) : ScopedTimer(regionNo)
+    {
+        if (regionNo_ >= 0)
+            profiler().addWork(regionNo_, work);
+    }
+    ScopedTimer(const std::string &name, const KernelWork &work) : ScopedTimer(profiler().enabled() ? profiler().region(name) : -1, work) {}
+    ScopedTimer(const ScopedTimer &) = delete;
+    ScopedTimer &operator=(const ScopedTimer &) = delete;
+
+private:
+    int regionNo_;
+};
+
+
+inline void Profiler::setup(Input &input, const long numNodes, const int iteration)
+/* input     : reads the profiling block, see the class comment
+ * numNodes  : fluid nodes on this rank, for the MLUPS
+ * iteration : first time step
+ */
+{
+    if (!input.contains("profiling"))
+        return;
+    const Block &block = input["profiling"];
+    const std::string traceFile = block.contains("trace") ? std::string(block["trace"]) : std::string("");
+    const long maxEvents = block.contains("events") ? static_cast<long>(static_cast<int>(block["events"])) : 1000000;
+    enable(numNodes, iteration, traceFile, maxEvents);
+    if (block.contains("bandwidth"))
+        setBandwidth(static_cast<double>(block["bandwidth"]));
+}
+
+
+inline void Profiler::enable(const long numNodes, const int iteration, const std::string &traceFile, const long maxEvents)
+/* enable : starts the clock of all ranks after a barrier, so that the trace
+ *  timelines are aligned. The times of earlier timers are discarded.
+ *
+ * iteration : first time step
+ * traceFile : Chrome trace file, no trace if empty
+ * maxEvents : maximum number of trace events on this rank; later events are dropped
+ */
+{
+    MPI_Allreduce(&numNodes, &numNodes_, 1, MPI_LONG, MPI_SUM, MPI_COMM_WORLD);
+    traceFile_ = traceFile;
+    maxEvents_ = traceFile.empty() ? 0 : maxEvents;
+    numDropped_ = 0;
+    events_.clear();
+    for (std::size_t r = 0; r < names_.size(); ++r) {
+        depth_[r] = 0;
+        time_[r] = timeLast_[r] = 0;
+        calls_[r] = callsLast_[r] = 0;
+        bytes_[r] = bytesLast_[r] = 0;
+        flops_[r] = flopsLast_[r] = 0;
+    }
+    iterStart_ = iterLast_ = iteration - 1;
+    MPI_Barrier(MPI_COMM_WORLD);
+    t0_ = std::chrono::steady_clock::now();
+    tLast_ = 0;
+    enabled_ = true;
+}
+
+
+inline int Profiler::region(const std::string &name)
+/* region : the number of the region with this name, added if it is new
+ */
+{
+    const auto ret = regionNo_.emplace(name, static_cast<int>(names_.size()));
+    if (ret.second) {
+        names_.push_back(name);
+        depth_.push_back(0);
+        tBegin_.push_back(0);
+        time_.push_back(0);
+        calls_.push_back(0);
+        bytes_.push_back(0);
+        flops_.push_back(0);
+        timeLast_.push_back(0);
+        callsLast_.push_back(0);
+        bytesLast_.push_back(0);
+        flopsLast_.push_back(0);
+    }
+    return ret.first->second;
+}
+
+
+inline void Profiler::begin(const int regionNo)
+{
+    if (depth_[regionNo]++ == 0)
+        tBegin_[regionNo] = now();
+}
+
+
+inline void Profiler::end(const int regionNo)
+{
+    if (--depth_[regionNo] > 0)
+        return;
+    const double t = now();
+    time_[regionNo] += t - tBegin_[regionNo];
+    ++calls_[regionNo];
+    if (maxEvents_ == 0)
+        return;
+    if (static_cast<long>(events_.size()) < maxEvents_)
+        events_.push_back({regionNo, tBegin_[regionNo], t});
+    else
+        ++numDropped_;
+}
+
+
+inline void Profiler::addWork(const int regionNo, const KernelWork &work)
+{
+    bytes_[regionNo] += work.bytes;
+    flops_[regionNo] += work.flops;
+}
+
+
+inline void Profiler::report(const int iteration)
+/* report : prints the time of each region and the MLUPS since the last report.
+ *  Call it after time step iteration.
+ */
+{
+    if (!enabled_)
+        return;
+    const double t = now();
+    std::vector<double> time(names_.size());
+    std::vector<long> calls(names_.size());
+    std::vector<double> bytes(names_.size()), flops(names_.size());
+    for (std::size_t r = 0; r < names_.size(); ++r) {
+        time[r] = time_[r] - timeLast_[r];
+        calls[r] = calls_[r] - callsLast_[r];
+        bytes[r] = bytes_[r] - bytesLast_[r];
+        flops[r] = flops_[r] - flopsLast_[r];
+    }
+    print("PROFILE AT ITERATION " + std::to_string(iteration), iteration - iterLast_, t - tLast_, time, calls, bytes, flops);
+    timeLast_ = time_;
+    callsLast_ = calls_;
+    bytesLast_ = bytes_;
+    flopsLast_ = flops_;
+    iterLast_ = iteration;
+    tLast_ = t;
+}
+
+
+inline void Profiler::finish(const int iteration)
+/* finish : prints the time of each region and the MLUPS since the setup, and
+ *  writes the trace file. iteration is the last time step.
+ */
+{
+    if (!enabled_)
+        return;
+    print("PROFILE TOTAL", iteration - iterStart_, now(), time_, calls_, bytes_, flops_);
+    writeTrace();
+}
+
+
+inline void Profiler::print(const std::string &title, const int numSteps, const double wallTime, const std::vector<double> &time, const std::vector<long> &calls,
+                            const std::vector<double> &bytes, const std::vector<double> &flops) const
+/* print : reduces the region times over the ranks and prints them on rank 0.
+ *  Regions are matched by name, as the ranks may have added them in different
+ *  orders, or not at all. The GB/s and GFLOP/s are the work of all ranks over
+ *  the max time.
+ */
+{
+    int myRank, nProcs;
+    MPI_Comm_rank(MPI_COMM_WORLD, &myRank);
+    MPI_Comm_size(MPI_COMM_WORLD, &nProcs);
+
+    // Names of the regions on all ranks
+    std::string local;
+    for (const auto &name: names_)
+        local += name + '\n';
+    int localSize = static_cast<int>(local.size());
+    std::vector<int> size(nProcs), offset(nProcs, 0);
+    MPI_Allgather(&localSize, 1, MPI_INT, size.data(), 1, MPI_INT, MPI_COMM_WORLD);
+    for (int p = 1; p < nProcs; ++p)
+        offset[p] = offset[p-1] + size[p-1];
+    std::string global(offset[nProcs-1] + size[nProcs-1], '\n');
+    MPI_Allgatherv(local.data(), localSize, MPI_CHAR, &global[0], size.data(), offset.data(), MPI_CHAR, MPI_COMM_WORLD);
+    std::set<std::string> allNames;
+    std::size_t pos = 0;
+    for (std::size_t next; (next = global.find('\n', pos)) != std::string::npos; pos = next + 1)
+        allNames.insert(global.substr(pos, next - pos));
+
+    const int nRegions = static_cast<int>(allNames.size());
+    std::vector<double> t(nRegions, 0), tMin(nRegions), tMax(nRegions), tSum(nRegions);
+    std::vector<long> c(nRegions, 0), cMax(nRegions);
+    std::vector<double> w(2*nRegions, 0), wSum(2*nRegions);  // Bytes and flops
+    int n = 0;
+    for (const auto &name: allNames) {
+        const auto it = regionNo_.find(name);
+        if (it != regionNo_.end()) {
+            t[n] = time[it->second];
+            c[n] = calls[it->second];
+            w[2*n] = bytes[it->second];
+            w[2*n + 1] = flops[it->second];
+        }
+        ++n;
+    }
+    double wallMax;
+    MPI_Reduce(t.data(), tMin.data(), nRegions, MPI_DOUBLE, MPI_MIN, 0, MPI_COMM_WORLD);
+    MPI_Reduce(t.data(), tMax.data(), nRegions, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+    MPI_Reduce(t.data(), tSum.data(), nRegions, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+    MPI_Reduce(c.data(), cMax.data(), nRegions, MPI_LONG, MPI_MAX, 0, MPI_COMM_WORLD);
+    MPI_Reduce(w.data(), wSum.data(), 2*nRegions, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+    MPI_Reduce(&wallTime, &wallMax, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+    if (myRank != 0)
+        return;
+
+    const double mlups = (wallMax > 0) ? 1e-6*numNodes_*numSteps/wallMax : 0;
+    std::cout << title << " : " << numSteps << " steps in " << std::fixed << std::setprecision(3) << wallMax << " s, "
+              << mlups << " MLUPS (" << numNodes_ << " nodes, " << nProcs << " ranks)" << std::endl;
+    std::cout << "    " << std::left << std::setw(28) << "region" << std::right << std::setw(10) << "calls" << std::setw(11) << "min [s]"
+              << std::setw(11) << "avg [s]" << std::setw(11) << "max [s]" << std::setw(9) << "avg [%]" << std::setw(9) << "GB/s"
+              << std::setw(9) << "GFLOP/s" << std::setw(9) << "flop/B";
+    if (bandwidth_ > 0)
+        std::cout << std::setw(9) << "bw [%]";
+    std::cout << std::endl;
+    n = 0;
+    for (const auto &name: allNames) {
+        if (cMax[n] > 0) {
+            const double tAvg = tSum[n]/nProcs;
+            std::cout << "    " << std::left << std::setw(28) << name << std::right << std::setw(10) << cMax[n] << std::setprecision(4)
+                      << std::setw(11) << tMin[n] << std::setw(11) << tAvg << std::setw(11) << tMax[n] << std::setprecision(1)
+                      << std::setw(9) << ((wallMax > 0) ? 100*tAvg/wallMax : 0);
+            if ( (wSum[2*n] + wSum[2*n + 1] > 0) && (tMax[n] > 0) ) {
+                const double gbs = 1e-9*wSum[2*n]/tMax[n];
+                std::cout << std::setprecision(2) << std::setw(9) << gbs << std::setw(9) << 1e-9*wSum[2*n + 1]/tMax[n];
+                if (wSum[2*n] > 0)
+                    std::cout << std::setw(9) << wSum[2*n + 1]/wSum[2*n];
+                else
+                    std::cout << std::setw(9) << "-";
+                if (bandwidth_ > 0)
+                    std::cout << std::setprecision(1) << std::setw(9) << 100*gbs/bandwidth_;
+            }
+            std::cout << std::endl;
+        }
+        ++n;
+    }
+    std::cout << std::defaultfloat << std::setprecision(6);
+}
+
+
+inline void Profiler::writeTrace() const
+/* writeTrace : writes the trace events of all ranks to one file, one rank at a time
+ */
+{
+    if (traceFile_.empty())
+        return;
+    int myRank, nProcs;
+    MPI_Comm_rank(MPI_COMM_WORLD, &myRank);
+    MPI_Comm_size(MPI_COMM_WORLD, &nProcs);
+    auto quoted = [](const std::string &str) {
+        std::string ret = "\"";
+        for (const auto &ch: str) {
+            if ( (ch == '"') || (ch == '\\') )
+                ret += '\\';
+            ret += ch;
+        }
+        return ret + "\"";
+    };
+
+    for (int p = 0; p < nProcs; ++p) {
+        if (p == myRank) {
+            std::ofstream ofs(traceFile_, (p == 0) ? std::ios::out : std::ios::app);
+            if (!ofs) {
+                std::cout << "ERROR in Profiler: could not open the trace file " << traceFile_ << std::endl;
+                exit(1);
+            }
+            ofs << ((p == 0) ? "{\"traceEvents\": [\n" : ",\n");
+            ofs << "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": " << myRank << ", \"tid\": 0, \"args\": {\"name\": \"rank " << myRank << "\"}}";
+            ofs << std::fixed << std::setprecision(3);
+            for (const auto &e: events_)
+                ofs << ",\n{\"name\": " << quoted(names_[e.regionNo]) << ", \"ph\": \"X\", \"pid\": " << myRank << ", \"tid\": 0, \"ts\": "
+                    << 1e6*e.tBegin << ", \"dur\": " << 1e6*(e.tEnd - e.tBegin) << "}";
+            if (p == nProcs - 1)
+                ofs << "\n], \"displayTimeUnit\": \"ms\"}\n";
+        }
+        MPI_Barrier(MPI_COMM_WORLD);
+    }
+    long numDropped;
+    MPI_Reduce(&numDropped_, &numDropped, 1, MPI_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+    if (myRank == 0) {
+        std::cout << "TRACE WRITTEN TO " << traceFile_;
+        if (numDropped > 0)
+            std::cout << " (" << numDropped << " events dropped, increase events in the profiling block)";
+        std::cout << std::endl;
+    }
+}
+
+#endif // LBPROFILER_H
@@ -0,0 +1,348 @@
+#ifndef LBRANSKEPSILON_H
+#define LBRANSKEPSILON_H
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include "LBglobal.h"
+#include "LBlatticetypes.h"
+#include "LBgrid.h"
+#include "LBfield.h"
+#include "LBwallfunction.h"
+#include "../io/Input.h"
+
+/*********************************************************
+ * class RANSKEPSILON: standard k-epsilon RANS model with
+ *  the flow, rho*k and rho*epsilon advanced in one fused
+ *  node loop.
+ *
+ * The three distributions are stored as the fields of one
+ *  LbField, so the node's values are next to each other in
+ *  memory and one BndMpi::communicateLbField(f, grid) call
+ *  exchanges all of them in one message per neighbor:
+ *     field 0 : flow
+ *     field 1 : rho*k
+ *     field 2 : rho*epsilon
+ *
+ * The model follows the RANS example (examples/rans):
+ *  - the collisions use the regularized distributions, the
+ *    projection on the zeroth to second moments, as fRegularized
+ *    in the example (turned off with regularized = false),
+ *  - the strain rate is found from the non-equilibrium second
+ *    moment of the flow distribution,
+ *  - the turbulent relaxation time is tau_t = C_mu k^2/(c_s^2 eps),
+ *    found implicitly with the half source correction of k
+ *    and epsilon,
+ *  - flow: TRT with (tau0 + tau_t, 1), Guo forcing,
+ *  - k and epsilon: advection-diffusion TRT with (1, tau_k) and
+ *    (1, tau_e), and sources P_k - eps and
+ *    eps/k (C_1 P_k - C_2 eps).
+ *
+ * All macroscopic values are computed once per node and shared
+ *  by the three collisions, and the node loop uses fixed size
+ *  arrays only.
+ *
+ * Use per time step:
+ *     rans.collideAndPropagate(bulkNodes, f, fTmp, force, rho, vel, rhoK, rhoE, viscosity, grid);
+ *     f.swapData(fTmp);
+ *     mpiBoundary.communicateLbField(f, grid);
+ *     ... boundary conditions for all three fields ...
+ *     wallFunction.update(vel);
+ *     rans.applyWallFunction(wallFunction, rho, vel, f);
+ *********************************************************/
+template <typename DXQY>
+class RansKEpsilon
+{
+public:
+    RansKEpsilon(const lbBase_t viscosity0, const lbBase_t Cmu, const lbBase_t C1epsilon, const lbBase_t C2epsilon,
+                 const lbBase_t sigma0k, const lbBase_t sigmak, const lbBase_t sigma0epsilon, const lbBase_t sigmaepsilon, const lbBase_t maxTau=0.3,
+                 const bool regularized=true);
+    RansKEpsilon(Input &input, const lbBase_t maxTau=0.3, const bool regularized=true);
+
+    template <typename S>
+    void collideAndPropagate(const std::vector<int> &bulkNodes, const LbField<DXQY, S> &f, LbField<DXQY, S> &fTmp, const VectorField<DXQY> &force,
+                             ScalarField &rho, VectorField<DXQY> &vel, ScalarField &rhoK, ScalarField &rhoE, ScalarField &viscosity,
+                             const Grid<DXQY> &grid) const;
+    template <typename S>
+    void initiate(const std::vector<int> &nodes, const lbBase_t rho0, const lbBase_t rhoK0, const lbBase_t rhoE0, LbField<DXQY, S> &f) const;
+
+    template <typename S>
+    void applyWallFunction(const WallFunction<DXQY> &wall, const ScalarField &rho, const VectorField<DXQY> &vel, LbField<DXQY, S> &f) const;
+
+    inline lbBase_t tau0() const {return tau0_;}
+
+private:
+    static void regularize(lbBase_t fN[DXQY::nQ]);
+
+    const lbBase_t tau0_;
+    const lbBase_t Cmu_;
+    const lbBase_t X1_;  // C_mu/c_s^2
+    const lbBase_t Y1_;  // 1/(4 c_s^2)
+    const lbBase_t Z1_;  // C_1 /(4 c_s^2)
+    const lbBase_t Z2_;  // C_2
+    const lbBase_t sigmakInv_;
+    const lbBase_t sigmaepsilonInv_;
+    const lbBase_t tauK0Term_;
+    const lbBase_t tauE0Term_;
+    const lbBase_t maxTau_;  // Upper limit of the turbulent relaxation time
+    const bool regularized_;  // Collide the regularized distributions
+};
+
+
+template <typename DXQY>
+RansKEpsilon<DXQY>::RansKEpsilon(const lbBase_t viscosity0, const lbBase_t Cmu, const lbBase_t C1epsilon, const lbBase_t C2epsilon,
+                                 const lbBase_t sigma0k, const lbBase_t sigmak, const lbBase_t sigma0epsilon, const lbBase_t sigmaepsilon, const lbBase_t maxTau,
+                                 const bool regularized)
+    : tau0_(DXQY::c2Inv*viscosity0 + 0.5), Cmu_(Cmu), X1_(Cmu*DXQY::c2Inv), Y1_(0.25*DXQY::c2Inv), Z1_(0.25*DXQY::c2Inv*C1epsilon), Z2_(C2epsilon),
+      sigmakInv_(1.0/sigmak), sigmaepsilonInv_(1.0/sigmaepsilon), tauK0Term_((tau0_ - 0.5)/sigma0k), tauE0Term_((tau0_ - 0.5)/sigma0epsilon),
+      maxTau_(maxTau), regularized_(regularized)
+/* viscosity0        : molecular kinematic viscosity
+ * Cmu, C1epsilon, C2epsilon : model constants
+ * sigma0k, sigmak   : Prandtl numbers for the molecular and turbulent diffusion of k
+ * sigma0epsilon, sigmaepsilon : Prandtl numbers for the molecular and turbulent diffusion of epsilon
+ * maxTau            : upper limit of the turbulent relaxation time
+ * regularized       : collide the regularized distributions, as the RANS example
+ */
+{
+}
+
+
+template <typename DXQY>
+RansKEpsilon<DXQY>::RansKEpsilon(Input &input, const lbBase_t maxTau, const bool regularized)
+    : RansKEpsilon(input["fluid"]["viscosity"],
+                   input["RANS"]["k-epsilonCoef"]["C_mu"], input["RANS"]["k-epsilonCoef"]["C_1epsilon"], input["RANS"]["k-epsilonCoef"]["C_2epsilon"],
+                   input["RANS"]["k-epsilonCoef"]["sigma_0k"], input["RANS"]["k-epsilonCoef"]["sigma_k"],
+                   input["RANS"]["k-epsilonCoef"]["sigma_0epsilon"], input["RANS"]["k-epsilonCoef"]["sigma_epsilon"], maxTau, regularized)
+/* input : uses the same keys as the RANS example
+ */
+{
+}
+
+
+template <typename DXQY>
+template <typename S>
+void RansKEpsilon<DXQY>::initiate(const std::vector<int> &nodes, const lbBase_t rho0, const lbBase_t rhoK0, const lbBase_t rhoE0, LbField<DXQY, S> &f) const
+/* initiate : sets the three fields to their rest equilibria
+ */
+{
+    for (const auto &nodeNo: nodes) {
+        for (int q = 0; q < DXQY::nQ; ++q) {
+            f(0, q, nodeNo) = DXQY::w[q]*rho0;
+            f(1, q, nodeNo) = DXQY::w[q]*rhoK0;
+            f(2, q, nodeNo) = DXQY::w[q]*rhoE0;
+        }
+    }
+}
+
+
+template <typename DXQY>
+void RansKEpsilon<DXQY>::regularize(lbBase_t fN[DXQY::nQ])
+/* regularize : replaces fN by its projection on the zeroth, first and second moments,
+ *     w_q (M + c_q.M_1/c_s^2 + (c_q c_q - c_s^2 I):(M_2 - c_s^2 M I)/(2 c_s^4)),
+ *  as fRegularized(f, 0) in examples/rans.
+ */
+{
+    constexpr int nQ = DXQY::nQ;
+    constexpr int nD = DXQY::nD;
+    lbBase_t M = 0, Mi[nD], Mij[nD*nD];
+    for (int i = 0; i < nD; ++i) {
+        Mi[i] = 0.0;
+        for (int j = 0; j < nD; ++j)
+            Mij[i + nD*j] = 0.0;
+    }
+    for (int q = 0; q < nQ; ++q) {
+        M += fN[q];
+        for (int i = 0; i < nD; ++i) {
+            Mi[i] += fN[q]*DXQY::c(q, i);
+            for (int j = 0; j < nD; ++j)
+                Mij[i + nD*j] += fN[q]*DXQY::c(q, i)*DXQY::c(q, j);
+        }
+    }
+    lbBase_t traceM = 0;
+    for (int i = 0; i < nD; ++i)
+        traceM += Mij[i + nD*i];
+    for (int q = 0; q < nQ; ++q) {
+        lbBase_t cM = 0, ccM = 0, cc = 0;
+        for (int i = 0; i < nD; ++i) {
+            cM += DXQY::c(q, i)*Mi[i];
+            cc += DXQY::c(q, i)*DXQY::c(q, i);
+            for (int j = 0; j < nD; ++j)
+                ccM += DXQY::c(q, i)*DXQY::c(q, j)*Mij[i + nD*j];
+        }
+        fN[q] = DXQY::w[q]*(M + DXQY::c2Inv*cM + DXQY::c4Inv0_5*(ccM - DXQY::c2*traceM - DXQY::c2*(cc - nD*DXQY::c2)*M));
+    }
+}
+
+
+template <typename DXQY>
+template <typename S>
+void RansKEpsilon<DXQY>::collideAndPropagate(const std::vector<int> &bulkNodes, const LbField<DXQY, S> &f, LbField<DXQY, S> &fTmp, const VectorField<DXQY> &force,
+                                             ScalarField &rho, VectorField<DXQY> &vel, ScalarField &rhoK, ScalarField &rhoE, ScalarField &viscosity,
+                                             const Grid<DXQY> &grid) const
+/* collideAndPropagate : collision of the flow, k and epsilon fields, and
+ *  propagation to fTmp, in one loop over the nodes.
+ *
+ * bulkNodes : nodes to update
+ * f, fTmp   : lb fields with 3 fields (flow, rho*k, rho*epsilon)
+ * force     : body force (field 0)
+ * rho, vel, rhoK, rhoE, viscosity : macroscopic values, set for each node (field 0)
+ */
+{
+    constexpr int nQ = DXQY::nQ;
+    constexpr int nD = DXQY::nD;
+    const lbBase_t eps = lbBaseEps;
+
+    for (const auto &nodeNo: bulkNodes) {
+        lbBase_t fN[nQ], gN[nQ], hN[nQ];
+        for (int q = 0; q < nQ; ++q) {
+            fN[q] = f(0, q, nodeNo);
+            gN[q] = f(1, q, nodeNo);
+            hN[q] = f(2, q, nodeNo);
+        }
+        if (regularized_) {
+            regularize(fN);
+            regularize(gN);
+            regularize(hN);
+        }
+
+        // Moments
+        lbBase_t rhoNode = 0, Mk = 0, Me = 0;
+        lbBase_t F[nD], u[nD];
+        for (int d = 0; d < nD; ++d) {
+            F[d] = force(0, d, nodeNo);
+            u[d] = 0.5*F[d];
+        }
+        for (int q = 0; q < nQ; ++q) {
+            rhoNode += fN[q];
+            Mk += gN[q];
+            Me += hN[q];
+            for (int d = 0; d < nD; ++d)
+                u[d] += fN[q]*DXQY::c(q, d);
+        }
+        const lbBase_t rhoInv = 1.0/rhoNode;
+        lbBase_t u2 = 0, uF = 0;
+        for (int d = 0; d < nD; ++d) {
+            u[d] *= rhoInv;
+            u2 += u[d]*u[d];
+            uF += u[d]*F[d];
+        }
+        lbBase_t cu[nQ], cF[nQ], feq[nQ];
+        for (int q = 0; q < nQ; ++q) {
+            cu[q] = DXQY::cDot(q, u);
+            cF[q] = DXQY::cDot(q, F);
+            feq[q] = DXQY::w[q]*(1.0 + DXQY::c2Inv*cu[q] + DXQY::c4Inv0_5*(cu[q]*cu[q] - DXQY::c2*u2));
+        }
+
+        // Strain rate from the non-equilibrium second moment
+        lbBase_t strain[nD*nD];
+        for (int i = 0; i < nD*nD; ++i)
+            strain[i] = 0.0;
+        for (int q = 0; q < nQ; ++q) {
+            const lbBase_t fNeq = fN[q] - rhoNode*feq[q];
+            for (int i = 0; i < nD; ++i) {
+                strain[i + nD*i] += fNeq*DXQY::c2;
+                for (int j = 0; j < nD; ++j)
+                    strain[i + nD*j] -= fNeq*DXQY::c(q, i)*DXQY::c(q, j);
+            }
+        }
+        lbBase_t SS = 0;
+        for (int i = 0; i < nD; ++i) {
+            for (int j = 0; j < nD; ++j) {
+                strain[i + nD*j] -= 0.5*(u[i]*F[j] + u[j]*F[i]);
+                SS += strain[i + nD*j]*strain[i + nD*j];
+            }
+        }
+        const lbBase_t gammaDot2 = 2*SS;
+
+        // Turbulent relaxation time and sources
+        lbBase_t rhoKNode = std::max(Mk + eps, 10*eps);
+        lbBase_t rhoENode = std::max(Me + eps, 10*eps);
+        lbBase_t tauT = std::max(rhoInv*X1_*rhoKNode*rhoKNode/rhoENode, 10*eps);
+        const lbBase_t production = rhoInv*gammaDot2*tauT/((tau0_ + tauT)*(tau0_ + tauT));
+        lbBase_t sourceK = Y1_*production - rhoENode;
+        lbBase_t sourceE = (rhoENode/rhoKNode)*(Z1_*production - Z2_*rhoENode);
+        rhoKNode = Mk + 0.5*sourceK;
+        rhoENode = Me + 0.5*sourceE;
+        if (rhoKNode < 2*eps) {
+            sourceK = -2*Mk + 2*eps;
+            rhoKNode = Mk + 0.5*sourceK;
+        }
+        if (rhoENode < 2*eps) {
+            sourceE = -2*Me + 2*eps;
+            rhoENode = Me + 0.5*sourceE;
+        }
+        tauT = std::min(std::max(rhoInv*X1_*rhoKNode*rhoKNode/rhoENode, 10*eps), maxTau_);
+        const lbBase_t tau = tau0_ + tauT;
+        const lbBase_t tauK = tauK0Term_ + 0.5 + tauT*sigmakInv_;
+        const lbBase_t tauE = tauE0Term_ + 0.5 + tauT*sigmaepsilonInv_;
+
+        rho(0, nodeNo) = rhoNode;
+        for (int d = 0; d < nD; ++d)
+            vel(0, d, nodeNo) = u[d];
+        rhoK(0, nodeNo) = rhoKNode;
+        rhoE(0, nodeNo) = rhoENode;
+        viscosity(0, nodeNo) = rhoNode*DXQY::c2*(tau - 0.5);
+
+        // Collision and propagation. Flow: TRT (tau, 1). k and epsilon: TRT (1, tau_k) and (1, tau_e)
+        const lbBase_t tauInv = 1.0/tau;
+        const lbBase_t tauKInv = 1.0/tauK;
+        const lbBase_t tauEInv = 1.0/tauE;
+        const lbBase_t forceSym = 1 - 0.5*tauInv;
+        const lbBase_t forceAntiK = (1 - 0.5*tauKInv)*rhoKNode*rhoInv;
+        const lbBase_t forceAntiE = (1 - 0.5*tauEInv)*rhoENode*rhoInv;
+        for (int q = 0; q < nQ; ++q) {
+            const int qRev = DXQY::reverseDirection(q);
+            const lbBase_t eqSym = DXQY::w[q]*(1.0 + DXQY::c4Inv0_5*(cu[q]*cu[q] - DXQY::c2*u2));
+            const lbBase_t eqAnti = DXQY::w[q]*DXQY::c2Inv*cu[q];
+            const lbBase_t wcF = DXQY::w[q]*DXQY::c2Inv*cF[q];
+
+            const lbBase_t fOut = fN[q] - tauInv*(0.5*(fN[q] + fN[qRev]) - rhoNode*eqSym) - (0.5*(fN[q] - fN[qRev]) - rhoNode*eqAnti)
+                                + 0.5*wcF + DXQY::w[q]*forceSym*DXQY::c4Inv*(cF[q]*cu[q] - DXQY::c2*uF);
+            const lbBase_t gOut = gN[q] - (0.5*(gN[q] + gN[qRev]) - rhoKNode*eqSym) - tauKInv*(0.5*(gN[q] - gN[qRev]) - rhoKNode*eqAnti)
+                                + forceAntiK*wcF + sourceK*DXQY::w[q]*(0.5 + (1 - 0.5*tauKInv)*DXQY::c2Inv*cu[q]);
+            const lbBase_t hOut = hN[q] - (0.5*(hN[q] + hN[qRev]) - rhoENode*eqSym) - tauEInv*(0.5*(hN[q] - hN[qRev]) - rhoENode*eqAnti)
+                                + forceAntiE*wcF + sourceE*DXQY::w[q]*(0.5 + (1 - 0.5*tauEInv)*DXQY::c2Inv*cu[q]);
+
+            const int neigNo = grid.neighbor(q, nodeNo);
+            fTmp(0, q, neigNo) = fOut;
+            fTmp(1, q, neigNo) = gOut;
+            fTmp(2, q, neigNo) = hOut;
+        }
+    }
+}
+
+template <typename DXQY>
+template <typename S>
+void RansKEpsilon<DXQY>::applyWallFunction(const WallFunction<DXQY> &wall, const ScalarField &rho, const VectorField<DXQY> &vel, LbField<DXQY, S> &f) const
+/* applyWallFunction : sets the k and epsilon distributions at the wall nodes to the
+ *  equilibrium of the log-layer values
+ *     k = u_tau^2/sqrt(C_mu),  epsilon = u_tau^3/(kappa y),
+ *  with the friction velocity cached in wall (call wall.update(vel) first).
+ *
+ * rho, vel : macroscopic values from collideAndPropagate (field 0)
+ * f        : lb field with 3 fields (flow, rho*k, rho*epsilon)
+ */
+{
+    const lbBase_t CmuSqrtInv = 1.0/std::sqrt(Cmu_);
+    const lbBase_t kappaInv = 1.0/wall.law().kappa();
+    for (int n = 0; n < wall.size(); ++n) {
+        const int nodeNo = wall.nodeNo(n);
+        const lbBase_t uTau = wall.frictionVelocity(n);
+        const lbBase_t rhoKWall = rho(0, nodeNo)*uTau*uTau*CmuSqrtInv;
+        const lbBase_t rhoEWall = std::max(rho(0, nodeNo)*uTau*uTau*uTau*kappaInv/wall.wallDistance(n), 10*lbBaseEps);
+        lbBase_t u[DXQY::nD];
+        lbBase_t u2 = 0;
+        for (int d = 0; d < DXQY::nD; ++d) {
+            u[d] = vel(0, d, nodeNo);
+            u2 += u[d]*u[d];
+        }
+        for (int q = 0; q < DXQY::nQ; ++q) {
+            const lbBase_t cu = DXQY::cDot(q, u);
+            const lbBase_t feq = DXQY::w[q]*(1.0 + DXQY::c2Inv*cu + DXQY::c4Inv0_5*(cu*cu - DXQY::c2*u2));
+            f(1, q, nodeNo) = rhoKWall*feq;
+            f(2, q, nodeNo) = rhoEWall*feq;
+        }
+    }
+}
+
+#endif // LBRANSKEPSILON_H
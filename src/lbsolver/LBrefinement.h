@@ -0,0 +1,259 @@
+#ifndef LBREFINEMENT_H
+#define LBREFINEMENT_H
+
+#include <algorithm>
+#include <iostream>
+#include <vector>
+#include <mpi.h>
+#include "LBglobal.h"
+#include "LBlatticetypes.h"
+#include "LBgrid.h"
+#include "LBfield.h"
+#include "LBgridtransfer.h"
+
+/*********************************************************
+ * class REFINEMENTINTERFACE: coupling of a fine, box shaped
+ *  patch to the coarser level it is nested in, with a 2:1
+ *  refinement ratio.
+ *
+ * Each level has its own Grid, Nodes and BndMpi, read from
+ *  its own vtklb files. The fine vtklb files cover only the
+ *  patch, so fine position p is at p + 2*patchOrigin on the
+ *  global fine lattice. The coarse level covers the whole
+ *  domain, patches included.
+ *
+ * Convective scaling is used, dx_f = dx_c/2 and dt_f = dt_c/2:
+ *     tau_f = 1/2 + 2 (tau_c - 1/2),   F_f = F_c/2,
+ *  with the same lattice velocity on both levels.
+ *
+ * Coupling (Dupuis-Chopard / Filippova-Haenel):
+ *  - Interface nodes, the fine fluid nodes on the faces of
+ *    the patch, are set before each fine time step to
+ *    f = feq + tau_f/(2 tau_c) fneq, from the coarse level
+ *    interpolated in space and linearly in time.
+ *  - Covered coarse nodes, whose voxel is at least one
+ *    coarse voxel inside the patch, are set from the
+ *    average of their fine nodes after the two fine steps,
+ *    with fneq scaled by 2 tau_c/tau_f.
+ *  The coupling is not mass conservative, so keep the patch
+ *  faces in regions of smooth flow.
+ *
+ * advanceRefined(...) below does the recursive sub-cycling
+ *  of a hierarchy of nested levels. Two levels:
+ *     std::vector<RefinementInterface<LT>> interfaces;
+ *     interfaces.emplace_back(gridC, bulkC, gridF, bulkF, origin, tau);
+ *     std::vector<LbField<LT> *> f = {&fC, &fF};
+ *     auto step = [&](int level) {...};
+ *     for (int i = 0; i <= nIterations; ++i)
+ *         advanceRefined(0, interfaces, f, step);
+ *********************************************************/
+template <typename DXQY>
+class RefinementInterface
+{
+public:
+    RefinementInterface(const Grid<DXQY> &coarseGrid, const std::vector<int> &coarseBulk, const Grid<DXQY> &fineGrid, const std::vector<int> &fineBulk,
+                        const std::vector<int> &patchOrigin, const lbBase_t tauCoarse);
+
+    static lbBase_t fineTau(const lbBase_t tauCoarse) {return 0.5 + 2*(tauCoarse - 0.5);}
+    lbBase_t tauFine() const {return tauFine_;}
+    const std::vector<int> &fineInterfaceNodes() const {return fineInterface_;}
+    bool hasCoarse() const {return !coarseNew_.empty();}
+
+    template <typename S>
+    void storeCoarse(const LbField<DXQY, S> &fCoarse);
+    template <typename S>
+    void setFineInterface(const lbBase_t alpha, LbField<DXQY, S> &fFine) const;
+    template <typename S>
+    void restrictToCoarse(const LbField<DXQY, S> &fFine, LbField<DXQY, S> &fCoarse) const;
+
+private:
+    static std::vector<int> findInterfaceNodes(const Grid<DXQY> &fineGrid, const std::vector<int> &fineBulk);
+    static std::vector<int> findRestrictionNodes(const Grid<DXQY> &fineGrid, const std::vector<int> &fineBulk, const std::vector<int> &fineInterface);
+    static std::vector<int> fineOffset(const std::vector<int> &patchOrigin);
+
+    const lbBase_t tauCoarse_;
+    const lbBase_t tauFine_;
+    const std::vector<int> fineInterface_;
+    GridTransfer<DXQY> interface_;  // Coarse level -> fine interface nodes
+    GridTransfer<DXQY> covered_;  // Fine nodes -> covered coarse nodes
+    std::vector<std::vector<lbBase_t>> coarseOld_;  // Coarse values at the start of the coarse step, per field
+    std::vector<std::vector<lbBase_t>> coarseNew_;  // Coarse values at the end of the coarse step, per field
+};
+
+
+template <typename DXQY>
+RefinementInterface<DXQY>::RefinementInterface(const Grid<DXQY> &coarseGrid, const std::vector<int> &coarseBulk, const Grid<DXQY> &fineGrid,
+                                               const std::vector<int> &fineBulk, const std::vector<int> &patchOrigin, const lbBase_t tauCoarse)
+    : tauCoarse_(tauCoarse), tauFine_(fineTau(tauCoarse)), fineInterface_(findInterfaceNodes(fineGrid, fineBulk)),
+      interface_(coarseGrid, coarseBulk, fineGrid, fineInterface_, 2, fineOffset(patchOrigin)),
+      covered_(coarseGrid, coarseBulk, fineGrid, findRestrictionNodes(fineGrid, fineBulk, fineInterface_), 2, fineOffset(patchOrigin))
+/* coarseGrid, coarseBulk : coarse level grid and bulk nodes on this rank
+ * fineGrid, fineBulk     : fine level (patch) grid and bulk nodes on this rank
+ * patchOrigin            : first coarse voxel covered by the patch (DXQY::nD values)
+ * tauCoarse              : relaxation time on the coarse level
+ */
+{
+}
+
+
+template <typename DXQY>
+std::vector<int> RefinementInterface<DXQY>::fineOffset(const std::vector<int> &patchOrigin)
+{
+    if (static_cast<int>(patchOrigin.size()) != DXQY::nD) {
+        std::cout << "ERROR in RefinementInterface: the patch origin must have " << DXQY::nD << " components" << std::endl;
+        exit(1);
+    }
+    std::vector<int> ret(DXQY::nD);
+    for (int d = 0; d < DXQY::nD; ++d)
+        ret[d] = 2*patchOrigin[d];
+    return ret;
+}
+
+
+template <typename DXQY>
+std::vector<int> RefinementInterface<DXQY>::findInterfaceNodes(const Grid<DXQY> &fineGrid, const std::vector<int> &fineBulk)
+/* findInterfaceNodes : fine bulk nodes with a link out of the patch, that is, to a node
+ *  that is not in the vtklb files (node number 0). Walls inside the patch are solid nodes,
+ *  and periodic directions have ghost nodes, so neither gives interface nodes.
+ */
+{
+    std::vector<int> ret;
+    for (const auto &nodeNo: fineBulk) {
+        for (int q = 0; q < DXQY::nQ; ++q) {
+            if (fineGrid.neighbor(q, nodeNo) == 0) {
+                ret.push_back(nodeNo);
+                break;
+            }
+        }
+    }
+    return ret;
+}
+
+
+template <typename DXQY>
+std::vector<int> RefinementInterface<DXQY>::findRestrictionNodes(const Grid<DXQY> &fineGrid, const std::vector<int> &fineBulk,
+                                                                 const std::vector<int> &fineInterface)
+/* findRestrictionNodes : fine bulk nodes in coarse voxels that are at least one coarse
+ *  voxel inside the patch. A patch face is an interface if some interface node has an
+ *  axis link out of the patch through it.
+ */
+{
+    constexpr int nD = DXQY::nD;
+    int local[3*nD], global[3*nD];  // Low face, high face, maximum position
+    for (int i = 0; i < 3*nD; ++i)
+        local[i] = 0;
+    for (const auto &nodeNo: fineInterface) {
+        for (int q = 0; q < DXQY::nQ; ++q) {
+            int nNonZero = 0, dir = 0;
+            for (int d = 0; d < nD; ++d)
+                if (DXQY::c(q, d) != 0) {
+                    ++nNonZero;
+                    dir = d;
+                }
+            if ( (nNonZero == 1) && (fineGrid.neighbor(q, nodeNo) == 0) )
+                local[(DXQY::c(q, dir) < 0) ? dir : nD + dir] = 1;
+        }
+    }
+    for (const auto &nodeNo: fineBulk)
+        for (int d = 0; d < nD; ++d)
+            local[2*nD + d] = std::max(local[2*nD + d], fineGrid.pos(nodeNo, d));
+    MPI_Allreduce(local, global, 3*nD, MPI_INT, MPI_MAX, MPI_COMM_WORLD);
+
+    int lo[nD], hi[nD];  // Range of covered coarse voxels, relative to the patch origin
+    for (int d = 0; d < nD; ++d) {
+        lo[d] = global[d] ? 1 : -1;
+        hi[d] = global[nD + d] ? global[2*nD + d]/2 - 1 : global[2*nD + d];
+    }
+    std::vector<int> ret;
+    for (const auto &nodeNo: fineBulk) {
+        bool inside = true;
+        for (int d = 0; d < nD; ++d) {
+            const int c = fineGrid.pos(nodeNo, d)/2;
+            inside = inside && (c >= lo[d]) && (c <= hi[d]);
+        }
+        if (inside)
+            ret.push_back(nodeNo);
+    }
+    return ret;
+}
+
+
+template <typename DXQY>
+template <typename S>
+void RefinementInterface<DXQY>::storeCoarse(const LbField<DXQY, S> &fCoarse)
+/* storeCoarse : stores the coarse values around the fine interface nodes. Call it once
+ *  before the first coarse time step, and then at the end of each coarse time step; the
+ *  values of the previous call are kept as the start of the step for the time interpolation.
+ */
+{
+    const int numFields = fCoarse.num_fields();
+    coarseOld_.swap(coarseNew_);
+    coarseNew_.resize(numFields);
+    for (int fieldNo = 0; fieldNo < numFields; ++fieldNo)
+        coarseNew_[fieldNo] = interface_.gatherCoarse(fieldNo, fCoarse);
+}
+
+
+template <typename DXQY>
+template <typename S>
+void RefinementInterface<DXQY>::setFineInterface(const lbBase_t alpha, LbField<DXQY, S> &fFine) const
+/* setFineInterface : sets the fine interface nodes from the coarse values at time
+ *  t + alpha dt_c, where t and t + dt_c are the two last calls to storeCoarse
+ */
+{
+    if (coarseOld_.size() != coarseNew_.size()) {
+        std::cout << "ERROR in RefinementInterface: call storeCoarse before the first coarse step and at the end of each coarse step" << std::endl;
+        exit(1);
+    }
+    for (int fieldNo = 0; fieldNo < fFine.num_fields(); ++fieldNo) {
+        const auto &vOld = coarseOld_[fieldNo];
+        const auto &vNew = coarseNew_[fieldNo];
+        std::vector<lbBase_t> val(vOld.size());
+        for (size_t i = 0; i < val.size(); ++i)
+            val[i] = (1 - alpha)*vOld[i] + alpha*vNew[i];
+        interface_.interpolateToFine(fieldNo, val, tauCoarse_, tauFine_, 1.0, fFine);
+    }
+}
+
+
+template <typename DXQY>
+template <typename S>
+void RefinementInterface<DXQY>::restrictToCoarse(const LbField<DXQY, S> &fFine, LbField<DXQY, S> &fCoarse) const
+/* restrictToCoarse : sets the covered coarse nodes from the fine level
+ */
+{
+    for (int fieldNo = 0; fieldNo < fFine.num_fields(); ++fieldNo)
+        covered_.toCoarse(fieldNo, tauFine_, tauCoarse_, 1.0, fFine, fCoarse);
+}
+
+
+template <typename DXQY, typename S, typename T>
+void advanceRefined(const int level, std::vector<RefinementInterface<DXQY>> &interfaces, const std::vector<LbField<DXQY, S> *> &f, T &step)
+/* advanceRefined : advances level one time step, and each finer level two time steps
+ *  per step of its parent level (recursive sub-cycling).
+ *
+ * interfaces : interfaces[l] couples level l to level l + 1
+ * f          : f[l] is the lb field of level l
+ * step       : step(l) does one full time step on level l (collision, propagation, mpi
+ *              and boundary conditions), with the relaxation time and force of that level.
+ *
+ * In the main loop:
+ *     advanceRefined(0, interfaces, f, step);
+ */
+{
+    const bool hasFiner = level < static_cast<int>(interfaces.size());
+    if ( hasFiner && !interfaces[level].hasCoarse() )
+        interfaces[level].storeCoarse(*f[level]);
+    step(level);
+    if (!hasFiner)
+        return;
+    // One gather per coarse step: the end values are the start values of the next step
+    interfaces[level].storeCoarse(*f[level]);
+    for (int sub = 0; sub < 2; ++sub) {
+        interfaces[level].setFineInterface(0.5*sub, *f[level + 1]);
+        advanceRefined(level + 1, interfaces, f, step);
+    }
+    interfaces[level].restrictToCoarse(*f[level + 1], *f[level]);
+}
+
+#endif // LBREFINEMENT_H
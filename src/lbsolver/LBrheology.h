@@ -5,6 +5,7 @@
 #include <iostream>
 #include <fstream>
 #include <algorithm>
+#include <array>
 #include "../lbsolver/LBglobal.h"
 
 
@@ -28,6 +29,14 @@ class Newtonian
  *
  * omegaBGK(f, rho, u, u_sq, cu, force, source)
  *     returns the BKG collision term 
+ *
+ * tau(tauIn, rho, strainRateTildeLowTri, u, force, source)
+ *     sets tau, the viscosity and all the strain rate diagnostics from a precomputed
+ *     strain rate (calcStrainRateTildeLowTri), e.g. the one used by calcOmegaRegularized
+ *
+ * omega(collision, tauIn, f, rho, u, u_sq, cu, force, source)
+ *     returns the collision term of a moment space ``collision`` object
+ *     (see LBcollisionmoment.h), including the force
  */ 
 {
 public:
@@ -41,6 +50,16 @@ public:
                                      const std::valarray<lbBase_t> &cu,
                                      const T3 &force,
                                      const lbBase_t &source);
+    template <typename C, typename T1, typename T2, typename T3>
+    std::array<lbBase_t, DXQY::nQ> omega(const C &collision,
+                                  const lbBase_t& tauIn,
+                                  const T1 &f,
+                                  const lbBase_t& rho,
+                                  const T2 &u,
+                                  const lbBase_t& u_sq,
+                                  const std::valarray<lbBase_t> &cu,
+                                  const T3 &force,
+                                  const lbBase_t &source);
     inline lbBase_t tau() const {
         return tau_;
     }
@@ -48,6 +67,13 @@ public:
       tau_=tauIn;
       return tau_;
     }
+    template <typename T1, typename T2>
+    lbBase_t tau(const lbBase_t& tauIn,
+                 const lbBase_t& rho,
+                 const std::valarray<lbBase_t> &strainRateTildeLowTri,
+                 const T1 &u,
+                 const T2 &force,
+                 const lbBase_t &source);
     inline lbBase_t viscosity() const {
         return visc_;
     }
@@ -70,6 +96,17 @@ public:
         return E00_2_;
     }
 private:
+    template <typename T1, typename T2, typename T3>
+    void updateTau(const lbBase_t& tauIn,
+                   const T1 &f,
+                   const lbBase_t& rho,
+                   const T2 &u,
+                   const lbBase_t& u_sq,
+                   const std::valarray<lbBase_t> &cu,
+                   const T3 &force,
+                   const lbBase_t &source,
+                   std::array<lbBase_t, DXQY::nQ> &feq);
+
     lbBase_t tau_;
     lbBase_t visc_;
     lbBase_t gammaDot_;
@@ -156,29 +193,40 @@ std::valarray<lbBase_t> Newtonian<DXQY>::omegaBGK(
  *     The BGK collision operator
  */ 
 {
-    
-    std::valarray<lbBase_t> feq(DXQY::nQ);
-    std::valarray<lbBase_t> strain_rate_tilde(0.0, DXQY::nD * DXQY::nD);
+    std::array<lbBase_t, DXQY::nQ> feq;
+    updateTau(tauIn, f, rho, u, u_sq, cu, F, source, feq);
+
+    const lbBase_t tau_inv = 1.0/tau_;
+    std::valarray<lbBase_t> omega(DXQY::nQ);
+    for (int q=0; q < DXQY::nQ; ++q)
+    {
+        omega[q] = -tau_inv*(f[q] - feq[q]); 
+    }
+        
+    return omega;
+}
+
+
+template <typename DXQY>
+template <typename T1, typename T2, typename T3>
+void Newtonian<DXQY>::updateTau(const lbBase_t& tauIn,
+                                const T1 &f,
+                                const lbBase_t& rho,
+                                const T2 &u,
+                                const lbBase_t& u_sq,
+                                const std::valarray<lbBase_t> &cu,
+                                const T3 &F,
+                                const lbBase_t &source,
+                                std::array<lbBase_t, DXQY::nQ> &feq)
+/* Sets tau, the viscosity and the strain rate diagnostics, as used by ``omegaBGK``
+ * and ``omega``, and returns the equilibrium distribution in feq.
+ */
+{
+    std::array<lbBase_t, DXQY::nD*DXQY::nD> strain_rate_tilde;
+    strain_rate_tilde.fill(0.0);
 
     tau_ = tauIn;
-    
 
-    
-    /*
-    for (int q = 0; q < DXQY::nQ; ++q)
-    {
-        feq[q] = DXQY::w[q]*rho*(1.0 + DXQY::c2Inv*cu[q] + DXQY::c4Inv0_5*(cu[q]*cu[q] - DXQY::c2*u_sq));        
-        for (int i=0; i < DXQY::nD; ++i)
-        {
-            strain_rate_tilde[i + DXQY::nD*i] -=  (f[q] - feq[q])*(DXQY::c(q, i)*DXQY::c(q, i) - DXQY::c2);
-            for (int j = i+1; j < DXQY::nD; ++j)
-            {
-                strain_rate_tilde[i + DXQY::nD*j] -=  (f[q] - feq[q])*DXQY::c(q, i)*DXQY::c(q, j);
-            }            
-        }
-    } 
-    */
-    
     for (int q = 0; q < DXQY::nQ; ++q)
     {
       feq[q] = DXQY::w[q]*rho*( 1.0 + DXQY::c2Inv*cu[q] + DXQY::c4Inv0_5 * (cu[q]*cu[q] - DXQY::c2*u_sq) );        
@@ -193,32 +241,7 @@ std::valarray<lbBase_t> Newtonian<DXQY>::omegaBGK(
     }
 
     E00_2_=   strain_rate_tilde[0];
-   
-    
-    
 
-    /*
-    lbBase_t strain_rate_tilde_square = 0;    
-    for (int i=0; i < DXQY::nD; ++i)
-    {
-        strain_rate_tilde[i + DXQY::nD*i] -= (u[i]*F[i]);
-        strain_rate_tilde[i + DXQY::nD*i] -= 0.5*(u_sq + DXQY::c2)*source;
-        // Strain rate calculation
-        strain_rate_tilde_square += strain_rate_tilde[i + DXQY::nD*i]*strain_rate_tilde[i + DXQY::nD*i];
-        for (int j = i+1; j < DXQY::nD; ++j)
-        {
-            strain_rate_tilde[i + DXQY::nD*j] -= 0.5*(u[i]*F[j] + u[j]*F[i]);
-            strain_rate_tilde[i + DXQY::nD*j] -= 0.5*u[i]*u[j]*source;
-            // Strain rate calculation
-            strain_rate_tilde_square += 2*strain_rate_tilde[i + DXQY::nD*j]*strain_rate_tilde[i + DXQY::nD*j];
-        }
-	//Extra calculation for preliminary strain_rate_tilde_cubed
-	for (int j = 0; j < i; ++j){
-	    strain_rate_tilde[i + DXQY::nD*j]=strain_rate_tilde[j + DXQY::nD*i];
-	}
-	  
-    } 
-    */
     lbBase_t strain_rate_tilde_square = 0;    
     for (int i=0; i < DXQY::nD; ++i)
     {
@@ -231,13 +254,8 @@ std::valarray<lbBase_t> Newtonian<DXQY>::omegaBGK(
             strain_rate_tilde_square += strain_rate_tilde[i + DXQY::nD*j]*strain_rate_tilde[i + DXQY::nD*j];
         } 
     }
-    
-   
-    //-----------Uferdig---------------
-      
- 
-    lbBase_t strain_rate_tilde_cubed = 0;  
 
+    lbBase_t strain_rate_tilde_cubed = 0;  
     for (int i=0; i < DXQY::nD; ++i)
     {
         for (int j = 0; j < DXQY::nD; ++j)
@@ -248,8 +266,7 @@ std::valarray<lbBase_t> Newtonian<DXQY>::omegaBGK(
 		strain_rate_tilde_cubed += strain_rate_tilde[i + DXQY::nD*j]*strain_rate_tilde[j + DXQY::nD*k]*strain_rate_tilde[i + DXQY::nD*k];
 	      }
 	}
-    } //-----------Uferdig---------------Slutt
- 
+    }
 
     visc_ = rho*DXQY::c2*(tau_-0.5);
     
@@ -268,15 +285,117 @@ std::valarray<lbBase_t> Newtonian<DXQY>::omegaBGK(
     
     E00_ = strain_rate_tilde[0];
     E01_ = strain_rate_tilde[1];
-    
-    std::valarray<lbBase_t> omega(DXQY::nQ);
-    
-    for (int q=0; q < DXQY::nQ; ++q)
-    {
-        omega[q] = -tau_inv*(f[q] - feq[q]); 
+}
+
+
+template <typename DXQY>
+template <typename T1, typename T2>
+lbBase_t Newtonian<DXQY>::tau(const lbBase_t& tauIn,
+                              const lbBase_t& rho,
+                              const std::valarray<lbBase_t> &strainRateTildeLowTri,
+                              const T1 &u,
+                              const T2 &F,
+                              const lbBase_t &source)
+/* Sets tau, the viscosity and the strain rate diagnostics from a precomputed strain rate
+ *
+ * Gives the same values as ``omegaBGK``, but reuses the lower triangular strain rate 
+ * returned by calcStrainRateTildeLowTri (LBmacroscopic.h), so that it can be shared with
+ * the regularized collision operators. All the diagnostics (viscosity, gammaDot, epsilonDot,
+ * trE, E00, E01 and E00_2) are set, so they refer to the same node after the call.
+ *
+ * Parameters
+ * ----------
+ * tauIn : float-like
+ *     relaxation time
+ *
+ * rho : float-like
+ *     fluid density
+ *
+ * strainRateTildeLowTri : valarray, size = [DXQY::nD*(DXQY::nD+1)/2]
+ *     LB strain rate, without 1/(2*rho*c2*tau)
+ *
+ * u : array-like, size = [DXQY::nD]
+ *     fluid velocity
+ *
+ * F : array-like, size = [DXQY::nD]
+ *     body force
+ *
+ * source :  float-like
+ *     bulk fluid source
+ *
+ * Returns
+ * -------
+ * lbBase_t
+ *     the relaxation time
+ */
+{
+    tau_ = tauIn;
+    visc_ = rho*DXQY::c2*(tau_-0.5);
+
+    std::valarray<lbBase_t> E(DXQY::nD*DXQY::nD);
+    int it = 0;
+    for (int i = 0; i < DXQY::nD; ++i) {
+        for (int j = 0; j <= i; ++j) {
+            E[i + DXQY::nD*j] = strainRateTildeLowTri[it];
+            E[j + DXQY::nD*i] = strainRateTildeLowTri[it];
+            it++;
+        }
     }
-        
-    return omega;
+
+    const lbBase_t strain_rate_tilde_square = DXQY::contractionLowTri(strainRateTildeLowTri, strainRateTildeLowTri);
+    lbBase_t strain_rate_tilde_cubed = 0;
+    for (int i=0; i < DXQY::nD; ++i)
+        for (int j = 0; j < DXQY::nD; ++j)
+            for (int k = 0; k < DXQY::nD; ++k)
+                strain_rate_tilde_cubed += E[i + DXQY::nD*j]*E[j + DXQY::nD*k]*E[i + DXQY::nD*k];
+
+    const lbBase_t tau_inv = 1.0/tau_;
+    gammaDot_= sqrt(2*strain_rate_tilde_square)/(2*rho)*tau_inv*DXQY::c2Inv;
+    epsilonDot_ = 2/(2*rho)*tau_inv*DXQY::c2Inv*strain_rate_tilde_cubed/strain_rate_tilde_square;
+    trE_ = DXQY::traceLowTri(strainRateTildeLowTri)/(2*rho)*tau_inv*DXQY::c2Inv;
+    E00_ = E[0];
+    E01_ = E[1];
+    // E00 without the force and source corrections, as in omegaBGK
+    E00_2_ = E[0] + u[0]*F[0] + 0.5*(DXQY::c2 + u[0]*u[0])*source;
+
+    return tau_;
+}
+
+template <typename DXQY>
+template <typename C, typename T1, typename T2, typename T3>
+std::array<lbBase_t, DXQY::nQ> Newtonian<DXQY>::omega(
+                                 const C &collision,
+                                 const lbBase_t& tauIn,
+                                 const T1 &f,
+                                 const lbBase_t& rho,
+                                 const T2 &u,
+                                 const lbBase_t& u_sq,
+                                 const std::valarray<lbBase_t> &cu,
+                                 const T3 &F,
+                                 const lbBase_t &source)
+/* Returns the collision term of a moment space collision operator
+ *
+ * The relaxation time and the strain rate diagnostics are calculated as in
+ * ``omegaBGK``, and the relaxation time is then handed to ``collision``
+ * (MRTCollision, CentralMomentCollision or CumulantCollision), which relaxes
+ * the shear moments with it. Note that, unlike ``omegaBGK``, the returned
+ * term includes the forcing term, so no separate deltaOmegaF should be added.
+ *
+ * Parameters
+ * ----------
+ * collision : moment space collision object
+ *
+ * see ``omegaBGK`` for the remaining parameters
+ *
+ * Returns
+ * -------
+ * array, size = [DXQY::nQ]
+ *     The collision operator including the force
+ */
+{
+    std::array<lbBase_t, DXQY::nQ> feq;
+    updateTau(tauIn, f, rho, u, u_sq, cu, F, source, feq);
+    return collision.omega(f, tau_, rho, u, F);
 }
 
 //-------------------------------------------------------
@@ -298,6 +417,13 @@ class GeneralizedNewtonian
  * 
  * omegaBGK(f, rho, u, u_sq, cu, force, source)
  *     returns the BKG collision term 
+ *
+ * tau(rho, strainRateTildeLowTri)
+ *     looks up tau from a precomputed strain rate (calcStrainRateTildeLowTri)
+ *
+ * omega(collision, f, rho, u, u_sq, cu, force, source)
+ *     returns the collision term of a moment space ``collision`` object
+ *     (see LBcollisionmoment.h), including the force
  */ 
 {
 public:
@@ -310,9 +436,19 @@ public:
                                      const std::valarray<lbBase_t> &cu,
                                      const T3 &force,
                                      const lbBase_t &source);
+    template <typename C, typename T1, typename T2, typename T3>
+    std::array<lbBase_t, DXQY::nQ> omega(const C &collision,
+                                  const T1 &f,
+                                  const lbBase_t& rho,
+                                  const T2 &u,
+                                  const lbBase_t& u_sq,
+                                  const std::valarray<lbBase_t> &cu,
+                                  const T3 &force,
+                                  const lbBase_t &source);
     inline lbBase_t tau() const {
         return tau_;
     }
+    lbBase_t tau(const lbBase_t& rho, const std::valarray<lbBase_t> &strainRateTildeLowTri);
     inline lbBase_t viscosity() const {
         return visc_;
     }
@@ -326,6 +462,16 @@ public:
         }
     }
 private:
+    template <typename T1, typename T2, typename T3>
+    void updateTau(const T1 &f,
+                   const lbBase_t& rho,
+                   const T2 &u,
+                   const lbBase_t& u_sq,
+                   const std::valarray<lbBase_t> &cu,
+                   const T3 &force,
+                   const lbBase_t &source,
+                   std::array<lbBase_t, DXQY::nQ> &feq);
+
     lbBase_t tau_;
     lbBase_t visc_;
     lbBase_t gammaDot_;
@@ -427,8 +573,36 @@ std::valarray<lbBase_t> GeneralizedNewtonian<DXQY>::omegaBGK(
  *     The BGK collision operator
  */ 
 {
-    std::valarray<lbBase_t> feq(DXQY::nQ);
-    std::valarray<lbBase_t> strain_rate_tilde(0.0, DXQY::nD * DXQY::nD);
+    std::array<lbBase_t, DXQY::nQ> feq;
+    updateTau(f, rho, u, u_sq, cu, F, source, feq);
+
+    const lbBase_t tau_inv = 1.0/tau_;
+    std::valarray<lbBase_t> omega(DXQY::nQ);
+    for (int q=0; q < DXQY::nQ; ++q)
+    {
+        omega[q] = -tau_inv*(f[q] - feq[q]); 
+    }
+        
+    return omega;
+}
+
+
+template <typename DXQY>
+template <typename T1, typename T2, typename T3>
+void GeneralizedNewtonian<DXQY>::updateTau(const T1 &f,
+                                           const lbBase_t& rho,
+                                           const T2 &u,
+                                           const lbBase_t& u_sq,
+                                           const std::valarray<lbBase_t> &cu,
+                                           const T3 &F,
+                                           const lbBase_t &source,
+                                           std::array<lbBase_t, DXQY::nQ> &feq)
+/* Looks up tau and sets the viscosity and gammaDot, as used by ``omegaBGK`` and
+ * ``omega``, and returns the equilibrium distribution in feq.
+ */
+{
+    std::array<lbBase_t, DXQY::nD*DXQY::nD> strain_rate_tilde;
+    strain_rate_tilde.fill(0.0);
  
     for (int q = 0; q < DXQY::nQ; ++q)
     {
@@ -467,14 +641,78 @@ std::valarray<lbBase_t> GeneralizedNewtonian<DXQY>::omegaBGK(
 
     auto tau_inv = 1.0/tau_;
     gammaDot_= sqrt(2*strain_rate_tilde_square)/(2*rho)*tau_inv*DXQY::c2Inv;
-    
-    std::valarray<lbBase_t> omega(DXQY::nQ);
-    for (int q=0; q < DXQY::nQ; ++q)
-    {
-        omega[q] = -tau_inv*(f[q] - feq[q]); 
-    }
-        
-    return omega;
+}
+
+
+template <typename DXQY>
+lbBase_t GeneralizedNewtonian<DXQY>::tau(const lbBase_t& rho, const std::valarray<lbBase_t> &strainRateTildeLowTri)
+/* Looks up tau from a precomputed strain rate
+ *
+ * Same lookup as in ``omegaBGK``, but reuses the lower triangular strain rate returned by 
+ * calcStrainRateTildeLowTri (LBmacroscopic.h), e.g. in combination with calcOmegaRegularized.
+ * Sets all the diagnostics (tau, viscosity and gammaDot), as ``omegaBGK`` does. The values
+ * agree with ``omegaBGK`` when there is no mass source. With a source, ``omegaBGK`` corrects
+ * the diagonal with 0.5*u_sq*source, while calcStrainRateTildeLowTri uses
+ * 0.5*(c2 + u_i u_i)*source, as Newtonian does.
+ *
+ * Parameters
+ * ----------
+ * rho : float-like
+ *     fluid density
+ *
+ * strainRateTildeLowTri : valarray, size = [DXQY::nD*(DXQY::nD+1)/2]
+ *     LB strain rate, without 1/(2*rho*c2*tau)
+ *
+ * Returns
+ * -------
+ * lbBase_t
+ *     the relaxation time
+ */
+{
+    const lbBase_t strain_rate_tilde_square = DXQY::contractionLowTri(strainRateTildeLowTri, strainRateTildeLowTri);
+
+    // Lookup viscosity value
+    auto upper = std::upper_bound(tabular_strain_rate_.begin()+1, tabular_strain_rate_.end()-1, strain_rate_tilde_square);
+    auto i = std::distance(tabular_strain_rate_.begin()+1, upper);
+    visc_ = (tabular_viscosity_[i+1] - tabular_viscosity_[i])*(strain_rate_tilde_square - tabular_strain_rate_[i])/(tabular_strain_rate_[i+1] - tabular_strain_rate_[i]) + tabular_viscosity_[i];
+    tau_ = visc_*DXQY::c2Inv/rho + 0.5;
+
+    gammaDot_= sqrt(2*strain_rate_tilde_square)/(2*rho)/tau_*DXQY::c2Inv;
+
+    return tau_;
+}
+
+template <typename DXQY>
+template <typename C, typename T1, typename T2, typename T3>
+std::array<lbBase_t, DXQY::nQ> GeneralizedNewtonian<DXQY>::omega(
+                                 const C &collision,
+                                 const T1 &f,
+                                 const lbBase_t& rho,
+                                 const T2 &u,
+                                 const lbBase_t& u_sq,
+                                 const std::valarray<lbBase_t> &cu,
+                                 const T3 &F,
+                                 const lbBase_t &source)
+/* Returns the collision term of a moment space collision operator
+ *
+ * The strain rate dependent relaxation time is looked up as in ``omegaBGK``
+ * and handed to ``collision``. The returned term includes the forcing term.
+ *
+ * Parameters
+ * ----------
+ * collision : moment space collision object
+ *
+ * see ``omegaBGK`` for the remaining parameters
+ *
+ * Returns
+ * -------
+ * array, size = [DXQY::nQ]
+ *     The collision operator including the force
+ */
+{
+    std::array<lbBase_t, DXQY::nQ> feq;
+    updateTau(f, rho, u, u_sq, cu, F, source, feq);
+    return collision.omega(f, tau_, rho, u, F);
 }
 
 
@@ -0,0 +1,225 @@
+#ifndef LBRIGIDBODY_H
+#define LBRIGIDBODY_H
+
+#include <cmath>
+#include <iostream>
+#include <valarray>
+#include "LBglobal.h"
+
+/*********************************************************
+ * class RIGIDBODY: six degrees of freedom rigid body
+ *
+ * State:
+ *  - position X and velocity U of the center of mass (world frame)
+ *  - orientation as a unit quaternion (w, x, y, z), rotating
+ *    body frame vectors into the world frame
+ *  - angular velocity omega in the body frame
+ *
+ * The inertia tensor is given by its principal values in the
+ *  body frame. All vectors have three components, also in 2D
+ *  where the motion can be restricted with setFreedom(...).
+ *
+ * step(...) integrates one LB time step with the force and
+ *  torque held constant over the step. The step can be split
+ *  into sub-steps. Translation uses velocity Verlet, which is
+ *  exact for a constant force. The Euler equations
+ *     I dw/dt = tau - w x (I w)
+ *  are integrated with RK4, and the quaternion is rotated
+ *  by the mean angular velocity over each sub-step.
+ *
+ * Example, coupled to the MovingBoundary class:
+ *     auto ft = movingBnd.forceAndTorque();  // one reduction
+ *     body.step(ft, nSubSteps);
+ *     movingBnd.update(shape, nodes, grid);
+ *     movingBnd.apply(0, f, grid, body.position(), body.velocity(), body.omegaWorld());
+ *********************************************************/
+class RigidBody
+{
+public:
+    RigidBody(const lbBase_t mass, const std::valarray<lbBase_t> &inertia, const std::valarray<lbBase_t> &position);
+
+    void setFreedom(const std::valarray<lbBase_t> &translation, const std::valarray<lbBase_t> &rotation);
+    void setVelocity(const std::valarray<lbBase_t> &velocity) {velocity_ = velocity*linFree_;}
+    void setOmegaWorld(const std::valarray<lbBase_t> &omega) {omega_ = toBodyFrame(omega)*angFree_;}
+    void setExternalForce(const std::valarray<lbBase_t> &force) {externalForce_ = force;}
+
+    void step(const std::valarray<lbBase_t> &force, const std::valarray<lbBase_t> &torque, const lbBase_t dt=1.0, const int nSubSteps=1);
+    void step(const std::valarray<lbBase_t> &forceTorque, const int nSubSteps=1);
+
+    inline const std::valarray<lbBase_t> & position() const {return position_;}
+    inline const std::valarray<lbBase_t> & velocity() const {return velocity_;}
+    inline const std::valarray<lbBase_t> & omega() const {return omega_;}
+    inline std::valarray<lbBase_t> omegaWorld() const {return toWorldFrame(omega_);}
+    inline const std::valarray<lbBase_t> & quaternion() const {return quat_;}
+    inline std::valarray<lbBase_t> toWorldFrame(const std::valarray<lbBase_t> &v) const {return rotate(quat_, v, 1.0);}
+    inline std::valarray<lbBase_t> toBodyFrame(const std::valarray<lbBase_t> &v) const {return rotate(quat_, v, -1.0);}
+    std::valarray<lbBase_t> bodyPosition(const std::valarray<lbBase_t> &worldPos) const;
+    inline lbBase_t mass() const {return mass_;}
+    inline const std::valarray<lbBase_t> & inertia() const {return inertia_;}
+    std::valarray<lbBase_t> state() const;
+    void setState(const std::valarray<lbBase_t> &state);
+
+private:
+    static std::valarray<lbBase_t> rotate(const std::valarray<lbBase_t> &q, const std::valarray<lbBase_t> &v, const lbBase_t sign);
+    static std::valarray<lbBase_t> cross(const std::valarray<lbBase_t> &a, const std::valarray<lbBase_t> &b);
+    inline std::valarray<lbBase_t> angularAcceleration(const std::valarray<lbBase_t> &w, const std::valarray<lbBase_t> &torqueBody) const;
+
+    lbBase_t mass_;
+    std::valarray<lbBase_t> inertia_;  // Principal moments of inertia (body frame)
+    std::valarray<lbBase_t> position_;  // Center of mass (world frame)
+    std::valarray<lbBase_t> velocity_;  // Center of mass velocity (world frame)
+    std::valarray<lbBase_t> quat_;  // Orientation (w, x, y, z)
+    std::valarray<lbBase_t> omega_;  // Angular velocity (body frame)
+    std::valarray<lbBase_t> linFree_;  // 1 for free, 0 for fixed translation (world frame)
+    std::valarray<lbBase_t> angFree_;  // 1 for free, 0 for fixed rotation (body frame)
+    std::valarray<lbBase_t> externalForce_;  // For instance gravity and buoyancy (world frame)
+};
+
+
+inline RigidBody::RigidBody(const lbBase_t mass, const std::valarray<lbBase_t> &inertia, const std::valarray<lbBase_t> &position)
+    : mass_(mass), inertia_(inertia), position_(position), velocity_(0.0, 3), quat_{1.0, 0.0, 0.0, 0.0}, omega_(0.0, 3),
+      linFree_(1.0, 3), angFree_(1.0, 3), externalForce_(0.0, 3)
+/* mass     : body mass
+ * inertia  : principal moments of inertia (3 components)
+ * position : initial center of mass (3 components)
+ */
+{
+    if ((mass_ <= 0) || (inertia_.size() != 3) || (position_.size() != 3)) {
+        std::cout << "Error in RigidBody: mass must be positive, and inertia and position must have 3 components." << std::endl;
+        exit(1);
+    }
+}
+
+
+inline void RigidBody::setFreedom(const std::valarray<lbBase_t> &translation, const std::valarray<lbBase_t> &rotation)
+/* setFreedom : sets which degrees of freedom that are integrated.
+ *  For a 2D simulation use translation = {1, 1, 0} and rotation = {0, 0, 1}.
+ */
+{
+    linFree_ = translation;
+    angFree_ = rotation;
+    velocity_ *= linFree_;
+    omega_ *= angFree_;
+}
+
+
+inline std::valarray<lbBase_t> RigidBody::cross(const std::valarray<lbBase_t> &a, const std::valarray<lbBase_t> &b)
+{
+    return std::valarray<lbBase_t>{a[1]*b[2] - a[2]*b[1], a[2]*b[0] - a[0]*b[2], a[0]*b[1] - a[1]*b[0]};
+}
+
+
+inline std::valarray<lbBase_t> RigidBody::rotate(const std::valarray<lbBase_t> &q, const std::valarray<lbBase_t> &v, const lbBase_t sign)
+/* rotate : rotates v by the quaternion q (sign = 1), or its conjugate (sign = -1)
+ */
+{
+    const std::valarray<lbBase_t> u{sign*q[1], sign*q[2], sign*q[3]};
+    const std::valarray<lbBase_t> t = 2.0*cross(u, v);
+    return v + q[0]*t + cross(u, t);
+}
+
+
+inline std::valarray<lbBase_t> RigidBody::bodyPosition(const std::valarray<lbBase_t> &worldPos) const
+/* bodyPosition : position relative to the center of mass in the body frame.
+ *  Useful when the body shape is given in the body frame.
+ *
+ * worldPos : position with 2 or 3 components
+ */
+{
+    std::valarray<lbBase_t> r(0.0, 3);
+    for (std::size_t d = 0; d < worldPos.size(); ++d)
+        r[d] = worldPos[d] - position_[d];
+    return toBodyFrame(r);
+}
+
+
+inline std::valarray<lbBase_t> RigidBody::state() const
+/* state : position, velocity, quaternion and body angular velocity (13 values).
+ *  Used to send a body to another process.
+ */
+{
+    std::valarray<lbBase_t> ret(13);
+    ret[std::slice(0, 3, 1)] = position_;
+    ret[std::slice(3, 3, 1)] = velocity_;
+    ret[std::slice(6, 4, 1)] = quat_;
+    ret[std::slice(10, 3, 1)] = omega_;
+    return ret;
+}
+
+
+inline void RigidBody::setState(const std::valarray<lbBase_t> &state)
+/* setState : sets the values returned by state().
+ */
+{
+    position_ = state[std::slice(0, 3, 1)];
+    velocity_ = state[std::slice(3, 3, 1)];
+    quat_ = state[std::slice(6, 4, 1)];
+    omega_ = state[std::slice(10, 3, 1)];
+}
+
+
+inline std::valarray<lbBase_t> RigidBody::angularAcceleration(const std::valarray<lbBase_t> &w, const std::valarray<lbBase_t> &torqueBody) const
+{
+    return angFree_*(torqueBody - cross(w, inertia_*w))/inertia_;
+}
+
+
+inline void RigidBody::step(const std::valarray<lbBase_t> &force, const std::valarray<lbBase_t> &torque, const lbBase_t dt, const int nSubSteps)
+/* step : integrates the body motion over the time dt.
+ *
+ * force     : hydrodynamic force (world frame, 3 components)
+ * torque    : hydrodynamic torque about the center of mass (world frame, 3 components)
+ * dt        : time step
+ * nSubSteps : number of sub-steps
+ */
+{
+    const lbBase_t h = dt/nSubSteps;
+    const std::valarray<lbBase_t> acc = linFree_*(force + externalForce_)/mass_;
+
+    for (int n = 0; n < nSubSteps; ++n) {
+        // Translation: velocity Verlet
+        position_ += h*velocity_ + 0.5*h*h*acc;
+        velocity_ += h*acc;
+
+        // Rotation: RK4 for the Euler equations, torque in the current body frame
+        const std::valarray<lbBase_t> tb = toBodyFrame(torque);
+        const std::valarray<lbBase_t> k1 = angularAcceleration(omega_, tb);
+        const std::valarray<lbBase_t> k2 = angularAcceleration(omega_ + 0.5*h*k1, tb);
+        const std::valarray<lbBase_t> k3 = angularAcceleration(omega_ + 0.5*h*k2, tb);
+        const std::valarray<lbBase_t> k4 = angularAcceleration(omega_ + h*k3, tb);
+        const std::valarray<lbBase_t> wOld = omega_;
+        omega_ += (h/6.0)*(k1 + 2.0*k2 + 2.0*k3 + k4);
+
+        // Quaternion: q <- q * exp(0.5 h w), with w the mean body angular velocity
+        const std::valarray<lbBase_t> w = 0.5*(wOld + omega_);
+        const lbBase_t wNorm = std::sqrt((w*w).sum());
+        if (wNorm > lbBaseEps) {
+            const lbBase_t a = 0.5*h*wNorm;
+            const lbBase_t s = std::sin(a)/wNorm;
+            const std::valarray<lbBase_t> dq{std::cos(a), s*w[0], s*w[1], s*w[2]};
+            const std::valarray<lbBase_t> q = quat_;
+            quat_[0] = q[0]*dq[0] - q[1]*dq[1] - q[2]*dq[2] - q[3]*dq[3];
+            quat_[1] = q[0]*dq[1] + q[1]*dq[0] + q[2]*dq[3] - q[3]*dq[2];
+            quat_[2] = q[0]*dq[2] - q[1]*dq[3] + q[2]*dq[0] + q[3]*dq[1];
+            quat_[3] = q[0]*dq[3] + q[1]*dq[2] - q[2]*dq[1] + q[3]*dq[0];
+            quat_ /= std::sqrt((quat_*quat_).sum());
+        }
+    }
+}
+
+
+inline void RigidBody::step(const std::valarray<lbBase_t> &forceTorque, const int nSubSteps)
+/* step : integrates one LB time step with the output from
+ *  MovingBoundary::forceAndTorque(), that is nD force components
+ *  followed by 3 torque components.
+ */
+{
+    const int nD = static_cast<int>(forceTorque.size()) - 3;
+    std::valarray<lbBase_t> force(0.0, 3);
+    for (int d = 0; d < nD; ++d)
+        force[d] = forceTorque[d];
+    const std::valarray<lbBase_t> torque = forceTorque[std::slice(nD, 3, 1)];
+    step(force, torque, 1.0, nSubSteps);
+}
+
+#endif // LBRIGIDBODY_H
@@ -0,0 +1,232 @@
+#ifndef LBROTATINGFRAME_H
+#define LBROTATINGFRAME_H
+
+#include <iostream>
+#include <valarray>
+#include <vector>
+#include "LBglobal.h"
+#include "LBlatticetypes.h"
+#include "LBgrid.h"
+#include "LBfield.h"
+
+/*********************************************************
+ * class ROTATINGFRAME: fictitious forces in a reference frame
+ *  rotating with angular velocity Omega and angular
+ *  acceleration alpha about an axis through origin.
+ *
+ * The force density is
+ *     F = F_body + rho (a(r) - 2 Omega x u),
+ *     a(r) = -Omega x (Omega x r) - alpha x r,
+ *  (centrifugal, Euler and Coriolis) with r = x - origin. The
+ *  position dependent parts, r, Omega x r and a(r), are stored
+ *  once per node in structure of arrays layout (component
+ *  d of node n at d*numNodes + n), and are only recomputed
+ *  by setRotation.
+ *
+ * The Coriolis force depends on the velocity, so the velocity
+ *  is found implicitly from
+ *     u + Omega x u = b,   b = (sum_q f_q c_q + F_body/2)/rho + a(r)/2,
+ *  which has the closed form solution
+ *     u = (b - Omega x b + (Omega.b) Omega)/(1 + |Omega|^2).
+ *
+ * In two dimensions Omega and alpha must be along the z-axis.
+ *  The velocity is the velocity in the rotating frame, and
+ *  inertialVelocity(...) adds Omega x r.
+ *********************************************************/
+template <typename DXQY>
+class RotatingFrame
+{
+public:
+    RotatingFrame(const Grid<DXQY> &grid, const std::vector<lbBase_t> &origin, const std::vector<lbBase_t> &omega,
+                  const std::vector<lbBase_t> &alpha=std::vector<lbBase_t>(3, 0.0));
+
+    void setRotation(const std::vector<lbBase_t> &omega, const std::vector<lbBase_t> &alpha=std::vector<lbBase_t>(3, 0.0));
+
+    template <typename T>
+    inline void velocityAndForce(const int nodeNo, const T &fNode, const lbBase_t rho, const lbBase_t *bodyForce, lbBase_t *vel, lbBase_t *force) const;
+
+    template <typename S>
+    void collideAndPropagate(const std::vector<int> &bulkNodes, const LbField<DXQY, S> &f, LbField<DXQY, S> &fTmp, const lbBase_t tau,
+                             const std::valarray<lbBase_t> &bodyForce, ScalarField &rho, VectorField<DXQY> &vel, const Grid<DXQY> &grid) const;
+
+    void inertialVelocity(const std::vector<int> &nodeList, const VectorField<DXQY> &vel, VectorField<DXQY> &velInertial) const;
+
+    inline lbBase_t r(const int nodeNo, const int d) const {return r_[d*numNodes_ + nodeNo];}
+    inline lbBase_t omegaCrossR(const int nodeNo, const int d) const {return omegaCrossR_[d*numNodes_ + nodeNo];}
+    inline lbBase_t positionForce(const int nodeNo, const int d) const {return aPos_[d*numNodes_ + nodeNo];}
+
+private:
+    static inline void cross(const lbBase_t *a, const lbBase_t *b, lbBase_t *ret)
+    {
+        ret[0] = a[1]*b[2] - a[2]*b[1];
+        ret[1] = a[2]*b[0] - a[0]*b[2];
+        ret[2] = a[0]*b[1] - a[1]*b[0];
+    }
+
+    const int numNodes_;
+    lbBase_t omega_[3];
+    lbBase_t alpha_[3];
+    lbBase_t omegaNorm2Inv_;  // 1/(1 + |Omega|^2)
+    std::vector<lbBase_t> r_;  // Position relative to the origin
+    std::vector<lbBase_t> omegaCrossR_;  // Omega x r
+    std::vector<lbBase_t> aPos_;  // -Omega x (Omega x r) - alpha x r
+};
+
+
+template <typename DXQY>
+RotatingFrame<DXQY>::RotatingFrame(const Grid<DXQY> &grid, const std::vector<lbBase_t> &origin, const std::vector<lbBase_t> &omega,
+                                   const std::vector<lbBase_t> &alpha)
+    : numNodes_(grid.size()), r_(DXQY::nD*grid.size(), 0.0), omegaCrossR_(DXQY::nD*grid.size(), 0.0), aPos_(DXQY::nD*grid.size(), 0.0)
+/* grid   : grid object
+ * origin : a point on the rotation axis (DXQY::nD values)
+ * omega  : angular velocity (3 values)
+ * alpha  : angular acceleration (3 values)
+ */
+{
+    if (static_cast<int>(origin.size()) < DXQY::nD) {
+        std::cout << "ERROR in RotatingFrame: origin must have " << DXQY::nD << " components" << std::endl;
+        exit(1);
+    }
+    for (int nodeNo = 1; nodeNo < numNodes_; ++nodeNo) {
+        for (int d = 0; d < DXQY::nD; ++d)
+            r_[d*numNodes_ + nodeNo] = grid.pos(nodeNo, d) - origin[d];
+    }
+    setRotation(omega, alpha);
+}
+
+
+template <typename DXQY>
+void RotatingFrame<DXQY>::setRotation(const std::vector<lbBase_t> &omega, const std::vector<lbBase_t> &alpha)
+/* setRotation : sets a new angular velocity and acceleration, and updates the
+ *  stored Omega x r and a(r). Only needed when the rotation changes.
+ */
+{
+    if ( (omega.size() != 3) || (alpha.size() != 3) ) {
+        std::cout << "ERROR in RotatingFrame: omega and alpha must have 3 components" << std::endl;
+        exit(1);
+    }
+    if ( (DXQY::nD == 2) && ((omega[0] != 0) || (omega[1] != 0) || (alpha[0] != 0) || (alpha[1] != 0)) ) {
+        std::cout << "ERROR in RotatingFrame: omega and alpha must be along the z-axis in 2D" << std::endl;
+        exit(1);
+    }
+    lbBase_t omega2 = 0;
+    for (int i = 0; i < 3; ++i) {
+        omega_[i] = omega[i];
+        alpha_[i] = alpha[i];
+        omega2 += omega[i]*omega[i];
+    }
+    omegaNorm2Inv_ = 1.0/(1.0 + omega2);
+
+    for (int nodeNo = 0; nodeNo < numNodes_; ++nodeNo) {
+        lbBase_t rNode[3] = {0.0, 0.0, 0.0};
+        for (int d = 0; d < DXQY::nD; ++d)
+            rNode[d] = r_[d*numNodes_ + nodeNo];
+        lbBase_t wr[3], wwr[3], ar[3];
+        cross(omega_, rNode, wr);
+        cross(omega_, wr, wwr);
+        cross(alpha_, rNode, ar);
+        for (int d = 0; d < DXQY::nD; ++d) {
+            omegaCrossR_[d*numNodes_ + nodeNo] = wr[d];
+            aPos_[d*numNodes_ + nodeNo] = -wwr[d] - ar[d];
+        }
+    }
+}
+
+
+template <typename DXQY>
+template <typename T>
+inline void RotatingFrame<DXQY>::velocityAndForce(const int nodeNo, const T &fNode, const lbBase_t rho, const lbBase_t *bodyForce, lbBase_t *vel, lbBase_t *force) const
+/* velocityAndForce : sets the rotating frame velocity and the total force density
+ *  at a node, with the implicit Coriolis force.
+ *
+ * fNode     : the node's distribution
+ * rho       : density
+ * bodyForce : body force density (DXQY::nD values)
+ * vel       : (out) velocity (DXQY::nD values)
+ * force     : (out) total force density (DXQY::nD values)
+ */
+{
+    const lbBase_t rhoInv = 1.0/rho;
+    lbBase_t b[3] = {0.0, 0.0, 0.0};
+    for (int q = 0; q < DXQY::nQ; ++q) {
+        for (int d = 0; d < DXQY::nD; ++d)
+            b[d] += fNode[q]*DXQY::c(q, d);
+    }
+    for (int d = 0; d < DXQY::nD; ++d)
+        b[d] = (b[d] + 0.5*bodyForce[d])*rhoInv + 0.5*aPos_[d*numNodes_ + nodeNo];
+
+    lbBase_t wb[3];
+    cross(omega_, b, wb);
+    const lbBase_t wDotB = omega_[0]*b[0] + omega_[1]*b[1] + omega_[2]*b[2];
+    lbBase_t u[3];
+    for (int i = 0; i < 3; ++i)
+        u[i] = omegaNorm2Inv_*(b[i] - wb[i] + wDotB*omega_[i]);
+    lbBase_t wu[3];
+    cross(omega_, u, wu);
+    for (int d = 0; d < DXQY::nD; ++d) {
+        vel[d] = u[d];
+        force[d] = bodyForce[d] + rho*(aPos_[d*numNodes_ + nodeNo] - 2*wu[d]);
+    }
+}
+
+
+template <typename DXQY>
+template <typename S>
+void RotatingFrame<DXQY>::collideAndPropagate(const std::vector<int> &bulkNodes, const LbField<DXQY, S> &f, LbField<DXQY, S> &fTmp, const lbBase_t tau,
+                                              const std::valarray<lbBase_t> &bodyForce, ScalarField &rho, VectorField<DXQY> &vel, const Grid<DXQY> &grid) const
+/* collideAndPropagate : BGK collision with Guo forcing of the rotating frame force,
+ *  and propagation to fTmp, for field 0.
+ *
+ * tau       : relaxation time
+ * bodyForce : body force density, the same for all nodes
+ * rho, vel  : (out) density and rotating frame velocity (field 0)
+ */
+{
+    constexpr int nQ = DXQY::nQ;
+    constexpr int nD = DXQY::nD;
+    const lbBase_t tauInv = 1.0/tau;
+    const lbBase_t forceFactor = 1 - 0.5*tauInv;
+    lbBase_t F0[nD];
+    for (int d = 0; d < nD; ++d)
+        F0[d] = bodyForce[d];
+
+    for (const auto &nodeNo: bulkNodes) {
+        lbBase_t fN[nQ];
+        lbBase_t rhoNode = 0;
+        for (int q = 0; q < nQ; ++q) {
+            fN[q] = f(0, q, nodeNo);
+            rhoNode += fN[q];
+        }
+        lbBase_t u[nD], F[nD];
+        velocityAndForce(nodeNo, fN, rhoNode, F0, u, F);
+
+        rho(0, nodeNo) = rhoNode;
+        lbBase_t u2 = 0, uF = 0;
+        for (int d = 0; d < nD; ++d) {
+            vel(0, d, nodeNo) = u[d];
+            u2 += u[d]*u[d];
+            uF += u[d]*F[d];
+        }
+        for (int q = 0; q < nQ; ++q) {
+            const lbBase_t cu = DXQY::cDot(q, u);
+            const lbBase_t cF = DXQY::cDot(q, F);
+            const lbBase_t feq = rhoNode*DXQY::w[q]*(1.0 + DXQY::c2Inv*cu + DXQY::c4Inv0_5*(cu*cu - DXQY::c2*u2));
+            const lbBase_t deltaF = DXQY::w[q]*forceFactor*(DXQY::c2Inv*cF + DXQY::c4Inv*(cF*cu - DXQY::c2*uF));
+            fTmp(0, q, grid.neighbor(q, nodeNo)) = fN[q] - tauInv*(fN[q] - feq) + deltaF;
+        }
+    }
+}
+
+
+template <typename DXQY>
+void RotatingFrame<DXQY>::inertialVelocity(const std::vector<int> &nodeList, const VectorField<DXQY> &vel, VectorField<DXQY> &velInertial) const
+/* inertialVelocity : velInertial = vel + Omega x r (field 0)
+ */
+{
+    for (const auto &nodeNo: nodeList) {
+        for (int d = 0; d < DXQY::nD; ++d)
+            velInertial(0, d, nodeNo) = vel(0, d, nodeNo) + omegaCrossR_[d*numNodes_ + nodeNo];
+    }
+}
+
+#endif // LBROTATINGFRAME_H
@@ -0,0 +1,611 @@
+#ifndef LBSLIDINGINTERFACE_H
+#define LBSLIDINGINTERFACE_H
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <unordered_map>
+#include <vector>
+#include <mpi.h>
+#include "LBglobal.h"
+#include "LBlatticetypes.h"
+#include "LBnodes.h"
+#include "LBgrid.h"
+#include "LBfield.h"
+
+/*********************************************************
+ * class SLIDINGINTERFACE: rotor-stator coupling across a
+ *  cylindrical interface of radius R about an axis through
+ *  center.
+ *
+ * The grid is shared by two regions, each with its own lb
+ *  field:
+ *   - stator: lab frame, nodes with r > R - overlap
+ *   - rotor : rotor frame, nodes with r <= R + overlap, where
+ *             the geometry is the rotor at angle zero and the
+ *             flow is solved with the fictitious forces of the
+ *             rotating frame (see RotatingFrame).
+ *  r is the distance from the axis, which is the same in both
+ *  frames, so the node sets are fixed and only the coupling
+ *  moves with the rotor angle theta:
+ *     x_lab = center + R(theta) (x_rotor - center).
+ *
+ * The fill nodes of a region are the fluid nodes just outside
+ *  it that stream into it. Each step their post-collision
+ *  distribution is reconstructed from the other region:
+ *  rho, u and the non-equilibrium stress are interpolated
+ *  (bi/tri-linear) at the node's position in the other frame,
+ *  transformed with
+ *     u_lab = R(theta) (u_rotor + Omega x r),
+ *     Pi_lab = R(theta) Pi_rotor R(theta)^T,
+ *  and the regularized distribution
+ *     f*_q = w_q rho (1 + c.u/c_s^2 + ((c.u)^2 - c_s^2 u^2)/(2 c_s^4))
+ *          + (1 - 1/tau) w_q/(2 c_s^4) (c c - c_s^2 I) : Pi
+ *  is propagated into the region, in the rotor with the Guo
+ *  forcing terms of the centrifugal and Coriolis forces. Other
+ *  body forces are not included in the reconstruction.
+ *
+ * setAngle(theta) updates the interpolation stencils. The donor
+ *  cell of a fill node is only looked up again when the rotation
+ *  moves it into a new lattice cell; otherwise only the weights
+ *  are recomputed.
+ *
+ * The donor nodes may be on other ranks. All ranks hold the
+ *  owner rank of the fluid nodes in the overlap annulus (set up
+ *  once in the constructor), and the donor moments of the nodes
+ *  on other ranks are exchanged with one MPI_Alltoallv in
+ *  propagate. The list of exchanged nodes is only set up again
+ *  when a donor cell changes on some rank. So setAngle and
+ *  propagate are collective, and the result does not depend on
+ *  the number of ranks.
+ *
+ * Use per time step:
+ *     interface.setAngle(theta);
+ *     interface.propagate(tauStator, tauRotor, fStator, fRotor, fStatorTmp, fRotorTmp, grid);
+ *     ... collision and propagation of interface.stator(bulkNodes) and interface.rotor(bulkNodes) ...
+ *     fStator.swapData(fStatorTmp);  fRotor.swapData(fRotorTmp);
+ *     ... boundary conditions and mpi communication of both fields ...
+ *
+ * The overlap annulus must be free of solid nodes. Donor corners
+ *  outside the system are left out of the interpolation, and the
+ *  weights of the other corners are renormalized.
+ *********************************************************/
+template <typename DXQY>
+class SlidingInterface
+{
+public:
+    SlidingInterface(const Nodes<DXQY> &nodes, const Grid<DXQY> &grid, const std::vector<lbBase_t> &center, const lbBase_t radius,
+                     const int axis, const lbBase_t omega, const lbBase_t overlap=2.0);
+
+    void setAngle(const lbBase_t theta);
+    template <typename S>
+    void propagate(const lbBase_t tauStator, const lbBase_t tauRotor, const LbField<DXQY, S> &fStator, const LbField<DXQY, S> &fRotor,
+                   LbField<DXQY, S> &fStatorTmp, LbField<DXQY, S> &fRotorTmp, const Grid<DXQY> &grid) const;
+
+    std::vector<int> stator(const std::vector<int> &nodeList) const;
+    std::vector<int> rotor(const std::vector<int> &nodeList) const;
+    inline bool isStator(const int nodeNo) const {return radius_[nodeNo] > rStator_;}
+    inline bool isRotor(const int nodeNo) const {return radius_[nodeNo] <= rRotor_;}
+    inline int numFill() const {return static_cast<int>(fillNode_.size());}
+    inline lbBase_t angle() const {return theta_;}
+    std::vector<lbBase_t> omegaVector() const;
+
+private:
+    static constexpr int nCorners_ = (DXQY::nD == 2) ? 4 : 8;
+    static constexpr int STATOR = 0;
+    static constexpr int ROTOR = 1;
+    static constexpr int nMoments_ = 1 + DXQY::nD + DXQY::nD*DXQY::nD;  // rho, u and Pi per donor node
+
+    inline long long flat(const int *pos) const;
+    inline lbBase_t radiusAt(const int *pos) const;
+    void setupExchange();
+    template <typename T>
+    static std::vector<T> alltoallv(const std::vector<T> &sendBuf, const std::vector<int> &sendCount, std::vector<int> &recvCount, MPI_Datatype type);
+
+    template <typename S>
+    void donorMoments(const int nodeNo, const bool rotorFrame, const LbField<DXQY, S> &f, lbBase_t &rho, lbBase_t *u, lbBase_t *pi) const;
+    inline void rotate(const lbBase_t c, const lbBase_t s, lbBase_t *vec) const
+    {
+        const lbBase_t v1 = vec[a1_], v2 = vec[a2_];
+        vec[a1_] = c*v1 - s*v2;
+        vec[a2_] = s*v1 + c*v2;
+    }
+
+    const Nodes<DXQY> &nodes_;
+    const Grid<DXQY> &grid_;
+    int a1_, a2_;  // Axes of the rotation plane
+    lbBase_t center_[DXQY::nD];
+    const lbBase_t omega_;
+    const lbBase_t rStator_;  // Stator: r > rStator_
+    const lbBase_t rRotor_;  // Rotor: r <= rRotor_
+    lbBase_t theta_;
+    std::vector<lbBase_t> radius_;  // Distance from the axis, per node
+    std::vector<int> fillNode_;
+    std::vector<int> fillRegion_;  // Region that the fill node streams into
+    std::vector<int> base_;  // nD lower corner positions per fill node
+    std::vector<int> donor_;  // nCorners_ donor nodes per fill node, 0 if not valid, -(slot + 1) on other ranks
+    std::vector<lbBase_t> weight_;  // nCorners_ interpolation weights per fill node
+
+    // Donors on other ranks
+    int myRank_, nProcs_;
+    int dim_[DXQY::nD];  // System size
+    std::unordered_map<long long, int> ownerRank_;  // Flat position -> rank, fluid nodes in the overlap annulus
+    std::unordered_map<long long, int> localNode_;  // Flat position -> node, for the nodes in ownerRank_ on this rank
+    std::vector<long long> donorKey_;  // Per donor corner: 2*flat position + donor region on another rank, -1 if local
+    std::vector<int> recvCount_;  // Donor nodes received from each rank (slots, in rank order)
+    std::vector<int> sendCount_;  // Donor nodes sent to each rank
+    std::vector<int> sendNode_;  // Nodes to send, grouped by rank
+    std::vector<int> sendRegion_;  // Region (field) of the nodes to send
+};
+
+
+template <typename DXQY>
+SlidingInterface<DXQY>::SlidingInterface(const Nodes<DXQY> &nodes, const Grid<DXQY> &grid, const std::vector<lbBase_t> &center, const lbBase_t radius,
+                                         const int axis, const lbBase_t omega, const lbBase_t overlap)
+    : nodes_(nodes), grid_(grid), omega_(omega), rStator_(radius - overlap), rRotor_(radius + overlap), theta_(0.0), radius_(grid.size(), 0.0)
+/* center  : a point on the rotation axis (DXQY::nD values)
+ * radius  : radius of the interface
+ * axis    : rotation axis (0, 1 or 2), must be 2 in two dimensions
+ * omega   : angular velocity of the rotor
+ * overlap : half width of the annulus solved by both regions
+ */
+{
+    if ( (axis < 0) || (axis > 2) || ((DXQY::nD == 2) && (axis != 2)) ) {
+        std::cout << "ERROR in SlidingInterface: axis must be 0, 1 or 2 (2 in two dimensions)" << std::endl;
+        exit(1);
+    }
+    if (overlap < 1.0) {
+        std::cout << "ERROR in SlidingInterface: overlap must be at least one lattice spacing" << std::endl;
+        exit(1);
+    }
+    a1_ = (axis + 1) % 3;
+    a2_ = (axis + 2) % 3;
+    if (DXQY::nD == 2) {
+        a1_ = 0;
+        a2_ = 1;
+    }
+    for (int d = 0; d < DXQY::nD; ++d)
+        center_[d] = center[d];
+    MPI_Comm_rank(MPI_COMM_WORLD, &myRank_);
+    MPI_Comm_size(MPI_COMM_WORLD, &nProcs_);
+
+    for (int nodeNo = 1; nodeNo < grid.size(); ++nodeNo) {
+        const lbBase_t x1 = grid.pos(nodeNo, a1_) - center_[a1_];
+        const lbBase_t x2 = grid.pos(nodeNo, a2_) - center_[a2_];
+        radius_[nodeNo] = std::sqrt(x1*x1 + x2*x2);
+        if ( nodes.isMyRank(nodeNo) && nodes.isSolid(nodeNo) && (radius_[nodeNo] > rStator_ - 2) && (radius_[nodeNo] <= rRotor_ + 2) ) {
+            std::cout << "ERROR in SlidingInterface: solid node in the overlap annulus at radius " << radius_[nodeNo] << std::endl;
+            exit(1);
+        }
+    }
+
+    // Fill nodes: fluid nodes outside a region with a neighbor inside it
+    for (int region = STATOR; region <= ROTOR; ++region) {
+        for (int nodeNo = 1; nodeNo < grid.size(); ++nodeNo) {
+            if (!nodes.isFluid(nodeNo) || !nodes.isMyRank(nodeNo))
+                continue;
+            if ( (region == STATOR) ? isStator(nodeNo) : isRotor(nodeNo) )
+                continue;
+            bool streamsIn = false;
+            for (int q = 0; q < DXQY::nQNonZero_; ++q) {
+                const int neigNo = grid.neighbor(q, nodeNo);
+                if ( nodes.isFluid(neigNo) && ((region == STATOR) ? isStator(neigNo) : isRotor(neigNo)) )
+                    streamsIn = true;
+            }
+            if (streamsIn) {
+                fillNode_.push_back(nodeNo);
+                fillRegion_.push_back(region);
+            }
+        }
+    }
+
+    // Owner ranks of the fluid nodes that can be donors. The fill nodes are within sqrt(nD) of
+    // the annulus, and their donor corners within sqrt(nD) of the fill nodes' radius.
+    int maxPos[DXQY::nD];
+    for (int d = 0; d < DXQY::nD; ++d)
+        maxPos[d] = 0;
+    for (int nodeNo = 1; nodeNo < grid.size(); ++nodeNo)
+        if (nodes.isMyRank(nodeNo))
+            for (int d = 0; d < DXQY::nD; ++d)
+                maxPos[d] = std::max(maxPos[d], grid.pos(nodeNo, d));
+    MPI_Allreduce(MPI_IN_PLACE, maxPos, DXQY::nD, MPI_INT, MPI_MAX, MPI_COMM_WORLD);
+    for (int d = 0; d < DXQY::nD; ++d)
+        dim_[d] = maxPos[d] + 1;
+    std::vector<long long> localFlat;
+    for (int nodeNo = 1; nodeNo < grid.size(); ++nodeNo) {
+        if ( nodes.isFluid(nodeNo) && nodes.isMyRank(nodeNo) && (radius_[nodeNo] > rStator_ - 4) && (radius_[nodeNo] <= rRotor_ + 4) ) {
+            int pos[DXQY::nD];
+            for (int d = 0; d < DXQY::nD; ++d)
+                pos[d] = grid.pos(nodeNo, d);
+            localNode_[flat(pos)] = nodeNo;
+            localFlat.push_back(flat(pos));
+        }
+    }
+    int numLocal = localFlat.size();
+    std::vector<int> numPerRank(nProcs_), displ(nProcs_, 0);
+    MPI_Allgather(&numLocal, 1, MPI_INT, numPerRank.data(), 1, MPI_INT, MPI_COMM_WORLD);
+    for (int r = 1; r < nProcs_; ++r)
+        displ[r] = displ[r-1] + numPerRank[r-1];
+    std::vector<long long> allFlat(displ[nProcs_-1] + numPerRank[nProcs_-1]);
+    MPI_Allgatherv(localFlat.data(), numLocal, MPI_LONG_LONG, allFlat.data(), numPerRank.data(), displ.data(), MPI_LONG_LONG, MPI_COMM_WORLD);
+    for (int r = 0; r < nProcs_; ++r)
+        for (int i = displ[r]; i < displ[r] + numPerRank[r]; ++i)
+            ownerRank_[allFlat[i]] = r;
+
+    base_.assign(DXQY::nD*fillNode_.size(), std::numeric_limits<int>::min());
+    donor_.assign(nCorners_*fillNode_.size(), 0);
+    donorKey_.assign(nCorners_*fillNode_.size(), -1);
+    weight_.assign(nCorners_*fillNode_.size(), 0.0);
+    setAngle(0.0);
+}
+
+
+template <typename DXQY>
+inline long long SlidingInterface<DXQY>::flat(const int *pos) const
+/* flat : index of a position in the system, -1 if it is outside
+ */
+{
+    long long ret = 0;
+    for (int d = DXQY::nD - 1; d >= 0; --d) {
+        if ( (pos[d] < 0) || (pos[d] >= dim_[d]) )
+            return -1;
+        ret = ret*dim_[d] + pos[d];
+    }
+    return ret;
+}
+
+
+template <typename DXQY>
+inline lbBase_t SlidingInterface<DXQY>::radiusAt(const int *pos) const
+/* radiusAt : distance from the axis, computed as radius_ of the nodes
+ */
+{
+    const lbBase_t x1 = pos[a1_] - center_[a1_];
+    const lbBase_t x2 = pos[a2_] - center_[a2_];
+    return std::sqrt(x1*x1 + x2*x2);
+}
+
+
+template <typename DXQY>
+std::vector<lbBase_t> SlidingInterface<DXQY>::omegaVector() const
+/* omegaVector : the angular velocity as a 3 component vector, e.g. for RotatingFrame
+ */
+{
+    std::vector<lbBase_t> ret(3, 0.0);
+    ret[(DXQY::nD == 2) ? 2 : 3 - a1_ - a2_] = omega_;
+    return ret;
+}
+
+
+template <typename DXQY>
+std::vector<int> SlidingInterface<DXQY>::stator(const std::vector<int> &nodeList) const
+/* stator : returns the nodes in nodeList that belong to the stator region
+ */
+{
+    std::vector<int> ret;
+    for (const auto &nodeNo: nodeList) {
+        if (isStator(nodeNo))
+            ret.push_back(nodeNo);
+    }
+    return ret;
+}
+
+
+template <typename DXQY>
+std::vector<int> SlidingInterface<DXQY>::rotor(const std::vector<int> &nodeList) const
+/* rotor : returns the nodes in nodeList that belong to the rotor region
+ */
+{
+    std::vector<int> ret;
+    for (const auto &nodeNo: nodeList) {
+        if (isRotor(nodeNo))
+            ret.push_back(nodeNo);
+    }
+    return ret;
+}
+
+
+template <typename DXQY>
+void SlidingInterface<DXQY>::setAngle(const lbBase_t theta)
+/* setAngle : sets the rotor angle and updates the interpolation stencils
+ */
+{
+    constexpr int nD = DXQY::nD;
+    theta_ = theta;
+    int donorChanged = 0;
+    for (int n = 0; n < numFill(); ++n) {
+        const int nodeNo = fillNode_[n];
+        // Stator fill nodes are found in the rotor (rotate by -theta), and the reverse
+        const lbBase_t angle = (fillRegion_[n] == STATOR) ? -theta : theta;
+        lbBase_t x[3] = {0.0, 0.0, 0.0};
+        for (int d = 0; d < nD; ++d)
+            x[d] = grid_.pos(nodeNo, d) - center_[d];
+        rotate(std::cos(angle), std::sin(angle), x);
+
+        int base[nD];
+        lbBase_t frac[nD];
+        bool newCell = false;
+        for (int d = 0; d < nD; ++d) {
+            const lbBase_t xd = x[d] + center_[d];
+            base[d] = static_cast<int>(std::floor(xd));
+            frac[d] = xd - base[d];
+            if (base[d] != base_[nD*n + d])
+                newCell = true;
+            base_[nD*n + d] = base[d];
+        }
+
+        if (newCell) {
+            donorChanged = 1;
+            const int donorRegion = (fillRegion_[n] == STATOR) ? ROTOR : STATOR;
+            for (int k = 0; k < nCorners_; ++k) {
+                int pos[nD];
+                for (int d = 0; d < nD; ++d)
+                    pos[d] = base[d] + ((k >> d) & 1);
+                const long long key = flat(pos);
+                const auto it = (key >= 0) ? ownerRank_.find(key) : ownerRank_.end();
+                const lbBase_t r = radiusAt(pos);
+                const bool inDonorRegion = (donorRegion == ROTOR) ? (r <= rRotor_) : (r > rStator_);
+                int donorNo = 0;
+                long long donorKey = -1;
+                if ( (it != ownerRank_.end()) && inDonorRegion ) {
+                    if (it->second == myRank_) {
+                        donorNo = localNode_.at(key);
+                    } else {
+                        donorNo = -1;  // The slot is set in setupExchange
+                        donorKey = 2*key + donorRegion;
+                    }
+                }
+                donor_[nCorners_*n + k] = donorNo;
+                donorKey_[nCorners_*n + k] = donorKey;
+            }
+        }
+
+        lbBase_t weightSum = 0;
+        for (int k = 0; k < nCorners_; ++k) {
+            lbBase_t wk = 0;
+            if (donor_[nCorners_*n + k] != 0) {
+                wk = 1.0;
+                for (int d = 0; d < nD; ++d)
+                    wk *= ((k >> d) & 1) ? frac[d] : 1 - frac[d];
+            }
+            weight_[nCorners_*n + k] = wk;
+            weightSum += wk;
+        }
+        if (weightSum < lbBaseEps) {
+            std::cout << "ERROR in SlidingInterface: no donor nodes for the fill node at";
+            for (int d = 0; d < nD; ++d)
+                std::cout << " " << grid_.pos(nodeNo, d);
+            std::cout << std::endl;
+            exit(1);
+        }
+        for (int k = 0; k < nCorners_; ++k)
+            weight_[nCorners_*n + k] /= weightSum;
+    }
+    MPI_Allreduce(MPI_IN_PLACE, &donorChanged, 1, MPI_INT, MPI_MAX, MPI_COMM_WORLD);
+    if (donorChanged)
+        setupExchange();
+}
+
+
+template <typename DXQY>
+void SlidingInterface<DXQY>::setupExchange()
+/* setupExchange : sets the slots of the donors on other ranks, grouped by owner rank,
+ *  and tells the owners which nodes to send. Collective.
+ */
+{
+    std::vector<std::vector<long long>> request(nProcs_);
+    std::unordered_map<long long, int> slot;
+    for (std::size_t i = 0; i < donorKey_.size(); ++i) {
+        const long long key = donorKey_[i];
+        if ( (key >= 0) && slot.insert({key, 0}).second )
+            request[ownerRank_.at(key/2)].push_back(key);
+    }
+    std::vector<long long> requestKeys;
+    recvCount_.assign(nProcs_, 0);
+    for (int r = 0; r < nProcs_; ++r) {
+        recvCount_[r] = request[r].size();
+        for (const auto &key: request[r]) {
+            slot[key] = static_cast<int>(requestKeys.size());
+            requestKeys.push_back(key);
+        }
+    }
+    for (std::size_t i = 0; i < donorKey_.size(); ++i)
+        if (donorKey_[i] >= 0)
+            donor_[i] = -(slot[donorKey_[i]] + 1);
+
+    const std::vector<long long> requested = alltoallv(requestKeys, recvCount_, sendCount_, MPI_LONG_LONG);
+    sendNode_.resize(requested.size());
+    sendRegion_.resize(requested.size());
+    for (std::size_t i = 0; i < requested.size(); ++i) {
+        sendNode_[i] = localNode_.at(requested[i]/2);
+        sendRegion_[i] = requested[i] % 2;
+    }
+}
+
+
+template <typename DXQY>
+template <typename T>
+std::vector<T> SlidingInterface<DXQY>::alltoallv(const std::vector<T> &sendBuf, const std::vector<int> &sendCount, std::vector<int> &recvCount, MPI_Datatype type)
+/* alltoallv : sends sendCount[r] consecutive entries of sendBuf to rank r, and returns the
+ *  received entries grouped by sending rank. recvCount is set to the number received from each rank.
+ */
+{
+    const int nProcs = sendCount.size();
+    recvCount.resize(nProcs);
+    MPI_Alltoall(sendCount.data(), 1, MPI_INT, recvCount.data(), 1, MPI_INT, MPI_COMM_WORLD);
+    std::vector<int> sendDispl(nProcs, 0), recvDispl(nProcs, 0);
+    for (int r = 1; r < nProcs; ++r) {
+        sendDispl[r] = sendDispl[r-1] + sendCount[r-1];
+        recvDispl[r] = recvDispl[r-1] + recvCount[r-1];
+    }
+    std::vector<T> recvBuf(recvDispl[nProcs-1] + recvCount[nProcs-1]);
+    MPI_Alltoallv(sendBuf.data(), sendCount.data(), sendDispl.data(), type, recvBuf.data(), recvCount.data(), recvDispl.data(), type, MPI_COMM_WORLD);
+    return recvBuf;
+}
+
+
+template <typename DXQY>
+template <typename S>
+void SlidingInterface<DXQY>::donorMoments(const int nodeNo, const bool rotorFrame, const LbField<DXQY, S> &f, lbBase_t &rho, lbBase_t *u, lbBase_t *pi) const
+/* donorMoments : density, velocity and non-equilibrium stress (nD x nD) at a node.
+ *  In the rotor the velocity includes half the centrifugal and Coriolis forces,
+ *  as in RotatingFrame::velocityAndForce, otherwise the coupling adds a net
+ *  momentum of order Omega x u every step.
+ */
+{
+    constexpr int nD = DXQY::nD;
+    rho = 0;
+    for (int d = 0; d < nD; ++d)
+        u[d] = 0;
+    for (int i = 0; i < nD*nD; ++i)
+        pi[i] = 0;
+    for (int q = 0; q < DXQY::nQ; ++q) {
+        const lbBase_t fq = f(0, q, nodeNo);
+        rho += fq;
+        for (int i = 0; i < nD; ++i) {
+            u[i] += fq*DXQY::c(q, i);
+            for (int j = 0; j < nD; ++j)
+                pi[nD*i + j] += fq*DXQY::c(q, i)*DXQY::c(q, j);
+        }
+    }
+    for (int i = 0; i < nD; ++i)
+        u[i] /= rho;
+    if (rotorFrame) {
+        // u + Omega x u = m/rho + Omega^2 r/2, solved in the rotation plane
+        const lbBase_t b1 = u[a1_] + 0.5*omega_*omega_*(grid_.pos(nodeNo, a1_) - center_[a1_]);
+        const lbBase_t b2 = u[a2_] + 0.5*omega_*omega_*(grid_.pos(nodeNo, a2_) - center_[a2_]);
+        const lbBase_t norm = 1.0/(1.0 + omega_*omega_);
+        u[a1_] = norm*(b1 + omega_*b2);
+        u[a2_] = norm*(b2 - omega_*b1);
+    }
+    for (int i = 0; i < nD; ++i) {
+        pi[nD*i + i] -= rho*DXQY::c2;
+        for (int j = 0; j < nD; ++j)
+            pi[nD*i + j] -= rho*u[i]*u[j];
+    }
+}
+
+
+template <typename DXQY>
+template <typename S>
+void SlidingInterface<DXQY>::propagate(const lbBase_t tauStator, const lbBase_t tauRotor, const LbField<DXQY, S> &fStator, const LbField<DXQY, S> &fRotor,
+                                       LbField<DXQY, S> &fStatorTmp, LbField<DXQY, S> &fRotorTmp, const Grid<DXQY> &grid) const
+/* propagate : reconstructs the post-collision distributions of all fill nodes from
+ *  the other region, and propagates them into their region.
+ *
+ * tauStator, tauRotor : relaxation times of the two regions
+ * fStator, fRotor     : distributions before collision (field 0)
+ * fStatorTmp, fRotorTmp : the fields that the collision propagates into
+ *
+ * Collective: the moments of the donor nodes on other ranks are exchanged first.
+ */
+{
+    constexpr int nD = DXQY::nD;
+    std::vector<lbBase_t> sendMoments(nMoments_*sendNode_.size());
+    for (std::size_t i = 0; i < sendNode_.size(); ++i) {
+        lbBase_t *mom = &sendMoments[nMoments_*i];
+        const bool rotorFrame = (sendRegion_[i] == ROTOR);
+        donorMoments(sendNode_[i], rotorFrame, rotorFrame ? fRotor : fStator, mom[0], &mom[1], &mom[1 + nD]);
+    }
+    std::vector<int> sendCount(nProcs_), recvCount;
+    for (int r = 0; r < nProcs_; ++r)
+        sendCount[r] = nMoments_*sendCount_[r];
+    const std::vector<lbBase_t> remoteMoments = alltoallv(sendMoments, sendCount, recvCount, MPI_DOUBLE);
+
+    const lbBase_t c = std::cos(theta_), s = std::sin(theta_);
+    for (int n = 0; n < numFill(); ++n) {
+        const int nodeNo = fillNode_[n];
+        const bool toStator = (fillRegion_[n] == STATOR);
+        const LbField<DXQY, S> &fDonor = toStator ? fRotor : fStator;
+
+        // Interpolate the donor moments
+        lbBase_t rho = 0;
+        lbBase_t u[3] = {0.0, 0.0, 0.0};
+        lbBase_t pi[3*3] = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+        for (int k = 0; k < nCorners_; ++k) {
+            const lbBase_t wk = weight_[nCorners_*n + k];
+            if (wk == 0)
+                continue;
+            const int donorNo = donor_[nCorners_*n + k];
+            lbBase_t rhoK, uK[nD], piK[nD*nD];
+            if (donorNo > 0) {
+                donorMoments(donorNo, toStator, fDonor, rhoK, uK, piK);
+            } else {
+                const lbBase_t *mom = &remoteMoments[nMoments_*(-donorNo - 1)];
+                rhoK = mom[0];
+                for (int i = 0; i < nD; ++i)
+                    uK[i] = mom[1 + i];
+                for (int i = 0; i < nD*nD; ++i)
+                    piK[i] = mom[1 + nD + i];
+            }
+            rho += wk*rhoK;
+            for (int i = 0; i < nD; ++i) {
+                u[i] += wk*uK[i];
+                for (int j = 0; j < nD; ++j)
+                    pi[3*i + j] += wk*piK[nD*i + j];
+            }
+        }
+
+        // Transform to the frame of the fill node, r is the position in the rotor frame
+        lbBase_t r[3] = {0.0, 0.0, 0.0};
+        for (int d = 0; d < nD; ++d)
+            r[d] = grid.pos(nodeNo, d) - center_[d];
+        if (toStator)
+            rotate(c, -s, r);
+        const lbBase_t omegaCrossR[2] = {-omega_*r[a2_], omega_*r[a1_]};
+        if (toStator) {
+            u[a1_] += omegaCrossR[0];
+            u[a2_] += omegaCrossR[1];
+            rotate(c, s, u);
+        } else {
+            rotate(c, -s, u);
+            u[a1_] -= omegaCrossR[0];
+            u[a2_] -= omegaCrossR[1];
+        }
+        // Pi -> R Pi R^T, rotating the rows and the columns
+        const lbBase_t sr = toStator ? s : -s;
+        for (int i = 0; i < 3; ++i)
+            rotate(c, sr, &pi[3*i]);  // Rows are stored contiguously, this rotates the column index
+        for (int j = 0; j < 3; ++j) {
+            lbBase_t col[3] = {pi[j], pi[3 + j], pi[6 + j]};
+            rotate(c, sr, col);
+            pi[j] = col[0];
+            pi[3 + j] = col[1];
+            pi[6 + j] = col[2];
+        }
+
+        // Regularized post-collision distribution
+        const lbBase_t neqFactor = (1 - 1/(toStator ? tauStator : tauRotor))*0.5*DXQY::c4Inv;
+        LbField<DXQY, S> &fTarget = toStator ? fStatorTmp : fRotorTmp;
+        lbBase_t u2 = 0, trPi = 0;
+        for (int d = 0; d < nD; ++d) {
+            u2 += u[d]*u[d];
+            trPi += pi[3*d + d];
+        }
+        // Rotor fill nodes: the post-collision first moment is rho u + F/2, with the fictitious force F
+        lbBase_t F[3] = {0.0, 0.0, 0.0};
+        if (!toStator) {
+            F[a1_] = rho*(omega_*omega_*r[a1_] + 2*omega_*u[a2_]);
+            F[a2_] = rho*(omega_*omega_*r[a2_] - 2*omega_*u[a1_]);
+        }
+        const lbBase_t forceFactor = (1 - 0.5/tauRotor)*DXQY::c4Inv;
+        lbBase_t uF = 0;
+        for (int d = 0; d < nD; ++d)
+            uF += u[d]*F[d];
+        for (int q = 0; q < DXQY::nQ; ++q) {
+            const lbBase_t cu = DXQY::cDot(q, u);
+            const lbBase_t cF = DXQY::cDot(q, F);
+            lbBase_t ccPi = -DXQY::c2*trPi;
+            for (int i = 0; i < nD; ++i) {
+                for (int j = 0; j < nD; ++j)
+                    ccPi += DXQY::c(q, i)*DXQY::c(q, j)*pi[3*i + j];
+            }
+            const lbBase_t fq = DXQY::w[q]*(rho*(1.0 + DXQY::c2Inv*cu + DXQY::c4Inv0_5*(cu*cu - DXQY::c2*u2)) + neqFactor*ccPi
+                                            + 0.5*DXQY::c2Inv*cF + forceFactor*(cF*cu - DXQY::c2*uF));
+            fTarget(0, q, grid.neighbor(q, nodeNo)) = fq;
+        }
+    }
+}
+
+#endif // LBSLIDINGINTERFACE_H
@@ -0,0 +1,334 @@
+#ifndef LBSUBGRIDBOUNDARY_H
+#define LBSUBGRIDBOUNDARY_H
+
+#include <math.h>
+#include <map>
+#include <vector>
+#include <mpi.h>
+
+#include "LBglobal.h"
+#include "LBboundary.h"
+#include "LBboundarylinks.h"
+#include "LBgrid.h"
+#include "LBnodes.h"
+#include "LBfield.h"
+#include "LBprofiler.h"
+#include "Field.h"
+
+//  Linear  package
+#include <Eigen/Dense>
+#include <Eigen/SVD>
+
+/*********************************************************
+ * class ONENODESUBGRIDBND: one node subgrid boundary
+ *
+ * The distributions at a fluid boundary node are found from
+ *  a least squares fit of the moments (rho, j, Pi) to the
+ *  known distributions, with additional constraints on the
+ *  wall normal and tangential strain rates.
+ *
+ * The system matrix only depends on the geometry, so its
+ *  pseudo-inverse is computed once in the constructor. Only
+ *  the columns that multiply known distributions are kept,
+ *  stored as a fixed size (nCol_ x nQ) row-major block. Nodes
+ *  with identical system matrices share the same block.
+ *
+ * apply(...) is then a gather of the known distributions,
+ *  a small matrix vector product and a reconstruction of all
+ *  distributions, for all boundary nodes.
+ *
+ * Eigen is only used in the constructor.
+ *********************************************************/
+template <typename DXQY>
+class OneNodeSubGridBnd : public Boundary<DXQY>
+{
+public:
+    static constexpr int nCol_ = 1 + DXQY::nD + (DXQY::nD*(DXQY::nD + 1))/2; // Number of unknown moments
+
+    OneNodeSubGridBnd(const std::vector<int> bndNodes, const Nodes<DXQY> &nodes, const Grid<DXQY> &grid, const ScalarField &qDist, const VectorField<DXQY> &normals, const VectorField<DXQY> &tangents, const ScalarField &rho, const VectorField<DXQY> &force, lbBase_t tau);
+    ~OneNodeSubGridBnd() {}
+    template <typename S>
+    void apply(const int fieldNo, LbField<DXQY, S> &f, const Nodes<DXQY> &nodes, const Grid<DXQY> &grid);
+    inline int numMatrices() const {return static_cast<int>(pinv_.size())/(nCol_*DXQY::nQ);}
+private:
+    template <typename MT>
+    void matrixFillfa(const int row, MT & m, const int alpha);
+    template <typename MT, typename T>
+    void matrixFillSnn(const int row, MT & m, const lbBase_t qDist, T & normal, const lbBase_t un_wall, const lbBase_t Snn);
+    template <typename MT, typename T>
+    void matrixFillSnt(const int row, MT & m, const lbBase_t qDist, T & normal, T & tangent, const lbBase_t ut_wall,
+                       const lbBase_t dun_dt, const lbBase_t Fn,const lbBase_t Ft, const lbBase_t rho0, const lbBase_t tau);
+    template <typename MT, typename T>
+    void matrixFillStt(const int row, MT & m, T & tangent, const lbBase_t Stt, const lbBase_t Ft, const lbBase_t tau);
+
+    std::vector<lbBase_t> pinv_; // Pseudo-inverses, (nCol_ x nQ) row-major for each distinct matrix
+    std::vector<int> matrixNo_; // Pseudo-inverse used by each boundary node
+    std::vector<int> knownDir_; // nQ known directions for each boundary node, padded with the rest direction
+    lbBase_t fa_[DXQY::nQ*nCol_]; // Distributions from moments, (nQ x nCol_) row-major
+    BoundaryLinks massLinks_; // Links to bulk fluid nodes used in the mass balance
+    lbBase_t boundaryMass_;
+    lbBase_t boundarySizeGlobal_;
+};
+
+template <typename DXQY>
+OneNodeSubGridBnd<DXQY>::OneNodeSubGridBnd(const std::vector<int> bndNodes, const Nodes<DXQY> &nodes, const Grid<DXQY> &grid, const ScalarField &qDist, const VectorField<DXQY> &normals,  const VectorField<DXQY> &tangents, const ScalarField &rho,  const VectorField<DXQY> &force, const lbBase_t tau)
+    : Boundary<DXQY>(bndNodes, nodes, grid), matrixNo_(bndNodes.size()), knownDir_(bndNodes.size()*DXQY::nQ)
+{
+    // Reconstruction of the distributions from the moments, with the coefficients
+    // of the fit rows (matrixFillfa) so that the fitted moments are reproduced
+    for (int q = 0; q < DXQY::nQ; ++q) {
+        lbBase_t *row = &fa_[q*nCol_];
+        int col = 0;
+        row[col++] = 1.0;
+        for (int i=0; i < DXQY::nD; ++i)
+            row[col++] = DXQY::c(q, i) * DXQY::c2Inv;
+        for (int i=0; i < DXQY::nD; ++i) {
+            row[col++] = (DXQY::c(q, i)*DXQY::c(q, i) - DXQY::c2) * DXQY::c4Inv0_5;
+            for (int j = i+1; j < DXQY::nD; ++j)
+                row[col++] = DXQY::c(q, i)*DXQY::c(q, j) * DXQY::c4Inv;
+        }
+        for (int k = 0; k < nCol_; ++k)
+            row[k] *= DXQY::w[q];
+    }
+
+    std::map<std::vector<lbBase_t>, int> matrixMap; // Matrix entries to pseudo-inverse number
+    Eigen::MatrixXd m;
+    // Mass at boundary
+    boundaryMass_ = 0;
+    for (int n=0; n < this->size(); ++n) {
+        int nodeNo = this->nodeNo(n);
+        int nKnown = 1 + this->nBeta(n) + 2*(this->nGamma(n));
+        int nRow = nKnown + 3;
+        // Setup matrix
+        m.resize(nRow, nCol_);
+        int row = 0;
+        int *dir = &knownDir_[n*DXQY::nQ];
+        // -- Setup equations from fa
+        // -- -- beta_reversed
+        for (auto beta: this->beta(n)) {
+            int betaRev = this->dirRev(beta);
+            dir[row] = betaRev;
+            matrixFillfa(row++, m, betaRev);
+            massLinks_.add(grid.neighbor(beta, nodeNo), beta, betaRev, nodeNo);
+        }
+        // -- -- gamma and gamma_reversed
+        for (auto gamma: this->gamma(n)) {
+            int gammaRev = this->dirRev(gamma);
+            dir[row] = gamma;
+            matrixFillfa(row++, m, gamma);
+            dir[row] = gammaRev;
+            matrixFillfa(row++, m, gammaRev);
+            massLinks_.add(grid.neighbor(gammaRev, nodeNo), gammaRev, gamma, nodeNo);
+            massLinks_.add(grid.neighbor(gamma, nodeNo), gamma, gammaRev, nodeNo);
+        }
+        // -- -- zero velocity
+        int zeroVelDir = DXQY::nQ-1;
+        for (int k = row; k < DXQY::nQ; ++k)
+            dir[k] = zeroVelDir;
+        matrixFillfa(row++, m, zeroVelDir);
+        // Setup equations from Snn
+        lbBase_t q = qDist(0, nodeNo);
+        std::valarray<lbBase_t> nVec = normals(0, nodeNo);
+        lbBase_t unWall = 0.0;
+        lbBase_t snn = 0.0;
+        matrixFillSnn(row++, m, q, nVec, unWall, snn);
+        // Setup equations from Snt
+        std::valarray<lbBase_t> tVec = tangents(0, nodeNo);
+        lbBase_t utWall = 0.0;
+        lbBase_t dundt = 0.0;
+        int nforce = 0;
+        if (force.getNumNodes() > 1)
+            nforce = nodeNo;
+        std::valarray<lbBase_t> F = force(0, nforce);
+        lbBase_t Fn = 0;
+        lbBase_t Ft = 0;
+        for (int i = 0; i < DXQY::nD; ++i) {
+            Fn += nVec[i]*F[i];
+            Ft += tVec[i]*F[i];
+        }
+        lbBase_t rho0 = 1.0;
+        matrixFillSnt(row++, m, q, nVec, tVec, utWall, dundt, Fn, Ft, rho0, tau);
+        // Setup equations frmo Stt
+        lbBase_t Stt = 0;
+        matrixFillStt(row++, m, tVec, Stt, Ft, tau);
+
+        // Reuse the pseudo-inverse if the matrix has been seen before
+        std::vector<lbBase_t> key(m.data(), m.data() + m.size());
+        key.push_back(nRow);
+        auto it = matrixMap.find(key);
+        if (it != matrixMap.end()) {
+            matrixNo_[n] = it->second;
+        }
+        else {
+            // Setup Singular Value Decomposition
+            Eigen::BDCSVD<Eigen::MatrixXd> svd(m, Eigen::ComputeThinU | Eigen::ComputeThinV);
+            // Check that the boundary conditions has enough data to solve the system.
+            if (svd.rank() < nCol_) {
+                std::cout << "Error in the boundary conditions: rank (" << svd.rank() << ") is less than number of unknowns (" << nCol_ << ")." << std::endl;
+            }
+            Eigen::MatrixXd pinv = svd.solve(Eigen::MatrixXd::Identity(nRow, nRow));
+            // Only the known distributions have non-zero right hand sides
+            const int matrixNo = numMatrices();
+            pinv_.resize(pinv_.size() + nCol_*DXQY::nQ, 0.0);
+            lbBase_t *P = &pinv_[matrixNo*nCol_*DXQY::nQ];
+            for (int i = 0; i < nCol_; ++i)
+                for (int k = 0; k < nKnown; ++k)
+                    P[i*DXQY::nQ + k] = pinv(i, k);
+            matrixMap[key] = matrixNo;
+            matrixNo_[n] = matrixNo;
+        }
+        // Find the total mass
+        boundaryMass_ += rho(0, nodeNo) - 1;
+    }
+
+    // Only keep links to bulk fluid nodes in the mass balance
+    BoundaryLinks bulkLinks;
+    for (int l = 0; l < massLinks_.size(); ++l) {
+        if (nodes.isBulkFluid(massLinks_.node(l)))
+            bulkLinks.add(massLinks_.node(l), massLinks_.qIn(l), massLinks_.qOut(l), massLinks_.neighbor(l));
+    }
+    massLinks_ = bulkLinks;
+
+    lbBase_t boundarySize = this->size();
+    MPI_Allreduce(&boundarySize, &boundarySizeGlobal_, 1, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+}
+
+template <typename DXQY>
+template <typename MT>
+void OneNodeSubGridBnd<DXQY>::matrixFillfa(const int row, MT &m, const int a)
+{
+    int col = 0;
+    m(row, col++) = DXQY::w[a];  // rho
+    for (int i=0; i < DXQY::nD; ++i) {  // j_i
+        m(row, col++) = DXQY::w[a] * DXQY::c(a, i) * DXQY::c2Inv;
+    }
+    for (int i=0; i < DXQY::nD; ++i) {  // Pi_ij
+        m(row, col++) = DXQY::w[a] * (DXQY::c(a, i)*DXQY::c(a, i) - DXQY::c2) * DXQY::c4Inv0_5;
+        for (int j = i+1; j < DXQY::nD; ++j) {
+            m(row, col++) = DXQY::w[a] * DXQY::c(a, i)*DXQY::c(a, j) * DXQY::c4Inv;
+        }
+    }
+}
+
+template <typename DXQY>
+template <typename MT, typename T>
+void OneNodeSubGridBnd<DXQY>::matrixFillSnn(const int row, MT &m, const lbBase_t q, T & n, const lbBase_t un, const lbBase_t Snn)
+{
+    int col = 0;
+    m(row, col++) = q*Snn + un;
+    for (int i = 0; i < DXQY::nD; ++i) {
+        m(row, col++) = -n[i];
+    }
+    for (int i = 0; i < DXQY::nD; ++i) {
+        for (int j = i; j < DXQY::nD; ++j) {
+            m(row, col++) = 0;
+        }
+    }
+}
+
+template <typename DXQY>
+template <typename MT, typename T>
+void OneNodeSubGridBnd<DXQY>::matrixFillSnt(const int row, MT & m, const lbBase_t q, T & n, T & t, const lbBase_t ut,
+        const lbBase_t dudt, const lbBase_t Fn, const lbBase_t Ft, const lbBase_t rho0, const lbBase_t tau)
+{
+    int col = 0;
+    m(row, col++) = q*dudt - ut;
+    lbBase_t k = 1.0/(2*DXQY::c2*tau*rho0);
+    for (int i = 0; i < DXQY::nD; ++i) {
+        m(row, col++) = t[i] + q*k*(t[i]*Fn + n[i]*Ft);
+    }
+    lbBase_t k2 = DXQY::c2Inv/tau;
+    for (int i = 0; i < DXQY::nD; ++i) {
+        m(row, col++) = k2*q*n[i]*t[i];
+        for (int j = i+1; j < DXQY::nD; ++j) {
+            m(row, col++) = q*k2*(t[i]*n[j] + t[j]*n[i]);
+        }
+    }
+}
+
+template <typename DXQY>
+template <typename MT, typename T>
+void OneNodeSubGridBnd<DXQY>::matrixFillStt(const int row, MT & m, T & t, const lbBase_t Stt,
+        const lbBase_t Ft, const lbBase_t tau)
+{
+    int col = 0;
+    m(row, col++) = Stt;
+    lbBase_t k1 = 0.5*DXQY::c2Inv/tau;
+    for (int i=0; i<DXQY::nD; ++i) {
+        m(row, col++) = k1*t[i]*Ft;
+    }
+    lbBase_t k2 = DXQY::c2Inv/tau;
+    for (int i=0; i<DXQY::nD; ++i) {
+        m(row, col++) = k1*t[i]*t[i];
+        for (int j=i+1; j<DXQY::nD; ++j) {
+            m(row, col++) = k2*t[i]*t[j];
+        }
+    }
+}
+
+template <typename DXQY>
+template <typename S>
+void OneNodeSubGridBnd<DXQY>::apply(const int fieldNo, LbField<DXQY, S> &f, const Nodes<DXQY> &nodes, const Grid<DXQY> &grid)
+/* apply : sets all distributions at the boundary nodes from the fitted moments,
+ *  and distributes the mass lost or gained equally on all boundary nodes.
+ *
+ * fieldNo : the lB-field number
+ * f       : the field object
+ * nodes   : nodes object
+ * grid    : grid object
+ */
+{
+    static const int region = profiler().region("OneNodeSubGridBnd::apply");
+    ScopedTimer timer(region);
+    // Mass streamed between the boundary and the bulk
+    lbBase_t deltaMass[2] = {0, 0}; // {wall, bulk}
+    for (int l = 0; l < massLinks_.size(); ++l) {
+        deltaMass[1] += f(fieldNo, massLinks_.qIn(l), massLinks_.node(l)) - f(fieldNo, massLinks_.qOut(l), massLinks_.neighbor(l));
+    }
+
+    lbBase_t predictedBoundaryMass = 0;
+    for (int n = 0; n < this->size(); ++n) {
+        const int nodeNo = this->nodeNo(n);
+        const int *dir = &knownDir_[n*DXQY::nQ];
+        const lbBase_t *P = &pinv_[matrixNo_[n]*nCol_*DXQY::nQ];
+        // Gather the known directions. Padded entries have zero coefficients.
+        lbBase_t rhs[DXQY::nQ];
+        for (int k = 0; k < DXQY::nQ; ++k)
+            rhs[k] = f(fieldNo, dir[k], nodeNo);
+        // Moments
+        lbBase_t x[nCol_];
+        for (int i = 0; i < nCol_; ++i) {
+            lbBase_t sum = 0;
+            for (int k = 0; k < DXQY::nQ; ++k)
+                sum += P[i*DXQY::nQ + k]*rhs[k];
+            x[i] = sum;
+        }
+        predictedBoundaryMass += x[0] - 1;
+        // Set new distributions
+        for (int q = 0; q < DXQY::nQ; ++q) {
+            lbBase_t sum = 0;
+            for (int k = 0; k < nCol_; ++k)
+                sum += fa_[q*nCol_ + k]*x[k];
+            f(fieldNo, q, nodeNo) = sum;
+        }
+    }
+    deltaMass[0] = predictedBoundaryMass - boundaryMass_;
+
+    lbBase_t deltaMassGlobal[2];
+    MPI_Allreduce(deltaMass, deltaMassGlobal, 2, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+
+    lbBase_t addMass = -(deltaMassGlobal[0] + deltaMassGlobal[1]) / boundarySizeGlobal_;
+
+    // Update the boundary mass
+    boundaryMass_ = predictedBoundaryMass + this->size() * addMass;
+
+    for (int n = 0; n < this->size(); ++n) {
+        int nodeNo = this->nodeNo(n);
+        for (int q = 0; q < DXQY::nQ; ++q) {
+            f(fieldNo, q, nodeNo) += DXQY::w[q]*addMass;
+        }
+    }
+}
+
+
+#endif // LBSUBGRIDBOUNDARY_H
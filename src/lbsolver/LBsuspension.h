@@ -0,0 +1,681 @@
+#ifndef LBSUSPENSION_H
+#define LBSUSPENSION_H
+
+#include <cmath>
+#include <functional>
+#include <iostream>
+#include <unordered_map>
+#include <vector>
+#include <valarray>
+#include <mpi.h>
+#include "LBglobal.h"
+#include "LBlatticetypes.h"
+#include "LBnodes.h"
+#include "LBgrid.h"
+#include "LBfield.h"
+#include "LBprofiler.h"
+#include "LBbndmpi.h"
+#include "LBboundarylinks.h"
+#include "LBrigidbody.h"
+
+/*********************************************************
+ * struct SUSPENSIONPARTICLE: spherical particle in a suspension
+ *********************************************************/
+struct SuspensionParticle
+{
+    SuspensionParticle(const int idIn, const lbBase_t radiusIn, const RigidBody &bodyIn) : id(idIn), radius(radiusIn), body(bodyIn) {}
+    int id;  // Global particle id
+    lbBase_t radius;
+    RigidBody body;
+};
+
+/* Pair force hook : returns the force on particle a from particle b (3 components).
+ */
+using SuspensionPairForce = std::function<std::valarray<lbBase_t>(const SuspensionParticle &a, const SuspensionParticle &b)>;
+
+
+inline SuspensionPairForce softSphereContact(const lbBase_t stiffness)
+/* softSphereContact : Hertz type repulsion F = k delta^(3/2) n for overlapping particles
+ *
+ * stiffness : k
+ */
+{
+    return [stiffness](const SuspensionParticle &a, const SuspensionParticle &b) {
+        std::valarray<lbBase_t> n = a.body.position() - b.body.position();
+        const lbBase_t dist = std::sqrt((n*n).sum());
+        const lbBase_t overlap = a.radius + b.radius - dist;
+        if ((overlap <= 0) || (dist < lbBaseEps))
+            return std::valarray<lbBase_t>(0.0, 3);
+        n /= dist;
+        return std::valarray<lbBase_t>(stiffness*std::pow(overlap, 1.5)*n);
+    };
+}
+
+
+inline SuspensionPairForce lubricationForce(const lbBase_t viscosity, const lbBase_t gapCutoff, const lbBase_t gapMin=0.01)
+/* lubricationForce : normal lubrication correction for gaps smaller than the
+ *  cutoff, where the lattice no longer resolves the film,
+ *     F = -6 pi mu R_eff^2 (u_rel . n) (1/h - 1/h_c) n,  R_eff = R_a R_b/(R_a + R_b)
+ *
+ * viscosity : kinematic viscosity times density (lattice units)
+ * gapCutoff : h_c
+ * gapMin    : smallest gap used, to limit the force
+ */
+{
+    return [viscosity, gapCutoff, gapMin](const SuspensionParticle &a, const SuspensionParticle &b) {
+        std::valarray<lbBase_t> n = a.body.position() - b.body.position();
+        const lbBase_t dist = std::sqrt((n*n).sum());
+        const lbBase_t gap = std::max(dist - a.radius - b.radius, gapMin);
+        if ((gap >= gapCutoff) || (dist < lbBaseEps))
+            return std::valarray<lbBase_t>(0.0, 3);
+        n /= dist;
+        const lbBase_t rEff = a.radius*b.radius/(a.radius + b.radius);
+        const lbBase_t un = ((a.body.velocity() - b.body.velocity())*n).sum();
+        return std::valarray<lbBase_t>(-6*3.14159265358979323846*viscosity*rEff*rEff*un*(1.0/gap - 1.0/gapCutoff)*n);
+    };
+}
+
+
+/*********************************************************
+ * class PARTICLESUSPENSION: many freely moving spherical
+ *  particles with halfway bounce back and momentum exchange.
+ *
+ * Node queries use a cell list over Grid::pos, so a particle
+ *  only checks the nodes in the cells that overlap its
+ *  bounding box.
+ *
+ * Each particle is owned by the rank that owns the node
+ *  nearest to its center. The owner integrates the motion.
+ *  Copies of particles close to a neighbor rank (found from
+ *  the BndMpi neighbor list and the ghost nodes) are sent to
+ *  that rank every step. Force contributions to the copies are
+ *  sent back to the owner, and particles that cross into a
+ *  neighbor domain are migrated to the new owner.
+ *  Particles must be smaller than the subdomains, and move
+ *  less than one lattice spacing per step. Periodic images are
+ *  not handled.
+ *
+ * Use per time step, after propagation and mpi communication:
+ *     mpiBoundary.communciateScalarField(rho);
+ *     suspension.update(nodes, grid);
+ *     suspension.apply(0, f, grid);
+ *     suspension.refill(0, f, rho, nodes, grid);
+ *     suspension.step(nodes, grid, nSubSteps);
+ *  where rho is the density set in the collision, see refill.
+ *********************************************************/
+template <typename DXQY>
+class ParticleSuspension
+{
+public:
+    ParticleSuspension(const BndMpi<DXQY> &mpiBoundary, const Nodes<DXQY> &nodes, const Grid<DXQY> &grid, const int cellSize=8);
+
+    void addParticle(const int id, const lbBase_t radius, const lbBase_t mass, const std::valarray<lbBase_t> &inertia, const std::valarray<lbBase_t> &position, const Nodes<DXQY> &nodes, const Grid<DXQY> &grid);
+    void addPairForce(const SuspensionPairForce &pairForce) {pairForces_.push_back(pairForce);}
+    void setFreedom(const std::valarray<lbBase_t> &translation, const std::valarray<lbBase_t> &rotation) {linFree_ = translation; angFree_ = rotation;}
+    void setExternalForce(const std::valarray<lbBase_t> &force) {externalForce_ = force;}
+
+    void update(const Nodes<DXQY> &nodes, const Grid<DXQY> &grid);
+    template <typename S>
+    void apply(const int fieldNo, LbField<DXQY, S> &f, const Grid<DXQY> &grid, const lbBase_t rho0=1.0);
+    template <typename S>
+    void refill(const int fieldNo, LbField<DXQY, S> &f, const ScalarField &rho, const Nodes<DXQY> &nodes, const Grid<DXQY> &grid);
+    void step(const Nodes<DXQY> &nodes, const Grid<DXQY> &grid, const int nSubSteps=1);
+
+    template <typename F>
+    void forNodesInBox(const std::valarray<lbBase_t> &lo, const std::valarray<lbBase_t> &hi, F func) const;
+
+    inline int numOwned() const {return nOwned_;}
+    inline int numLocal() const {return static_cast<int>(particles_.size());}
+    inline const SuspensionParticle & particle(const int n) const {return particles_[n];}
+    inline int particleId(const int nodeNo) const {return ownerId_[nodeNo];}
+    inline bool isSolid(const int nodeNo) const {return ownerId_[nodeNo] >= 0;}
+    inline int numLinks() const {return links_.size();}
+    int numGlobal() const;
+
+private:
+    int cellNo(const lbBase_t *x) const;
+    int nearestNode(const std::valarray<lbBase_t> &x, const Grid<DXQY> &grid) const;
+    std::valarray<lbBase_t> wallVelocity(const SuspensionParticle &p, const lbBase_t *x) const;
+    void addForce(const int particleNo, const lbBase_t *x, const lbBase_t *F);
+    std::vector<lbBase_t> exchange(const int neigRank, const std::vector<lbBase_t> &sendBuffer) const;
+    std::vector<lbBase_t> pack(const SuspensionParticle &p) const;
+    SuspensionParticle unpack(const lbBase_t *buffer) const;
+    void exchangeHalo();
+
+    static constexpr int packSize_ = 19;  // id, radius, mass, inertia (3), state (13)
+    int myRank_;
+
+    // Cell list over the node positions
+    int cellSize_;
+    int cellLo_[3];  // Lowest node position
+    int nCells_[3];  // Number of cells in each direction
+    std::vector<int> cellStart_;  // CSR offsets
+    std::vector<int> cellNodes_;  // Nodes sorted by cell
+
+    // Mpi topology
+    std::vector<int> neigRanks_;
+    std::vector<std::valarray<lbBase_t>> ghostLo_;  // Bounding box of the ghost nodes of each neighbor rank
+    std::vector<std::valarray<lbBase_t>> ghostHi_;
+
+    // Particles: owned particles first, then copies from neighbor ranks
+    std::vector<SuspensionParticle> particles_;
+    std::vector<int> ownerRank_;
+    int nOwned_;
+    std::unordered_map<int, int> idToLocal_;
+    std::vector<lbBase_t> forceTorque_;  // 6 values for each local particle
+    std::vector<SuspensionPairForce> pairForces_;
+    std::valarray<lbBase_t> linFree_;
+    std::valarray<lbBase_t> angFree_;
+    std::valarray<lbBase_t> externalForce_;
+
+    // Node coverage
+    std::vector<int> ownerId_;  // Id of the particle covering the node, or -1
+    std::vector<int> coveredList_;  // Nodes with ownerId_ >= 0
+    std::vector<int> freshNodes_;
+    std::vector<int> freshIds_;  // Id of the particle that left the fresh node
+    std::vector<int> newlyCovered_;
+    BoundaryLinks links_;  // (fluid node, unknown q, qRev, covered node)
+    std::vector<int> linkParticle_;  // Local particle number of each link
+};
+
+
+template <typename DXQY>
+ParticleSuspension<DXQY>::ParticleSuspension(const BndMpi<DXQY> &mpiBoundary, const Nodes<DXQY> &nodes, const Grid<DXQY> &grid, const int cellSize)
+    : cellSize_(cellSize), neigRanks_(mpiBoundary.neighborRanks()), nOwned_(0), linFree_(1.0, 3), angFree_(1.0, 3), externalForce_(0.0, 3),
+      ownerId_(grid.size(), -1)
+/* mpiBoundary : the mpi boundary object, used for the neighbor ranks
+ * cellSize    : side length of the cells in the node cell list
+ */
+{
+    MPI_Comm_rank(MPI_COMM_WORLD, &myRank_);
+
+    // Setup the cell list
+    int hi[3] = {0, 0, 0};
+    for (int d = 0; d < 3; ++d) {
+        cellLo_[d] = 0;
+        nCells_[d] = 1;
+    }
+    for (int d = 0; d < DXQY::nD; ++d) {
+        cellLo_[d] = grid.pos(1, d);
+        hi[d] = grid.pos(1, d);
+    }
+    for (int n = 1; n < grid.size(); ++n) {
+        for (int d = 0; d < DXQY::nD; ++d) {
+            cellLo_[d] = std::min(cellLo_[d], grid.pos(n, d));
+            hi[d] = std::max(hi[d], grid.pos(n, d));
+        }
+    }
+    for (int d = 0; d < DXQY::nD; ++d)
+        nCells_[d] = (hi[d] - cellLo_[d])/cellSize_ + 1;
+
+    cellStart_.assign(nCells_[0]*nCells_[1]*nCells_[2] + 1, 0);
+    std::vector<int> nodeCell(grid.size(), 0);
+    for (int n = 1; n < grid.size(); ++n) {
+        lbBase_t x[3] = {0, 0, 0};
+        for (int d = 0; d < DXQY::nD; ++d)
+            x[d] = grid.pos(n, d);
+        nodeCell[n] = cellNo(x);
+        cellStart_[nodeCell[n] + 1] += 1;
+    }
+    for (std::size_t c = 1; c < cellStart_.size(); ++c)
+        cellStart_[c] += cellStart_[c-1];
+    cellNodes_.resize(grid.size() - 1);
+    std::vector<int> cnt(cellStart_.begin(), cellStart_.end() - 1);
+    for (int n = 1; n < grid.size(); ++n)
+        cellNodes_[cnt[nodeCell[n]]++] = n;
+
+    // Bounding boxes of the ghost nodes of each neighbor rank
+    for (const auto &rank: neigRanks_) {
+        std::valarray<lbBase_t> lo(1e30, 3), hiBox(-1e30, 3);
+        for (int d = DXQY::nD; d < 3; ++d) {
+            lo[d] = 0;
+            hiBox[d] = 0;
+        }
+        for (int n = 1; n < grid.size(); ++n) {
+            if (nodes.getRank(n) == rank) {
+                for (int d = 0; d < DXQY::nD; ++d) {
+                    lo[d] = std::min(lo[d], static_cast<lbBase_t>(grid.pos(n, d)));
+                    hiBox[d] = std::max(hiBox[d], static_cast<lbBase_t>(grid.pos(n, d)));
+                }
+            }
+        }
+        ghostLo_.push_back(lo);
+        ghostHi_.push_back(hiBox);
+    }
+}
+
+
+template <typename DXQY>
+int ParticleSuspension<DXQY>::cellNo(const lbBase_t *x) const
+{
+    int ret = 0;
+    for (int d = DXQY::nD - 1; d >= 0; --d) {
+        int i = static_cast<int>(std::floor((x[d] - cellLo_[d])/cellSize_));
+        i = std::min(std::max(i, 0), nCells_[d] - 1);
+        ret = ret*nCells_[d] + i;
+    }
+    return ret;
+}
+
+
+template <typename DXQY>
+template <typename F>
+void ParticleSuspension<DXQY>::forNodesInBox(const std::valarray<lbBase_t> &lo, const std::valarray<lbBase_t> &hi, F func) const
+/* forNodesInBox : calls func(nodeNo) for all nodes in the cells that overlap
+ *  the box [lo, hi]. The caller must check the node position.
+ */
+{
+    int cLo[3] = {0, 0, 0}, cHi[3] = {0, 0, 0};
+    for (int d = 0; d < DXQY::nD; ++d) {
+        cLo[d] = static_cast<int>(std::floor((lo[d] - cellLo_[d])/cellSize_));
+        cHi[d] = static_cast<int>(std::floor((hi[d] - cellLo_[d])/cellSize_));
+        if ((cHi[d] < 0) || (cLo[d] >= nCells_[d]))
+            return;
+        cLo[d] = std::max(cLo[d], 0);
+        cHi[d] = std::min(cHi[d], nCells_[d] - 1);
+    }
+    for (int k = cLo[2]; k <= cHi[2]; ++k) {
+        for (int j = cLo[1]; j <= cHi[1]; ++j) {
+            for (int i = cLo[0]; i <= cHi[0]; ++i) {
+                const int c = (k*nCells_[1] + j)*nCells_[0] + i;
+                for (int m = cellStart_[c]; m < cellStart_[c+1]; ++m)
+                    func(cellNodes_[m]);
+            }
+        }
+    }
+}
+
+
+template <typename DXQY>
+int ParticleSuspension<DXQY>::nearestNode(const std::valarray<lbBase_t> &x, const Grid<DXQY> &grid) const
+/* nearestNode : local node at the rounded position x, or -1 if not found
+ */
+{
+    int ret = -1;
+    std::valarray<lbBase_t> xr(0.0, 3);
+    for (int d = 0; d < DXQY::nD; ++d)
+        xr[d] = std::round(x[d]);
+    forNodesInBox(xr, xr, [&](const int nodeNo) {
+        bool same = true;
+        for (int d = 0; d < DXQY::nD; ++d)
+            same = same && (grid.pos(nodeNo, d) == xr[d]);
+        if (same)
+            ret = nodeNo;
+    });
+    return ret;
+}
+
+
+template <typename DXQY>
+void ParticleSuspension<DXQY>::addParticle(const int id, const lbBase_t radius, const lbBase_t mass, const std::valarray<lbBase_t> &inertia, const std::valarray<lbBase_t> &position, const Nodes<DXQY> &nodes, const Grid<DXQY> &grid)
+/* addParticle : adds a particle if its center is on this rank. Can be called with
+ *  the same arguments on all ranks.
+ *
+ * id       : unique particle id (>= 0)
+ * radius   : particle radius
+ * mass     : particle mass
+ * inertia  : principal moments of inertia (3 components)
+ * position : center position (3 components)
+ */
+{
+    const int nodeNo = nearestNode(position, grid);
+    if ((nodeNo > 0) && nodes.isMyRank(nodeNo)) {
+        RigidBody body(mass, inertia, position);
+        body.setFreedom(linFree_, angFree_);
+        body.setExternalForce(externalForce_);
+        particles_.insert(particles_.begin() + nOwned_, SuspensionParticle(id, radius, body));
+        ownerRank_.insert(ownerRank_.begin() + nOwned_, myRank_);
+        nOwned_ += 1;
+    }
+}
+
+
+template <typename DXQY>
+int ParticleSuspension<DXQY>::numGlobal() const
+{
+    int ret = 0;
+    MPI_Allreduce(&nOwned_, &ret, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+    return ret;
+}
+
+
+template <typename DXQY>
+std::vector<lbBase_t> ParticleSuspension<DXQY>::pack(const SuspensionParticle &p) const
+{
+    std::vector<lbBase_t> ret(packSize_);
+    ret[0] = p.id;
+    ret[1] = p.radius;
+    ret[2] = p.body.mass();
+    for (int d = 0; d < 3; ++d)
+        ret[3 + d] = p.body.inertia()[d];
+    const auto state = p.body.state();
+    for (int i = 0; i < 13; ++i)
+        ret[6 + i] = state[i];
+    return ret;
+}
+
+
+template <typename DXQY>
+SuspensionParticle ParticleSuspension<DXQY>::unpack(const lbBase_t *buffer) const
+{
+    RigidBody body(buffer[2], std::valarray<lbBase_t>(buffer + 3, 3), std::valarray<lbBase_t>(buffer + 6, 3));
+    body.setFreedom(linFree_, angFree_);
+    body.setExternalForce(externalForce_);
+    body.setState(std::valarray<lbBase_t>(buffer + 6, 13));
+    return SuspensionParticle(static_cast<int>(buffer[0]), buffer[1], body);
+}
+
+
+template <typename DXQY>
+std::vector<lbBase_t> ParticleSuspension<DXQY>::exchange(const int neigRank, const std::vector<lbBase_t> &sendBuffer) const
+/* exchange : sends a variable sized buffer to neigRank and receives one from it
+ */
+{
+    int nSend = static_cast<int>(sendBuffer.size());
+    int nRecv = 0;
+    MPI_Sendrecv(&nSend, 1, MPI_INT, neigRank, 0, &nRecv, 1, MPI_INT, neigRank, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+    std::vector<lbBase_t> ret(nRecv);
+    MPI_Sendrecv(sendBuffer.data(), nSend, MPI_DOUBLE, neigRank, 1, ret.data(), nRecv, MPI_DOUBLE, neigRank, 1, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+    return ret;
+}
+
+
+template <typename DXQY>
+void ParticleSuspension<DXQY>::exchangeHalo()
+/* exchangeHalo : replaces the copies of neighbor particles. Owned particles
+ *  whose bounding box overlaps the ghost nodes of a neighbor rank are sent to it.
+ */
+{
+    particles_.erase(particles_.begin() + nOwned_, particles_.end());
+    ownerRank_.resize(nOwned_);
+    for (std::size_t r = 0; r < neigRanks_.size(); ++r) {
+        std::vector<lbBase_t> sendBuffer;
+        for (int n = 0; n < nOwned_; ++n) {
+            const auto &p = particles_[n];
+            bool overlap = true;
+            for (int d = 0; d < DXQY::nD; ++d) {
+                const lbBase_t x = p.body.position()[d];
+                const lbBase_t ext = p.radius + 2;
+                overlap = overlap && (x + ext >= ghostLo_[r][d]) && (x - ext <= ghostHi_[r][d]);
+            }
+            if (overlap) {
+                const auto buffer = pack(p);
+                sendBuffer.insert(sendBuffer.end(), buffer.begin(), buffer.end());
+            }
+        }
+        const auto recvBuffer = exchange(neigRanks_[r], sendBuffer);
+        for (std::size_t i = 0; i < recvBuffer.size(); i += packSize_) {
+            particles_.push_back(unpack(&recvBuffer[i]));
+            ownerRank_.push_back(neigRanks_[r]);
+        }
+    }
+    idToLocal_.clear();
+    for (std::size_t n = 0; n < particles_.size(); ++n)
+        idToLocal_[particles_[n].id] = static_cast<int>(n);
+    forceTorque_.assign(6*particles_.size(), 0.0);
+}
+
+
+template <typename DXQY>
+void ParticleSuspension<DXQY>::update(const Nodes<DXQY> &nodes, const Grid<DXQY> &grid)
+/* update : receives neighbor particles, finds the covered nodes and sets up
+ *  the bounce back links. Only nodes in the cells that overlap each particle's
+ *  bounding box are checked.
+ */
+{
+    exchangeHalo();
+
+    // Clear the previous coverage, and remember the previous owners
+    std::vector<int> prevId(coveredList_.size());
+    for (std::size_t i = 0; i < coveredList_.size(); ++i) {
+        prevId[i] = ownerId_[coveredList_[i]];
+        ownerId_[coveredList_[i]] = -2;  // Marks previously covered
+    }
+    const std::vector<int> prevList = coveredList_;
+    coveredList_.clear();
+    newlyCovered_.clear();
+
+    // Cover nodes
+    for (const auto &p: particles_) {
+        const std::valarray<lbBase_t> &X = p.body.position();
+        const lbBase_t r2 = p.radius*p.radius;
+        forNodesInBox(X - p.radius, X + p.radius, [&](const int nodeNo) {
+            if ((ownerId_[nodeNo] >= 0) || !nodes.isFluid(nodeNo))
+                return;
+            lbBase_t dist2 = 0;
+            for (int d = 0; d < DXQY::nD; ++d) {
+                const lbBase_t dx = grid.pos(nodeNo, d) - X[d];
+                dist2 += dx*dx;
+            }
+            if (dist2 < r2) {
+                if (ownerId_[nodeNo] == -1)
+                    newlyCovered_.push_back(nodeNo);
+                ownerId_[nodeNo] = p.id;
+                coveredList_.push_back(nodeNo);
+            }
+        });
+    }
+
+    // Fresh nodes
+    freshNodes_.clear();
+    freshIds_.clear();
+    for (std::size_t i = 0; i < prevList.size(); ++i) {
+        const int nodeNo = prevList[i];
+        if (ownerId_[nodeNo] == -2) {
+            ownerId_[nodeNo] = -1;
+            freshNodes_.push_back(nodeNo);
+            freshIds_.push_back(prevId[i]);
+        }
+    }
+
+    // Links from covered nodes to fluid nodes on this rank
+    links_ = BoundaryLinks();
+    linkParticle_.clear();
+    for (const auto &nodeNo: coveredList_) {
+        const int particleNo = idToLocal_[ownerId_[nodeNo]];
+        for (int q = 0; q < DXQY::nQ - 1; ++q) {
+            const int neigNo = grid.neighbor(q, nodeNo);
+            if ((neigNo > 0) && nodes.isFluid(neigNo) && nodes.isMyRank(neigNo) && (ownerId_[neigNo] < 0)) {
+                links_.add(neigNo, q, DXQY::reverseDirection(q), nodeNo);
+                linkParticle_.push_back(particleNo);
+            }
+        }
+    }
+}
+
+
+template <typename DXQY>
+std::valarray<lbBase_t> ParticleSuspension<DXQY>::wallVelocity(const SuspensionParticle &p, const lbBase_t *x) const
+{
+    const std::valarray<lbBase_t> &X = p.body.position();
+    const std::valarray<lbBase_t> w = p.body.omegaWorld();
+    const lbBase_t r[3] = {x[0] - X[0], x[1] - X[1], x[2] - X[2]};
+    std::valarray<lbBase_t> ret(DXQY::nD);
+    const lbBase_t wr[3] = {w[1]*r[2] - w[2]*r[1], w[2]*r[0] - w[0]*r[2], w[0]*r[1] - w[1]*r[0]};
+    for (int d = 0; d < DXQY::nD; ++d)
+        ret[d] = p.body.velocity()[d] + wr[d];
+    return ret;
+}
+
+
+template <typename DXQY>
+void ParticleSuspension<DXQY>::addForce(const int particleNo, const lbBase_t *x, const lbBase_t *F)
+{
+    const std::valarray<lbBase_t> &X = particles_[particleNo].body.position();
+    const lbBase_t r[3] = {x[0] - X[0], x[1] - X[1], x[2] - X[2]};
+    lbBase_t *ft = &forceTorque_[6*particleNo];
+    for (int d = 0; d < 3; ++d)
+        ft[d] += F[d];
+    ft[3] += r[1]*F[2] - r[2]*F[1];
+    ft[4] += r[2]*F[0] - r[0]*F[2];
+    ft[5] += r[0]*F[1] - r[1]*F[0];
+}
+
+
+template <typename DXQY>
+template <typename S>
+void ParticleSuspension<DXQY>::apply(const int fieldNo, LbField<DXQY, S> &f, const Grid<DXQY> &grid, const lbBase_t rho0)
+/* apply : moving wall halfway bounce back on all particle links, and momentum
+ *  exchange force and torque on the particles.
+ */
+{
+    static const int region = profiler().region("ParticleSuspension::apply");
+    ScopedTimer timer(region);
+    for (int l = 0; l < links_.size(); ++l) {
+        const int nodeNo = links_.node(l);
+        const int q = links_.qIn(l);
+        const int qRev = links_.qOut(l);
+        const int particleNo = linkParticle_[l];
+        lbBase_t xWall[3] = {0, 0, 0};
+        for (int d = 0; d < DXQY::nD; ++d)
+            xWall[d] = grid.pos(nodeNo, d) + 0.5*DXQY::c(qRev, d);
+        const auto uWall = wallVelocity(particles_[particleNo], xWall);
+        const lbBase_t fOut = f(fieldNo, qRev, links_.neighbor(l));
+        const lbBase_t fIn = fOut + 2*DXQY::w[q]*rho0*DXQY::cDot(q, &uWall[0])*DXQY::c2Inv;
+        f(fieldNo, q, nodeNo) = fIn;
+        lbBase_t F[3] = {0, 0, 0};
+        for (int d = 0; d < DXQY::nD; ++d)
+            F[d] = (fOut + fIn)*DXQY::c(qRev, d);
+        addForce(particleNo, xWall, F);
+    }
+}
+
+
+template <typename DXQY>
+template <typename S>
+void ParticleSuspension<DXQY>::refill(const int fieldNo, LbField<DXQY, S> &f, const ScalarField &rho, const Nodes<DXQY> &nodes, const Grid<DXQY> &grid)
+/* refill : equilibrium at uncovered nodes, and momentum exchange for
+ *  uncovered and newly covered nodes.
+ *
+ * rho : density field fieldNo, also on the ghost nodes. Ghost nodes only hold the
+ *       streamed directions of f, so the mean density of the neighbors is taken
+ *       from rho, which makes it the same for any number of ranks.
+ */
+{
+    for (const auto &nodeNo: newlyCovered_) {
+        if (!nodes.isMyRank(nodeNo))
+            continue;
+        lbBase_t x[3] = {0, 0, 0};
+        lbBase_t F[3] = {0, 0, 0};
+        for (int d = 0; d < DXQY::nD; ++d) {
+            x[d] = grid.pos(nodeNo, d);
+            for (int q = 0; q < DXQY::nQ; ++q)
+                F[d] += f(fieldNo, q, nodeNo)*DXQY::c(q, d);
+        }
+        addForce(idToLocal_[ownerId_[nodeNo]], x, F);
+    }
+
+    for (std::size_t i = 0; i < freshNodes_.size(); ++i) {
+        const int nodeNo = freshNodes_[i];
+        if (!nodes.isMyRank(nodeNo))
+            continue;
+        lbBase_t rhoNode = 0;
+        int nNeig = 0;
+        for (int q = 0; q < DXQY::nQ - 1; ++q) {
+            const int neigNo = grid.neighbor(q, nodeNo);
+            if (nodes.isFluid(neigNo) && (ownerId_[neigNo] < 0)) {
+                rhoNode += rho(fieldNo, neigNo);
+                nNeig += 1;
+            }
+        }
+        rhoNode = (nNeig > 0) ? rhoNode/nNeig : 1.0;
+        lbBase_t x[3] = {0, 0, 0};
+        for (int d = 0; d < DXQY::nD; ++d)
+            x[d] = grid.pos(nodeNo, d);
+        const auto it = idToLocal_.find(freshIds_[i]);
+        std::valarray<lbBase_t> uWall(0.0, DXQY::nD);
+        if (it != idToLocal_.end())
+            uWall = wallVelocity(particles_[it->second], x);
+        const lbBase_t uu = DXQY::dot(uWall, uWall);
+        const auto cu = DXQY::cDotAll(uWall);
+        for (int q = 0; q < DXQY::nQ; ++q)
+            f(fieldNo, q, nodeNo) = DXQY::w[q]*rhoNode*(1.0 + DXQY::c2Inv*cu[q] + DXQY::c4Inv0_5*(cu[q]*cu[q] - DXQY::c2*uu));
+        if (it != idToLocal_.end()) {
+            lbBase_t F[3] = {0, 0, 0};
+            for (int d = 0; d < DXQY::nD; ++d)
+                F[d] = -rhoNode*uWall[d];
+            addForce(it->second, x, F);
+        }
+    }
+}
+
+
+template <typename DXQY>
+void ParticleSuspension<DXQY>::step(const Nodes<DXQY> &nodes, const Grid<DXQY> &grid, const int nSubSteps)
+/* step : sends the force on particle copies to their owners, adds the pair forces,
+ *  integrates the owned particles and migrates particles that changed rank.
+ */
+{
+    // Force contributions from copies to the owners
+    for (const auto &rank: neigRanks_) {
+        std::vector<lbBase_t> sendBuffer;
+        for (std::size_t n = nOwned_; n < particles_.size(); ++n) {
+            if (ownerRank_[n] == rank) {
+                sendBuffer.push_back(particles_[n].id);
+                sendBuffer.insert(sendBuffer.end(), &forceTorque_[6*n], &forceTorque_[6*n] + 6);
+            }
+        }
+        const auto recvBuffer = exchange(rank, sendBuffer);
+        for (std::size_t i = 0; i < recvBuffer.size(); i += 7) {
+            const int n = idToLocal_[static_cast<int>(recvBuffer[i])];
+            for (int k = 0; k < 6; ++k)
+                forceTorque_[6*n + k] += recvBuffer[i + 1 + k];
+        }
+    }
+
+    // Pair forces between owned particles and all local particles
+    if (pairForces_.size() > 0) {
+        lbBase_t maxRadius = 0;
+        for (const auto &p: particles_)
+            maxRadius = std::max(maxRadius, p.radius);
+        for (int a = 0; a < nOwned_; ++a) {
+            for (std::size_t b = 0; b < particles_.size(); ++b) {
+                if (static_cast<int>(b) == a)
+                    continue;
+                const std::valarray<lbBase_t> dX = particles_[a].body.position() - particles_[b].body.position();
+                if ((dX*dX).sum() > 4*(maxRadius + 2)*(maxRadius + 2))
+                    continue;
+                for (const auto &pairForce: pairForces_) {
+                    const std::valarray<lbBase_t> F = pairForce(particles_[a], particles_[b]);
+                    for (int d = 0; d < 3; ++d)
+                        forceTorque_[6*a + d] += F[d];
+                }
+            }
+        }
+    }
+
+    // Integrate
+    for (int n = 0; n < nOwned_; ++n) {
+        const std::valarray<lbBase_t> force(&forceTorque_[6*n], 3);
+        const std::valarray<lbBase_t> torque(&forceTorque_[6*n + 3], 3);
+        particles_[n].body.step(force, torque, 1.0, nSubSteps);
+    }
+
+    // Migration
+    std::vector<SuspensionParticle> kept;
+    for (const auto &rank: neigRanks_) {
+        std::vector<lbBase_t> sendBuffer;
+        for (int n = 0; n < nOwned_; ++n) {
+            const int nodeNo = nearestNode(particles_[n].body.position(), grid);
+            if ((nodeNo > 0) && (nodes.getRank(nodeNo) == rank) && (ownerRank_[n] == myRank_)) {
+                const auto buffer = pack(particles_[n]);
+                sendBuffer.insert(sendBuffer.end(), buffer.begin(), buffer.end());
+                ownerRank_[n] = rank;  // Marks as sent
+            }
+        }
+        const auto recvBuffer = exchange(rank, sendBuffer);
+        for (std::size_t i = 0; i < recvBuffer.size(); i += packSize_)
+            kept.push_back(unpack(&recvBuffer[i]));
+    }
+    std::vector<SuspensionParticle> owned;
+    for (int n = 0; n < nOwned_; ++n) {
+        if (ownerRank_[n] == myRank_)
+            owned.push_back(particles_[n]);
+    }
+    owned.insert(owned.end(), kept.begin(), kept.end());
+    particles_ = owned;
+    nOwned_ = static_cast<int>(particles_.size());
+    ownerRank_.assign(nOwned_, myRank_);
+}
+
+#endif // LBSUSPENSION_H
@@ -50,9 +50,10 @@ class LBvtk
 {
 public:
     LBvtk(std::string filename);
+    LBvtk(std::istringstream text);  // vtklb file contents generated in memory
 
     ~LBvtk() {
-        ifs_.close();
+        file_.close();
     }
 
     void readPreamble();
@@ -174,9 +175,19 @@ public:
 
     inline int dirVtkToLB(const int q) {return f2p_[q];}
 
+    // Names of the data set attributes (POINT_DATA), in file order
+    inline const std::vector<std::string> &getAttributeNames() const {return dataAttributeNames_;}
+
+    // Data type of a data set attribute (int or float)
+    inline const std::string &getAttributeType(const std::string &dataName) const {return dataAttributeTypes_.at(dataName);}
+
 private:
+    void read();
+
     std::string filename_;  // The file name
-    std::ifstream ifs_;   // File stream object
+    std::ifstream file_;   // File stream object
+    std::istringstream text_;  // In memory file contents
+    std::istream &ifs_;  // The one of file_ and text_ that is read
 
     // PREAMBLE
     std::string title_; // File title
@@ -208,6 +219,8 @@ private:
 
     // DATA SET ATTRIBUTES
     std::map<std::string, int> dataAttributes_;
+    std::vector<std::string> dataAttributeNames_;
+    std::map<std::string, std::string> dataAttributeTypes_;
 
     // DATA SUBSET ATTRUBUTES
     std::map<std::string, std::vector<long int>> dataSubsetAttributes_; // block name, [size, file position]
@@ -219,18 +232,34 @@ private:
 
 
 template<typename DXQY>
-LBvtk<DXQY>::LBvtk(std::string filename) : filename_(filename)
+LBvtk<DXQY>::LBvtk(std::string filename) : filename_(filename), ifs_(file_)
 {
-    // Set default values
-    nD_ = 3; // Default value
-    zero_ghost_node_ = false; // Default value
-
     // Open input file
-    ifs_.open(filename_);
-    if (!ifs_) {
+    file_.open(filename_);
+    if (!file_) {
         std::cout << "ERROR reading file in LBvtk: coult not open file " << filename_ << "." << std::endl;
         exit(1);
     }
+    read();
+}
+
+
+template<typename DXQY>
+LBvtk<DXQY>::LBvtk(std::istringstream text) : filename_("<in memory>"), text_(std::move(text)), ifs_(text_)
+/* text : the contents of a vtklb file, for instance from a geometry generator,
+ *        so that no file is written or read
+ */
+{
+    read();
+}
+
+
+template<typename DXQY>
+void LBvtk<DXQY>::read()
+{
+    // Set default values
+    nD_ = 3; // Default value
+    zero_ghost_node_ = false; // Default value
 
     // Preamble
     readPreamble();
@@ -573,6 +602,8 @@ void LBvtk<DXQY>::readPointData()
 
             // Add attribute to map
             dataAttributes_.insert(std::pair<std::string, int>(dataName, ifs_.tellg()));
+            dataAttributeNames_.push_back(dataName);
+            dataAttributeTypes_.insert(std::pair<std::string, std::string>(dataName, dataType));
 
             // Read the scalar entries
             for (int n=0; n < getNumPoints; ++n) getScalarAttribute<double>();
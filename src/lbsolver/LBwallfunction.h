@@ -0,0 +1,346 @@
+#ifndef LBWALLFUNCTION_H
+#define LBWALLFUNCTION_H
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "LBglobal.h"
+#include "LBlatticetypes.h"
+#include "LBnodes.h"
+#include "LBgrid.h"
+#include "LBfield.h"
+
+/*********************************************************
+ * class WALLLAW: tabulated inverse of the law of the wall.
+ *
+ * The laws are written as y+ = g(u+):
+ *  "spalding" : y+ = u+ + exp(-kappa B)(exp(kappa u+) - 1 - kappa u+
+ *                    - (kappa u+)^2/2 - (kappa u+)^3/6)
+ *  "loglaw"   : y+ = u+                      (u+ < u+_lam)
+ *               y+ = exp(kappa u+)/E,  E = exp(kappa B)  (u+ >= u+_lam)
+ *
+ * With a velocity u sampled at wall distance y, the local
+ *  Reynolds number Re_y = u y/nu = u+ y+ only depends on u+.
+ *  The inverse u+(Re_y) is tabulated once, on a grid that is
+ *  uniform in sqrt(Re_y), so the viscous sublayer (u+ = sqrt(Re_y))
+ *  is exact and a lookup costs one square root and a linear
+ *  interpolation:
+ *     u_tau = u/u+(Re_y).
+ * Values above the table are found with Newton iterations,
+ *  started from a given guess (e.g. the last friction velocity).
+ *
+ * The van Driest damping 1 - exp(-y+/A+) is tabulated in the
+ *  same way.
+ *********************************************************/
+class WallLaw
+{
+public:
+    WallLaw(const std::string &law, const lbBase_t viscosity0, const lbBase_t kappa=0.41, const lbBase_t B=5.2,
+            const lbBase_t ReMax=1.0e6, const lbBase_t dSqrtRe=0.25)
+    /* law        : "spalding" or "loglaw"
+     * viscosity0 : molecular kinematic viscosity
+     * kappa, B   : von Karman constant and log-law intercept
+     * ReMax      : largest tabulated u y/nu
+     * dSqrtRe    : table spacing in sqrt(u y/nu)
+     */
+        : viscosity0_(viscosity0), kappa_(kappa), E_(std::exp(kappa*B)), sqrtReMax_(std::sqrt(ReMax)), dSqrtReInv_(1.0/dSqrtRe)
+    {
+        if (law == "spalding") {
+            law_ = SPALDING;
+        } else if (law == "loglaw") {
+            law_ = LOGLAW;
+        } else {
+            std::cout << "ERROR in WallLaw: unknown law " << law << ". Use spalding or loglaw" << std::endl;
+            exit(1);
+        }
+
+        // Matching point of the linear and logarithmic parts (larger root of u+ = exp(kappa u+)/E)
+        lbBase_t lo = 1.0, hi = 100.0;
+        for (int n = 0; n < 100; ++n) {
+            const lbBase_t mid = 0.5*(lo + hi);
+            ((mid - std::exp(kappa_*mid)/E_) > 0 ? lo : hi) = mid;
+        }
+        uPlusLam_ = 0.5*(lo + hi);
+
+        // Tabulate u+(Re_y) by bisection in u+
+        const int nTable = static_cast<int>(std::ceil(sqrtReMax_*dSqrtReInv_)) + 1;
+        uPlusTable_.resize(nTable + 1);
+        for (int n = 0; n <= nTable; ++n) {
+            const lbBase_t sqrtRe = n*dSqrtRe;
+            const lbBase_t Re = sqrtRe*sqrtRe;
+            lo = 0.0;
+            hi = sqrtRe + 1.0;  // u+ <= sqrt(Re_y) as y+ >= u+
+            for (int i = 0; i < 100; ++i) {
+                const lbBase_t mid = 0.5*(lo + hi);
+                ((mid*yPlus(mid) < Re) ? lo : hi) = mid;
+            }
+            uPlusTable_[n] = 0.5*(lo + hi);
+        }
+        sqrtReMax_ = (nTable - 1)*dSqrtRe;
+
+        // van Driest damping, 1 - exp(-x) for x in [0, xMax]
+        const int nDamping = static_cast<int>(dampingXMax_*dampingDxInv_) + 1;
+        dampingTable_.resize(nDamping + 1);
+        for (int n = 0; n <= nDamping; ++n)
+            dampingTable_[n] = 1.0 - std::exp(-n/dampingDxInv_);
+    }
+
+    inline lbBase_t yPlus(const lbBase_t uPlus) const
+    /* yPlus : the law of the wall, y+ as a function of u+
+     */
+    {
+        const lbBase_t ku = kappa_*uPlus;
+        if (law_ == SPALDING)
+            return uPlus + (std::exp(ku) - 1.0 - ku - 0.5*ku*ku - ku*ku*ku/6.0)/E_;
+        return (uPlus < uPlusLam_) ? uPlus : std::exp(ku)/E_;
+    }
+
+    inline lbBase_t dYPlus(const lbBase_t uPlus) const
+    /* dYPlus : derivative of y+ with respect to u+
+     */
+    {
+        const lbBase_t ku = kappa_*uPlus;
+        if (law_ == SPALDING)
+            return 1.0 + kappa_*(std::exp(ku) - 1.0 - ku - 0.5*ku*ku)/E_;
+        return (uPlus < uPlusLam_) ? 1.0 : kappa_*std::exp(ku)/E_;
+    }
+
+    inline lbBase_t uPlus(const lbBase_t Re, const lbBase_t uPlusGuess=0.0) const
+    /* uPlus : returns u+ for the local Reynolds number Re = u y/nu
+     *
+     * uPlusGuess : start value of the Newton iterations used above the table
+     */
+    {
+        const lbBase_t sqrtRe = std::sqrt(std::max(Re, 0.0));
+        if (sqrtRe < sqrtReMax_) {
+            const lbBase_t x = sqrtRe*dSqrtReInv_;
+            const int n = static_cast<int>(x);
+            const lbBase_t a = x - n;
+            return (1 - a)*uPlusTable_[n] + a*uPlusTable_[n+1];
+        }
+        // Newton iterations on ln(u+) + ln(y+(u+)) = ln(Re), which is close to linear in u+
+        lbBase_t ret = std::max(uPlusGuess, uPlusTable_.back());
+        const lbBase_t lnRe = std::log(Re);
+        for (int n = 0; n < 8; ++n) {
+            const lbBase_t yp = yPlus(ret);
+            ret -= (std::log(ret*yp) - lnRe)/(1.0/ret + dYPlus(ret)/yp);
+        }
+        return ret;
+    }
+
+    inline lbBase_t frictionVelocity(const lbBase_t u, const lbBase_t y, const lbBase_t uTauGuess=0.0) const
+    /* frictionVelocity : returns u_tau for the wall parallel speed u at wall distance y
+     *
+     * uTauGuess : last friction velocity, only used above the table
+     */
+    {
+        if (u <= 0)
+            return 0.0;
+        const lbBase_t guess = (uTauGuess > 0) ? u/uTauGuess : 0.0;
+        return u/uPlus(u*y/viscosity0_, guess);
+    }
+
+    inline lbBase_t damping(const lbBase_t yPlus, const lbBase_t APlus=25.0) const
+    /* damping : van Driest damping 1 - exp(-y+/A+)
+     */
+    {
+        const lbBase_t x = yPlus/APlus*dampingDxInv_;
+        if (x >= dampingXMax_*dampingDxInv_)
+            return 1.0;
+        const int n = static_cast<int>(x);
+        const lbBase_t a = x - n;
+        return (1 - a)*dampingTable_[n] + a*dampingTable_[n+1];
+    }
+
+    inline lbBase_t viscosity0() const {return viscosity0_;}
+    inline lbBase_t kappa() const {return kappa_;}
+    inline lbBase_t E() const {return E_;}
+
+private:
+    enum { SPALDING, LOGLAW } law_;
+    const lbBase_t viscosity0_;
+    const lbBase_t kappa_;
+    const lbBase_t E_;
+    lbBase_t uPlusLam_;
+    lbBase_t sqrtReMax_;
+    const lbBase_t dSqrtReInv_;
+    std::vector<lbBase_t> uPlusTable_;  // u+ at sqrt(Re_y) = n*dSqrtRe
+    static constexpr lbBase_t dampingXMax_ = 20.0;
+    static constexpr lbBase_t dampingDxInv_ = 100.0;
+    std::vector<lbBase_t> dampingTable_;  // 1 - exp(-x) at x = n/dampingDxInv_
+};
+
+
+/*********************************************************
+ * class WALLFUNCTION: per wall node geometry and cached
+ *  friction velocity for wall-modelled RANS and LES.
+ *
+ * For each fluid boundary node the constructor stores
+ *  - the wall normal n (into the fluid),
+ *  - the wall distance y,
+ *  - the partner node, one lattice step along the direction
+ *    closest to n, and its wall distance y_p,
+ * so that update(vel) only samples the wall parallel velocity
+ *  at the partner node and does one table lookup per node.
+ *
+ * Without a signed distance the wall is taken at the halfway
+ *  position of the solid links, with n the weighted sum of the
+ *  directions away from the solid neighbors. With a signed
+ *  distance (positive in the fluid) y is read directly and n
+ *  is its lattice gradient.
+ *
+ * The friction velocity is cached per node between calls to
+ *  update, and is used as the start value of the (rare) Newton
+ *  iterations above the table.
+ *********************************************************/
+template <typename DXQY>
+class WallFunction
+{
+public:
+    WallFunction(const WallLaw &law, const std::vector<int> &bndNodes, const Nodes<DXQY> &nodes, const Grid<DXQY> &grid);
+    WallFunction(const WallLaw &law, const std::vector<int> &bndNodes, const Nodes<DXQY> &nodes, const Grid<DXQY> &grid, const ScalarField &sd);
+
+    void update(const VectorField<DXQY> &vel);
+
+    inline int size() const {return static_cast<int>(nodeNo_.size());}
+    inline int nodeNo(const int n) const {return nodeNo_[n];}
+    inline int partnerNo(const int n) const {return partnerNo_[n];}
+    inline lbBase_t wallDistance(const int n) const {return y_[n];}
+    inline lbBase_t partnerDistance(const int n) const {return yPartner_[n];}
+    inline lbBase_t normal(const int n, const int d) const {return normal_[DXQY::nD*n + d];}
+    inline lbBase_t frictionVelocity(const int n) const {return uTau_[n];}
+    inline lbBase_t yPlus(const int n) const {return y_[n]*uTau_[n]/law_.viscosity0();}
+    inline lbBase_t wallShearStress(const int n, const lbBase_t rho) const {return rho*uTau_[n]*uTau_[n];}
+    inline const WallLaw & law() const {return law_;}
+
+private:
+    void setup(const std::vector<int> &bndNodes, const Nodes<DXQY> &nodes, const Grid<DXQY> &grid, const ScalarField *sd);
+
+    const WallLaw law_;
+    std::vector<int> nodeNo_;
+    std::vector<int> partnerNo_;
+    std::vector<lbBase_t> y_;
+    std::vector<lbBase_t> yPartner_;
+    std::vector<lbBase_t> normal_;  // nD values per node
+    std::vector<lbBase_t> uTau_;  // Cached friction velocity
+};
+
+
+template <typename DXQY>
+WallFunction<DXQY>::WallFunction(const WallLaw &law, const std::vector<int> &bndNodes, const Nodes<DXQY> &nodes, const Grid<DXQY> &grid)
+    : law_(law)
+/* bndNodes : fluid boundary nodes
+ */
+{
+    setup(bndNodes, nodes, grid, nullptr);
+}
+
+
+template <typename DXQY>
+WallFunction<DXQY>::WallFunction(const WallLaw &law, const std::vector<int> &bndNodes, const Nodes<DXQY> &nodes, const Grid<DXQY> &grid, const ScalarField &sd)
+    : law_(law)
+/* sd : signed distance to the wall, positive in the fluid (field 0)
+ */
+{
+    setup(bndNodes, nodes, grid, &sd);
+}
+
+
+template <typename DXQY>
+void WallFunction<DXQY>::setup(const std::vector<int> &bndNodes, const Nodes<DXQY> &nodes, const Grid<DXQY> &grid, const ScalarField *sd)
+{
+    constexpr int nD = DXQY::nD;
+    for (const auto &nodeNo: bndNodes) {
+        lbBase_t n[nD];
+        lbBase_t y = 0;
+        if (sd == nullptr) {
+            for (int d = 0; d < nD; ++d)
+                n[d] = 0;
+            for (int q = 0; q < DXQY::nQNonZero_; ++q) {
+                if (nodes.isSolid(grid.neighbor(q, nodeNo))) {
+                    for (int d = 0; d < nD; ++d)
+                        n[d] -= DXQY::w[q]*DXQY::c(q, d);
+                }
+            }
+        } else {
+            std::valarray<lbBase_t> sdNeig(DXQY::nQ);
+            for (int q = 0; q < DXQY::nQ; ++q)
+                sdNeig[q] = (*sd)(0, grid.neighbor(q, nodeNo));
+            const std::valarray<lbBase_t> g = DXQY::grad(sdNeig);
+            for (int d = 0; d < nD; ++d)
+                n[d] = g[d];
+            y = (*sd)(0, nodeNo);
+        }
+        lbBase_t nAbs = 0;
+        for (int d = 0; d < nD; ++d)
+            nAbs += n[d]*n[d];
+        nAbs = std::sqrt(nAbs);
+        if (nAbs < lbBaseEps)
+            continue;  // Not next to a wall
+        for (int d = 0; d < nD; ++d)
+            n[d] /= nAbs;
+
+        if (sd == nullptr) {
+            for (int q = 0; q < DXQY::nQNonZero_; ++q) {
+                if (nodes.isSolid(grid.neighbor(q, nodeNo)))
+                    y = std::max(y, -0.5*DXQY::cDot(q, n));
+            }
+        }
+
+        // Partner node: the fluid neighbor in the direction closest to the normal
+        int partner = nodeNo;
+        lbBase_t bestCos = 0;
+        for (int q = 0; q < DXQY::nQNonZero_; ++q) {
+            const int neigNo = grid.neighbor(q, nodeNo);
+            if (!nodes.isFluid(neigNo))
+                continue;
+            const lbBase_t cosAngle = DXQY::cDot(q, n)/DXQY::cNorm[q];
+            if (cosAngle > bestCos) {
+                bestCos = cosAngle;
+                partner = neigNo;
+            }
+        }
+        lbBase_t yPartner = y;
+        if (partner != nodeNo) {
+            for (int d = 0; d < nD; ++d)
+                yPartner += (grid.pos(partner, d) - grid.pos(nodeNo, d))*n[d];
+        }
+
+        nodeNo_.push_back(nodeNo);
+        partnerNo_.push_back(partner);
+        y_.push_back(y);
+        yPartner_.push_back(yPartner);
+        for (int d = 0; d < nD; ++d)
+            normal_.push_back(n[d]);
+        uTau_.push_back(0.0);
+    }
+}
+
+
+template <typename DXQY>
+void WallFunction<DXQY>::update(const VectorField<DXQY> &vel)
+/* update : sets the friction velocity of all wall nodes from the wall
+ *  parallel velocity at the partner nodes.
+ *
+ * vel : velocity field (field 0)
+ */
+{
+    constexpr int nD = DXQY::nD;
+    for (int n = 0; n < size(); ++n) {
+        const int partner = partnerNo_[n];
+        const lbBase_t *normal = &normal_[nD*n];
+        lbBase_t un = 0;
+        for (int d = 0; d < nD; ++d)
+            un += vel(0, d, partner)*normal[d];
+        lbBase_t ut2 = 0;
+        for (int d = 0; d < nD; ++d) {
+            const lbBase_t ut = vel(0, d, partner) - un*normal[d];
+            ut2 += ut*ut;
+        }
+        uTau_[n] = law_.frictionVelocity(std::sqrt(ut2), yPartner_[n], uTau_[n]);
+    }
+}
+
+#endif // LBWALLFUNCTION_H
@@ -0,0 +1,157 @@
+#ifndef LBCHECK_H
+#define LBCHECK_H
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <mpi.h>
+#include "LBglobal.h"
+#include "LBgrid.h"
+
+/*********************************************************
+ * Helpers for the regression checks in test/. A check is
+ *  an mpi program that returns 0 on success, and is run
+ *  by ctest (see test/CMakeLists.txt).
+ *
+ * Rank independence is checked against a reference file.
+ *  The run on one rank writes the values of all nodes,
+ *  ordered by the global node position, and the runs on
+ *  more ranks compare with it:
+ *     check_xxx --write xxx.ref
+ *     mpirun -np 3 check_xxx --compare xxx.ref
+ *  Without arguments only the checks of the program itself
+ *  are done.
+ *********************************************************/
+class Check
+{
+public:
+    Check(const std::string &name, const int myRank) : name_(name), myRank_(myRank), numFailed_(0) {}
+
+    void require(const bool ok, const std::string &what)
+    /* require : counts a failed check and prints what failed (on all ranks) */
+    {
+        if (!ok) {
+            numFailed_ += 1;
+            std::cout << "FAILED in " << name_ << " (rank " << myRank_ << "): " << what << std::endl;
+        }
+    }
+    void near(const lbBase_t value, const lbBase_t expected, const lbBase_t tolerance, const std::string &what)
+    /* near : |value - expected| <= tolerance */
+    {
+        std::ostringstream msg;
+        msg << std::setprecision(12) << what << " = " << value << ", expected " << expected;
+        require(std::abs(value - expected) <= tolerance, msg.str());
+    }
+    int result() const
+    /* result : 0 if all checks on all ranks passed. Collective. */
+    {
+        int numFailed = numFailed_;
+        MPI_Allreduce(MPI_IN_PLACE, &numFailed, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+        if ( (myRank_ == 0) && (numFailed == 0) )
+            std::cout << name_ << ": passed" << std::endl;
+        return (numFailed == 0) ? 0 : 1;
+    }
+
+private:
+    const std::string name_;
+    const int myRank_;
+    int numFailed_;
+};
+
+
+template <typename DXQY>
+std::vector<lbBase_t> gatherNodeValues(const Grid<DXQY> &grid, const std::vector<int> &nodes, const std::vector<lbBase_t> &values)
+/* gatherNodeValues : the values of all ranks on rank 0, ordered by the global
+ *  node position. values has the same number of values for each of the nodes.
+ *  Each node is returned as its position followed by its values. Collective.
+ */
+{
+    const int numValues = nodes.empty() ? 0 : values.size()/nodes.size();
+    int numPerNode = numValues;
+    MPI_Allreduce(MPI_IN_PLACE, &numPerNode, 1, MPI_INT, MPI_MAX, MPI_COMM_WORLD);
+    const int recordSize = DXQY::nD + numPerNode;
+
+    std::vector<lbBase_t> local;
+    local.reserve(nodes.size()*recordSize);
+    for (std::size_t n = 0; n < nodes.size(); ++n) {
+        for (int d = 0; d < DXQY::nD; ++d)
+            local.push_back(grid.pos(nodes[n], d));
+        for (int k = 0; k < numPerNode; ++k)
+            local.push_back(values[n*numPerNode + k]);
+    }
+
+    int nProcs, myRank;
+    MPI_Comm_size(MPI_COMM_WORLD, &nProcs);
+    MPI_Comm_rank(MPI_COMM_WORLD, &myRank);
+    int localSize = local.size();
+    std::vector<int> sizes(nProcs), displ(nProcs, 0);
+    MPI_Gather(&localSize, 1, MPI_INT, sizes.data(), 1, MPI_INT, 0, MPI_COMM_WORLD);
+    for (int n = 1; n < nProcs; ++n)
+        displ[n] = displ[n-1] + sizes[n-1];
+    std::vector<lbBase_t> all(myRank == 0 ? displ[nProcs-1] + sizes[nProcs-1] : 0);
+    MPI_Gatherv(local.data(), localSize, MPI_DOUBLE, all.data(), sizes.data(), displ.data(), MPI_DOUBLE, 0, MPI_COMM_WORLD);
+    if (myRank != 0)
+        return {};
+
+    // Sort the records by position, z first
+    const int numNodes = all.size()/recordSize;
+    std::vector<int> order(numNodes);
+    for (int n = 0; n < numNodes; ++n)
+        order[n] = n;
+    std::sort(order.begin(), order.end(), [&](const int a, const int b) {
+        for (int d = DXQY::nD - 1; d >= 0; --d)
+            if (all[a*recordSize + d] != all[b*recordSize + d])
+                return all[a*recordSize + d] < all[b*recordSize + d];
+        return false;
+    });
+    std::vector<lbBase_t> ret;
+    ret.reserve(all.size());
+    for (const auto n: order)
+        ret.insert(ret.end(), all.begin() + n*recordSize, all.begin() + (n + 1)*recordSize);
+    return ret;
+}
+
+
+inline void checkReference(int argc, char *argv[], const std::vector<lbBase_t> &values, const lbBase_t tolerance, Check &check)
+/* checkReference : writes (--write file) or compares with (--compare file) the values
+ *  gathered on rank 0. tolerance = 0 requires bitwise equal values.
+ */
+{
+    int myRank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &myRank);
+    if ( (argc < 3) || (myRank != 0) )
+        return;
+    const std::string mode = argv[1];
+    const std::string fileName = argv[2];
+    if (mode == "--write") {
+        std::ofstream ofs(fileName, std::ios::out | std::ios::binary);
+        const long size = values.size();
+        ofs.write((char*) &size, sizeof(size));
+        ofs.write((char*) values.data(), size*sizeof(lbBase_t));
+        check.require(ofs.good(), "could not write " + fileName);
+    } else if (mode == "--compare") {
+        std::ifstream ifs(fileName, std::ios::in | std::ios::binary);
+        long size = -1;
+        ifs.read((char*) &size, sizeof(size));
+        check.require(ifs.good() && (size == static_cast<long>(values.size())), "size of " + fileName + " differs from this run");
+        if (!ifs.good() || (size != static_cast<long>(values.size())))
+            return;
+        std::vector<lbBase_t> ref(size);
+        ifs.read((char*) ref.data(), size*sizeof(lbBase_t));
+        lbBase_t maxDiff = 0;
+        for (long n = 0; n < size; ++n)
+            maxDiff = std::max(maxDiff, std::abs(values[n] - ref[n]));
+        std::ostringstream msg;
+        msg << "max difference from " << fileName << " is " << maxDiff;
+        check.require(maxDiff <= tolerance, msg.str());
+    } else {
+        check.require(false, "unknown option " + mode + ", use --write or --compare");
+    }
+}
+
+#endif // LBCHECK_H
@@ -0,0 +1,113 @@
+// //////////////////////////////////////////////
+//
+// Check of the active set of a transported scalar
+// (LBactiveset.h).
+//
+// A disk of tracer in a periodic D2Q9 box of 48x32
+// nodes is advected with a uniform velocity and
+// diffuses, first on all bulk nodes and then only on
+// the active nodes. With threshold 0 the active set
+// run must be bitwise equal to the full run, while
+// skipping tiles. With a threshold of 1e-4 the tracer
+// mass must be kept to 1e-5. The threshold 0 run must
+// be independent of the number of ranks (the reference
+// file holds its concentration).
+//
+// //////////////////////////////////////////////
+
+#include <LBSOLVER.h>
+#include "LBcheck.h"
+
+typedef D2Q9 LT;
+
+
+std::vector<lbBase_t> runTracer(Grid<LT> &grid, BndMpi<LT> &mpiBoundary, const std::vector<int> &bulkNodes, ActiveSet<LT> *activeSet,
+                                int &maxSkipped)
+/* runTracer : concentration of the bulk nodes after the advection, on all nodes if
+ *  activeSet is null. maxSkipped is the largest number of inactive tiles on this rank.
+ */
+{
+    const lbBase_t tau = 0.8;
+    const lbBase_t u[2] = {0.05, 0.02};
+    const int nSteps = 300;
+    LbField<LT> g(1, grid.size()), gTmp(1, grid.size());
+    for (auto nodeNo: bulkNodes) {
+        const lbBase_t phi = (std::hypot(grid.pos(nodeNo, 0) - 12.0, grid.pos(nodeNo, 1) - 16.0) < 5.0) ? 1.0 : 0.0;
+        for (int q = 0; q < LT::nQ; ++q)
+            g(0, q, nodeNo) = phi*LT::w[q]*(1.0 + LT::c2Inv*LT::cDot(q, u));
+    }
+
+    maxSkipped = 0;
+    for (int i = 0; i < nSteps; ++i) {
+        for (auto nodeNo: activeSet ? activeSet->nodes() : bulkNodes) {
+            lbBase_t phi = 0;
+            for (int q = 0; q < LT::nQ; ++q)
+                phi += g(0, q, nodeNo);
+            for (int q = 0; q < LT::nQ; ++q) {
+                const lbBase_t gEq = phi*LT::w[q]*(1.0 + LT::c2Inv*LT::cDot(q, u));
+                gTmp(0, q, grid.neighbor(q, nodeNo)) = g(0, q, nodeNo) - (g(0, q, nodeNo) - gEq)/tau;
+            }
+        }
+        g.swapData(gTmp);
+        if (activeSet) {
+            mpiBoundary.communicateLbField(g, grid, activeSet->mask());
+            activeSet->update(i + 1, g, gTmp, mpiBoundary);
+            maxSkipped = std::max(maxSkipped, activeSet->numTiles() - activeSet->numActiveTiles());
+        } else {
+            mpiBoundary.communicateLbField(g, grid);
+        }
+    }
+
+    std::vector<lbBase_t> ret;
+    for (auto nodeNo: bulkNodes) {
+        lbBase_t phi = 0;
+        for (int q = 0; q < LT::nQ; ++q)
+            phi += g(0, q, nodeNo);
+        ret.push_back(phi);
+    }
+    return ret;
+}
+
+
+int main(int argc, char *argv[])
+{
+    MPI_Init(&argc, &argv);
+    int myRank, nProcs;
+    MPI_Comm_rank(MPI_COMM_WORLD, &myRank);
+    MPI_Comm_size(MPI_COMM_WORLD, &nProcs);
+    Check check("check_active_set", myRank);
+
+    GeometryGenerator<LT> generator({48, 32});
+    LBvtk<LT> vtklb(std::istringstream(generator.vtklb(myRank, nProcs)));
+    Grid<LT> grid(vtklb);
+    Nodes<LT> nodes(vtklb, grid);
+    BndMpi<LT> mpiBoundary(vtklb, nodes, grid);
+    const std::vector<int> bulkNodes = findBulkNodes(nodes);
+
+    int skipped[3];
+    const std::vector<lbBase_t> phiFull = runTracer(grid, mpiBoundary, bulkNodes, nullptr, skipped[0]);
+    ActiveSet<LT> activeSetZero(grid, bulkNodes, 0.0, 4);
+    const std::vector<lbBase_t> phiZero = runTracer(grid, mpiBoundary, bulkNodes, &activeSetZero, skipped[1]);
+    ActiveSet<LT> activeSetSmall(grid, bulkNodes, 1e-4, 4);
+    const std::vector<lbBase_t> phiSmall = runTracer(grid, mpiBoundary, bulkNodes, &activeSetSmall, skipped[2]);
+
+    lbBase_t maxDiff = 0, mass[2] = {0, 0};
+    for (std::size_t n = 0; n < bulkNodes.size(); ++n) {
+        maxDiff = std::max(maxDiff, std::abs(phiZero[n] - phiFull[n]));
+        mass[0] += phiFull[n];
+        mass[1] += phiSmall[n];
+    }
+    MPI_Allreduce(MPI_IN_PLACE, &maxDiff, 1, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+    MPI_Allreduce(MPI_IN_PLACE, mass, 2, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+    MPI_Allreduce(MPI_IN_PLACE, skipped, 3, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+    check.require(skipped[1] > 0, "tiles skipped with threshold 0");
+    check.near(maxDiff, 0.0, 0.0, "concentration difference of threshold 0 and the full run");
+    check.require(skipped[2] > 0, "tiles skipped with threshold 1e-4");
+    check.near(mass[1]/mass[0], 1.0, 1e-5, "relative tracer mass with threshold 1e-4");
+
+    checkReference(argc, argv, gatherNodeValues(grid, bulkNodes, phiZero), 0.0, check);
+
+    const int ret = check.result();
+    MPI_Finalize();
+    return ret;
+}
@@ -0,0 +1,144 @@
+// //////////////////////////////////////////////
+//
+// Check of the convergence monitor
+// (LBconvergence.h) on a periodic D2Q9 domain of
+// 12x10 nodes.
+//
+// The density and velocity are set to known functions
+// of the position and the time t = 0, 1, 2, 3, and
+// checked every time step. The l2 and linf norms of
+// both variables, and the flux norm through the planes
+// x = 2 and x = 7, must give the residuals computed
+// here over the whole domain. At t = 2 rank 0 leaves
+// out the node at (0, 0), which must restart the l2
+// and linf tests on all ranks: check returns false and
+// keeps the residual of t = 1 everywhere, and the
+// residual of t = 3 is that of the domain without the
+// node.
+//
+// //////////////////////////////////////////////
+
+#include <LBSOLVER.h>
+#include "LBcheck.h"
+
+typedef D2Q9 LT;
+
+const int nx = 12, ny = 10;
+const lbBase_t pi = 3.14159265358979323846;
+
+
+lbBase_t rhoAt(const int t, const int x, const int y)
+{
+    return 1.0 + 1e-3*std::cos(2*pi*x/nx) + 1e-4*t*(y + 1);
+}
+
+
+lbBase_t velAt(const int t, const int d, const int x, const int y)
+{
+    return 0.01*(1 + d)*std::sin(2*pi*x/nx + 0.3*d)*std::cos(2*pi*y/ny) + 0.02 + 1e-3*t*(x + 2*y + d)/20.0;
+}
+
+
+lbBase_t expectedResidual(const std::string &norm, const std::string &variable, const int t, const bool skipOrigin)
+/* expectedResidual : residual of the values at t against those at t - 1 */
+{
+    if (norm == "flux") {
+        lbBase_t ret = 0;
+        for (const int x: {2, 7}) {
+            lbBase_t flux[2] = {0, 0};
+            for (int y = 0; y < ny; ++y)
+                for (int n = 0; n < 2; ++n)
+                    flux[n] += rhoAt(t - n, x, y)*velAt(t - n, 0, x, y);
+            ret = std::max(ret, std::abs(flux[0] - flux[1])/(std::abs(flux[0]) + lbBaseEps));
+        }
+        return ret;
+    }
+    lbBase_t change = 0, size = 0;
+    for (int x = 0; x < nx; ++x) {
+        for (int y = 0; y < ny; ++y) {
+            if (skipOrigin && (x == 0) && (y == 0))
+                continue;
+            for (int d = 0; d < ((variable == "vel") ? LT::nD : 1); ++d) {
+                const lbBase_t val = (variable == "vel") ? velAt(t, d, x, y) : rhoAt(t, x, y);
+                const lbBase_t diff = val - ((variable == "vel") ? velAt(t - 1, d, x, y) : rhoAt(t - 1, x, y));
+                if (norm == "l2") {
+                    change += diff*diff;
+                    size += val*val;
+                } else {
+                    change = std::max(change, std::abs(diff));
+                    size = std::max(size, std::abs(val));
+                }
+            }
+        }
+    }
+    return (norm == "l2") ? std::sqrt(change/size) : change/size;
+}
+
+
+int main(int argc, char *argv[])
+{
+    MPI_Init(&argc, &argv);
+    int myRank, nProcs;
+    MPI_Comm_rank(MPI_COMM_WORLD, &myRank);
+    MPI_Comm_size(MPI_COMM_WORLD, &nProcs);
+    Check check("check_convergence", myRank);
+
+    GeometryGenerator<LT> generator({nx, ny});
+    LBvtk<LT> vtklb(std::istringstream(generator.vtklb(myRank, nProcs)));
+    Grid<LT> grid(vtklb);
+    Nodes<LT> nodes(vtklb, grid);
+    const std::vector<int> bulkNodes = findBulkNodes(nodes);
+    std::vector<int> shortNodes;  // Without the node at (0, 0)
+    for (auto nodeNo: bulkNodes)
+        if ( (grid.pos(nodeNo, 0) != 0) || (grid.pos(nodeNo, 1) != 0) )
+            shortNodes.push_back(nodeNo);
+    int numNodes = bulkNodes.size();
+    MPI_Allreduce(MPI_IN_PLACE, &numNodes, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+    check.require(numNodes == nx*ny, "all nodes are fluid nodes");
+
+    ScalarField rho(1, grid.size());
+    VectorField<LT> vel(1, grid.size());
+    auto setFields = [&](const int t) {
+        for (auto nodeNo: bulkNodes) {
+            const int x = grid.pos(nodeNo, 0), y = grid.pos(nodeNo, 1);
+            rho(0, nodeNo) = rhoAt(t, x, y);
+            for (int d = 0; d < LT::nD; ++d)
+                vel(0, d, nodeNo) = velAt(t, d, x, y);
+        }
+    };
+
+    const lbBase_t tolerance = 1e-12;
+    for (const std::string norm: {"l2", "linf", "flux"}) {
+        for (const std::string variable: {"vel", "rho"}) {
+            if ( (norm == "flux") && (variable == "rho") )
+                continue;
+            const std::string name = norm + " norm of " + variable;
+            ConvergenceMonitor<LT> convergence(norm, variable, 1, 0.0);
+            if (norm == "flux")
+                convergence.setFluxPlanes(0, {2, 7});
+            const bool skipOrigin = (norm != "flux");
+            for (int t = 0; t < 4; ++t) {
+                setFields(t);
+                const std::vector<int> &nodeList = (skipOrigin && (t >= 2) && (myRank == 0)) ? shortNodes : bulkNodes;
+                int converged = convergence.check(t, nodeList, rho, vel, grid);
+                MPI_Allreduce(MPI_IN_PLACE, &converged, 1, MPI_INT, MPI_MAX, MPI_COMM_WORLD);
+                check.require(!converged, name + " not converged at t = " + std::to_string(t));
+                lbBase_t residual[2] = {convergence.residual(), -convergence.residual()};  // Largest and smallest on the ranks
+                MPI_Allreduce(MPI_IN_PLACE, residual, 2, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+                check.require(residual[0] == -residual[1], name + " residual the same on all ranks at t = " + std::to_string(t));
+                lbBase_t expected = -1;
+                if (t == 1)
+                    expected = expectedResidual(norm, variable, 1, false);
+                else if (t == 2)
+                    expected = skipOrigin ? expectedResidual(norm, variable, 1, false) : expectedResidual(norm, variable, 2, false);
+                else if (t == 3)
+                    expected = expectedResidual(norm, variable, 3, skipOrigin);
+                check.near(residual[0], expected, tolerance*std::abs(expected), name + " residual at t = " + std::to_string(t));
+            }
+        }
+    }
+
+    const int ret = check.result();
+    MPI_Finalize();
+    return ret;
+}
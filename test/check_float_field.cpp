@@ -0,0 +1,144 @@
+// //////////////////////////////////////////////
+//
+// Check of the reduced precision LbField<LT, float>
+// against the full precision LbField<LT>.
+//
+// A D2Q9 channel, with walls normal to y and a body
+// force along x, is run with both storage types with
+// the mpi exchange of all fields and the half way
+// bounce back. The float velocity must agree with the
+// double velocity to within single precision, and the
+// float run must be independent of the number of ranks
+// (the reference file holds the float velocity).
+// PressureBnd, InletOutlet and the checkpoint files are
+// checked for a float field against a double field.
+//
+// //////////////////////////////////////////////
+
+#include <LBSOLVER.h>
+#include "LBcheck.h"
+
+typedef D2Q9 LT;
+
+
+template <typename S>
+std::vector<lbBase_t> runChannel(Grid<LT> &grid, const Nodes<LT> &nodes, BndMpi<LT> &mpiBoundary, const std::vector<int> &bulkNodes, const int nSteps)
+/* runChannel : velocity of the bulk nodes after nSteps, node by node */
+{
+    HalfWayBounceBack<LT> bounceBackBnd(findFluidBndNodes(nodes), nodes, grid);
+    const lbBase_t tau = 0.8;
+    const std::valarray<lbBase_t> force = {1.0e-6, 0.0};
+    const int nFields = 2;  // The second field is a passive copy, to exchange several fields
+    LbField<LT, S> f(nFields, grid.size());
+    LbField<LT, S> fTmp(nFields, grid.size());
+    for (auto nodeNo: bulkNodes)
+        for (int fieldNo = 0; fieldNo < nFields; ++fieldNo)
+            for (int q = 0; q < LT::nQ; ++q)
+                f(fieldNo, q, nodeNo) = LT::w[q];
+
+    std::vector<lbBase_t> ret(LT::nD*bulkNodes.size());
+    for (int i = 1; i <= nSteps; ++i) {
+        for (std::size_t n = 0; n < bulkNodes.size(); ++n) {
+            const int nodeNo = bulkNodes[n];
+            for (int fieldNo = 0; fieldNo < nFields; ++fieldNo) {
+                const std::valarray<lbBase_t> fNode = f(fieldNo, nodeNo);
+                const lbBase_t rhoNode = calcRho<LT>(fNode);
+                const std::valarray<lbBase_t> velNode = calcVel<LT>(fNode, rhoNode, force);
+                const std::valarray<lbBase_t> cu = LT::cDotAll(velNode);
+                const std::valarray<lbBase_t> omega = calcOmegaBGK<LT>(fNode, tau, rhoNode, LT::dot(velNode, velNode), cu);
+                const std::valarray<lbBase_t> deltaOmegaF = calcDeltaOmegaF<LT>(tau, cu, LT::dot(velNode, force), LT::cDotAll(force));
+                fTmp.propagateTo(fieldNo, nodeNo, fNode + omega + deltaOmegaF, grid);
+                if ( (i == nSteps) && (fieldNo == 0) )
+                    for (int d = 0; d < LT::nD; ++d)
+                        ret[n*LT::nD + d] = velNode[d];
+            }
+        }
+        f.swapData(fTmp);
+        mpiBoundary.communicateLbField(f, grid);
+        bounceBackBnd.apply(f, grid);
+    }
+    return ret;
+}
+
+
+template <typename S>
+LbField<LT, S> applyBoundaries(const Grid<LT> &grid, const Nodes<LT> &nodes, const std::vector<int> &bndNodes)
+/* applyBoundaries : a field with the values set by PressureBnd (field 0) and InletOutlet (field 1) */
+{
+    LbField<LT, S> f(2, grid.size());
+    ScalarField rho(2, grid.size());
+    for (int nodeNo = 0; nodeNo < grid.size(); ++nodeNo) {
+        f.set(0, nodeNo) = 0.0;  // The stored zero of a float field is w*rho0
+        f.set(1, nodeNo) = 0.0;
+        rho(0, nodeNo) = 1.0 + 1e-3*grid.pos(nodeNo, 0);
+        rho(1, nodeNo) = rho(0, nodeNo);
+    }
+    PressureBnd<LT>(bndNodes, nodes, grid).apply(0, f, grid, rho);
+    InletOutlet<LT>(bndNodes, nodes, grid).apply(1, f, grid, 1.01, {0.02, -0.01});
+    return f;
+}
+
+
+int main(int argc, char *argv[])
+{
+    MPI_Init(&argc, &argv);
+    int myRank, nProcs;
+    MPI_Comm_rank(MPI_COMM_WORLD, &myRank);
+    MPI_Comm_size(MPI_COMM_WORLD, &nProcs);
+    Check check("check_float_field", myRank);
+
+    GeometryGenerator<LT> generator({36, 18});
+    generator.addWalls(1);
+    LBvtk<LT> vtklb(std::istringstream(generator.vtklb(myRank, nProcs)));
+    Grid<LT> grid(vtklb);
+    Nodes<LT> nodes(vtklb, grid);
+    BndMpi<LT> mpiBoundary(vtklb, nodes, grid);
+    const std::vector<int> bulkNodes = findBulkNodes(nodes);
+
+    // Channel flow
+    const int nSteps = 2000;
+    const std::vector<lbBase_t> velDouble = runChannel<lbBase_t>(grid, nodes, mpiBoundary, bulkNodes, nSteps);
+    const std::vector<lbBase_t> velFloat = runChannel<float>(grid, nodes, mpiBoundary, bulkNodes, nSteps);
+    lbBase_t maxVel = 0, maxDiff = 0;
+    for (std::size_t n = 0; n < velDouble.size(); ++n) {
+        maxVel = std::max(maxVel, std::abs(velDouble[n]));
+        maxDiff = std::max(maxDiff, std::abs(velFloat[n] - velDouble[n]));
+    }
+    MPI_Allreduce(MPI_IN_PLACE, &maxVel, 1, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+    MPI_Allreduce(MPI_IN_PLACE, &maxDiff, 1, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+    check.require(maxVel > 1e-4, "channel flow has developed");
+    check.near(maxDiff/maxVel, 0.0, 1e-6, "relative velocity difference of float and double");
+
+    // Boundaries, on the nodes next to the walls
+    const std::vector<int> bndNodes = findFluidBndNodes(nodes);
+    const LbField<LT> fBndDouble = applyBoundaries<lbBase_t>(grid, nodes, bndNodes);
+    const LbField<LT, float> fBndFloat = applyBoundaries<float>(grid, nodes, bndNodes);
+    lbBase_t maxBndDiff = 0;
+    for (int nodeNo = 1; nodeNo < grid.size(); ++nodeNo)
+        for (int fieldNo = 0; fieldNo < 2; ++fieldNo)
+            for (int q = 0; q < LT::nQ; ++q)
+                maxBndDiff = std::max(maxBndDiff, std::abs(fBndFloat(fieldNo, q, nodeNo) - fBndDouble(fieldNo, q, nodeNo)));
+    check.near(maxBndDiff, 0.0, 1e-7, "PressureBnd and InletOutlet difference of float and double");
+
+    // Checkpoints: float file into float field, double file into float field
+    const std::string fileName = "check_float_field_rank" + std::to_string(myRank);
+    fBndFloat.writeToFile(fileName + "_float");
+    fBndDouble.writeToFile(fileName + "_double");
+    LbField<LT, float> fRead(2, grid.size());
+    lbBase_t maxReadDiff[2] = {0, 0};
+    for (int n = 0; n < 2; ++n) {
+        fRead.readFromFile(fileName + ( (n == 0) ? "_float" : "_double" ));
+        for (int nodeNo = 1; nodeNo < grid.size(); ++nodeNo)
+            for (int fieldNo = 0; fieldNo < 2; ++fieldNo)
+                for (int q = 0; q < LT::nQ; ++q)
+                    maxReadDiff[n] = std::max(maxReadDiff[n], std::abs(fRead(fieldNo, q, nodeNo) - fBndFloat(fieldNo, q, nodeNo)));
+    }
+    check.near(maxReadDiff[0], 0.0, 0.0, "float checkpoint read into float field");
+    check.near(maxReadDiff[1], 0.0, 1e-7, "double checkpoint read into float field");
+
+    checkReference(argc, argv, gatherNodeValues(grid, bulkNodes, velFloat), 0.0, check);
+
+    const int ret = check.result();
+    MPI_Finalize();
+    return ret;
+}
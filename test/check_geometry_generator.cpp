@@ -0,0 +1,121 @@
+// //////////////////////////////////////////////
+//
+// Check of the synthetic geometries
+// (LBgeometrygenerator.h).
+//
+// A periodic D3Q19 box of 36x30x24 nodes, read from
+// an input file with walls, a cylinder, random
+// spheres and a gaussian medium, is split over the
+// ranks. The node types must be independent of the
+// number of ranks (the reference file holds the
+// type of each fluid node, fluid boundary or bulk;
+// the solid nodes are copied on each rank that
+// needs them). The porosity of
+// random spheres alone and of a gaussian medium
+// alone, averaged over 8 seeds in a 48x48x48 box,
+// must be the given porosity. Single seeds of the
+// gaussian medium are off by up to 0.016 with length
+// 1 (and 0.04 with length 2), so the check uses the
+// mean. The measured means are 0.6984 (spheres, 0.7)
+// and 0.6003 (gaussian, 0.6).
+//
+// //////////////////////////////////////////////
+
+#include <LBSOLVER.h>
+#include "LBcheck.h"
+
+typedef D3Q19 LT;
+
+
+std::vector<lbBase_t> nodeTypes(const Nodes<LT> &nodes, std::vector<int> &myNodes)
+/* nodeTypes : the node types of the fluid nodes on this rank, listed in myNodes
+ */
+{
+    std::vector<lbBase_t> ret;
+    for (int n = 1; n < nodes.size(); ++n) {
+        if (nodes.isFluid(n) && nodes.isMyRank(n)) {
+            myNodes.push_back(n);
+            ret.push_back(nodes.getType(n));
+        }
+    }
+    return ret;
+}
+
+
+lbBase_t meanPorosity(const bool gaussian, const lbBase_t porosity, const int myRank, const int nProcs)
+/* meanPorosity : fraction of fluid nodes in a 48x48x48 system, averaged over the seeds
+ *  1 to 8. Each rank counts a slab of x planes. Collective.
+ */
+{
+    const std::vector<int> size = {48, 48, 48};
+    const std::vector<int> lo = {(myRank*size[0])/nProcs, 0, 0};
+    const std::vector<int> hi = {((myRank + 1)*size[0])/nProcs, size[1], size[2]};
+    long numFluid = 0;
+    for (unsigned seed = 1; seed <= 8; ++seed) {
+        GeometryGenerator<LT> generator(size);
+        if (gaussian)
+            generator.setGaussian(porosity, 1.0, seed);
+        else
+            generator.addSpheres(porosity, 4.0, seed);
+        for (auto isSolid: generator.solid(lo, hi))
+            numFluid += (isSolid == 0) ? 1 : 0;
+    }
+    MPI_Allreduce(MPI_IN_PLACE, &numFluid, 1, MPI_LONG, MPI_SUM, MPI_COMM_WORLD);
+    return numFluid/(8.0*size[0]*size[1]*size[2]);
+}
+
+
+int main(int argc, char *argv[])
+{
+    MPI_Init(&argc, &argv);
+    int myRank, nProcs;
+    MPI_Comm_rank(MPI_COMM_WORLD, &myRank);
+    MPI_Comm_size(MPI_COMM_WORLD, &nProcs);
+    Check check("check_geometry_generator", myRank);
+
+    // One input file per number of ranks, as the runs may be done at the same time
+    const std::string inputName = "check_geometry_generator_np" + std::to_string(nProcs) + ".input";
+    if (myRank == 0) {
+        std::ofstream ofs(inputName);
+        ofs << "<geometry>\n"
+            << "    size 36 30 24\n"
+            << "    walls 1\n"
+            << "    cylinder_axis 2\n"
+            << "    <cylinders>\n"
+            << "        18 15 0 5\n"
+            << "    <end>\n"
+            << "    <spheres>\n"
+            << "        porosity 0.9\n"
+            << "        radius 3\n"
+            << "        seed 3000000000\n"
+            << "    <end>\n"
+            << "    <gaussian>\n"
+            << "        porosity 0.8\n"
+            << "        length 2\n"
+            << "        seed 7\n"
+            << "    <end>\n"
+            << "<end>\n";
+    }
+    MPI_Barrier(MPI_COMM_WORLD);
+    Input input(inputName);
+    GeometryGenerator<LT> generator(input);
+    LBvtk<LT> vtklb(std::istringstream(generator.vtklb(myRank, nProcs)));
+    Grid<LT> grid(vtklb);
+    Nodes<LT> nodes(vtklb, grid);
+    std::vector<int> myNodes;
+    const std::vector<lbBase_t> types = nodeTypes(nodes, myNodes);
+    int numFluid[2] = {0, 0};  // Fluid boundary and bulk
+    for (auto type: types)
+        numFluid[(type == 2) ? 0 : 1] += 1;
+    MPI_Allreduce(MPI_IN_PLACE, numFluid, 2, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+    check.require( (numFluid[0] > 0) && (numFluid[1] > 0), "fluid boundary and bulk nodes in the input geometry");
+
+    check.near(meanPorosity(false, 0.7, myRank, nProcs), 0.7, 1e-2, "mean porosity of the spheres");
+    check.near(meanPorosity(true, 0.6, myRank, nProcs), 0.6, 1e-2, "mean porosity of the gaussian medium");
+
+    checkReference(argc, argv, gatherNodeValues(grid, myNodes, types), 0.0, check);
+
+    const int ret = check.result();
+    MPI_Finalize();
+    return ret;
+}
@@ -0,0 +1,151 @@
+// //////////////////////////////////////////////
+//
+// Check of the grid transfer between a coarse and
+// a fine grid (LBgridtransfer.h).
+//
+// A D2Q9 box of 16x12 coarse nodes and the same box
+// with 32x24 fine nodes, both with a cylinder in the
+// middle. Away from the cylinder and the box edges
+// toFine must reproduce a quadratic rho and vel
+// (quadratic interpolation), and toCoarse a linear
+// rho and vel (voxel average). The two grids are
+// partitioned differently, and the transfers must
+// be independent of the number of ranks (the
+// reference file holds the fine values after toFine
+// and the coarse values after toCoarse).
+//
+// //////////////////////////////////////////////
+
+#include <LBSOLVER.h>
+#include "LBcheck.h"
+
+typedef D2Q9 LT;
+
+
+void setEquilibrium(const std::vector<int> &bulkNodes, const Grid<LT> &grid, const int ratio, const bool quadratic,
+                    ScalarField &rho, VectorField<LT> &vel, LbField<LT> &f)
+/* setEquilibrium : rho, vel and their equilibrium as functions of the coarse coordinate
+ *  x = (pos + 0.5)/ratio - 0.5, quadratic or linear
+ */
+{
+    for (auto nodeNo: bulkNodes) {
+        const lbBase_t x = (grid.pos(nodeNo, 0) + 0.5)/ratio - 0.5;
+        const lbBase_t y = (grid.pos(nodeNo, 1) + 0.5)/ratio - 0.5;
+        rho(0, nodeNo) = 1.0 + 1e-3*(x - 0.5*y) + (quadratic ? 1e-4*(x*x + 2*x*y - y*y) : 0.0);
+        vel(0, 0, nodeNo) = 1e-3*(x + 2*y) + (quadratic ? 1e-4*y*y : 0.0);
+        vel(0, 1, nodeNo) = 1e-3*(3 - x) + (quadratic ? 1e-4*x*y : 0.0);
+        const lbBase_t u[2] = {vel(0, 0, nodeNo), vel(0, 1, nodeNo)};
+        const lbBase_t u2 = u[0]*u[0] + u[1]*u[1];
+        for (int q = 0; q < LT::nQ; ++q) {
+            const lbBase_t cu = LT::cDot(q, u);
+            f(0, q, nodeNo) = rho(0, nodeNo)*LT::w[q]*(1.0 + LT::c2Inv*cu + LT::c4Inv0_5*(cu*cu - LT::c2*u2));
+        }
+    }
+}
+
+
+bool farFromSolids(const Grid<LT> &grid, const int nodeNo, const int ratio, const std::vector<int> &coarseSize)
+/* farFromSolids : the containing coarse voxel and its neighbours are inside the box
+ *  and away from the cylinder
+ */
+{
+    const int x = grid.pos(nodeNo, 0)/ratio;
+    const int y = grid.pos(nodeNo, 1)/ratio;
+    const bool inside = (x > 0) && (x < coarseSize[0] - 1) && (y > 0) && (y < coarseSize[1] - 1);
+    return inside && (std::hypot(x - 8.0, y - 6.0) > 5.0);
+}
+
+
+int main(int argc, char *argv[])
+{
+    MPI_Init(&argc, &argv);
+    int myRank, nProcs;
+    MPI_Comm_rank(MPI_COMM_WORLD, &myRank);
+    MPI_Comm_size(MPI_COMM_WORLD, &nProcs);
+    Check check("check_grid_transfer", myRank);
+
+    const int ratio = 2;
+    const std::vector<int> coarseSize = {16, 12};
+    GeometryGenerator<LT> generatorC(coarseSize);
+    generatorC.addCylinder({8.0, 6.0}, 2.5);
+    LBvtk<LT> vtklbC(std::istringstream(generatorC.vtklb(myRank, nProcs)));
+    Grid<LT> gridC(vtklbC);
+    Nodes<LT> nodesC(vtklbC, gridC);
+    const std::vector<int> bulkC = findBulkNodes(nodesC);
+
+    GeometryGenerator<LT> generatorF({ratio*coarseSize[0], ratio*coarseSize[1]});
+    generatorF.addCylinder({16.5, 12.5}, 5.0);
+    LBvtk<LT> vtklbF(std::istringstream(generatorF.vtklb(myRank, nProcs)));
+    Grid<LT> gridF(vtklbF);
+    Nodes<LT> nodesF(vtklbF, gridF);
+    const std::vector<int> bulkF = findBulkNodes(nodesF);
+
+    GridTransfer<LT> transfer(gridC, bulkC, gridF, bulkF, ratio);
+    const lbBase_t tau = 0.8;
+
+    // Prolongation of a quadratic field
+    ScalarField rhoC(1, gridC.size()), rhoF(1, gridF.size()), rhoExact(1, gridF.size());
+    VectorField<LT> velC(1, gridC.size()), velF(1, gridF.size()), velExact(1, gridF.size());
+    LbField<LT> fC(1, gridC.size()), fF(1, gridF.size()), fExact(1, gridF.size());
+    setEquilibrium(bulkC, gridC, 1, true, rhoC, velC, fC);
+    setEquilibrium(bulkF, gridF, ratio, true, rhoExact, velExact, fExact);
+    transfer.toFine(0, tau, tau, 1.0, rhoC, velC, fC, rhoF, velF, fF);
+
+    lbBase_t maxDiff[3] = {0, 0, 0};  // rho, vel and f
+    int numFar = 0;
+    std::vector<lbBase_t> fineValues;
+    for (auto nodeNo: bulkF) {
+        fineValues.push_back(rhoF(0, nodeNo));
+        for (int d = 0; d < LT::nD; ++d)
+            fineValues.push_back(velF(0, d, nodeNo));
+        for (int q = 0; q < LT::nQ; ++q)
+            fineValues.push_back(fF(0, q, nodeNo));
+        if (!farFromSolids(gridF, nodeNo, ratio, coarseSize))
+            continue;
+        numFar += 1;
+        maxDiff[0] = std::max(maxDiff[0], std::abs(rhoF(0, nodeNo) - rhoExact(0, nodeNo)));
+        for (int d = 0; d < LT::nD; ++d)
+            maxDiff[1] = std::max(maxDiff[1], std::abs(velF(0, d, nodeNo) - velExact(0, d, nodeNo)));
+        for (int q = 0; q < LT::nQ; ++q)
+            maxDiff[2] = std::max(maxDiff[2], std::abs(fF(0, q, nodeNo) - fExact(0, q, nodeNo)));
+    }
+    MPI_Allreduce(MPI_IN_PLACE, maxDiff, 3, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+    MPI_Allreduce(MPI_IN_PLACE, &numFar, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+    check.require(numFar > 0, "fine nodes away from the solids");
+    check.near(maxDiff[0], 0.0, 1e-14, "toFine rho difference from the quadratic field");
+    check.near(maxDiff[1], 0.0, 1e-14, "toFine vel difference from the quadratic field");
+    check.near(maxDiff[2], 0.0, 1e-14, "toFine f difference from the quadratic equilibrium");
+
+    // Restriction of a linear field
+    ScalarField rhoExactC(1, gridC.size());
+    VectorField<LT> velExactC(1, gridC.size());
+    LbField<LT> fExactC(1, gridC.size());
+    setEquilibrium(bulkF, gridF, ratio, false, rhoF, velF, fF);
+    setEquilibrium(bulkC, gridC, 1, false, rhoExactC, velExactC, fExactC);
+    transfer.toCoarse(0, tau, tau, 1.0, rhoF, velF, fF, rhoC, velC, fC);
+
+    lbBase_t maxDiffC[2] = {0, 0};
+    std::vector<lbBase_t> coarseValues;
+    for (auto nodeNo: bulkC) {
+        coarseValues.push_back(rhoC(0, nodeNo));
+        for (int d = 0; d < LT::nD; ++d)
+            coarseValues.push_back(velC(0, d, nodeNo));
+        if (std::hypot(gridC.pos(nodeNo, 0) - 8.0, gridC.pos(nodeNo, 1) - 6.0) <= 4.0)
+            continue;
+        maxDiffC[0] = std::max(maxDiffC[0], std::abs(rhoC(0, nodeNo) - rhoExactC(0, nodeNo)));
+        for (int d = 0; d < LT::nD; ++d)
+            maxDiffC[1] = std::max(maxDiffC[1], std::abs(velC(0, d, nodeNo) - velExactC(0, d, nodeNo)));
+    }
+    MPI_Allreduce(MPI_IN_PLACE, maxDiffC, 2, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+    check.near(maxDiffC[0], 0.0, 1e-14, "toCoarse rho difference from the linear field");
+    check.near(maxDiffC[1], 0.0, 1e-14, "toCoarse vel difference from the linear field");
+
+    std::vector<lbBase_t> values = gatherNodeValues(gridF, bulkF, fineValues);
+    const std::vector<lbBase_t> valuesC = gatherNodeValues(gridC, bulkC, coarseValues);
+    values.insert(values.end(), valuesC.begin(), valuesC.end());
+    checkReference(argc, argv, values, 0.0, check);
+
+    const int ret = check.result();
+    MPI_Finalize();
+    return ret;
+}
@@ -0,0 +1,133 @@
+// //////////////////////////////////////////////
+//
+// Check of the immersed boundary method
+// (LBimmersedboundary.h).
+//
+// A fixed cylinder of 40 markers, radius 6 and center
+// (32.3, 16.2), in a periodic D2Q9 box of 64x32 nodes.
+// The flow is driven by a body force along x, and the
+// cylinder straddles the rank boundary at x = 32 on
+// two ranks, so most markers have copies. After the
+// multi-direct forcing the interpolated velocity at
+// the markers (the slip) must be small, and smaller
+// with 5 forcing iterations than with 1 (the measured
+// slip is 6.2 % of the mean velocity with 1 iteration
+// and 0.5 % with 5). At steady state, after 4000 steps,
+// the marker force on the fluid must balance the body
+// force on the fluid (measured to 2e-4). The marker force of each
+// step must be independent of the number of ranks up
+// to the order of the sums (the reference file holds
+// totalForce() of each step).
+//
+// //////////////////////////////////////////////
+
+#include <LBSOLVER.h>
+#include "LBcheck.h"
+
+typedef D2Q9 LT;
+
+
+std::vector<lbBase_t> runCylinder(const LBvtk<LT> &vtklb, Grid<LT> &grid, const Nodes<LT> &nodes, BndMpi<LT> &mpiBoundary,
+                                  const std::vector<int> &bulkNodes, const int nIter, const int nSteps, lbBase_t &slip, lbBase_t &mass, lbBase_t &uMean)
+/* runCylinder : marker force on the fluid (x and y) of each step. slip is the largest
+ *  interpolated velocity at the markers after the forcing of the last step, mass the
+ *  total fluid mass and uMean the mean fluid velocity along x.
+ */
+{
+    const lbBase_t pi = 3.14159265358979323846;
+    const lbBase_t tau = 1.0;
+    const std::valarray<lbBase_t> g = {1e-6, 0.0};
+    const int numMarkers = 40;
+    const lbBase_t radius = 6.0;
+
+    ImmersedBoundary<LT> ibm(mpiBoundary, nodes, grid, vtklb, 4, "xy");
+    for (int m = 0; m < numMarkers; ++m) {
+        const lbBase_t phi = 2*pi*m/numMarkers;
+        ibm.addMarker(m, {32.3 + radius*std::cos(phi), 16.2 + radius*std::sin(phi)}, 2*pi*radius/numMarkers, nodes, grid);
+    }
+    ibm.update(nodes, grid);
+
+    LbField<LT> f(1, grid.size()), fTmp(1, grid.size());
+    ScalarField rho(1, grid.size());
+    VectorField<LT> vel(1, grid.size()), force(1, grid.size());
+    for (auto nodeNo: bulkNodes)
+        for (int q = 0; q < LT::nQ; ++q)
+            f(0, q, nodeNo) = LT::w[q];
+
+    std::vector<lbBase_t> ret;
+    for (int i = 0; i < nSteps; ++i) {
+        for (auto nodeNo: bulkNodes) {
+            const std::valarray<lbBase_t> fNode = f(0, nodeNo);
+            const lbBase_t rhoNode = calcRho<LT>(fNode);
+            const std::valarray<lbBase_t> forceNode = rhoNode*g;
+            rho(0, nodeNo) = rhoNode;
+            vel.set(0, nodeNo) = calcVel<LT>(fNode, rhoNode, forceNode);
+            force.set(0, nodeNo) = forceNode;
+        }
+        ibm.apply(rho, vel, force, nIter);
+        const std::valarray<lbBase_t> ibmForce = ibm.totalForce();
+        ret.push_back(ibmForce[0]);
+        ret.push_back(ibmForce[1]);
+
+        for (auto nodeNo: bulkNodes) {
+            const std::valarray<lbBase_t> fNode = f(0, nodeNo);
+            const std::valarray<lbBase_t> velNode = vel(0, nodeNo);
+            const std::valarray<lbBase_t> forceNode = force(0, nodeNo);
+            const std::valarray<lbBase_t> cu = LT::cDotAll(velNode);
+            const std::valarray<lbBase_t> omegaBGK = calcOmegaBGK<LT>(fNode, tau, rho(0, nodeNo), LT::dot(velNode, velNode), cu);
+            const std::valarray<lbBase_t> deltaOmegaF = calcDeltaOmegaF<LT>(tau, cu, LT::dot(velNode, forceNode), LT::cDotAll(forceNode));
+            fTmp.propagateTo(0, nodeNo, fNode + omegaBGK + deltaOmegaF, grid);
+        }
+        f.swapData(fTmp);
+        mpiBoundary.communicateLbField(f, grid);
+    }
+
+    ibm.interpolate(vel);
+    slip = 0;
+    for (int n = 0; n < ibm.numOwned(); ++n)
+        slip = std::max(slip, std::hypot(ibm.marker(n).uFluid[0], ibm.marker(n).uFluid[1]));
+    MPI_Allreduce(MPI_IN_PLACE, &slip, 1, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+    lbBase_t sums[3] = {0, 0, 0};  // Mass, velocity and number of nodes
+    for (auto nodeNo: bulkNodes) {
+        sums[0] += rho(0, nodeNo);
+        sums[1] += vel(0, 0, nodeNo);
+        sums[2] += 1;
+    }
+    MPI_Allreduce(MPI_IN_PLACE, sums, 3, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+    mass = sums[0];
+    uMean = sums[1]/sums[2];
+    return ret;
+}
+
+
+int main(int argc, char *argv[])
+{
+    MPI_Init(&argc, &argv);
+    int myRank, nProcs;
+    MPI_Comm_rank(MPI_COMM_WORLD, &myRank);
+    MPI_Comm_size(MPI_COMM_WORLD, &nProcs);
+    Check check("check_immersed_boundary", myRank);
+
+    GeometryGenerator<LT> generator({64, 32});
+    LBvtk<LT> vtklb(std::istringstream(generator.vtklb(myRank, nProcs)));
+    Grid<LT> grid(vtklb);
+    Nodes<LT> nodes(vtklb, grid);
+    BndMpi<LT> mpiBoundary(vtklb, nodes, grid);
+    const std::vector<int> bulkNodes = findBulkNodes(nodes);
+
+    const int nSteps = 4000;
+    lbBase_t slip[2], mass, uMean;
+    runCylinder(vtklb, grid, nodes, mpiBoundary, bulkNodes, 1, nSteps, slip[0], mass, uMean);
+    const std::vector<lbBase_t> forces = runCylinder(vtklb, grid, nodes, mpiBoundary, bulkNodes, 5, nSteps, slip[1], mass, uMean);
+    check.require(uMean > 0, "flow along the body force");
+    check.near(slip[1]/uMean, 0.0, 1e-2, "largest marker slip after 5 forcing iterations, relative to the mean velocity");
+    check.require(slip[1] < 0.2*slip[0], "smaller slip with 5 forcing iterations than with 1");
+    check.near(forces[2*nSteps - 2]/(1e-6*mass), -1.0, 1e-3, "marker force relative to the body force on the fluid");
+    check.near(forces[2*nSteps - 1]/forces[2*nSteps - 2], 0.0, 1e-3, "cross flow marker force relative to the marker force");
+
+    checkReference(argc, argv, forces, 1e-12, check);
+
+    const int ret = check.result();
+    MPI_Finalize();
+    return ret;
+}
@@ -0,0 +1,154 @@
+// //////////////////////////////////////////////
+//
+// Check of the interpolated bounce back
+// (LBinterpolatedbb.h).
+//
+// Force driven Poiseuille flow in a D2Q9 channel,
+// periodic along x, with walls a distance q from the
+// fluid boundary nodes along the y links. The solid
+// nodes are the planes y = 0 and y = ny - 1, so the
+// walls are at y = 1 - q and y = ny - 2 + q. For each
+// scheme and q = 0.2, 0.5 and 0.8 the relative L2
+// error of the velocity is found for the channel
+// widths 8 + 2q and 16 + 2q, and the order of the
+// error must be about two.
+//
+// On two ranks the diagonal links next to the rank
+// boundary have x_f + c_beta on a ghost node, where the
+// quadratic scheme falls back to the linear scheme.
+// The number of such links must be positive on two
+// ranks, and the quadratic scheme must still be of
+// second order, with errors that are not larger than
+// those of the linear scheme (on one rank they are
+// about half as large for q = 0.2 and 0.8, and the
+// same for q = 0.5).
+// The bouzidi and yu schemes do not depend on the
+// ranks (the reference file holds their errors).
+//
+// //////////////////////////////////////////////
+
+#include <LBSOLVER.h>
+#include "LBcheck.h"
+
+typedef D2Q9 LT;
+
+
+lbBase_t poiseuilleError(const int ny, const lbBase_t q, const std::string &scheme, const int myRank, const int nProcs, int &numGhostLinks)
+/* poiseuilleError : relative L2 error of the velocity after the run. numGhostLinks is the
+ *  number of links, on all ranks, where x_f + c_beta is a ghost node.
+ */
+{
+    const lbBase_t tau = 0.8;
+    const lbBase_t viscosity = LT::c2*(tau - 0.5);
+    const lbBase_t yLow = 1.0 - q, yHigh = ny - 2.0 + q;
+    const lbBase_t width = yHigh - yLow;
+    const lbBase_t uMax = 0.01;
+    const lbBase_t g = 8*viscosity*uMax/(width*width);
+    auto uExact = [&](const lbBase_t y) {return 0.5*g/viscosity*(y - yLow)*(yHigh - y);};
+
+    GeometryGenerator<LT> generator({8, ny});
+    generator.addWalls(1);
+    LBvtk<LT> vtklb(std::istringstream(generator.vtklb(myRank, nProcs)));
+    Grid<LT> grid(vtklb);
+    Nodes<LT> nodes(vtklb, grid);
+    BndMpi<LT> mpiBoundary(vtklb, nodes, grid);
+    const std::vector<int> bulkNodes = findBulkNodes(nodes);
+    const std::vector<int> bndNodes = findFluidBndNodes(nodes);
+
+    ScalarField sd(1, grid.size());
+    for (int nodeNo = 1; nodeNo < grid.size(); ++nodeNo) {
+        const lbBase_t y = grid.pos(nodeNo, 1);
+        sd(0, nodeNo) = std::min(y - yLow, yHigh - y);
+    }
+    const InterpolatedBounceBack<LT> ibb(bndNodes, nodes, grid, sd, scheme);
+
+    const Boundary<LT> bnd(bndNodes, nodes, grid);
+    numGhostLinks = 0;
+    for (int bndNo = 0; bndNo < bnd.size(); ++bndNo) {
+        for (const auto &beta: bnd.beta(bndNo)) {
+            const int xf2 = grid.neighbor(beta, bnd.nodeNo(bndNo));
+            numGhostLinks += (nodes.isFluid(xf2) && !nodes.isMyRank(xf2)) ? 1 : 0;
+        }
+    }
+    MPI_Allreduce(MPI_IN_PLACE, &numGhostLinks, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+
+    // Start from the exact profile, so that only the error has to relax
+    LbField<LT> f(1, grid.size()), fTmp(1, grid.size());
+    for (auto nodeNo: bulkNodes) {
+        const std::valarray<lbBase_t> vel = {uExact(grid.pos(nodeNo, 1)), 0.0};
+        const std::valarray<lbBase_t> cu = LT::cDotAll(vel);
+        for (int q = 0; q < LT::nQ; ++q)
+            f(0, q, nodeNo) = LT::w[q]*(1.0 + LT::c2Inv*cu[q] + LT::c4Inv0_5*(cu[q]*cu[q] - LT::c2*vel[0]*vel[0]));
+    }
+
+    const std::valarray<lbBase_t> force = {g, 0.0};
+    const std::valarray<lbBase_t> cF = LT::cDotAll(force);
+    const int nSteps = 3000;
+    for (int i = 0; i < nSteps; ++i) {
+        for (auto nodeNo: bulkNodes) {
+            const std::valarray<lbBase_t> fNode = f(0, nodeNo);
+            const lbBase_t rhoNode = calcRho<LT>(fNode);
+            const std::valarray<lbBase_t> velNode = calcVel<LT>(fNode, rhoNode, force);
+            const std::valarray<lbBase_t> cu = LT::cDotAll(velNode);
+            const std::valarray<lbBase_t> omegaBGK = calcOmegaBGK<LT>(fNode, tau, rhoNode, LT::dot(velNode, velNode), cu);
+            const std::valarray<lbBase_t> deltaOmegaF = calcDeltaOmegaF<LT>(tau, cu, LT::dot(velNode, force), cF);
+            fTmp.propagateTo(0, nodeNo, fNode + omegaBGK + deltaOmegaF, grid);
+        }
+        f.swapData(fTmp);
+        mpiBoundary.communicateLbField(f, grid);
+        ibb.apply(0, f);
+    }
+
+    lbBase_t sums[2] = {0, 0};  // Squared error and squared exact velocity
+    for (auto nodeNo: bulkNodes) {
+        const std::valarray<lbBase_t> fNode = f(0, nodeNo);
+        const lbBase_t rhoNode = calcRho<LT>(fNode);
+        const std::valarray<lbBase_t> velNode = calcVel<LT>(fNode, rhoNode, force);
+        const lbBase_t u = uExact(grid.pos(nodeNo, 1));
+        sums[0] += (velNode[0] - u)*(velNode[0] - u) + velNode[1]*velNode[1];
+        sums[1] += u*u;
+    }
+    MPI_Allreduce(MPI_IN_PLACE, sums, 2, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+    return std::sqrt(sums[0]/sums[1]);
+}
+
+
+int main(int argc, char *argv[])
+{
+    MPI_Init(&argc, &argv);
+    int myRank, nProcs;
+    MPI_Comm_rank(MPI_COMM_WORLD, &myRank);
+    MPI_Comm_size(MPI_COMM_WORLD, &nProcs);
+    Check check("check_interpolated_bb", myRank);
+
+    const int ny[2] = {11, 19};
+    const std::vector<std::string> schemes = {"bouzidi", "quadratic", "yu"};
+    const std::vector<lbBase_t> qs = {0.2, 0.5, 0.8};
+    std::vector<lbBase_t> err(2*schemes.size()*qs.size());  // Two widths for each scheme and q
+    std::vector<lbBase_t> refErrors;
+    for (std::size_t s = 0; s < schemes.size(); ++s) {
+        for (std::size_t k = 0; k < qs.size(); ++k) {
+            lbBase_t *e = &err[2*(qs.size()*s + k)];
+            int numGhostLinks;
+            for (int n = 0; n < 2; ++n)
+                e[n] = poiseuilleError(ny[n], qs[k], schemes[s], myRank, nProcs, numGhostLinks);
+            const lbBase_t order = std::log(e[0]/e[1])/std::log((ny[1] - 3 + 2*qs[k])/(ny[0] - 3 + 2*qs[k]));
+            const std::string what = schemes[s] + " with q = " + std::to_string(qs[k]);
+            check.require(order > 1.8, "second order error of " + what);
+            check.require((nProcs == 1) == (numGhostLinks == 0), "links with x_f + c_beta on a ghost node only on several ranks");
+            if (schemes[s] != "quadratic")
+                refErrors.insert(refErrors.end(), e, e + 2);
+        }
+    }
+    // The quadratic scheme, also where it falls back to the linear scheme, is not less accurate than the linear scheme
+    for (std::size_t k = 0; k < qs.size(); ++k) {
+        for (int n = 0; n < 2; ++n)
+            check.require(err[2*(qs.size() + k) + n] <= (1 + 1e-9)*err[2*k + n], "quadratic error not larger than the bouzidi error with q = " + std::to_string(qs[k]));
+    }
+
+    checkReference(argc, argv, refErrors, 1e-12, check);
+
+    const int ret = check.result();
+    MPI_Finalize();
+    return ret;
+}
@@ -0,0 +1,187 @@
+// //////////////////////////////////////////////
+//
+// Check of the LES eddy viscosity models (LBles.h)
+// in 2d (D2Q9) and 3d (D3Q19).
+//
+// The velocity is a linear field u_i = g_ij x_j, so
+// that the lattice gradient is exact at an interior
+// node, and the eddy viscosity of WALE and Vreman is
+// compared with the model formulas for g. In 2d the
+// WALE operator of an incompressible field is zero.
+// The Smagorinsky tau is checked against its
+// definition nu_t = (C D)^2 |S|, also with the van
+// Driest damping D of the law of the wall in a channel.
+//
+// //////////////////////////////////////////////
+
+#include <LBSOLVER.h>
+#include "LBcheck.h"
+
+
+template <typename LT>
+lbBase_t waleViscosity(const std::vector<lbBase_t> &g, const lbBase_t C)
+{
+    constexpr int nD = LT::nD;
+    lbBase_t traceG2 = 0;
+    for (int i = 0; i < nD; ++i)
+        for (int k = 0; k < nD; ++k)
+            traceG2 += g[i*nD + k]*g[k*nD + i];
+    lbBase_t SS = 0, SdSd = 0;
+    for (int i = 0; i < nD; ++i) {
+        for (int j = 0; j < nD; ++j) {
+            lbBase_t Sd = (i == j) ? -traceG2/nD : 0.0;
+            for (int k = 0; k < nD; ++k)
+                Sd += 0.5*(g[i*nD + k]*g[k*nD + j] + g[j*nD + k]*g[k*nD + i]);
+            const lbBase_t S = 0.5*(g[i*nD + j] + g[j*nD + i]);
+            SS += S*S;
+            SdSd += Sd*Sd;
+        }
+    }
+    return C*C*pow(SdSd, 1.5)/(pow(SS, 2.5) + pow(SdSd, 1.25));
+}
+
+
+template <typename LT>
+lbBase_t vremanViscosity(const std::vector<lbBase_t> &g, const lbBase_t C)
+{
+    constexpr int nD = LT::nD;
+    // beta_ij = sum_m d_m u_i d_m u_j
+    lbBase_t beta[3][3] = {};
+    lbBase_t alphaAlpha = 0;
+    for (int i = 0; i < nD; ++i)
+        for (int j = 0; j < nD; ++j) {
+            alphaAlpha += g[i*nD + j]*g[i*nD + j];
+            for (int m = 0; m < nD; ++m)
+                beta[i][j] += g[i*nD + m]*g[j*nD + m];
+        }
+    lbBase_t B = beta[0][0]*beta[1][1] - beta[0][1]*beta[0][1];
+    if (nD == 3)
+        B += beta[0][0]*beta[2][2] - beta[0][2]*beta[0][2] + beta[1][1]*beta[2][2] - beta[1][2]*beta[1][2];
+    return 2.5*C*C*sqrt(B/alphaAlpha);
+}
+
+
+template <typename LT>
+void checkLattice(const std::vector<int> &size, const std::vector<lbBase_t> &gIncompressible, const std::vector<lbBase_t> &gGeneral, Check &check)
+{
+    const std::string name = (LT::nD == 2) ? "D2Q9" : "D3Q19";
+    int myRank, nProcs;
+    MPI_Comm_rank(MPI_COMM_WORLD, &myRank);
+    MPI_Comm_size(MPI_COMM_WORLD, &nProcs);
+    GeometryGenerator<LT> generator(size);
+    LBvtk<LT> vtklb(std::istringstream(generator.vtklb(myRank, nProcs)));
+    Grid<LT> grid(vtklb);
+    Nodes<LT> nodes(vtklb, grid);
+    const std::vector<int> bulkNodes = findBulkNodes(nodes);
+
+    // The node at the center of the system, if on this rank
+    int center = -1;
+    for (auto nodeNo: bulkNodes) {
+        bool isCenter = true;
+        for (int d = 0; d < LT::nD; ++d)
+            isCenter = isCenter && (grid.pos(nodeNo, d) == size[d]/2);
+        if (isCenter)
+            center = nodeNo;
+    }
+
+    const lbBase_t C = 0.5;
+    const lbBase_t tau0 = 0.51;
+    const lbBase_t rho = 1.0;
+    const std::valarray<lbBase_t> noStrain(0.0, LT::nD*(LT::nD + 1)/2);
+    for (int n = 0; n < 2; ++n) {
+        const std::vector<lbBase_t> &g = (n == 0) ? gIncompressible : gGeneral;
+        const bool incompressible = (n == 0);
+        VectorField<LT> vel(1, grid.size());
+        for (int nodeNo = 1; nodeNo < grid.size(); ++nodeNo)
+            for (int i = 0; i < LT::nD; ++i) {
+                vel(0, i, nodeNo) = 0;
+                for (int j = 0; j < LT::nD; ++j)
+                    vel(0, i, nodeNo) += g[i*LT::nD + j]*(grid.pos(nodeNo, j) - size[j]/2);
+            }
+        if (center < 0)
+            continue;
+        LES<LT> wale("wale", C, tau0, grid.size());
+        const lbBase_t tauWale = wale.tau(center, rho, noStrain, vel, grid);
+        const lbBase_t nuWale = (incompressible && (LT::nD == 2)) ? 0.0 : waleViscosity<LT>(g, C);
+        check.near(wale.eddyViscosity(), nuWale, 1e-12, name + " WALE eddy viscosity");
+        check.near(tauWale, tau0 + nuWale*LT::c2Inv, 1e-12, name + " WALE tau");
+
+        LES<LT> vreman("vreman", C, tau0, grid.size());
+        vreman.tau(center, rho, noStrain, vel, grid);
+        check.near(vreman.eddyViscosity(), vremanViscosity<LT>(g, C), 1e-12, name + " Vreman eddy viscosity");
+    }
+
+    // Smagorinsky: the strain rate tilde of a node with tau is 2 rho c2 tau S
+    LES<LT> smagorinsky("smagorinsky", C, tau0, grid.size());
+    std::valarray<lbBase_t> ETilde(LT::nD*(LT::nD + 1)/2);
+    for (std::size_t n = 0; n < ETilde.size(); ++n)
+        ETilde[n] = 1e-3*(n + 1);
+    const lbBase_t tau = smagorinsky.tau(bulkNodes[0], rho, ETilde, VectorField<LT>(1, grid.size()), grid);
+    const std::valarray<lbBase_t> S = ETilde/(2*rho*LT::c2*tau);
+    const lbBase_t traceS = LT::traceLowTri(S)/LT::nD;
+    const lbBase_t SS = LT::contractionLowTri(S, S) - LT::nD*traceS*traceS;
+    check.near(LT::c2*(tau - tau0), C*C*sqrt(2*SS), 1e-12, name + " Smagorinsky eddy viscosity");
+}
+
+
+void checkDamping(Check &check)
+/* checkDamping : Smagorinsky with the damping from the law of the wall, next to the walls of a D2Q9 channel */
+{
+    typedef D2Q9 LT;
+    int myRank, nProcs;
+    MPI_Comm_rank(MPI_COMM_WORLD, &myRank);
+    MPI_Comm_size(MPI_COMM_WORLD, &nProcs);
+    GeometryGenerator<LT> generator({9, 12});
+    generator.addWalls(1);
+    LBvtk<LT> vtklb(std::istringstream(generator.vtklb(myRank, nProcs)));
+    Grid<LT> grid(vtklb);
+    Nodes<LT> nodes(vtklb, grid);
+
+    const lbBase_t C = 0.5;
+    const lbBase_t tau0 = 0.51;
+    const lbBase_t rho = 1.0;
+    const lbBase_t u = 0.05;
+    const WallLaw wallLaw("spalding", LT::c2*(tau0 - 0.5));
+    VectorField<LT> vel(1, grid.size());
+    for (int nodeNo = 1; nodeNo < grid.size(); ++nodeNo) {
+        vel(0, 0, nodeNo) = u;
+        vel(0, 1, nodeNo) = 0.0;
+    }
+    LES<LT> smagorinsky("smagorinsky", C, tau0, grid.size());
+    smagorinsky.setWallDistance(nodes, grid, 4.0);
+    smagorinsky.setDamping(wallLaw, vel);
+
+    const std::valarray<lbBase_t> ETilde = {1e-3, 2e-3, 3e-3};
+    for (auto nodeNo: findBulkNodes(nodes)) {
+        if (grid.pos(nodeNo, 1) != 1)
+            continue;
+        // The wall is half way between the node and the solid
+        const lbBase_t y = 0.5;
+        const lbBase_t D = wallLaw.damping(y*wallLaw.frictionVelocity(u, y)/wallLaw.viscosity0());
+        const lbBase_t tau = smagorinsky.tau(nodeNo, rho, ETilde, vel, grid);
+        const std::valarray<lbBase_t> S = ETilde/(2*rho*LT::c2*tau);
+        const lbBase_t traceS = LT::traceLowTri(S)/LT::nD;
+        const lbBase_t SS = LT::contractionLowTri(S, S) - LT::nD*traceS*traceS;
+        check.require(D < 0.9, "damping next to the wall");
+        check.near(LT::c2*(tau - tau0), C*C*D*D*sqrt(2*SS), 1e-12, "D2Q9 damped Smagorinsky eddy viscosity");
+    }
+}
+
+
+int main(int argc, char *argv[])
+{
+    MPI_Init(&argc, &argv);
+    int myRank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &myRank);
+    Check check("check_les", myRank);
+
+    // g_ij = d_j u_i, row major
+    checkLattice<D2Q9>({9, 9}, {0.01, 0.02, -0.015, -0.01}, {0.01, 0.02, -0.015, 0.005}, check);
+    checkLattice<D3Q19>({7, 7, 7}, {0.01, 0.02, 0.0, -0.015, -0.004, 0.01, 0.003, -0.02, -0.006},
+                                   {0.01, 0.02, 0.0, -0.015, 0.004, 0.01, 0.003, -0.02, 0.006}, check);
+    checkDamping(check);
+
+    const int ret = check.result();
+    MPI_Finalize();
+    return ret;
+}
@@ -0,0 +1,155 @@
+// //////////////////////////////////////////////
+//
+// Check of the load balancer (LBloadbalance.h).
+//
+// A force driven D2Q9 channel of 16x42 nodes,
+// periodic along x, with walls at y = 0 and y = 41,
+// starts as one slab along x per rank. Without timing
+// each node costs the same, so the recursive
+// coordinate bisection must cut the 40 fluid rows along
+// y into equal parts (the same number of fluid nodes
+// on all ranks), and the next check must keep the
+// partition. The registered fields must be moved
+// bitwise, and the run that is repartitioned after 50
+// of 100 steps, with the Grid, Nodes and BndMpi made
+// from the vtklb contents returned by repartition(...),
+// must give the same distributions, density and
+// velocity bit for bit as the run that is not.
+//
+// //////////////////////////////////////////////
+
+#include <LBSOLVER.h>
+#include "LBcheck.h"
+
+typedef D2Q9 LT;
+
+
+struct Run  // Geometry and fields of a channel run
+{
+    Run(LBvtk<LT> &vtklb) : grid(vtklb), nodes(vtklb, grid), mpiBoundary(vtklb, nodes, grid),
+        bulkNodes(findBulkNodes(nodes)), bounceBack(findFluidBndNodes(nodes), nodes, grid),
+        f(1, grid.size()), fTmp(1, grid.size()), rho(1, grid.size()), vel(1, grid.size()) {}
+    void rebuild(LBvtk<LT> &vtklb)
+    {
+        grid = Grid<LT>(vtklb);
+        nodes = Nodes<LT>(vtklb, grid);
+        mpiBoundary = BndMpi<LT>(vtklb, nodes, grid);
+        bulkNodes = findBulkNodes(nodes);
+        bounceBack = HalfWayBounceBack<LT>(findFluidBndNodes(nodes), nodes, grid);
+    }
+    std::vector<lbBase_t> values() const
+    /* values : distributions, density and velocity of all fluid nodes, ordered by
+     *  position, on rank 0
+     */
+    {
+        std::vector<lbBase_t> ret;
+        for (auto nodeNo: bulkNodes) {
+            for (int q = 0; q < LT::nQ; ++q)
+                ret.push_back(f(0, q, nodeNo));
+            ret.push_back(rho(0, nodeNo));
+            for (int d = 0; d < LT::nD; ++d)
+                ret.push_back(vel(0, d, nodeNo));
+        }
+        return gatherNodeValues(grid, bulkNodes, ret);
+    }
+
+    Grid<LT> grid;
+    Nodes<LT> nodes;
+    BndMpi<LT> mpiBoundary;
+    std::vector<int> bulkNodes;
+    HalfWayBounceBack<LT> bounceBack;
+    LbField<LT> f, fTmp;
+    ScalarField rho;
+    VectorField<LT> vel;
+};
+
+
+void initiate(Run &run)
+/* initiate : equilibrium with a velocity that varies along x and y */
+{
+    const lbBase_t pi = 3.14159265358979323846;
+    for (auto nodeNo: run.bulkNodes) {
+        const lbBase_t x = run.grid.pos(nodeNo, 0), y = run.grid.pos(nodeNo, 1);
+        const lbBase_t rhoNode = 1.0 + 0.01*std::cos(2*pi*x/16);
+        const std::valarray<lbBase_t> velNode = {0.02*std::sin(pi*y/41), 0.01*std::sin(2*pi*x/16)};
+        const std::valarray<lbBase_t> cu = LT::cDotAll(velNode);
+        const lbBase_t u2 = LT::dot(velNode, velNode);
+        for (int q = 0; q < LT::nQ; ++q)
+            run.f(0, q, nodeNo) = LT::w[q]*rhoNode*(1.0 + LT::c2Inv*cu[q] + LT::c4Inv0_5*(cu[q]*cu[q] - LT::c2*u2));
+    }
+}
+
+
+void step(Run &run, const int nSteps)
+{
+    const lbBase_t tau = 0.7;
+    const std::valarray<lbBase_t> force = {1e-5, 0.0};
+    const std::valarray<lbBase_t> cF = LT::cDotAll(force);
+    for (int i = 0; i < nSteps; ++i) {
+        for (auto nodeNo: run.bulkNodes) {
+            const std::valarray<lbBase_t> fNode = run.f(0, nodeNo);
+            const lbBase_t rhoNode = calcRho<LT>(fNode);
+            const std::valarray<lbBase_t> velNode = calcVel<LT>(fNode, rhoNode, force);
+            const std::valarray<lbBase_t> cu = LT::cDotAll(velNode);
+            const std::valarray<lbBase_t> omegaBGK = calcOmegaBGK<LT>(fNode, tau, rhoNode, LT::dot(velNode, velNode), cu);
+            const std::valarray<lbBase_t> deltaOmegaF = calcDeltaOmegaF<LT>(tau, cu, LT::dot(velNode, force), cF);
+            run.rho(0, nodeNo) = rhoNode;
+            run.vel.set(0, nodeNo) = velNode;
+            run.fTmp.propagateTo(0, nodeNo, fNode + omegaBGK + deltaOmegaF, run.grid);
+        }
+        run.f.swapData(run.fTmp);
+        run.mpiBoundary.communicateLbField(run.f, run.grid);
+        run.bounceBack.apply(run.f, run.grid);
+    }
+}
+
+
+int main(int argc, char *argv[])
+{
+    MPI_Init(&argc, &argv);
+    int myRank, nProcs;
+    MPI_Comm_rank(MPI_COMM_WORLD, &myRank);
+    MPI_Comm_size(MPI_COMM_WORLD, &nProcs);
+    Check check("check_load_balance", myRank);
+
+    GeometryGenerator<LT> generator({16, 42});
+    generator.addWalls(1);
+    generator.setRankDims({nProcs, 1});
+    const std::string text = generator.vtklb(myRank, nProcs);
+    LBvtk<LT> vtklbFixed((std::istringstream(text))), vtklbBalanced((std::istringstream(text)));
+    Run fixed(vtklbFixed), balanced(vtklbBalanced);
+    LoadBalancer<LT> balancer(vtklbBalanced, 50, 0.0);
+    balancer.addField(balanced.f);
+    balancer.addField(balanced.fTmp);
+    balancer.addField(balanced.rho);
+    balancer.addField(balanced.vel);
+
+    initiate(fixed);
+    initiate(balanced);
+    step(fixed, 100);
+    step(balanced, 50);
+
+    // Repartition
+    const std::vector<lbBase_t> before = balanced.values();
+    check.require(!balancer.check(49, balanced.grid, balanced.nodes), "no check between the intervals");
+    check.require(balancer.check(50, balanced.grid, balanced.nodes), "nodes move to the new partition");
+    LBvtk<LT> vtklbNew(std::istringstream(balancer.repartition(balanced.grid, balanced.nodes)));
+    balanced.rebuild(vtklbNew);
+    check.require(balancer.numRepartitions() == 1, "one repartition");
+    check.require(before == balanced.values(), "fields bitwise equal after the repartition");
+
+    // Balanced node counts
+    const int numNodes = balanced.bulkNodes.size();
+    int numMin, numMax;
+    MPI_Allreduce(&numNodes, &numMin, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+    MPI_Allreduce(&numNodes, &numMax, 1, MPI_INT, MPI_MAX, MPI_COMM_WORLD);
+    check.require((numMin == 16*40/nProcs) && (numMax == numMin), "the same number of fluid nodes on all ranks, " + std::to_string(numMin) + " to " + std::to_string(numMax));
+    check.require(!balancer.check(100, balanced.grid, balanced.nodes), "no nodes move from a balanced partition");
+
+    step(balanced, 50);
+    check.require(fixed.values() == balanced.values(), "the repartitioned run bitwise equal to the fixed run after 100 steps");
+
+    const int ret = check.result();
+    MPI_Finalize();
+    return ret;
+}
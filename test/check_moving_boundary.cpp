@@ -0,0 +1,123 @@
+// //////////////////////////////////////////////
+//
+// Check of the moving rigid body boundary
+// (LBmovingboundary.h).
+//
+// A cylinder of radius 5 in a periodic D2Q9 box of
+// 64x32 nodes with fluid at rest. A cylinder at rest,
+// centered on a node, must get zero force and torque.
+// A cylinder moving along x must get a drag opposite
+// to its velocity, with a small lift, and the nodes it
+// covers and uncovers must be updated as it crosses
+// the rank boundary at x = 32 on two ranks. The
+// uncovered nodes get the mean density of their
+// neighbors, also of those on the other rank, so the
+// force history must be independent of the number of
+// ranks up to the order of the global sum (the
+// reference file holds the force of each step).
+//
+// //////////////////////////////////////////////
+
+#include <LBSOLVER.h>
+#include "LBcheck.h"
+
+typedef D2Q9 LT;
+
+
+std::vector<lbBase_t> runCylinder(Grid<LT> &grid, const Nodes<LT> &nodes, BndMpi<LT> &mpiBoundary, const std::vector<int> &bulkNodes,
+                                  const lbBase_t U, const int nSteps, int &numChanged)
+/* runCylinder : force and torque (x, y and the z torque) of each step on a cylinder
+ *  starting at (20, 16) and moving with the velocity U along x. numChanged is the
+ *  number of covered and uncovered nodes on this rank.
+ */
+{
+    const lbBase_t tau = 0.8;
+    const lbBase_t radius = 5.0;
+    std::vector<lbBase_t> center = {20.0, 16.0, 0.0};
+    const std::vector<lbBase_t> velocity = {U, 0.0, 0.0};
+    const std::vector<lbBase_t> omega = {0.0, 0.0, 0.0};
+    auto isInside = [&](const std::valarray<lbBase_t> &pos) {
+        return std::hypot(pos[0] - center[0], pos[1] - center[1]) <= radius;
+    };
+
+    LbField<LT> f(1, grid.size()), fTmp(1, grid.size());
+    ScalarField rho(1, grid.size());
+    for (auto nodeNo: bulkNodes)
+        for (int q = 0; q < LT::nQ; ++q)
+            f(0, q, nodeNo) = LT::w[q];
+    MovingBoundary<LT> movingBnd(nodes, grid);
+    movingBnd.initiate(isInside, nodes, grid);
+
+    std::vector<lbBase_t> ret;
+    numChanged = 0;
+    for (int i = 0; i < nSteps; ++i) {
+        for (auto nodeNo: bulkNodes) {
+            const std::valarray<lbBase_t> fNode = f(0, nodeNo);
+            const lbBase_t rhoNode = calcRho<LT>(fNode);
+            rho(0, nodeNo) = rhoNode;
+            const std::valarray<lbBase_t> velNode = calcVel<LT>(fNode, rhoNode);
+            const std::valarray<lbBase_t> omegaBGK = calcOmegaBGK<LT>(fNode, tau, rhoNode, LT::dot(velNode, velNode), LT::cDotAll(velNode));
+            fTmp.propagateTo(0, nodeNo, fNode + omegaBGK, grid);
+        }
+        f.swapData(fTmp);
+        mpiBoundary.communicateLbField(f, grid);
+        mpiBoundary.communciateScalarField(rho);
+
+        center[0] += U;
+        movingBnd.update(isInside, nodes, grid);
+        movingBnd.apply(0, f, grid, center, velocity, omega);
+        movingBnd.refill(0, f, rho, nodes, grid, center, velocity, omega);
+        numChanged += movingBnd.freshNodes().size() + movingBnd.coveredNodes().size();
+        const std::valarray<lbBase_t> forceTorque = movingBnd.forceAndTorque();
+        ret.push_back(forceTorque[0]);
+        ret.push_back(forceTorque[1]);
+        ret.push_back(forceTorque[LT::nD + 2]);
+    }
+    return ret;
+}
+
+
+int main(int argc, char *argv[])
+{
+    MPI_Init(&argc, &argv);
+    int myRank, nProcs;
+    MPI_Comm_rank(MPI_COMM_WORLD, &myRank);
+    MPI_Comm_size(MPI_COMM_WORLD, &nProcs);
+    Check check("check_moving_boundary", myRank);
+
+    GeometryGenerator<LT> generator({64, 32});
+    LBvtk<LT> vtklb(std::istringstream(generator.vtklb(myRank, nProcs)));
+    Grid<LT> grid(vtklb);
+    Nodes<LT> nodes(vtklb, grid);
+    BndMpi<LT> mpiBoundary(vtklb, nodes, grid);
+    const std::vector<int> bulkNodes = findBulkNodes(nodes);
+
+    // Body at rest
+    int numChanged[2];
+    const std::vector<lbBase_t> rest = runCylinder(grid, nodes, mpiBoundary, bulkNodes, 0.0, 50, numChanged[0]);
+    lbBase_t maxRest = 0;
+    for (auto val: rest)
+        maxRest = std::max(maxRest, std::abs(val));
+    check.near(maxRest, 0.0, 1e-12, "largest force and torque component on the cylinder at rest");
+
+    // Moving body, drag averaged over the last half of the run
+    const lbBase_t U = 0.02;
+    const int nSteps = 600;
+    const std::vector<lbBase_t> moving = runCylinder(grid, nodes, mpiBoundary, bulkNodes, U, nSteps, numChanged[1]);
+    lbBase_t meanForce[2] = {0, 0};
+    for (int i = nSteps/2; i < nSteps; ++i) {
+        meanForce[0] += moving[3*i]/(nSteps - nSteps/2);
+        meanForce[1] += moving[3*i + 1]/(nSteps - nSteps/2);
+    }
+    MPI_Allreduce(MPI_IN_PLACE, numChanged, 2, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+    check.require(numChanged[0] == 0, "no nodes covered or uncovered by the cylinder at rest");
+    check.require(numChanged[1] > 0, "nodes covered and uncovered by the moving cylinder");
+    check.require(meanForce[0] < 0, "drag opposite to the velocity");
+    check.require(std::abs(meanForce[1]) < 0.1*std::abs(meanForce[0]), "lift small compared with the drag");
+
+    checkReference(argc, argv, moving, 1e-12, check);
+
+    const int ret = check.result();
+    MPI_Finalize();
+    return ret;
+}
@@ -0,0 +1,184 @@
+// //////////////////////////////////////////////
+//
+// Check of the k-epsilon RANS module
+// (LBranskepsilon.h) against the node loop of the
+// RANS example (examples/rans/main.cpp).
+//
+// A force driven D2Q9 channel of 8x34 nodes, periodic
+// along x, with halfway bounce back walls for all
+// three fields. The same channel is run with the
+// example's collision (fRegularized, Rans::apply and
+// the TRT collisions) and with
+// RansKEpsilon::collideAndPropagate, from the same
+// input file. The example relaxes the epsilon source
+// with tau_k where the module uses tau_epsilon, so the
+// input has the same Prandtl numbers for k and
+// epsilon. After 2000 steps the distributions and the
+// macroscopic values must agree to round off (the
+// measured relative differences are below 4e-12), and
+// the turbulent viscosity must be active (it is 2.5
+// times the molecular viscosity).
+//
+// //////////////////////////////////////////////
+
+#include <LBSOLVER.h>
+#include "LBcheck.h"
+#include "ransmain.h"
+
+typedef D2Q9 LT;
+
+
+void exampleCollideAndPropagate(Rans<LT> &rans, const std::vector<int> &bulkNodes, const LbField<LT> &f, LbField<LT> &fTmp, const std::valarray<lbBase_t> &force,
+                                ScalarField &rho, VectorField<LT> &vel, ScalarField &rhoK, ScalarField &rhoE, ScalarField &viscosity, const Grid<LT> &grid)
+/* exampleCollideAndPropagate : the bulk node loop of examples/rans/main.cpp, with a
+ *  constant body force
+ */
+{
+    for (auto nodeNo: bulkNodes) {
+        const auto fNode = fRegularized<LT>(f(0, nodeNo), 0);
+        const auto gNode = fRegularized<LT>(f(1, nodeNo), 0);
+        const auto hNode = fRegularized<LT>(f(2, nodeNo), 0);
+
+        const lbBase_t rhoNode = calcRho<LT>(fNode);
+        const auto velNode = calcVel<LT>(fNode, rhoNode, force);
+        const lbBase_t u2 = LT::dot(velNode, velNode);
+        const auto cu = LT::cDotAll(velNode);
+
+        rans.apply(fNode, rhoNode, velNode, u2, cu, force, 0.0, gNode, hNode, calcRho<LT>(gNode), calcRho<LT>(hNode));
+        const lbBase_t rhoKNode = rans.rhoK();
+        const lbBase_t rhoENode = rans.rhoE();
+        const lbBase_t tauNode = rans.tau();
+        const lbBase_t tauKNode = rans.tauK();
+        const lbBase_t tauENode = rans.tauE();
+
+        rho(0, nodeNo) = rhoNode;
+        vel.set(0, nodeNo) = velNode;
+        rhoK(0, nodeNo) = rhoKNode;
+        rhoE(0, nodeNo) = rhoENode;
+        viscosity(0, nodeNo) = rhoNode*LT::c2*(tauNode - 0.5);
+
+        const lbBase_t uF = LT::dot(velNode, force);
+        const auto cF = LT::cDotAll(force);
+        const auto deltaOmegaF = calcDeltaOmegaFTRT<LT>(tauNode, 1.0, 1.0, cu, uF, cF);
+        const auto omegaBGK = calcOmegaBGKTRT<LT>(fNode, tauNode, 1.0, rhoNode, u2, cu);
+        const auto dOmegaFK = calcDeltaOmegaFDiffTRT<LT>(1.0, tauKNode, rhoKNode/rhoNode, cu, uF, cF);
+        const auto dOmegaFE = calcDeltaOmegaFDiffTRT<LT>(1.0, tauENode, rhoENode/rhoNode, cu, uF, cF);
+        const auto dOmegaSourceK = calcDeltaOmegaRTRT<LT>(1.0, tauKNode, cu, rans.sourceK());
+        const auto dOmegaSourceE = calcDeltaOmegaRTRT<LT>(1.0, tauKNode, cu, rans.sourceE());
+        const auto omegaBGK_K = calcOmegaBGKTRT<LT>(gNode, 1.0, tauKNode, rhoKNode, u2, cu);
+        const auto omegaBGK_E = calcOmegaBGKTRT<LT>(hNode, 1.0, tauENode, rhoENode, u2, cu);
+
+        fTmp.propagateTo(0, nodeNo, fNode + omegaBGK + deltaOmegaF, grid);
+        fTmp.propagateTo(1, nodeNo, gNode + omegaBGK_K + dOmegaFK + dOmegaSourceK, grid);
+        fTmp.propagateTo(2, nodeNo, hNode + omegaBGK_E + dOmegaFE + dOmegaSourceE, grid);
+    }
+}
+
+
+int main(int argc, char *argv[])
+{
+    MPI_Init(&argc, &argv);
+    int myRank, nProcs;
+    MPI_Comm_rank(MPI_COMM_WORLD, &myRank);
+    MPI_Comm_size(MPI_COMM_WORLD, &nProcs);
+    Check check("check_rans_kepsilon", myRank);
+
+    // One input file per number of ranks, as the runs may be done at the same time
+    const std::string inputName = "check_rans_kepsilon_np" + std::to_string(nProcs) + ".input";
+    if (myRank == 0) {
+        std::ofstream ofs(inputName);
+        ofs << "<fluid>\n"
+            << "    viscosity 0.01\n"
+            << "<end>\n"
+            << "<RANS>\n"
+            << "    <k-epsilonCoef>\n"
+            << "        C_mu 0.09\n"
+            << "        sigma_0k 1.0\n"
+            << "        sigma_k 1.3\n"
+            << "        C_1epsilon 1.44\n"
+            << "        C_2epsilon 1.92\n"
+            << "        sigma_0epsilon 1.0\n"
+            << "        sigma_epsilon 1.3\n"
+            << "    <end>\n"
+            << "    <inlet>\n"
+            << "        velNoiseAmplitude 0\n"
+            << "    <end>\n"
+            << "    <wall>\n"
+            << "        kappa 0.42\n"
+            << "        E 9.0\n"
+            << "        yp 0.5\n"
+            << "    <end>\n"
+            << "<end>\n";
+    }
+    MPI_Barrier(MPI_COMM_WORLD);
+    Input input(inputName);
+
+    GeometryGenerator<LT> generator({8, 34});
+    generator.addWalls(1);
+    LBvtk<LT> vtklb(std::istringstream(generator.vtklb(myRank, nProcs)));
+    Grid<LT> grid(vtklb);
+    Nodes<LT> nodes(vtklb, grid);
+    BndMpi<LT> mpiBoundary(vtklb, nodes, grid);
+    const std::vector<int> bulkNodes = findBulkNodes(nodes);
+    const HalfWayBounceBack<LT> bounceBackBnd(findFluidBndNodes(nodes), nodes, grid);
+
+    Rans<LT> ransExample(input, myRank);
+    const RansKEpsilon<LT> ransModule(input);
+
+    const std::valarray<lbBase_t> g = {2e-5, 0.0};
+    const lbBase_t rhoK0 = 1e-4, rhoE0 = 1e-7;
+    VectorField<LT> force(1, grid.size());
+    for (auto nodeNo: bulkNodes)
+        force.set(0, nodeNo) = g;
+
+    // Fields of the example (0) and of the module (1)
+    std::vector<LbField<LT>> f(2, LbField<LT>(3, grid.size())), fTmp(2, LbField<LT>(3, grid.size()));
+    std::vector<ScalarField> rho(2, ScalarField(1, grid.size())), rhoK(2, ScalarField(1, grid.size())), rhoE(2, ScalarField(1, grid.size()));
+    std::vector<ScalarField> viscosity(2, ScalarField(1, grid.size()));
+    std::vector<VectorField<LT>> vel(2, VectorField<LT>(1, grid.size()));
+    for (int n = 0; n < 2; ++n)
+        ransModule.initiate(bulkNodes, 1.0, rhoK0, rhoE0, f[n]);
+
+    const int nSteps = 2000;
+    for (int i = 0; i < nSteps; ++i) {
+        exampleCollideAndPropagate(ransExample, bulkNodes, f[0], fTmp[0], g, rho[0], vel[0], rhoK[0], rhoE[0], viscosity[0], grid);
+        ransModule.collideAndPropagate(bulkNodes, f[1], fTmp[1], force, rho[1], vel[1], rhoK[1], rhoE[1], viscosity[1], grid);
+        for (int n = 0; n < 2; ++n) {
+            f[n].swapData(fTmp[n]);
+            mpiBoundary.communicateLbField(f[n], grid);
+            bounceBackBnd.apply(f[n], grid);
+        }
+    }
+
+    // Largest differences relative to the largest values
+    lbBase_t diff[6] = {0, 0, 0, 0, 0, 0}, scale[6] = {0, 0, 0, 0, 0, 0};  // f, rho, vel, rhoK, rhoE, viscosity
+    auto compare = [&](const int k, const lbBase_t a, const lbBase_t b) {
+        diff[k] = std::max(diff[k], std::abs(a - b));
+        scale[k] = std::max(scale[k], std::abs(a));
+    };
+    lbBase_t maxTurbulentViscosity = 0;
+    for (auto nodeNo: bulkNodes) {
+        for (int fieldNo = 0; fieldNo < 3; ++fieldNo)
+            for (int q = 0; q < LT::nQ; ++q)
+                compare(0, f[0](fieldNo, q, nodeNo), f[1](fieldNo, q, nodeNo));
+        compare(1, rho[0](0, nodeNo), rho[1](0, nodeNo));
+        for (int d = 0; d < LT::nD; ++d)
+            compare(2, vel[0](0, d, nodeNo), vel[1](0, d, nodeNo));
+        compare(3, rhoK[0](0, nodeNo), rhoK[1](0, nodeNo));
+        compare(4, rhoE[0](0, nodeNo), rhoE[1](0, nodeNo));
+        compare(5, viscosity[0](0, nodeNo), viscosity[1](0, nodeNo));
+        maxTurbulentViscosity = std::max(maxTurbulentViscosity, viscosity[1](0, nodeNo)/rho[1](0, nodeNo) - 0.01);
+    }
+    MPI_Allreduce(MPI_IN_PLACE, diff, 6, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+    MPI_Allreduce(MPI_IN_PLACE, scale, 6, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+    MPI_Allreduce(MPI_IN_PLACE, &maxTurbulentViscosity, 1, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+
+    const std::string names[6] = {"distributions", "density", "velocity", "rho k", "rho epsilon", "viscosity"};
+    for (int k = 0; k < 6; ++k)
+        check.near(diff[k]/scale[k], 0.0, 1e-10, "largest difference of the " + names[k] + " of the example and the module, relative to the largest value");
+    check.require(maxTurbulentViscosity > 0.1*0.01, "turbulent viscosity larger than a tenth of the molecular viscosity");
+
+    const int ret = check.result();
+    MPI_Finalize();
+    return ret;
+}
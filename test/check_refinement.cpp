@@ -0,0 +1,183 @@
+// //////////////////////////////////////////////
+//
+// Check of the 2:1 block refinement with sub-cycling
+// (LBrefinement.h).
+//
+// A periodic D2Q9 channel of 32x12 coarse nodes, with
+// walls normal to y and a body force along x, and a
+// fine patch over the coarse columns 8 to 15 and the
+// full height. The patch is read from a vtklb file
+// written here, with no links out of the patch. At
+// steady state the coarse and the fine velocity
+// profiles must both be the Poiseuille profile, and
+// the flux through the patch must be the coarse flux.
+// The measured errors are 1.4% (coarse) and 1.7%
+// (fine) of the maximum velocity, against 0.5% for
+// the coarse channel alone, and 0.8% in the flux, as
+// the coupling is not mass conservative.
+// Runs on one rank only.
+//
+// //////////////////////////////////////////////
+
+#include <LBSOLVER.h>
+#include "LBcheck.h"
+
+typedef D2Q9 LT;
+
+
+std::string patchVtklb(const int nx, const int ny)
+/* patchVtklb : vtklb file of an nx x ny box, solid in the two bottom and the two top
+ *  rows, with no periodic links
+ */
+{
+    std::ostringstream ofs;
+    ofs << "# BADChIMP vtklb Version na\n";
+    ofs << "Geometry file for process 0\n";
+    ofs << "ASCII\n";
+    ofs << "DATASET UNSTRUCTURED_LB_GRID\n";
+    ofs << "NUM_DIMENSIONS 2\n";
+    ofs << "GLOBAL_DIMENSIONS " << nx + 2 << " " << ny + 2 << "\n";
+    ofs << "USE_ZERO_GHOST_NODE\n";
+    ofs << "POINTS " << nx*ny << " int\n";
+    for (int x = 0; x < nx; ++x)
+        for (int y = 0; y < ny; ++y)
+            ofs << x << " " << y << "\n";
+    ofs << "LATTICE " << LT::nQ << " int\n";
+    for (int q = 0; q < LT::nQ; ++q)
+        ofs << LT::c(q, 0) << " " << LT::c(q, 1) << "\n";
+    ofs << "NEIGHBORS int\n";
+    for (int x = 0; x < nx; ++x) {
+        for (int y = 0; y < ny; ++y) {
+            for (int q = 0; q < LT::nQ; ++q) {
+                const int xn = x + LT::c(q, 0);
+                const int yn = y + LT::c(q, 1);
+                const bool inside = (xn >= 0) && (xn < nx) && (yn >= 0) && (yn < ny);
+                ofs << (inside ? 1 + xn*ny + yn : 0) << ((q < LT::nQ - 1) ? " " : "\n");
+            }
+        }
+    }
+    ofs << "PARALLEL_COMPUTING 0\n";
+    ofs << "POINT_DATA " << nx*ny << "\n";
+    ofs << "SCALARS nodetype int\n";
+    for (int x = 0; x < nx; ++x)
+        for (int y = 0; y < ny; ++y)
+            ofs << ( ((y < 2) || (y >= ny - 2)) ? 0 : 1 ) << "\n";
+    return ofs.str();
+}
+
+
+struct Level
+/* Level : grid, boundaries and fields of one refinement level */
+{
+    Level(const std::string &vtklbText)
+        : vtklb(std::istringstream(vtklbText)), grid(vtklb), nodes(vtklb, grid), mpiBoundary(vtklb, nodes, grid),
+          bulkNodes(findBulkNodes(nodes)), bounceBack(findFluidBndNodes(nodes), nodes, grid), f(1, grid.size()), fTmp(1, grid.size()),
+          vel(1, grid.size())
+    {
+        for (auto nodeNo: bulkNodes)
+            for (int q = 0; q < LT::nQ; ++q)
+                f(0, q, nodeNo) = LT::w[q];
+    }
+
+    void step(const lbBase_t tau, const std::valarray<lbBase_t> &force)
+    /* step : BGK collision with Guo forcing, propagation, mpi and bounce back */
+    {
+        for (auto nodeNo: bulkNodes) {
+            const std::valarray<lbBase_t> fNode = f(0, nodeNo);
+            const lbBase_t rhoNode = calcRho<LT>(fNode);
+            const std::valarray<lbBase_t> velNode = calcVel<LT>(fNode, rhoNode, force);
+            const std::valarray<lbBase_t> cu = LT::cDotAll(velNode);
+            const std::valarray<lbBase_t> omega = calcOmegaBGK<LT>(fNode, tau, rhoNode, LT::dot(velNode, velNode), cu);
+            const std::valarray<lbBase_t> deltaOmegaF = calcDeltaOmegaF<LT>(tau, cu, LT::dot(velNode, force), LT::cDotAll(force));
+            fTmp.propagateTo(0, nodeNo, fNode + omega + deltaOmegaF, grid);
+            vel.set(0, nodeNo) = velNode;
+        }
+        f.swapData(fTmp);
+        mpiBoundary.communicateLbField(f, grid);
+        bounceBack.apply(f, grid);
+    }
+
+    LBvtk<LT> vtklb;
+    Grid<LT> grid;
+    Nodes<LT> nodes;
+    BndMpi<LT> mpiBoundary;
+    std::vector<int> bulkNodes;
+    HalfWayBounceBack<LT> bounceBack;
+    LbField<LT> f, fTmp;
+    VectorField<LT> vel;
+};
+
+
+int main(int argc, char *argv[])
+{
+    MPI_Init(&argc, &argv);
+    int myRank, nProcs;
+    MPI_Comm_rank(MPI_COMM_WORLD, &myRank);
+    MPI_Comm_size(MPI_COMM_WORLD, &nProcs);
+    Check check("check_refinement", myRank);
+    if (nProcs != 1) {
+        check.require(false, "the patch is written for one rank");
+        const int ret = check.result();
+        MPI_Finalize();
+        return ret;
+    }
+
+    const std::vector<int> size = {32, 12};
+    const std::vector<int> patchOrigin = {8, 0};
+    const int patchWidth = 8;
+    GeometryGenerator<LT> generator(size);
+    generator.addWalls(1);
+    Level coarse(generator.vtklb(myRank, nProcs));
+    Level fine(patchVtklb(2*patchWidth, 2*size[1]));
+
+    const lbBase_t tauC = 0.8;
+    const std::valarray<lbBase_t> forceC = {1.0e-5, 0.0};
+    const std::valarray<lbBase_t> forceF = 0.5*forceC;
+    std::vector<RefinementInterface<LT>> interfaces;
+    interfaces.emplace_back(coarse.grid, coarse.bulkNodes, fine.grid, fine.bulkNodes, patchOrigin, tauC);
+    const lbBase_t tauF = interfaces[0].tauFine();
+    std::vector<LbField<LT> *> f = {&coarse.f, &fine.f};
+    auto step = [&](const int level) {
+        if (level == 0)
+            coarse.step(tauC, forceC);
+        else
+            fine.step(tauF, forceF);
+    };
+    check.require(!interfaces[0].fineInterfaceNodes().empty(), "fine interface nodes");
+
+    const int nSteps = 4000;
+    for (int i = 0; i < nSteps; ++i)
+        advanceRefined(0, interfaces, f, step);
+
+    // Poiseuille profile in coarse units, with the walls half way between the nodes
+    const lbBase_t nu = LT::c2*(tauC - 0.5);
+    const lbBase_t width = size[1] - 2;
+    auto poiseuille = [&](const lbBase_t y) {return forceC[0]/(2*nu)*(y - 0.5)*(width + 0.5 - y);};
+    const lbBase_t uMax = poiseuille(0.5 + 0.5*width);
+
+    lbBase_t maxErr[2] = {0, 0};  // Coarse outside the patch, fine
+    std::vector<lbBase_t> flux(size[0], 0.0), fluxFine(2*patchWidth, 0.0);
+    for (auto nodeNo: coarse.bulkNodes) {
+        const int x = coarse.grid.pos(nodeNo, 0);
+        const int y = coarse.grid.pos(nodeNo, 1);
+        flux[x] += coarse.vel(0, 0, nodeNo);
+        if ( (x < patchOrigin[0]) || (x >= patchOrigin[0] + patchWidth) )
+            maxErr[0] = std::max(maxErr[0], std::abs(coarse.vel(0, 0, nodeNo) - poiseuille(y)));
+    }
+    for (auto nodeNo: fine.bulkNodes) {
+        const lbBase_t y = 0.5*(fine.grid.pos(nodeNo, 1) + 0.5) - 0.5;  // Coarse coordinate
+        fluxFine[fine.grid.pos(nodeNo, 0)] += 0.5*fine.vel(0, 0, nodeNo);
+        maxErr[1] = std::max(maxErr[1], std::abs(fine.vel(0, 0, nodeNo) - poiseuille(y)));
+    }
+    lbBase_t maxFluxDiff = 0;
+    for (auto q: fluxFine)
+        maxFluxDiff = std::max(maxFluxDiff, std::abs(q - flux[0]));
+
+    check.near(maxErr[0]/uMax, 0.0, 2.5e-2, "relative coarse velocity error");
+    check.near(maxErr[1]/uMax, 0.0, 2.5e-2, "relative fine velocity error");
+    check.near(maxFluxDiff/flux[0], 0.0, 1e-2, "relative flux difference of the patch");
+
+    const int ret = check.result();
+    MPI_Finalize();
+    return ret;
+}
@@ -0,0 +1,157 @@
+// //////////////////////////////////////////////
+//
+// Check of the regularized collisions
+// (calcOmegaRegularized and
+// calcOmegaRecursiveRegularized in LBcollision.h) in
+// 2d (D2Q9) and 3d (D3Q19).
+//
+// A distribution is made from the second order
+// equilibrium, a second order Hermite non-equilibrium
+// part and the first order Guo force correction, so
+// that it is its own Hermite projection. Its
+// regularized collision, with calcDeltaOmegaF, must
+// then be the BGK collision to round off. Ghost
+// moments (third and fourth order Hermite terms, which
+// do not change the density, the velocity or the
+// strain rate) added to the distribution must be
+// removed by the regularized collision, while the BGK
+// collision keeps them. Without a force, and with the
+// non-equilibrium part scaled by Ma^2, the recursive
+// regularized collision must match the plain one to
+// second order in the Mach number, so that the
+// difference is of third order when Ma is halved.
+//
+// //////////////////////////////////////////////
+
+#include <LBSOLVER.h>
+#include "LBcheck.h"
+
+
+template <typename LT>
+std::valarray<lbBase_t> hermiteDistribution(const lbBase_t rho, const std::valarray<lbBase_t> &u, const lbBase_t scaleA, const std::valarray<lbBase_t> &force)
+/* hermiteDistribution : feq(rho, u) + w/(2c^4) (cc - c^2 I):A - w/(2c^2) c.F, where A is a
+ *  fixed symmetric matrix times scaleA. Its velocity with the Guo correction is u.
+ */
+{
+    std::valarray<lbBase_t> A(LT::nD*LT::nD);
+    for (int i = 0; i < LT::nD; ++i)
+        for (int j = 0; j < LT::nD; ++j)
+            A[i*LT::nD + j] = scaleA*((i == j) ? 1.0 + 0.5*i : 0.3/(1.0 + i + j));
+    const std::valarray<lbBase_t> cu = LT::cDotAll(u);
+    const std::valarray<lbBase_t> cF = LT::cDotAll(force);
+    const lbBase_t u2 = LT::dot(u, u);
+    std::valarray<lbBase_t> ret(LT::nQ);
+    for (int q = 0; q < LT::nQ; ++q) {
+        lbBase_t H2A = 0;
+        for (int i = 0; i < LT::nD; ++i)
+            for (int j = 0; j < LT::nD; ++j)
+                H2A += (LT::c(q, i)*LT::c(q, j) - ((i == j) ? LT::c2 : 0.0))*A[i*LT::nD + j];
+        ret[q] = LT::w[q]*(rho*(1.0 + LT::c2Inv*cu[q] + LT::c4Inv0_5*(cu[q]*cu[q] - LT::c2*u2)) + LT::c4Inv0_5*H2A - 0.5*LT::c2Inv*cF[q]);
+    }
+    return ret;
+}
+
+
+template <typename LT>
+std::valarray<lbBase_t> ghostDistribution()
+/* ghostDistribution : w times a sum of the Hermite polynomials c_i^2 c_j - c^2 c_j (i != j)
+ *  and, in 2d, (c_x^2 - c^2)(c_y^2 - c^2), which are orthogonal to the moments up to
+ *  second order on the lattice
+ */
+{
+    std::valarray<lbBase_t> ret(0.0, LT::nQ);
+    for (int q = 0; q < LT::nQ; ++q) {
+        int it = 0;
+        for (int i = 0; i < LT::nD; ++i)
+            for (int j = 0; j < LT::nD; ++j)
+                if (i != j)
+                    ret[q] += 1e-3*(1.0 + 0.7*it++)*LT::w[q]*(LT::c(q, i)*LT::c(q, i) - LT::c2)*LT::c(q, j);
+        if (LT::nD == 2)
+            ret[q] += 2e-3*LT::w[q]*(LT::c(q, 0)*LT::c(q, 0) - LT::c2)*(LT::c(q, 1)*LT::c(q, 1) - LT::c2);
+    }
+    return ret;
+}
+
+
+template <typename LT>
+std::valarray<lbBase_t> collide(const std::string &scheme, const std::valarray<lbBase_t> &f, const lbBase_t tau, const std::valarray<lbBase_t> &force)
+/* collide : post collision distribution, f + omega + deltaOmegaF, of the BGK ("bgk"),
+ *  regularized ("regularized") or recursive regularized ("recursive") collision
+ */
+{
+    const lbBase_t rho = calcRho<LT>(f);
+    const std::valarray<lbBase_t> vel = calcVel<LT>(f, rho, force);
+    const lbBase_t u2 = LT::dot(vel, vel);
+    const std::valarray<lbBase_t> cu = LT::cDotAll(vel);
+    const lbBase_t uF = LT::dot(vel, force);
+    const std::valarray<lbBase_t> cF = LT::cDotAll(force);
+    const std::valarray<lbBase_t> strainRate = calcStrainRateTildeLowTri<LT>(f, rho, vel, force, 0.0);
+    std::valarray<lbBase_t> omega;
+    if (scheme == "bgk")
+        omega = calcOmegaBGK<LT>(f, tau, rho, u2, cu);
+    else if (scheme == "regularized")
+        omega = calcOmegaRegularized<LT>(f, tau, rho, u2, cu, uF, cF, strainRate);
+    else
+        omega = calcOmegaRecursiveRegularized<LT>(f, tau, rho, vel, u2, cu, uF, cF, strainRate);
+    return f + omega + calcDeltaOmegaF<LT>(tau, cu, uF, cF);
+}
+
+
+template <typename LT>
+void checkLattice(Check &check)
+{
+    const std::string in = " in " + std::to_string(LT::nD) + "d";
+    const lbBase_t tau = 0.7;
+    const lbBase_t rho = 1.05;
+    std::valarray<lbBase_t> u(LT::nD), force(LT::nD);
+    for (int d = 0; d < LT::nD; ++d) {
+        u[d] = 0.04 - 0.03*d;
+        force[d] = 1e-4*(1 + d);
+    }
+
+    // A Hermite projected distribution
+    const std::valarray<lbBase_t> f = hermiteDistribution<LT>(rho, u, 1e-3, force);
+    const std::valarray<lbBase_t> vel = calcVel<LT>(f, calcRho<LT>(f), force);
+    check.near(std::abs(vel - u).max(), 0.0, 1e-14, "velocity of the Hermite distribution" + in);
+    const std::valarray<lbBase_t> fBGK = collide<LT>("bgk", f, tau, force);
+    const std::valarray<lbBase_t> fReg = collide<LT>("regularized", f, tau, force);
+    check.near(std::abs(fReg - fBGK).max(), 0.0, 1e-14, "largest difference of the regularized and the BGK collision of a Hermite distribution" + in);
+
+    // Ghost moments
+    const std::valarray<lbBase_t> g = ghostDistribution<LT>();
+    check.near(std::abs(calcStrainRateTildeLowTri<LT>(f + g, rho, u, force, 0.0) - calcStrainRateTildeLowTri<LT>(f, rho, u, force, 0.0)).max(), 0.0, 1e-14,
+               "strain rate of the ghost moments" + in);
+    check.near(std::abs(calcVel<LT>(f + g, calcRho<LT>(f + g), force) - u).max(), 0.0, 1e-14, "velocity of the distribution with ghost moments" + in);
+    for (const std::string scheme: {"regularized", "recursive"})
+        check.near(std::abs(collide<LT>(scheme, f + g, tau, force) - collide<LT>(scheme, f, tau, force)).max(), 0.0, 1e-14,
+                   "ghost moments after the " + scheme + " collision" + in);
+    check.near(std::abs(collide<LT>("bgk", f + g, tau, force) - fBGK - (1 - 1/tau)*g).max(), 0.0, 1e-14, "ghost moments after the BGK collision" + in);
+    check.require(std::abs(g).max() > 1e-4, "ghost moments of the distribution" + in);
+
+    // Recursive and plain regularization at low Mach numbers
+    const std::valarray<lbBase_t> zero(0.0, LT::nD);
+    lbBase_t diff[2];
+    for (int n = 0; n < 2; ++n) {
+        const lbBase_t Ma = 0.1/(1 << n);
+        const std::valarray<lbBase_t> fMa = hermiteDistribution<LT>(rho, (Ma/0.04)*u, Ma*Ma, zero);
+        diff[n] = std::abs(collide<LT>("recursive", fMa, tau, zero) - collide<LT>("regularized", fMa, tau, zero)).max();
+    }
+    check.require(diff[0] > 0, "recursive terms at Ma = 0.1" + in);
+    check.near(std::log2(diff[0]/diff[1]), 3.0, 0.1, "order in Ma of the difference of the recursive and plain regularized collision" + in);
+}
+
+
+int main(int argc, char *argv[])
+{
+    MPI_Init(&argc, &argv);
+    int myRank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &myRank);
+    Check check("check_regularized", myRank);
+
+    checkLattice<D2Q9>(check);
+    checkLattice<D3Q19>(check);
+
+    const int ret = check.result();
+    MPI_Finalize();
+    return ret;
+}
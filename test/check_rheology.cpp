@@ -0,0 +1,114 @@
+// //////////////////////////////////////////////
+//
+// Check of the moment space collision of the
+// rheology models (LBrheology.h) in 2d (D2Q9) and 3d
+// (D3Q19).
+//
+// With the bulk and ghost relaxation times equal to
+// the shear relaxation time the MRT collision is a BGK
+// collision. For a distribution off equilibrium and a
+// body force, omega(collision, ...) of Newtonian and of
+// GeneralizedNewtonian (a shear thinning table written
+// by the check) must then give omegaBGK plus the Guo
+// force term (calcDeltaOmegaF) to round off, and the
+// relaxation time, viscosity and strain rate must be
+// the same as after omegaBGK.
+//
+// //////////////////////////////////////////////
+
+#include <LBSOLVER.h>
+#include "LBcheck.h"
+
+
+template <typename LT>
+void nodeValues(std::valarray<lbBase_t> &f, lbBase_t &rho, std::valarray<lbBase_t> &vel, std::valarray<lbBase_t> &force)
+/* nodeValues : a distribution with a non-equilibrium part, its density, its velocity
+ *  (with the Guo correction) and the body force
+ */
+{
+    force.resize(LT::nD);
+    for (int d = 0; d < LT::nD; ++d)
+        force[d] = 1e-4*(d + 1);
+    std::valarray<lbBase_t> u(LT::nD);
+    for (int d = 0; d < LT::nD; ++d)
+        u[d] = 0.02 - 0.015*d;
+    const std::valarray<lbBase_t> cu = LT::cDotAll(u);
+    const lbBase_t u2 = LT::dot(u, u);
+    f.resize(LT::nQ);
+    for (int q = 0; q < LT::nQ; ++q)
+        f[q] = LT::w[q]*1.1*(1.0 + LT::c2Inv*cu[q] + LT::c4Inv0_5*(cu[q]*cu[q] - LT::c2*u2)) + 1e-3*LT::w[q]*std::sin(1.0 + 2.3*q);
+    rho = calcRho<LT>(f);
+    vel = calcVel<LT>(f, rho, force);
+}
+
+
+template <typename LT, typename R, typename... TauIn>
+void checkModel(R &model, const std::string &name, Check &check, const TauIn&... tauIn)
+/* checkModel : compares omega with a BGK MRT collision with omegaBGK + calcDeltaOmegaF.
+ *  tauIn is the relaxation time argument of Newtonian, and empty for GeneralizedNewtonian.
+ */
+{
+    std::valarray<lbBase_t> f, vel, force;
+    lbBase_t rho;
+    nodeValues<LT>(f, rho, vel, force);
+    const lbBase_t u2 = LT::dot(vel, vel);
+    const std::valarray<lbBase_t> cu = LT::cDotAll(vel);
+    const lbBase_t source = 0.0;
+
+    const std::valarray<lbBase_t> omegaBGK = model.omegaBGK(tauIn..., f, rho, vel, u2, cu, force, source);
+    const lbBase_t tau = model.tau();
+    const lbBase_t viscosity = model.viscosity();
+    const lbBase_t gammaDot = model.gammaDot();
+    const std::valarray<lbBase_t> omegaRef = omegaBGK + calcDeltaOmegaF<LT>(tau, cu, LT::dot(vel, force), LT::cDotAll(force));
+
+    const MRTCollision<LT> bgk(tau, tau);
+    const std::array<lbBase_t, LT::nQ> omega = model.omega(bgk, tauIn..., f, rho, vel, u2, cu, force, source);
+    lbBase_t diff = 0;
+    for (int q = 0; q < LT::nQ; ++q)
+        diff = std::max(diff, std::abs(omega[q] - omegaRef[q]));
+    const std::string what = name + " in " + std::to_string(LT::nD) + "d";
+    check.near(diff/std::abs(omegaRef).max(), 0.0, 1e-12, "largest difference of omega and omegaBGK + deltaOmegaF relative to the largest value, " + what);
+    check.require(std::abs(omegaBGK).max() > 1e-4, "distribution off equilibrium, " + what);
+    check.require(model.tau() == tau, "tau of omega and omegaBGK, " + what);
+    check.require(model.viscosity() == viscosity, "viscosity of omega and omegaBGK, " + what);
+    check.require(model.gammaDot() == gammaDot, "strain rate of omega and omegaBGK, " + what);
+}
+
+
+template <typename LT>
+void checkLattice(const std::string &tableName, Check &check)
+{
+    Newtonian<LT> newtonian(0.8);
+    checkModel<LT>(newtonian, "Newtonian", check, 0.8);
+    GeneralizedNewtonian<LT> generalized(tableName);
+    checkModel<LT>(generalized, "GeneralizedNewtonian", check);
+    check.require((generalized.tau() > 0.5) && (generalized.tau() < 2.0), "tau from the table in " + std::to_string(LT::nD) + "d");
+}
+
+
+int main(int argc, char *argv[])
+{
+    MPI_Init(&argc, &argv);
+    int myRank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &myRank);
+    Check check("check_rheology", myRank);
+
+    // Shear thinning viscosity table, mu = 0.1/(1 + 100 gamma)
+    const std::string tableName = "check_rheology.dat";
+    {
+        std::ofstream ofs(tableName);
+        const int tableLength = 200;
+        ofs << tableLength << "\n" << std::setprecision(17);
+        for (int i = 0; i < tableLength; ++i) {
+            const lbBase_t gamma = 1e-4*i;
+            ofs << gamma << " " << 0.1/(1 + 100*gamma) << "\n";
+        }
+    }
+
+    checkLattice<D2Q9>(tableName, check);
+    checkLattice<D3Q19>(tableName, check);
+
+    const int ret = check.result();
+    MPI_Finalize();
+    return ret;
+}
@@ -0,0 +1,75 @@
+// //////////////////////////////////////////////
+//
+// Check of the six degrees of freedom integrator
+// (LBrigidbody.h).
+//
+// Under a constant torque about an axis that stays
+// fixed, the rotation angle is
+//     theta(t) = w0 t + 0.5 (tau/I) t^2,
+// and the quaternion is (cos(theta/2), sin(theta/2) n).
+// Two cases are run for 200 steps of 4 sub-steps:
+// a spherical body with the torque along (1, 2, 2)/3,
+// and a body with the principal moments (1, 2, 3)
+// spinning and torqued about its z axis, so that the
+// gyroscopic term is zero. The angular velocity is
+// linear in time, so RK4 and the mean velocity rotation
+// are exact up to round off. A constant force must give
+// x(t) = x0 + 0.5 (F/m) t^2. The body is integrated
+// on every rank, and the check is run on 1 and 2 ranks.
+//
+// //////////////////////////////////////////////
+
+#include <LBSOLVER.h>
+#include "LBcheck.h"
+
+
+lbBase_t quaternionError(const RigidBody &body, const std::valarray<lbBase_t> &axis, const lbBase_t theta)
+/* quaternionError : largest difference from the rotation by theta about the unit axis */
+{
+    const std::valarray<lbBase_t> exact = {std::cos(0.5*theta), std::sin(0.5*theta)*axis[0], std::sin(0.5*theta)*axis[1], std::sin(0.5*theta)*axis[2]};
+    return std::abs(body.quaternion() - exact).max();
+}
+
+
+int main(int argc, char *argv[])
+{
+    MPI_Init(&argc, &argv);
+    int myRank, nProcs;
+    MPI_Comm_rank(MPI_COMM_WORLD, &myRank);
+    MPI_Comm_size(MPI_COMM_WORLD, &nProcs);
+    Check check("check_rigid_body", myRank);
+
+    const int nSteps = 200;
+    const int nSubSteps = 4;
+    const lbBase_t tauNorm = 1e-4;
+
+    // Spherical body, torque along a general axis, and a constant force
+    const std::valarray<lbBase_t> axis = {1.0/3.0, 2.0/3.0, 2.0/3.0};
+    const std::valarray<lbBase_t> force = {1e-3, -2e-3, 5e-4};
+    RigidBody sphere(4.0, {2.0, 2.0, 2.0}, {10.0, 20.0, 30.0});
+    for (int i = 0; i < nSteps; ++i)
+        sphere.step(force, tauNorm*axis, 1.0, nSubSteps);
+    const lbBase_t t = nSteps;
+    check.near(quaternionError(sphere, axis, 0.5*tauNorm/2.0*t*t), 0.0, 1e-12, "quaternion error of the spherical body");
+    check.near(std::abs(sphere.omegaWorld() - tauNorm/2.0*t*axis).max(), 0.0, 1e-14, "angular velocity error of the spherical body");
+    const std::valarray<lbBase_t> x0 = {10.0, 20.0, 30.0};
+    check.near(std::abs(sphere.position() - x0 - 0.5*force/4.0*t*t).max(), 0.0, 1e-10, "position error of the spherical body");
+    check.near(std::abs(sphere.velocity() - force/4.0*t).max(), 0.0, 1e-14, "velocity error of the spherical body");
+
+    // Spinning body torqued about a principal axis
+    const lbBase_t w0 = 0.01;
+    const std::valarray<lbBase_t> zAxis = {0.0, 0.0, 1.0};
+    RigidBody top(1.0, {1.0, 2.0, 3.0}, {0.0, 0.0, 0.0});
+    top.setOmegaWorld(w0*zAxis);
+    for (int i = 0; i < nSteps; ++i)
+        top.step(std::valarray<lbBase_t>(0.0, 3), tauNorm*zAxis, 1.0, nSubSteps);
+    check.near(quaternionError(top, zAxis, w0*t + 0.5*tauNorm/3.0*t*t), 0.0, 1e-12, "quaternion error of the spinning body");
+
+    // The quaternion rotates body frame vectors into the world frame
+    const std::valarray<lbBase_t> v = {0.3, -0.2, 0.7};
+    check.near(std::abs(sphere.toBodyFrame(sphere.toWorldFrame(v)) - v).max(), 0.0, 1e-15, "body frame of the world frame vector");
+
+    const int ret = check.result();
+    MPI_Finalize();
+    return ret;
+}
@@ -0,0 +1,110 @@
+// //////////////////////////////////////////////
+//
+// Check of the one node subgrid boundary
+// (LBsubgridboundary.h).
+//
+// A D2Q9 channel of 8x12 nodes, periodic along x,
+// with walls a distance q = 0.3 from the fluid
+// boundary nodes. The distributions are set to the
+// Chapman-Enskog solution of a linear shear flow from
+// each wall, u_x = gamma d, with d the distance to the
+// nearest wall,
+//     f = w [rho + c.j/c^2 + H2:(rho uu + Pi1)/(2c^4)],
+//     Pi1_xy = -rho c^2 tau du_x/dy.
+// The known distributions of a boundary node then
+// fit the wall conditions, so apply(...) must
+// reconstruct the same distributions, and the shear
+// stress to round off (a reconstruction with half the
+// fitted off-diagonal Pi gives half of it). Only the
+// tangential strain rate condition, S_tt = 0, is not
+// met by rho u_x^2 in Pi, which gives distributions
+// off by 8e-4 of the non-equilibrium part.
+//
+// //////////////////////////////////////////////
+
+#include <LBSOLVER.h>
+#include <lbsolver/LBsubgridboundary.h>
+#include "LBcheck.h"
+
+typedef D2Q9 LT;
+
+
+int main(int argc, char *argv[])
+{
+    MPI_Init(&argc, &argv);
+    int myRank, nProcs;
+    MPI_Comm_rank(MPI_COMM_WORLD, &myRank);
+    MPI_Comm_size(MPI_COMM_WORLD, &nProcs);
+    Check check("check_subgrid_boundary", myRank);
+
+    const int ny = 12;
+    const lbBase_t q = 0.3;
+    const lbBase_t tau = 0.8;
+    const lbBase_t gamma = 1e-3;
+    const lbBase_t yLow = 1.0 - q, yHigh = ny - 2.0 + q;
+
+    GeometryGenerator<LT> generator({8, ny});
+    generator.addWalls(1);
+    LBvtk<LT> vtklb(std::istringstream(generator.vtklb(myRank, nProcs)));
+    Grid<LT> grid(vtklb);
+    Nodes<LT> nodes(vtklb, grid);
+    const std::vector<int> bulkNodes = findBulkNodes(nodes);
+    const std::vector<int> bndNodes = findFluidBndNodes(nodes);
+
+    // Wall distance, normal into the fluid and tangent of the nearest wall
+    ScalarField qDist(1, grid.size()), rho(1, grid.size());
+    VectorField<LT> normals(1, grid.size()), tangents(1, grid.size());
+    VectorField<LT> force(1, 1);
+    force.set(0, 0) = std::valarray<lbBase_t>(0.0, LT::nD);
+    for (int nodeNo = 1; nodeNo < grid.size(); ++nodeNo) {
+        const bool lower = grid.pos(nodeNo, 1) < 0.5*(yLow + yHigh);
+        qDist(0, nodeNo) = q;
+        rho(0, nodeNo) = 1.0;
+        normals.set(0, nodeNo) = std::valarray<lbBase_t>({0.0, lower ? 1.0 : -1.0});
+        tangents.set(0, nodeNo) = std::valarray<lbBase_t>({1.0, 0.0});
+    }
+    OneNodeSubGridBnd<LT> subGridBnd(bndNodes, nodes, grid, qDist, normals, tangents, rho, force, tau);
+
+    // Linear shear flow from each wall
+    LbField<LT> f(1, grid.size()), fExact(1, grid.size());
+    auto setShearFlow = [&](const int nodeNo) {
+        const lbBase_t y = grid.pos(nodeNo, 1);
+        const bool lower = y < 0.5*(yLow + yHigh);
+        const lbBase_t ux = gamma*(lower ? y - yLow : yHigh - y);
+        const lbBase_t Pi[3] = {ux*ux, -LT::c2*tau*(lower ? gamma : -gamma), 0.0};  // xx, xy, yy
+        for (int a = 0; a < LT::nQ; ++a) {
+            const lbBase_t cx = LT::c(a, 0), cy = LT::c(a, 1);
+            const lbBase_t H2Pi = (cx*cx - LT::c2)*Pi[0] + 2*cx*cy*Pi[1] + (cy*cy - LT::c2)*Pi[2];
+            f(0, a, nodeNo) = LT::w[a]*(1.0 + LT::c2Inv*cx*ux + LT::c4Inv0_5*H2Pi);
+            fExact(0, a, nodeNo) = f(0, a, nodeNo);
+        }
+    };
+    for (auto nodeNo: bulkNodes)
+        setShearFlow(nodeNo);
+    for (auto nodeNo: bndNodes)
+        setShearFlow(nodeNo);
+
+    subGridBnd.apply(0, f, nodes, grid);
+
+    lbBase_t diff[2] = {0, 0};  // Distributions and shear stress
+    for (auto nodeNo: bndNodes) {
+        lbBase_t PiXY = 0, PiXYExact = 0;
+        for (int a = 0; a < LT::nQ; ++a) {
+            diff[0] = std::max(diff[0], std::abs(f(0, a, nodeNo) - fExact(0, a, nodeNo)));
+            PiXY += f(0, a, nodeNo)*LT::c(a, 0)*LT::c(a, 1);
+            PiXYExact += fExact(0, a, nodeNo)*LT::c(a, 0)*LT::c(a, 1);
+        }
+        diff[1] = std::max(diff[1], std::abs(PiXY/PiXYExact - 1.0));
+    }
+    MPI_Allreduce(MPI_IN_PLACE, diff, 2, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+    const lbBase_t fNeq = LT::w[5]*LT::c4Inv*LT::c2*tau*gamma;  // Largest non-equilibrium part
+    check.near(diff[0]/fNeq, 0.0, 2e-3, "largest difference of the reconstructed and exact distributions relative to the non-equilibrium part");
+    check.near(diff[1], 0.0, 1e-10, "largest relative difference of the reconstructed and exact shear stress");
+    int numBndNodes = bndNodes.size();
+    MPI_Allreduce(MPI_IN_PLACE, &numBndNodes, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+    check.require(numBndNodes == 2*8, "two rows of boundary nodes");
+
+    const int ret = check.result();
+    MPI_Finalize();
+    return ret;
+}
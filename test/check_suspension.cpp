@@ -0,0 +1,162 @@
+// //////////////////////////////////////////////
+//
+// Check of the particle suspension
+// (LBsuspension.h).
+//
+// The pair force hooks are called for two approaching
+// spheres, first overlapping and then with a small gap:
+// softSphereContact and lubricationForce must give
+// equal and opposite forces, a contact force that
+// pushes the spheres apart and a lubrication force that
+// resists the approach, both as given by their formulas.
+//
+// Then two disks of radius 3 in a periodic D2Q9 box of
+// 64x32 nodes are dragged by a uniform flow along x.
+// The light upstream disk (density 10) starts at
+// x = 27.5 and catches up with the heavy disk (density
+// 100) at x = 34.5. The lubrication and contact forces,
+// between an owned particle and a copy on two ranks,
+// push it back, and the disks then move together with
+// an overlap below 0.1. The light disk crosses the
+// rank boundary at x = 32 after about 1000 steps.
+// With densities below about 10, or a smaller gapMin,
+// the explicit pair forces make the velocities of the
+// disks oscillate and grow. The particle states must
+// be independent of the number of ranks up to the
+// order of the force sums (the reference file holds
+// the position and velocity of both disks for every
+// 50 steps).
+//
+// //////////////////////////////////////////////
+
+#include <LBSOLVER.h>
+#include "LBcheck.h"
+
+typedef D2Q9 LT;
+
+
+std::vector<lbBase_t> particleStates(const ParticleSuspension<LT> &suspension, const int numParticles)
+/* particleStates : position and velocity (x and y) of the particles, ordered by id,
+ *  on all ranks. Each particle is owned by one rank. Collective.
+ */
+{
+    std::vector<lbBase_t> ret(4*numParticles, 0.0);
+    for (int n = 0; n < suspension.numOwned(); ++n) {
+        const SuspensionParticle &p = suspension.particle(n);
+        for (int d = 0; d < 2; ++d) {
+            ret[4*p.id + d] = p.body.position()[d];
+            ret[4*p.id + 2 + d] = p.body.velocity()[d];
+        }
+    }
+    MPI_Allreduce(MPI_IN_PLACE, ret.data(), 4*numParticles, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+    return ret;
+}
+
+
+int main(int argc, char *argv[])
+{
+    MPI_Init(&argc, &argv);
+    int myRank, nProcs;
+    MPI_Comm_rank(MPI_COMM_WORLD, &myRank);
+    MPI_Comm_size(MPI_COMM_WORLD, &nProcs);
+    Check check("check_suspension", myRank);
+
+    const lbBase_t pi = 3.14159265358979323846;
+    const lbBase_t tau = 0.8;
+    const lbBase_t viscosity = LT::c2*(tau - 0.5);
+    const SuspensionPairForce contact = softSphereContact(50.0);
+    const SuspensionPairForce lubrication = lubricationForce(viscosity, 1.0, 0.05);
+
+    // Pair forces of two approaching spheres
+    RigidBody bodyA(10.0, {1.0, 1.0, 1.0}, {10.0, 10.0, 10.0});
+    RigidBody bodyB(20.0, {1.0, 1.0, 1.0}, {13.0, 12.0, 10.0});
+    bodyA.setVelocity({0.01, 0.005, 0.0});
+    bodyB.setVelocity({-0.02, -0.01, 0.0});
+    const SuspensionParticle a(0, 1.9, bodyA), b(1, 1.8, bodyB);
+    const std::valarray<lbBase_t> dX = a.body.position() - b.body.position();
+    const lbBase_t dist = std::sqrt((dX*dX).sum());
+    const std::valarray<lbBase_t> n = dX/dist;
+    const lbBase_t un = ((a.body.velocity() - b.body.velocity())*n).sum();
+    check.require(un < 0, "the spheres approach");
+    check.require(dist < 3.7, "the spheres overlap");
+
+    const std::valarray<lbBase_t> contactAB = contact(a, b);
+    check.near(std::abs(contactAB + contact(b, a)).max(), 0.0, 0.0, "sum of the contact forces on the two spheres");
+    check.near(std::abs(contactAB - 50.0*std::pow(3.7 - dist, 1.5)*n).max(), 0.0, 1e-15, "contact force from the formula");
+    check.require((contactAB*n).sum() > 0, "contact force pushes the spheres apart");
+
+    const SuspensionParticle aSmall(0, 1.5, bodyA), bSmall(1, 1.6, bodyB);
+    const lbBase_t gapSmall = dist - 3.1;
+    check.require((gapSmall > 0) && (gapSmall < 1.0), "gap inside the lubrication cutoff");
+    const std::valarray<lbBase_t> lubricationAB = lubrication(aSmall, bSmall);
+    const lbBase_t rEff = 1.5*1.6/3.1;
+    const std::valarray<lbBase_t> lubricationExact = -6*pi*viscosity*rEff*rEff*un*(1.0/gapSmall - 1.0)*n;
+    check.near(std::abs(lubricationAB + lubrication(bSmall, aSmall)).max(), 0.0, 0.0, "sum of the lubrication forces on the two spheres");
+    check.near(std::abs(lubricationAB - lubricationExact).max(), 0.0, 1e-15, "lubrication force from the formula");
+    check.require((lubricationAB*n).sum() > 0, "lubrication force resists the approach");
+    check.near(std::abs(contact(aSmall, bSmall)).max(), 0.0, 0.0, "contact force with a gap");
+
+    // Two disks dragged by a uniform flow
+    GeometryGenerator<LT> generator({64, 32});
+    LBvtk<LT> vtklb(std::istringstream(generator.vtklb(myRank, nProcs)));
+    Grid<LT> grid(vtklb);
+    Nodes<LT> nodes(vtklb, grid);
+    BndMpi<LT> mpiBoundary(vtklb, nodes, grid);
+    const std::vector<int> bulkNodes = findBulkNodes(nodes);
+
+    ParticleSuspension<LT> suspension(mpiBoundary, nodes, grid, 4);
+    suspension.setFreedom({1.0, 1.0, 0.0}, {0.0, 0.0, 1.0});
+    suspension.addPairForce(contact);
+    suspension.addPairForce(lubrication);
+    suspension.addParticle(0, 3.0, 300.0, {1350.0, 1350.0, 1350.0}, {27.5, 16.0, 0.0}, nodes, grid);
+    suspension.addParticle(1, 3.0, 3000.0, {13500.0, 13500.0, 13500.0}, {34.5, 16.0, 0.0}, nodes, grid);
+
+    const lbBase_t u[2] = {0.02, 0.0};
+    LbField<LT> f(1, grid.size()), fTmp(1, grid.size());
+    ScalarField rho(1, grid.size());
+    for (auto nodeNo: bulkNodes)
+        for (int q = 0; q < LT::nQ; ++q)
+            f(0, q, nodeNo) = LT::w[q]*(1.0 + LT::c2Inv*LT::cDot(q, u) + LT::c4Inv0_5*(std::pow(LT::cDot(q, u), 2) - LT::c2*u[0]*u[0]));
+
+    const int nSteps = 1200;
+    std::vector<lbBase_t> states;
+    int numGlobal = 2;
+    lbBase_t minGap = 1.0, minVel = 0.0;  // Of the light disk
+    for (int i = 0; i < nSteps; ++i) {
+        for (auto nodeNo: bulkNodes) {
+            const std::valarray<lbBase_t> fNode = f(0, nodeNo);
+            const lbBase_t rhoNode = calcRho<LT>(fNode);
+            rho(0, nodeNo) = rhoNode;
+            const std::valarray<lbBase_t> velNode = calcVel<LT>(fNode, rhoNode);
+            const std::valarray<lbBase_t> omegaBGK = calcOmegaBGK<LT>(fNode, tau, rhoNode, LT::dot(velNode, velNode), LT::cDotAll(velNode));
+            fTmp.propagateTo(0, nodeNo, fNode + omegaBGK, grid);
+        }
+        f.swapData(fTmp);
+        mpiBoundary.communicateLbField(f, grid);
+        mpiBoundary.communciateScalarField(rho);
+
+        suspension.update(nodes, grid);
+        suspension.apply(0, f, grid);
+        suspension.refill(0, f, rho, nodes, grid);
+        suspension.step(nodes, grid);
+        numGlobal = std::min(numGlobal, suspension.numGlobal());
+        const std::vector<lbBase_t> state = particleStates(suspension, 2);
+        minGap = std::min(minGap, state[4] - state[0] - 6.0);
+        minVel = std::min(minVel, state[2]);
+        if ((i + 1) % 50 == 0)
+            states.insert(states.end(), state.begin(), state.end());
+    }
+
+    const std::vector<lbBase_t> state = particleStates(suspension, 2);
+    check.require(numGlobal == 2, "two particles in every step");
+    check.require((state[0] > 32.0) && (state[0] < 64.0 - 3.0), "the light disk crossed x = 32");
+    check.require(minVel < 0, "the light disk is pushed back");
+    check.require((minGap < 0) && (minGap > -0.1), "the contact force limits the overlap of the disks");
+    check.near(state[1], 16.0, 1e-10, "light disk on the axis");
+
+    checkReference(argc, argv, states, 1e-12, check);
+
+    const int ret = check.result();
+    MPI_Finalize();
+    return ret;
+}
@@ -0,0 +1,69 @@
+// //////////////////////////////////////////////
+//
+// Check of the tabulated law of the wall
+// (LBwallfunction.h).
+//
+// For the spalding and log laws, and y+ from the
+// viscous sublayer to beyond the end of the table
+// (Re_y = 1e6, y+ about 4e4), the exact u+ is found by
+// Newton iterations on y+(u+) = y+. WallLaw::uPlus,
+// with the local Reynolds number Re_y = u+ y+, must
+// give the same u+: to the interpolation error in the
+// table (measured up to 7e-5 relative, near y+ = 8),
+// exactly for the linear part of the log law, and to
+// round off above the table, where uPlus uses Newton
+// iterations. frictionVelocity must give the
+// friction velocity of a sampled velocity and wall
+// distance.
+//
+// //////////////////////////////////////////////
+
+#include <LBSOLVER.h>
+#include "LBcheck.h"
+
+
+lbBase_t newtonUPlus(const WallLaw &law, const lbBase_t yPlus)
+/* newtonUPlus : u+ with y+(u+) = yPlus, by Newton iterations started to the right of the
+ *  root, where y+(u+) is convex.
+ */
+{
+    lbBase_t ret = std::min(yPlus, std::log(law.E()*yPlus)/law.kappa() + 1.0);
+    for (int n = 0; n < 100; ++n)
+        ret -= (law.yPlus(ret) - yPlus)/law.dYPlus(ret);
+    return ret;
+}
+
+
+int main(int argc, char *argv[])
+{
+    MPI_Init(&argc, &argv);
+    int myRank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &myRank);
+    Check check("check_wall_function", myRank);
+
+    const lbBase_t viscosity = 1e-3;
+    const std::vector<lbBase_t> yPlusValues = {0.1, 0.5, 1.0, 2.0, 5.0, 8.0, 11.0, 15.0, 30.0, 100.0, 300.0, 1e3, 1e4, 3e4, 1e5, 1e6};
+    for (const std::string name: {"spalding", "loglaw"}) {
+        const WallLaw law(name, viscosity);
+        for (const auto &yPlus: yPlusValues) {
+            const std::string at = " at y+ = " + std::to_string(yPlus);
+            const lbBase_t uPlus = newtonUPlus(law, yPlus);
+            check.near(law.yPlus(uPlus)/yPlus, 1.0, 1e-14, name + " Newton solution" + at);
+            const lbBase_t Re = uPlus*yPlus;
+            const lbBase_t tolerance = (Re < 1e6) ? 1e-4 : 1e-12;  // Interpolation in the table, Newton above it
+            check.near(law.uPlus(Re)/uPlus, 1.0, tolerance, name + " u+ relative to the Newton solution" + at);
+            if ((name == "loglaw") && (uPlus == yPlus))
+                check.near(law.uPlus(Re), uPlus, 1e-14*uPlus, "loglaw u+ in the viscous sublayer" + at);
+        }
+
+        // Friction velocity 0.01 at the wall distance 1.5, y+ = 15
+        const lbBase_t uTau = 0.01;
+        const lbBase_t y = 1.5;
+        const lbBase_t u = uTau*newtonUPlus(law, y*uTau/viscosity);
+        check.near(law.frictionVelocity(u, y)/uTau, 1.0, 1e-4, name + " friction velocity relative to the exact value");
+    }
+
+    const int ret = check.result();
+    MPI_Finalize();
+    return ret;
+}
@@ -1,15 +1,16 @@
 #include <iostream>
+#include <chrono>
 
 
 //
 // Basis directory
-//
-//      6   2   5
-//        \ | /
-//      3 - 0 - 1
-//        / | \
-//      7   4   8
-//
+/*
+        6   2   5
+          \ | /
+        3 - 0 - 1
+          / | \
+        7   4   8
+*/
 //
 //  Compile with :
 //                 g++ -std=c++11 -O3 mainfast.cpp
@@ -20,7 +21,9 @@
 
 
 // CONSTANTS
+#ifndef N_ITERATIONS
 #define N_ITERATIONS 1000
+#endif
 #define NX 250
 #define NY 100
 #define OMEGA 1.3
@@ -126,6 +129,7 @@ int main()
     }
 
     // MAIN LOOP
+    const auto tStart = std::chrono::steady_clock::now();
     for (int n = 0; n < N_ITERATIONS; n += 2) {
         // EVEN FUNCTION
         pos = 1 + DNY;
@@ -367,5 +371,10 @@ int main()
     pos = 1 + DNY;
     std::cout << VX[pos] << std::endl;
 
+    // Timing, comparable to the MLUPS of benchmarks/bench_lbm
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - tStart;
+    std::cout << "D2Q9 " << NX << " x " << NY << ", " << N_ITERATIONS << " steps: " << elapsed.count() << " s, "
+              << 1e-6*NX*NY*N_ITERATIONS/elapsed.count() << " MLUPS" << std::endl;
+
     return 0;
 }